@@ -29,6 +29,8 @@ LMS.mediaplayer = function () {
 	var _gainNode = _audioCtx.createGain();
 	var _playedDuration = 0;
 	var _lastStartPlaying = null;
+	var _prewarmDelay = 0;
+	var _prewarmRequested = false;
 
 	var _updateControls = function() {
 		if (_elems.audio.paused) {
@@ -163,8 +165,9 @@ LMS.mediaplayer = function () {
 		_gainNode.gain.value = Math.pow(10, (_settings.replayGain.preAmpGain + replayGain) / 20);
 	}
 
-	var init = function(root, defaultSettings) {
+	var init = function(root, defaultSettings, prewarmDelay) {
 		_root = root;
+		_prewarmDelay = prewarmDelay;
 
 		_elems.audio = document.getElementById("lms-mp-audio");
 		_elems.playpause = document.getElementById("lms-mp-playpause");
@@ -230,6 +233,14 @@ LMS.mediaplayer = function () {
 		_elems.audio.addEventListener("timeupdate", function() {
 			_elems.progress.style.width = "" + ((_offset + _elems.audio.currentTime) / _duration) * 100 + "%";
 			_elems.curtime.innerHTML = _durationToString(_offset + _elems.audio.currentTime);
+
+			// Let the server start transcoding the next track, if this one needed to be transcoded
+			if (_prewarmDelay > 0 && !_prewarmRequested
+				&& _getAudioMode() == Mode.Transcode
+				&& _duration - (_offset + _elems.audio.currentTime) <= _prewarmDelay) {
+				_prewarmRequested = true;
+				Wt.emit(_root, "playbackEndingSoon");
+			}
 		});
 
 		_elems.audio.addEventListener("ended", function() {
@@ -324,6 +335,7 @@ LMS.mediaplayer = function () {
 
 		_trackId = params.trackId;
 		_offset = 0;
+		_prewarmRequested = false;
 		_duration = params.duration;
 		_audioNativeSrc = params.nativeResource;
 		_audioTranscodeSrc = params.transcodeResource + "&bitrate=" + _settings.transcode.bitrate + "&format=" + _settings.transcode.format;
@@ -0,0 +1,496 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "ann/HnswIndex.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <istream>
+#include <ostream>
+#include <queue>
+
+namespace Ann
+{
+
+namespace
+{
+	constexpr char fileMagic[] {"LMSHNSW"};
+	constexpr std::uint32_t fileVersion {1};
+
+	struct CloserFirst
+	{
+		bool operator()(const HnswIndex::SearchResult& a, const HnswIndex::SearchResult& b) const { return a.distance > b.distance; }
+	};
+
+	struct FurtherFirst
+	{
+		bool operator()(const HnswIndex::SearchResult& a, const HnswIndex::SearchResult& b) const { return a.distance < b.distance; }
+	};
+
+	template <typename T>
+	void
+	writeValue(std::ostream& os, const T& value)
+	{
+		os.write(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+
+	template <typename T>
+	void
+	writeValues(std::ostream& os, const std::vector<T>& values)
+	{
+		writeValue<std::uint64_t>(os, values.size());
+		os.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+	}
+
+	template <typename T>
+	bool
+	readValue(std::istream& is, T& value)
+	{
+		is.read(reinterpret_cast<char*>(&value), sizeof(value));
+		return static_cast<bool>(is);
+	}
+
+	// number of bytes left to read, or max if the stream is not seekable
+	std::uint64_t
+	getRemainingSize(std::istream& is)
+	{
+		const std::istream::pos_type current {is.tellg()};
+		if (current == std::istream::pos_type {-1})
+			return std::numeric_limits<std::uint64_t>::max();
+
+		is.seekg(0, std::ios::end);
+		const std::istream::pos_type end {is.tellg()};
+		is.seekg(current);
+		if (!is || end == std::istream::pos_type {-1} || end < current)
+			return std::numeric_limits<std::uint64_t>::max();
+
+		return static_cast<std::uint64_t>(end - current);
+	}
+
+	template <typename T>
+	bool
+	readValues(std::istream& is, std::vector<T>& values, std::uint64_t maxSize)
+	{
+		std::uint64_t size;
+		if (!readValue(is, size) || size > maxSize)
+			return false;
+
+		// do not trust the size before allocating
+		if (size > getRemainingSize(is) / sizeof(T))
+			return false;
+
+		values.resize(size);
+		is.read(reinterpret_cast<char*>(values.data()), size * sizeof(T));
+		return static_cast<bool>(is);
+	}
+}
+
+HnswIndex::HnswIndex(std::size_t dimCount)
+: HnswIndex {dimCount, Settings {}}
+{
+}
+
+HnswIndex::HnswIndex(std::size_t dimCount, const Settings& settings)
+: _dimCount {dimCount}
+, _settings {settings}
+, _levelFactor {1. / std::log(static_cast<double>(std::max<std::size_t>(settings.maxLinkCount, 2)))}
+, _randGenerator {static_cast<std::mt19937::result_type>(dimCount)}
+{
+	if (_dimCount == 0)
+		throw Exception {"Bad dimension count"};
+	if (_settings.maxLinkCount < 2)
+		throw Exception {"Bad max link count"};
+
+	_settings.efConstruction = std::max(_settings.efConstruction, _settings.maxLinkCount);
+}
+
+Distance
+HnswIndex::computeDistance(const Value* a, const Value* b) const
+{
+	// several accumulators to help the compiler to vectorize
+	Distance res[4] {};
+
+	std::size_t i {};
+	for (; i + 4 <= _dimCount; i += 4)
+	{
+		for (std::size_t j {}; j < 4; ++j)
+		{
+			const Value diff {a[i + j] - b[i + j]};
+			res[j] += diff * diff;
+		}
+	}
+	for (; i < _dimCount; ++i)
+	{
+		const Value diff {a[i] - b[i]};
+		res[0] += diff * diff;
+	}
+
+	return (res[0] + res[1]) + (res[2] + res[3]);
+}
+
+std::size_t
+HnswIndex::getMaxLinkCount(std::size_t level) const
+{
+	return level == 0 ? _settings.maxLinkCount * 2 : _settings.maxLinkCount;
+}
+
+std::vector<NodeId>&
+HnswIndex::getLinks(NodeId id, std::size_t level)
+{
+	return _links[id][level];
+}
+
+const std::vector<NodeId>&
+HnswIndex::getLinks(NodeId id, std::size_t level) const
+{
+	return _links[id][level];
+}
+
+std::vector<Value>
+HnswIndex::getValues(NodeId id) const
+{
+	if (id >= getNodeCount())
+		throw Exception {"Bad node id"};
+
+	const Value* values {getNodeValues(id)};
+	return std::vector<Value>(values, values + _dimCount);
+}
+
+std::size_t
+HnswIndex::drawLevel()
+{
+	std::uniform_real_distribution<double> dist {0, 1};
+	const double level {std::floor(-std::log(1. - dist(_randGenerator)) * _levelFactor)};
+
+	return std::min<std::size_t>(static_cast<std::size_t>(level), std::numeric_limits<std::uint8_t>::max());
+}
+
+NodeId
+HnswIndex::add(const std::vector<Value>& values)
+{
+	if (values.size() != _dimCount)
+		throw Exception {"Bad dimension count"};
+	if (getNodeCount() >= std::numeric_limits<NodeId>::max())
+		throw Exception {"Too many nodes"};
+
+	const NodeId id {static_cast<NodeId>(getNodeCount())};
+	const std::size_t level {drawLevel()};
+
+	_values.insert(std::end(_values), std::cbegin(values), std::cend(values));
+	_levels.push_back(static_cast<std::uint8_t>(level));
+	_links.emplace_back(level + 1);
+
+	if (!_entryPoint)
+	{
+		_entryPoint = id;
+		_maxLevel = level;
+		return id;
+	}
+
+	const Value* query {getNodeValues(id)};
+
+	NodeId entryPoint {*_entryPoint};
+	for (std::size_t currentLevel {_maxLevel}; currentLevel > level; --currentLevel)
+		entryPoint = searchLayerGreedy(query, entryPoint, currentLevel);
+
+	std::vector<SearchResult> entryPoints {{entryPoint, computeDistance(query, getNodeValues(entryPoint))}};
+	for (std::size_t currentLevel {std::min(level, _maxLevel) + 1}; currentLevel-- > 0;)
+	{
+		std::vector<SearchResult> candidates {searchLayer(query, entryPoints, _settings.efConstruction, currentLevel)};
+
+		getLinks(id, currentLevel) = selectNeighbours(candidates, _settings.maxLinkCount);
+		for (NodeId neighbourId : getLinks(id, currentLevel))
+		{
+			std::vector<NodeId>& neighbourLinks {getLinks(neighbourId, currentLevel)};
+			neighbourLinks.push_back(id);
+			if (neighbourLinks.size() > getMaxLinkCount(currentLevel))
+				shrinkLinks(neighbourId, currentLevel);
+		}
+
+		entryPoints = std::move(candidates);
+	}
+
+	if (level > _maxLevel)
+	{
+		_maxLevel = level;
+		_entryPoint = id;
+	}
+
+	return id;
+}
+
+NodeId
+HnswIndex::searchLayerGreedy(const Value* query, NodeId entryPoint, std::size_t level) const
+{
+	NodeId current {entryPoint};
+	Distance currentDistance {computeDistance(query, getNodeValues(current))};
+
+	bool changed {true};
+	while (changed)
+	{
+		changed = false;
+		for (NodeId neighbourId : getLinks(current, level))
+		{
+			const Distance distance {computeDistance(query, getNodeValues(neighbourId))};
+			if (distance < currentDistance)
+			{
+				current = neighbourId;
+				currentDistance = distance;
+				changed = true;
+			}
+		}
+	}
+
+	return current;
+}
+
+std::vector<HnswIndex::SearchResult>
+HnswIndex::searchLayer(const Value* query, const std::vector<SearchResult>& entryPoints, std::size_t ef, std::size_t level) const
+{
+	// reuse the visited marks across searches: a node is visited if its mark equals the current epoch
+	struct VisitedMarks
+	{
+		std::vector<std::uint32_t>	marks;
+		std::uint32_t				epoch {};
+	};
+	thread_local VisitedMarks visitedMarks;
+
+	if (visitedMarks.marks.size() < getNodeCount())
+		visitedMarks.marks.resize(getNodeCount());
+	if (++visitedMarks.epoch == 0)
+	{
+		std::fill(std::begin(visitedMarks.marks), std::end(visitedMarks.marks), 0);
+		visitedMarks.epoch = 1;
+	}
+
+	const std::uint32_t epoch {visitedMarks.epoch};
+	std::vector<std::uint32_t>& visited {visitedMarks.marks};
+
+	std::priority_queue<SearchResult, std::vector<SearchResult>, CloserFirst> candidates;
+	std::priority_queue<SearchResult, std::vector<SearchResult>, FurtherFirst> results;
+
+	for (const SearchResult& entryPoint : entryPoints)
+	{
+		visited[entryPoint.id] = epoch;
+		candidates.push(entryPoint);
+		results.push(entryPoint);
+		if (results.size() > ef)
+			results.pop();
+	}
+
+	while (!candidates.empty())
+	{
+		const SearchResult candidate {candidates.top()};
+		if (results.size() >= ef && candidate.distance > results.top().distance)
+			break;
+
+		candidates.pop();
+
+		for (NodeId neighbourId : getLinks(candidate.id, level))
+		{
+			if (visited[neighbourId] == epoch)
+				continue;
+
+			visited[neighbourId] = epoch;
+
+			const Distance distance {computeDistance(query, getNodeValues(neighbourId))};
+			if (results.size() < ef || distance < results.top().distance)
+			{
+				candidates.push({neighbourId, distance});
+				results.push({neighbourId, distance});
+				if (results.size() > ef)
+					results.pop();
+			}
+		}
+	}
+
+	std::vector<SearchResult> res(results.size());
+	for (std::size_t i {res.size()}; i-- > 0;)
+	{
+		res[i] = results.top();
+		results.pop();
+	}
+
+	return res;
+}
+
+std::vector<NodeId>
+HnswIndex::selectNeighbours(const std::vector<SearchResult>& candidates, std::size_t maxCount) const
+{
+	// candidates are sorted by ascending distance
+	// Heuristic: only keep a candidate if it is closer to the base node than to any already selected node,
+	// so that links go in diverse directions
+	std::vector<NodeId> res;
+	res.reserve(maxCount);
+
+	for (const SearchResult& candidate : candidates)
+	{
+		if (res.size() == maxCount)
+			break;
+
+		const bool keep {std::none_of(std::cbegin(res), std::cend(res), [&](NodeId selectedId)
+		{
+			return computeDistance(getNodeValues(candidate.id), getNodeValues(selectedId)) < candidate.distance;
+		})};
+
+		if (keep)
+			res.push_back(candidate.id);
+	}
+
+	return res;
+}
+
+void
+HnswIndex::shrinkLinks(NodeId id, std::size_t level)
+{
+	std::vector<NodeId>& links {getLinks(id, level)};
+
+	std::vector<SearchResult> candidates;
+	candidates.reserve(links.size());
+	for (NodeId linkId : links)
+		candidates.push_back({linkId, computeDistance(getNodeValues(id), getNodeValues(linkId))});
+
+	std::sort(std::begin(candidates), std::end(candidates), [](const SearchResult& a, const SearchResult& b) { return a.distance < b.distance; });
+
+	links = selectNeighbours(candidates, getMaxLinkCount(level));
+}
+
+std::vector<HnswIndex::SearchResult>
+HnswIndex::search(const std::vector<Value>& query, std::size_t resultCount, std::size_t efSearch) const
+{
+	if (query.size() != _dimCount)
+		throw Exception {"Bad dimension count"};
+
+	if (!_entryPoint || resultCount == 0)
+		return {};
+
+	NodeId entryPoint {*_entryPoint};
+	for (std::size_t currentLevel {_maxLevel}; currentLevel > 0; --currentLevel)
+		entryPoint = searchLayerGreedy(query.data(), entryPoint, currentLevel);
+
+	std::vector<SearchResult> res {searchLayer(query.data(), {{entryPoint, computeDistance(query.data(), getNodeValues(entryPoint))}}, std::max(efSearch, resultCount), 0)};
+	if (res.size() > resultCount)
+		res.resize(resultCount);
+
+	return res;
+}
+
+std::vector<HnswIndex::SearchResult>
+HnswIndex::searchExact(const std::vector<Value>& query, std::size_t resultCount) const
+{
+	if (query.size() != _dimCount)
+		throw Exception {"Bad dimension count"};
+
+	std::vector<SearchResult> res;
+	res.reserve(getNodeCount());
+	for (NodeId id {}; id < getNodeCount(); ++id)
+		res.push_back({id, computeDistance(query.data(), getNodeValues(id))});
+
+	const auto itEnd {std::next(std::begin(res), std::min(resultCount, res.size()))};
+	std::partial_sort(std::begin(res), itEnd, std::end(res), [](const SearchResult& a, const SearchResult& b) { return a.distance < b.distance; });
+	res.erase(itEnd, std::end(res));
+
+	return res;
+}
+
+void
+HnswIndex::write(std::ostream& os) const
+{
+	os.write(fileMagic, sizeof(fileMagic));
+	writeValue(os, fileVersion);
+	writeValue<std::uint64_t>(os, _dimCount);
+	writeValue<std::uint64_t>(os, _settings.maxLinkCount);
+	writeValue<std::uint64_t>(os, _settings.efConstruction);
+	writeValue<std::uint64_t>(os, _maxLevel);
+	writeValue<NodeId>(os, _entryPoint.value_or(0));
+
+	writeValues(os, _values);
+	writeValues(os, _levels);
+	for (std::size_t id {}; id < getNodeCount(); ++id)
+	{
+		for (const std::vector<NodeId>& links : _links[id])
+			writeValues(os, links);
+	}
+}
+
+std::optional<HnswIndex>
+HnswIndex::read(std::istream& is)
+{
+	char magic[sizeof(fileMagic)];
+	is.read(magic, sizeof(magic));
+	if (!is || !std::equal(std::cbegin(magic), std::cend(magic), std::cbegin(fileMagic)))
+		return std::nullopt;
+
+	std::uint32_t version;
+	std::uint64_t dimCount, maxLinkCount, efConstruction, maxLevel;
+	NodeId entryPoint;
+	if (!readValue(is, version) || version != fileVersion
+		|| !readValue(is, dimCount) || !readValue(is, maxLinkCount) || !readValue(is, efConstruction)
+		|| !readValue(is, maxLevel) || !readValue(is, entryPoint))
+	{
+		return std::nullopt;
+	}
+
+	// levels are stored on 8 bits
+	if (dimCount == 0 || maxLinkCount < 2 || maxLevel > std::numeric_limits<std::uint8_t>::max())
+		return std::nullopt;
+
+	HnswIndex res {dimCount, Settings {maxLinkCount, efConstruction}};
+	res._maxLevel = maxLevel;
+
+	constexpr std::uint64_t maxNodeCount {std::numeric_limits<NodeId>::max()};
+	if (!readValues(is, res._values, maxNodeCount * dimCount)
+		|| !readValues(is, res._levels, maxNodeCount)
+		|| res._values.size() != res._levels.size() * dimCount)
+	{
+		return std::nullopt;
+	}
+
+	if (std::any_of(std::cbegin(res._levels), std::cend(res._levels), [&](std::uint8_t level) { return level > maxLevel; }))
+		return std::nullopt;
+
+	const std::size_t nodeCount {res.getNodeCount()};
+	res._links.resize(nodeCount);
+	for (std::size_t id {}; id < nodeCount; ++id)
+	{
+		res._links[id].resize(res._levels[id] + std::size_t {1});
+		for (std::vector<NodeId>& links : res._links[id])
+		{
+			if (!readValues(is, links, std::min<std::uint64_t>(res.getMaxLinkCount(0), nodeCount)))
+				return std::nullopt;
+
+			if (std::any_of(std::cbegin(links), std::cend(links), [&](NodeId linkId) { return linkId >= nodeCount; }))
+				return std::nullopt;
+		}
+	}
+
+	if (nodeCount > 0)
+	{
+		if (entryPoint >= nodeCount || res._levels[entryPoint] != maxLevel)
+			return std::nullopt;
+
+		res._entryPoint = entryPoint;
+	}
+
+	return res;
+}
+
+} // namespace Ann
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include "utils/Exception.hpp"
+
+namespace Ann
+{
+
+class Exception : public LmsException
+{
+	public:
+		using LmsException::LmsException;
+};
+
+using Value = float;
+using Distance = float;
+using NodeId = std::uint32_t;
+
+// Hierarchical Navigable Small World graph, see "Efficient and robust approximate
+// nearest neighbor search using Hierarchical Navigable Small World graphs" (Malkov, Yashunin)
+// Uses the squared euclidian distance
+// Not thread safe for insertions, concurrent searches are fine
+class HnswIndex
+{
+	public:
+		struct Settings
+		{
+			std::size_t maxLinkCount {16};		// "M", max links per node on upper layers (twice on layer 0)
+			std::size_t efConstruction {200};	// higher is better recall but slower build
+		};
+
+		HnswIndex(std::size_t dimCount);
+		HnswIndex(std::size_t dimCount, const Settings& settings);
+
+		std::size_t getDimCount() const { return _dimCount; }
+		std::size_t getNodeCount() const { return _levels.size(); }
+		const Settings& getSettings() const { return _settings; }
+
+		// returns the id of the new node (nodes are numbered in insertion order)
+		NodeId add(const std::vector<Value>& values);
+
+		struct SearchResult
+		{
+			NodeId id;
+			Distance distance;
+		};
+		// ordered by ascending distance
+		// efSearch is clamped to resultCount, higher means better recall but slower searches
+		std::vector<SearchResult> search(const std::vector<Value>& query, std::size_t resultCount, std::size_t efSearch) const;
+
+		// brute force search, mainly for testing/benchmark purposes
+		std::vector<SearchResult> searchExact(const std::vector<Value>& query, std::size_t resultCount) const;
+
+		std::vector<Value> getValues(NodeId id) const;
+
+		void write(std::ostream& os) const;
+		static std::optional<HnswIndex> read(std::istream& is);
+
+	private:
+		const Value* getNodeValues(NodeId id) const { return &_values[static_cast<std::size_t>(id) * _dimCount]; }
+		Distance computeDistance(const Value* a, const Value* b) const;
+		std::size_t getMaxLinkCount(std::size_t level) const;
+		std::vector<NodeId>& getLinks(NodeId id, std::size_t level);
+		const std::vector<NodeId>& getLinks(NodeId id, std::size_t level) const;
+
+		std::size_t drawLevel();
+		NodeId searchLayerGreedy(const Value* query, NodeId entryPoint, std::size_t level) const;
+		std::vector<SearchResult> searchLayer(const Value* query, const std::vector<SearchResult>& entryPoints, std::size_t ef, std::size_t level) const;
+		std::vector<NodeId> selectNeighbours(const std::vector<SearchResult>& candidates, std::size_t maxCount) const;
+		void shrinkLinks(NodeId id, std::size_t level);
+
+		std::size_t		_dimCount;
+		Settings		_settings;
+		double			_levelFactor;
+		std::mt19937	_randGenerator;
+
+		std::vector<Value>			_values;	// all node values, contiguous
+		std::vector<std::uint8_t>	_levels;	// top level of each node
+		std::vector<std::vector<std::vector<NodeId>>>	_links;	// per node, per level
+		std::optional<NodeId>		_entryPoint;
+		std::size_t					_maxLevel {};
+};
+
+} // namespace Ann
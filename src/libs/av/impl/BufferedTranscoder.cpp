@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "BufferedTranscoder.hpp"
+
+#include <algorithm>
+
+namespace Av
+{
+	BufferedTranscoder::BufferedTranscoder(std::unique_ptr<ITranscoder> transcoder, std::size_t maxBufferSize)
+		: _maxBufferSize {maxBufferSize}
+		, _transcoder {std::move(transcoder)}
+	{
+		_fillPending = true;
+		startFill();
+	}
+
+	std::size_t
+	BufferedTranscoder::getBufferedSize() const
+	{
+		std::scoped_lock lock {_mutex};
+		return _buffer.size();
+	}
+
+	void
+	BufferedTranscoder::startFill()
+	{
+		_transcoder->asyncRead(_fillBuffer.data(), _fillBuffer.size(), [this](std::size_t nbReadBytes)
+		{
+			onFillComplete(nbReadBytes);
+		});
+	}
+
+	void
+	BufferedTranscoder::onFillComplete(std::size_t nbReadBytes)
+	{
+		std::unique_lock lock {_mutex};
+
+		_buffer.insert(std::cend(_buffer), std::cbegin(_fillBuffer), std::next(std::cbegin(_fillBuffer), nbReadBytes));
+		_fillPending = false;
+
+		if (_pendingRead)
+		{
+			PendingRead pendingRead {std::move(*_pendingRead)};
+			_pendingRead.reset();
+
+			const std::size_t size {consumeBuffer(pendingRead.buffer, pendingRead.bufferSize)};
+			lock.unlock();
+
+			pendingRead.callback(size);
+			return;
+		}
+
+		if (!_readStarted && _buffer.size() < _maxBufferSize && !_transcoder->finished())
+		{
+			_fillPending = true;
+			lock.unlock();
+
+			startFill();
+		}
+	}
+
+	void
+	BufferedTranscoder::asyncRead(std::byte* buffer, std::size_t bufferSize, ReadCallback callback)
+	{
+		std::unique_lock lock {_mutex};
+
+		_readStarted = true;
+
+		if (!_buffer.empty())
+		{
+			const std::size_t size {consumeBuffer(buffer, bufferSize)};
+			lock.unlock();
+
+			callback(size);
+			return;
+		}
+
+		if (_fillPending)
+		{
+			_pendingRead = PendingRead {buffer, bufferSize, std::move(callback)};
+			return;
+		}
+
+		lock.unlock();
+
+		// Buffer fully consumed, now directly read the transcoder
+		_transcoder->asyncRead(buffer, bufferSize, std::move(callback));
+	}
+
+	bool
+	BufferedTranscoder::finished() const
+	{
+		std::scoped_lock lock {_mutex};
+		return _buffer.empty() && !_fillPending && _transcoder->finished();
+	}
+
+	std::size_t
+	BufferedTranscoder::consumeBuffer(std::byte* buffer, std::size_t bufferSize)
+	{
+		const std::size_t size {std::min(bufferSize, _buffer.size())};
+
+		std::copy(std::cbegin(_buffer), std::next(std::cbegin(_buffer), size), buffer);
+		_buffer.erase(std::cbegin(_buffer), std::next(std::cbegin(_buffer), size));
+
+		return size;
+	}
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <array>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "ITranscoder.hpp"
+
+namespace Av
+{
+	// Reads the output of a transcoder in background until it is first read or until the buffer is full
+	class BufferedTranscoder final : public ITranscoder
+	{
+		public:
+			BufferedTranscoder(std::unique_ptr<ITranscoder> transcoder, std::size_t maxBufferSize);
+			~BufferedTranscoder() override = default;
+
+			BufferedTranscoder(const BufferedTranscoder&) = delete;
+			BufferedTranscoder& operator=(const BufferedTranscoder&) = delete;
+			BufferedTranscoder(BufferedTranscoder&&) = delete;
+			BufferedTranscoder& operator=(BufferedTranscoder&&) = delete;
+
+			std::size_t getBufferedSize() const;
+
+		private:
+			void				asyncRead(std::byte* buffer, std::size_t bufferSize, ReadCallback) override;
+			const std::string&	getOutputMimeType() const override { return _transcoder->getOutputMimeType(); }
+			bool				finished() const override;
+			bool				succeeded() const override { return _transcoder->succeeded(); }
+
+			void		startFill();
+			void		onFillComplete(std::size_t nbReadBytes);
+			std::size_t	consumeBuffer(std::byte* buffer, std::size_t bufferSize);
+
+			struct PendingRead
+			{
+				std::byte*		buffer;
+				std::size_t		bufferSize;
+				ReadCallback	callback;
+			};
+
+			const std::size_t				_maxBufferSize;
+			mutable std::mutex				_mutex;
+			std::vector<std::byte>			_buffer;
+			std::array<std::byte, 32768>	_fillBuffer;
+			bool							_fillPending {};
+			bool							_readStarted {};
+			std::optional<PendingRead>		_pendingRead;	// waiting for the fill to complete
+			std::unique_ptr<ITranscoder>	_transcoder;	// destroyed first: no more callbacks
+	};
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "av/TranscodeParameters.hpp"
+
+namespace Av
+{
+	class ITranscoder
+	{
+		public:
+			virtual ~ITranscoder() = default;
+
+			// non blocking call, the callback is called from another thread
+			using ReadCallback = std::function<void(std::size_t nbReadBytes)>;
+			virtual void asyncRead(std::byte* buffer, std::size_t bufferSize, ReadCallback) = 0;
+
+			virtual const std::string& getOutputMimeType() const = 0;
+
+			virtual bool finished() const = 0;
+			// Once finished, tells whether the whole output has been produced
+			virtual bool succeeded() const = 0;
+	};
+
+	// Backend is selected using the "transcode-backend" config entry
+	std::unique_ptr<ITranscoder> createTranscoder(const std::filesystem::path& file, const TranscodeParameters& parameters);
+
+} // namespace Av
@@ -0,0 +1,681 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "LibavTranscoder.hpp"
+
+extern "C"
+{
+#define __STDC_CONSTANT_MACROS
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/audio_fifo.h>
+#include <libavutil/channel_layout.h>
+#include <libavutil/error.h>
+#include <libswresample/swresample.h>
+}
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <thread>
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/post.hpp>
+
+#include "av/Types.hpp"
+#include "utils/IConfig.hpp"
+#include "utils/IOContextRunner.hpp"
+#include "utils/Logger.hpp"
+#include "utils/Service.hpp"
+
+namespace Av {
+
+#define LOG(sev)	LMS_LOG(TRANSCODE, sev) << "[libav " << _id << "] - "
+
+namespace
+{
+	std::atomic<std::size_t>	globalId {};
+
+	// The AVIO write callback takes a const buffer since libavformat 61
+#if LIBAVFORMAT_VERSION_MAJOR >= 61
+	using AVIOWriteBuffer = const std::uint8_t*;
+#else
+	using AVIOWriteBuffer = std::uint8_t*;
+#endif
+
+	// Encoders without a fixed frame size are fed using frames of this size
+	constexpr int defaultFrameSize {1024};
+	constexpr std::size_t outputIOBufferSize {32768};
+
+	std::string averrorToString(int error)
+	{
+		std::array<char, 128> buf = {0};
+
+		if (av_strerror(error, buf.data(), buf.size()) == 0)
+			return &buf[0];
+		else
+			return "Unknown error";
+	}
+
+	class LibavTranscoderException : public Exception
+	{
+		public:
+			LibavTranscoderException(const std::string& msg, int avError)
+				: Exception {msg + ": " + averrorToString(avError)}
+			{}
+	};
+
+	boost::asio::io_service& getWorkerIOService()
+	{
+		// Shared by all the transcoders, the thread count bounds the CPU usage whatever the number of clients
+		static boost::asio::io_service ioService;
+		static IOContextRunner ioContextRunner {ioService, []
+		{
+			std::size_t threadCount {Service<IConfig>::get()->getULong("transcode-thread-count", 0)};
+			if (threadCount == 0)
+				threadCount = std::max<std::size_t>(std::thread::hardware_concurrency() / 2, 1);
+
+			LMS_LOG(TRANSCODE, INFO) << "Using " << threadCount << " thread(s) for in-process transcoding";
+			return threadCount;
+		}()};
+
+		return ioService;
+	}
+
+	struct OutputFormat
+	{
+		const char* muxerName;
+		const char* encoderName;
+	};
+
+	OutputFormat getOutputFormat(Format format)
+	{
+		switch (format)
+		{
+			case Format::MP3:			return {"mp3", "libmp3lame"};
+			case Format::OGG_OPUS:		return {"ogg", "libopus"};
+			case Format::MATROSKA_OPUS:	return {"matroska", "libopus"};
+			case Format::OGG_VORBIS:	return {"ogg", "libvorbis"};
+			case Format::WEBM_VORBIS:	return {"webm", "libvorbis"};
+			case Format::MPEGTS_AAC:	return {"mpegts", "aac"};
+		}
+
+		throw Exception {"Unhandled format (" + std::to_string(static_cast<int>(format)) + ")"};
+	}
+
+	int selectSampleRate(const AVCodec* encoder, int inputSampleRate)
+	{
+		if (!encoder->supported_samplerates)
+			return inputSampleRate;
+
+		int bestSampleRate {};
+		for (const int* sampleRate {encoder->supported_samplerates}; *sampleRate != 0; ++sampleRate)
+		{
+			if (*sampleRate == inputSampleRate)
+				return inputSampleRate;
+
+			bestSampleRate = std::max(bestSampleRate, *sampleRate);
+		}
+
+		return bestSampleRate;
+	}
+}
+
+LibavTranscoder::LibavTranscoder(const std::filesystem::path& filePath, const TranscodeParameters& parameters)
+: _id {globalId++}
+, _filePath {filePath}
+, _parameters {parameters}
+, _outputMimeType {formatToMimetype(parameters.format)}
+{
+	LOG(INFO) << "Transcoding file '" << _filePath.string() << "'";
+
+	try
+	{
+		openInput();
+		openOutput();
+	}
+	catch (const Exception& e)
+	{
+		LOG(ERROR) << "Cannot transcode file '" << _filePath.string() << "': " << e.what();
+		release();
+		throw;
+	}
+}
+
+LibavTranscoder::~LibavTranscoder()
+{
+	{
+		// Make sure no worker is still using this object
+		std::unique_lock lock {_mutex};
+		_cancelled = true;
+		_cv.wait(lock, [this] { return _pendingReadCount == 0; });
+	}
+
+	release();
+}
+
+void
+LibavTranscoder::openInput()
+{
+	_inputContext = avformat_alloc_context();
+	if (!_inputContext)
+		throw Exception {"Cannot allocate input context"};
+
+	// Use the container indexes (seek tables, TOC, ...) instead of reading the whole file until the offset
+	// Not for segments: they must start exactly at their offset to join up with the previous one
+	if (_parameters.offset.count() > 0 && !_parameters.duration)
+		_inputContext->flags |= AVFMT_FLAG_FAST_SEEK;
+
+	int error {avformat_open_input(&_inputContext, _filePath.string().c_str(), nullptr, nullptr)};
+	if (error < 0)
+		throw LibavTranscoderException {"Cannot open input", error};
+
+	error = avformat_find_stream_info(_inputContext, nullptr);
+	if (error < 0)
+		throw LibavTranscoderException {"Cannot find stream info", error};
+
+	if (_parameters.stream)
+	{
+		if (*_parameters.stream >= _inputContext->nb_streams
+				|| _inputContext->streams[*_parameters.stream]->codecpar->codec_type != AVMEDIA_TYPE_AUDIO)
+			throw Exception {"Stream " + std::to_string(*_parameters.stream) + " is not an audio stream"};
+
+		_inputStreamIndex = static_cast<int>(*_parameters.stream);
+	}
+	else
+	{
+		error = av_find_best_stream(_inputContext, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
+		if (error < 0)
+			throw LibavTranscoderException {"Cannot find audio stream", error};
+
+		_inputStreamIndex = error;
+	}
+
+	// Do not demux covers and other streams
+	for (unsigned i {}; i < _inputContext->nb_streams; ++i)
+	{
+		if (static_cast<int>(i) != _inputStreamIndex)
+			_inputContext->streams[i]->discard = AVDISCARD_ALL;
+	}
+
+	const AVStream* inputStream {_inputContext->streams[_inputStreamIndex]};
+
+	const AVCodec* decoder {avcodec_find_decoder(inputStream->codecpar->codec_id)};
+	if (!decoder)
+		throw Exception {"Cannot find decoder"};
+
+	_decoderContext = avcodec_alloc_context3(decoder);
+	if (!_decoderContext)
+		throw Exception {"Cannot allocate decoder context"};
+
+	error = avcodec_parameters_to_context(_decoderContext, inputStream->codecpar);
+	if (error < 0)
+		throw LibavTranscoderException {"Cannot set decoder parameters", error};
+
+	_decoderContext->pkt_timebase = inputStream->time_base;
+
+	error = avcodec_open2(_decoderContext, decoder, nullptr);
+	if (error < 0)
+		throw LibavTranscoderException {"Cannot open decoder", error};
+
+	const std::int64_t startTime {inputStream->start_time != AV_NOPTS_VALUE ? inputStream->start_time : 0};
+	if (_parameters.duration)
+		_inputEnd = startTime + av_rescale_q(_parameters.offset.count() + _parameters.duration->count(), AVRational {1, 1000}, inputStream->time_base);
+
+	if (_parameters.offset.count() > 0)
+	{
+		_inputOffset = startTime + av_rescale_q(_parameters.offset.count(), AVRational {1, 1000}, inputStream->time_base);
+
+		// Seek to the previous key frame, the decoded frames before the offset are skipped
+		error = avformat_seek_file(_inputContext, _inputStreamIndex, std::numeric_limits<std::int64_t>::min(), _inputOffset, _inputOffset, 0);
+		if (error < 0)
+			LOG(WARNING) << "Cannot seek to offset: " << averrorToString(error) << ", decoding from start";
+	}
+
+	_packet = av_packet_alloc();
+	_decodedFrame = av_frame_alloc();
+	_resampledFrame = av_frame_alloc();
+	_encoderFrame = av_frame_alloc();
+	_resampler = swr_alloc();
+	if (!_packet || !_decodedFrame || !_resampledFrame || !_encoderFrame || !_resampler)
+		throw Exception {"Cannot allocate decoding resources"};
+}
+
+void
+LibavTranscoder::openOutput()
+{
+	const OutputFormat outputFormat {getOutputFormat(_parameters.format)};
+
+	int error {avformat_alloc_output_context2(&_outputContext, nullptr, outputFormat.muxerName, nullptr)};
+	if (error < 0)
+		throw LibavTranscoderException {std::string {"Cannot create output context for muxer '"} + outputFormat.muxerName + "'", error};
+
+	const AVCodec* encoder {avcodec_find_encoder_by_name(outputFormat.encoderName)};
+	if (!encoder)
+		throw Exception {std::string {"Cannot find encoder '"} + outputFormat.encoderName + "'"};
+
+	_encoderContext = avcodec_alloc_context3(encoder);
+	if (!_encoderContext)
+		throw Exception {"Cannot allocate encoder context"};
+
+	const int channelCount {std::min(_decoderContext->ch_layout.nb_channels, 2)};
+	av_channel_layout_default(&_encoderContext->ch_layout, channelCount);
+	_encoderContext->sample_rate = selectSampleRate(encoder, _decoderContext->sample_rate);
+	_encoderContext->sample_fmt = encoder->sample_fmts ? encoder->sample_fmts[0] : AV_SAMPLE_FMT_FLTP;
+	_encoderContext->bit_rate = _parameters.bitrate;
+	_encoderContext->time_base = AVRational {1, _encoderContext->sample_rate};
+	if (_outputContext->oformat->flags & AVFMT_GLOBALHEADER)
+		_encoderContext->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+
+	error = avcodec_open2(_encoderContext, encoder, nullptr);
+	if (error < 0)
+		throw LibavTranscoderException {"Cannot open encoder", error};
+
+	// Segments keep the timestamps of the whole track, and are cut at the exact requested duration
+	// The encoder delay (priming samples) is timestamped before the segment start, where players drop it as an overlap with the previous segment
+	if (_parameters.duration)
+	{
+		_nextPts = av_rescale_q(_parameters.offset.count(), AVRational {1, 1000}, _encoderContext->time_base);
+		_remainingSampleCount = av_rescale_q(_parameters.duration->count(), AVRational {1, 1000}, _encoderContext->time_base);
+	}
+
+	_outputStream = avformat_new_stream(_outputContext, nullptr);
+	if (!_outputStream)
+		throw Exception {"Cannot create output stream"};
+
+	error = avcodec_parameters_from_context(_outputStream->codecpar, _encoderContext);
+	if (error < 0)
+		throw LibavTranscoderException {"Cannot set output stream parameters", error};
+
+	_outputStream->time_base = _encoderContext->time_base;
+
+	if (!_parameters.stripMetadata)
+	{
+		av_dict_copy(&_outputContext->metadata, _inputContext->metadata, 0);
+		av_dict_copy(&_outputStream->metadata, _inputContext->streams[_inputStreamIndex]->metadata, 0);
+	}
+
+	_fifo = av_audio_fifo_alloc(_encoderContext->sample_fmt, channelCount, defaultFrameSize);
+	if (!_fifo)
+		throw Exception {"Cannot allocate audio fifo"};
+
+	// The muxer writes directly in the output buffer
+	unsigned char* ioBuffer {static_cast<unsigned char*>(av_malloc(outputIOBufferSize))};
+	if (!ioBuffer)
+		throw Exception {"Cannot allocate output buffer"};
+
+	auto writeCallback {[](void* opaque, AVIOWriteBuffer buffer, int bufferSize)
+	{
+		static_cast<LibavTranscoder*>(opaque)->writeOutput(buffer, bufferSize);
+		return bufferSize;
+	}};
+
+	_outputIOContext = avio_alloc_context(ioBuffer, outputIOBufferSize, 1 /* write */, this, nullptr, writeCallback, nullptr);
+	if (!_outputIOContext)
+	{
+		av_free(ioBuffer);
+		throw Exception {"Cannot allocate output IO context"};
+	}
+
+	_outputContext->pb = _outputIOContext;
+	_outputContext->flags |= AVFMT_FLAG_CUSTOM_IO;
+
+	// Keep these timestamps, even if negative for the first segment
+	if (_parameters.duration)
+		_outputContext->avoid_negative_ts = AVFMT_AVOID_NEG_TS_DISABLED;
+
+	error = avformat_write_header(_outputContext, nullptr);
+	if (error < 0)
+		throw LibavTranscoderException {"Cannot write header", error};
+}
+
+void
+LibavTranscoder::release()
+{
+	if (_outputContext)
+	{
+		avformat_free_context(_outputContext);
+		_outputContext = nullptr;
+	}
+
+	if (_outputIOContext)
+	{
+		av_freep(&_outputIOContext->buffer);
+		avio_context_free(&_outputIOContext);
+	}
+
+	avcodec_free_context(&_encoderContext);
+	avcodec_free_context(&_decoderContext);
+	avformat_close_input(&_inputContext);
+
+	if (_fifo)
+	{
+		av_audio_fifo_free(_fifo);
+		_fifo = nullptr;
+	}
+
+	swr_free(&_resampler);
+	av_packet_free(&_packet);
+	av_frame_free(&_decodedFrame);
+	av_frame_free(&_resampledFrame);
+	av_frame_free(&_encoderFrame);
+}
+
+void
+LibavTranscoder::asyncRead(std::byte* buffer, std::size_t bufferSize, ReadCallback readCallback)
+{
+	{
+		std::scoped_lock lock {_mutex};
+		assert(!_cancelled);
+		++_pendingReadCount;
+	}
+
+	boost::asio::post(getWorkerIOService(), [this, buffer, bufferSize, readCallback {std::move(readCallback)}]
+	{
+		auto isCancelled {[this]
+		{
+			std::scoped_lock lock {_mutex};
+			return _cancelled;
+		}};
+
+		std::size_t nbReadBytes {};
+		if (!isCancelled())
+		{
+			try
+			{
+				nbReadBytes = readSome(buffer, bufferSize);
+			}
+			catch (const Exception& e)
+			{
+				LOG(ERROR) << "Transcode failed: " << e.what();
+				_output.clear();
+				_outputOffset = 0;
+				_failed = true;
+				_finished = true;
+			}
+		}
+
+		if (!isCancelled())
+			readCallback(nbReadBytes);
+
+		{
+			std::scoped_lock lock {_mutex};
+			--_pendingReadCount;
+		}
+		_cv.notify_all();
+	});
+}
+
+std::size_t
+LibavTranscoder::readSome(std::byte* buffer, std::size_t bufferSize)
+{
+	// More output is only produced once the previous one has been fully read
+	if (_outputOffset == _output.size())
+	{
+		_output.clear();
+		_outputOffset = 0;
+
+		while (_output.empty() && !_inputEnded)
+			processInput();
+	}
+
+	const std::size_t nbReadBytes {std::min(bufferSize, _output.size() - _outputOffset)};
+	std::copy_n(std::next(std::cbegin(_output), _outputOffset), nbReadBytes, buffer);
+	_outputOffset += nbReadBytes;
+
+	if (_inputEnded && _outputOffset == _output.size())
+	{
+		LOG(DEBUG) << "Transcode complete";
+		_finished = true;
+	}
+
+	return nbReadBytes;
+}
+
+void
+LibavTranscoder::processInput()
+{
+	const int error {_inputEndReached ? AVERROR_EOF : av_read_frame(_inputContext, _packet)};
+	if (error == AVERROR_EOF)
+	{
+		flush();
+		return;
+	}
+	else if (error < 0)
+		throw LibavTranscoderException {"Cannot read input", error};
+
+	if (_packet->stream_index == _inputStreamIndex)
+		decode(_packet);
+
+	av_packet_unref(_packet);
+	encodeFromFifo(false);
+}
+
+void
+LibavTranscoder::flush()
+{
+	decode(nullptr);
+	if (swr_is_initialized(_resampler))
+		resample(nullptr);
+	encodeFromFifo(true);
+	encode(nullptr);
+
+	const int error {av_write_trailer(_outputContext)};
+	if (error < 0)
+		throw LibavTranscoderException {"Cannot write trailer", error};
+
+	avio_flush(_outputIOContext);
+	_inputEnded = true;
+}
+
+void
+LibavTranscoder::decode(const AVPacket* packet)
+{
+	int error {avcodec_send_packet(_decoderContext, packet)};
+	if (error < 0)
+	{
+		// Just skip corrupted packets
+		LOG(DEBUG) << "Cannot decode packet: " << averrorToString(error);
+		return;
+	}
+
+	while (true)
+	{
+		error = avcodec_receive_frame(_decoderContext, _decodedFrame);
+		if (error == AVERROR(EAGAIN) || error == AVERROR_EOF)
+			break;
+		else if (error < 0)
+			throw LibavTranscoderException {"Cannot decode", error};
+
+		if (_decodedFrame->best_effort_timestamp != AV_NOPTS_VALUE && _decodedFrame->best_effort_timestamp >= _inputEnd)
+			_inputEndReached = true;
+		else if (!isBeforeOffset(_decodedFrame))
+		{
+			if (_decodedFrame->ch_layout.order == AV_CHANNEL_ORDER_UNSPEC)
+				av_channel_layout_default(&_decodedFrame->ch_layout, _decodedFrame->ch_layout.nb_channels);
+
+			// The first frame may start before the offset: skip its leading samples once resampled
+			if (!_firstFrameDecoded && _inputOffset > 0 && _decodedFrame->best_effort_timestamp != AV_NOPTS_VALUE && _decodedFrame->best_effort_timestamp < _inputOffset)
+				_skipSampleCount = av_rescale_q(_inputOffset - _decodedFrame->best_effort_timestamp, _inputContext->streams[_inputStreamIndex]->time_base, _encoderContext->time_base);
+			_firstFrameDecoded = true;
+
+			resample(_decodedFrame);
+		}
+
+		av_frame_unref(_decodedFrame);
+	}
+}
+
+bool
+LibavTranscoder::isBeforeOffset(const AVFrame* frame) const
+{
+	if (_inputOffset == 0 || frame->best_effort_timestamp == AV_NOPTS_VALUE)
+		return false;
+
+	const AVRational timeBase {_inputContext->streams[_inputStreamIndex]->time_base};
+	const std::int64_t frameEnd {frame->best_effort_timestamp + av_rescale_q(frame->nb_samples, AVRational {1, frame->sample_rate}, timeBase)};
+
+	return frameEnd <= _inputOffset;
+}
+
+void
+LibavTranscoder::resample(const AVFrame* frame)
+{
+	int error {av_channel_layout_copy(&_resampledFrame->ch_layout, &_encoderContext->ch_layout)};
+	if (error < 0)
+		throw LibavTranscoderException {"Cannot set channel layout", error};
+	_resampledFrame->format = _encoderContext->sample_fmt;
+	_resampledFrame->sample_rate = _encoderContext->sample_rate;
+
+	if (frame && _parameters.gain && !swr_is_initialized(_resampler))
+		initResamplerWithGain(frame);
+
+	// resampler is lazily configured using the first frame
+	error = swr_convert_frame(_resampler, _resampledFrame, frame);
+	if (error < 0)
+		throw LibavTranscoderException {"Cannot resample", error};
+
+	if (_resampledFrame->nb_samples > 0)
+	{
+		error = av_audio_fifo_write(_fifo, reinterpret_cast<void**>(_resampledFrame->data), _resampledFrame->nb_samples);
+		if (error < 0)
+			throw LibavTranscoderException {"Cannot write to audio fifo", error};
+
+		if (_skipSampleCount > 0)
+		{
+			const int nbSkippedSamples {static_cast<int>(std::min<std::int64_t>(_skipSampleCount, av_audio_fifo_size(_fifo)))};
+			av_audio_fifo_drain(_fifo, nbSkippedSamples);
+			_skipSampleCount -= nbSkippedSamples;
+		}
+	}
+
+	av_frame_unref(_resampledFrame);
+}
+
+void
+LibavTranscoder::initResamplerWithGain(const AVFrame* frame)
+{
+	int error {swr_config_frame(_resampler, _resampledFrame, frame)};
+	if (error < 0)
+		throw LibavTranscoderException {"Cannot configure resampler", error};
+
+	// The gain is applied by the rematrixing stage, using the default matrix scaled by the gain
+	// Downmix coefficients are still normalized
+	const double linearGain {std::pow(10., *_parameters.gain / 20.)};
+	const int inputChannelCount {frame->ch_layout.nb_channels};
+	const int outputChannelCount {_resampledFrame->ch_layout.nb_channels};
+
+	std::vector<double> matrix(static_cast<std::size_t>(inputChannelCount) * outputChannelCount);
+	error = swr_build_matrix2(&frame->ch_layout, &_resampledFrame->ch_layout,
+			M_SQRT1_2, M_SQRT1_2, 0 /* lfe */,
+			std::max(1., linearGain), linearGain,
+			matrix.data(), inputChannelCount, AV_MATRIX_ENCODING_NONE, nullptr);
+	if (error < 0)
+		throw LibavTranscoderException {"Cannot build rematrix matrix", error};
+
+	error = swr_set_matrix(_resampler, matrix.data(), inputChannelCount);
+	if (error < 0)
+		throw LibavTranscoderException {"Cannot set rematrix matrix", error};
+
+	error = swr_init(_resampler);
+	if (error < 0)
+		throw LibavTranscoderException {"Cannot init resampler", error};
+}
+
+void
+LibavTranscoder::encodeFromFifo(bool flush)
+{
+	const int frameSize {_encoderContext->frame_size > 0 ? _encoderContext->frame_size : defaultFrameSize};
+	const bool padLastFrame {_encoderContext->frame_size > 0 && !(_encoderContext->codec->capabilities & (AV_CODEC_CAP_SMALL_LAST_FRAME | AV_CODEC_CAP_VARIABLE_FRAME_SIZE))};
+
+	while (av_audio_fifo_size(_fifo) >= frameSize || (flush && av_audio_fifo_size(_fifo) > 0))
+	{
+		if (_remainingSampleCount == 0)
+		{
+			// Segment complete, no need to decode further
+			av_audio_fifo_reset(_fifo);
+			_inputEndReached = true;
+			break;
+		}
+
+		const int nbSamples {static_cast<int>(std::min<std::int64_t>({frameSize, av_audio_fifo_size(_fifo), _remainingSampleCount}))};
+		_remainingSampleCount -= nbSamples;
+
+		_encoderFrame->nb_samples = padLastFrame ? frameSize : nbSamples;
+		_encoderFrame->format = _encoderContext->sample_fmt;
+		_encoderFrame->sample_rate = _encoderContext->sample_rate;
+
+		int error {av_channel_layout_copy(&_encoderFrame->ch_layout, &_encoderContext->ch_layout)};
+		if (error < 0)
+			throw LibavTranscoderException {"Cannot set channel layout", error};
+
+		error = av_frame_get_buffer(_encoderFrame, 0);
+		if (error < 0)
+			throw LibavTranscoderException {"Cannot allocate frame", error};
+
+		if (av_audio_fifo_read(_fifo, reinterpret_cast<void**>(_encoderFrame->data), nbSamples) < nbSamples)
+			throw Exception {"Cannot read from audio fifo"};
+
+		if (nbSamples < _encoderFrame->nb_samples)
+			av_samples_set_silence(_encoderFrame->extended_data, nbSamples, _encoderFrame->nb_samples - nbSamples, _encoderContext->ch_layout.nb_channels, _encoderContext->sample_fmt);
+
+		_encoderFrame->pts = _nextPts;
+		_nextPts += _encoderFrame->nb_samples;
+
+		encode(_encoderFrame);
+		av_frame_unref(_encoderFrame);
+	}
+}
+
+void
+LibavTranscoder::encode(const AVFrame* frame)
+{
+	int error {avcodec_send_frame(_encoderContext, frame)};
+	if (error < 0)
+		throw LibavTranscoderException {"Cannot encode", error};
+
+	while (true)
+	{
+		error = avcodec_receive_packet(_encoderContext, _packet);
+		if (error == AVERROR(EAGAIN) || error == AVERROR_EOF)
+			break;
+		else if (error < 0)
+			throw LibavTranscoderException {"Cannot encode", error};
+
+		_packet->stream_index = _outputStream->index;
+		av_packet_rescale_ts(_packet, _encoderContext->time_base, _outputStream->time_base);
+
+		// takes ownership of the packet
+		error = av_interleaved_write_frame(_outputContext, _packet);
+		if (error < 0)
+			throw LibavTranscoderException {"Cannot write output", error};
+	}
+}
+
+void
+LibavTranscoder::writeOutput(const std::uint8_t* buffer, int bufferSize)
+{
+	const std::byte* data {reinterpret_cast<const std::byte*>(buffer)};
+	_output.insert(std::cend(_output), data, data + bufferSize);
+}
+
+} // namespace Av
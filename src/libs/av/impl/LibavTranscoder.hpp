@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+#include "av/TranscodeParameters.hpp"
+#include "ITranscoder.hpp"
+
+struct AVAudioFifo;
+struct AVCodecContext;
+struct AVFormatContext;
+struct AVFrame;
+struct AVIOContext;
+struct AVPacket;
+struct AVStream;
+struct SwrContext;
+
+namespace Av
+{
+	// Decodes, resamples and encodes in process, using a shared pool of worker threads
+	// Each read request only processes the input until some output is available,
+	// so that the workers are fairly shared between the transcoders
+	class LibavTranscoder final : public ITranscoder
+	{
+		public:
+			LibavTranscoder(const std::filesystem::path& file, const TranscodeParameters& parameters);
+			~LibavTranscoder() override;
+
+			LibavTranscoder(const LibavTranscoder&) = delete;
+			LibavTranscoder& operator=(const LibavTranscoder&) = delete;
+			LibavTranscoder(LibavTranscoder&&) = delete;
+			LibavTranscoder& operator=(LibavTranscoder&&) = delete;
+
+		private:
+			void				asyncRead(std::byte* buffer, std::size_t bufferSize, ReadCallback) override;
+			const std::string&	getOutputMimeType() const override { return _outputMimeType; }
+			bool				finished() const override { return _finished; }
+			bool				succeeded() const override { return !_failed; }
+
+			void		openInput();
+			void		openOutput();
+			void		release();
+
+			std::size_t	readSome(std::byte* buffer, std::size_t bufferSize);
+			void		processInput();
+			void		flush();
+			void		decode(const AVPacket* packet);
+			bool		isBeforeOffset(const AVFrame* frame) const;
+			void		resample(const AVFrame* frame);
+			void		initResamplerWithGain(const AVFrame* frame);
+			void		encodeFromFifo(bool flush);
+			void		encode(const AVFrame* frame);
+
+			void		writeOutput(const std::uint8_t* buffer, int bufferSize);
+
+			const std::size_t				_id {};
+			const std::filesystem::path		_filePath;
+			const TranscodeParameters		_parameters;
+			std::string						_outputMimeType;
+
+			AVFormatContext*	_inputContext {};
+			AVCodecContext*		_decoderContext {};
+			int					_inputStreamIndex {-1};
+			std::int64_t		_inputOffset {};	// in input stream time base
+			std::int64_t		_inputEnd {std::numeric_limits<std::int64_t>::max()};	// in input stream time base
+			bool				_inputEndReached {};
+			bool				_firstFrameDecoded {};
+
+			SwrContext*			_resampler {};
+			AVAudioFifo*		_fifo {};
+			std::int64_t		_skipSampleCount {};		// in output samples, to reach the exact offset
+			std::int64_t		_remainingSampleCount {std::numeric_limits<std::int64_t>::max()};	// in output samples, segments only
+
+			AVFormatContext*	_outputContext {};
+			AVIOContext*		_outputIOContext {};
+			AVCodecContext*		_encoderContext {};
+			AVStream*			_outputStream {};
+			std::int64_t		_nextPts {};
+
+			AVPacket*			_packet {};
+			AVFrame*			_decodedFrame {};
+			AVFrame*			_resampledFrame {};
+			AVFrame*			_encoderFrame {};
+
+			// produced by the muxer, read from the offset
+			std::vector<std::byte>	_output;
+			std::size_t				_outputOffset {};
+			bool					_inputEnded {};
+			std::atomic<bool>		_finished {};
+			std::atomic<bool>		_failed {};
+
+			std::mutex				_mutex;
+			std::condition_variable	_cv;
+			std::size_t				_pendingReadCount {};
+			bool					_cancelled {};
+	};
+}
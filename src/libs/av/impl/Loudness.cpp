@@ -0,0 +1,265 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "av/Loudness.hpp"
+
+#if LMS_SUPPORT_LOUDNESS
+extern "C"
+{
+#define __STDC_CONSTANT_MACROS
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/channel_layout.h>
+#include <libavutil/error.h>
+#include <libswresample/swresample.h>
+}
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#endif // LMS_SUPPORT_LOUDNESS
+
+#include "av/LoudnessMeter.hpp"
+
+#include "av/Types.hpp"
+#include "utils/Logger.hpp"
+
+namespace Av
+{
+#if LMS_SUPPORT_LOUDNESS
+	namespace
+	{
+		std::string averrorToString(int error)
+		{
+			std::array<char, 128> buf = {0};
+
+			if (av_strerror(error, buf.data(), buf.size()) == 0)
+				return &buf[0];
+			else
+				return "Unknown error";
+		}
+
+		class LoudnessException : public Exception
+		{
+			public:
+				LoudnessException(const std::string& msg, int avError)
+					: Exception {msg + ": " + averrorToString(avError)}
+				{}
+		};
+
+		struct InputContextDeleter { void operator()(AVFormatContext* context) { avformat_close_input(&context); } };
+		struct CodecContextDeleter { void operator()(AVCodecContext* context) { avcodec_free_context(&context); } };
+		struct ResamplerDeleter { void operator()(SwrContext* resampler) { swr_free(&resampler); } };
+		struct PacketDeleter { void operator()(AVPacket* packet) { av_packet_free(&packet); } };
+		struct FrameDeleter { void operator()(AVFrame* frame) { av_frame_free(&frame); } };
+		struct ChannelLayoutDeleter { void operator()(AVChannelLayout* layout) { av_channel_layout_uninit(layout); delete layout; } };
+
+		class Analyzer
+		{
+			public:
+				Analyzer(const std::filesystem::path& file);
+
+				std::optional<LoudnessInfo> run();
+
+			private:
+				void decode(const AVPacket* packet);
+				void measure(const AVFrame* frame);
+
+				std::unique_ptr<AVFormatContext, InputContextDeleter>	_inputContext;
+				std::unique_ptr<AVCodecContext, CodecContextDeleter>	_decoderContext;
+				std::unique_ptr<SwrContext, ResamplerDeleter>			_resampler {swr_alloc()};
+				std::unique_ptr<AVPacket, PacketDeleter>				_packet {av_packet_alloc()};
+				std::unique_ptr<AVFrame, FrameDeleter>					_decodedFrame {av_frame_alloc()};
+				std::unique_ptr<AVFrame, FrameDeleter>					_resampledFrame {av_frame_alloc()};
+				int														_streamIndex {};
+				std::unique_ptr<AVChannelLayout, ChannelLayoutDeleter>	_outputChannelLayout {new AVChannelLayout {}};
+				std::unique_ptr<LoudnessMeter>							_meter;
+		};
+
+		Analyzer::Analyzer(const std::filesystem::path& file)
+		{
+			if (!_resampler || !_packet || !_decodedFrame || !_resampledFrame)
+				throw Exception {"Cannot allocate decoding resources"};
+
+			{
+				AVFormatContext* inputContext {};
+				const int error {avformat_open_input(&inputContext, file.string().c_str(), nullptr, nullptr)};
+				if (error < 0)
+					throw LoudnessException {"Cannot open input", error};
+
+				_inputContext.reset(inputContext);
+			}
+
+			int error {avformat_find_stream_info(_inputContext.get(), nullptr)};
+			if (error < 0)
+				throw LoudnessException {"Cannot find stream info", error};
+
+			error = av_find_best_stream(_inputContext.get(), AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
+			if (error < 0)
+				throw LoudnessException {"Cannot find audio stream", error};
+
+			_streamIndex = error;
+
+			// Do not demux covers and other streams
+			for (unsigned i {}; i < _inputContext->nb_streams; ++i)
+			{
+				if (static_cast<int>(i) != _streamIndex)
+					_inputContext->streams[i]->discard = AVDISCARD_ALL;
+			}
+
+			const AVStream* stream {_inputContext->streams[_streamIndex]};
+
+			const AVCodec* decoder {avcodec_find_decoder(stream->codecpar->codec_id)};
+			if (!decoder)
+				throw Exception {"Cannot find decoder"};
+
+			_decoderContext.reset(avcodec_alloc_context3(decoder));
+			if (!_decoderContext)
+				throw Exception {"Cannot allocate decoder context"};
+
+			error = avcodec_parameters_to_context(_decoderContext.get(), stream->codecpar);
+			if (error < 0)
+				throw LoudnessException {"Cannot set decoder parameters", error};
+
+			error = avcodec_open2(_decoderContext.get(), decoder, nullptr);
+			if (error < 0)
+				throw LoudnessException {"Cannot open decoder", error};
+
+			// Multichannel inputs are downmixed to stereo
+			const int channelCount {std::min(_decoderContext->ch_layout.nb_channels, 2)};
+			_meter = std::make_unique<LoudnessMeter>(channelCount, _decoderContext->sample_rate);
+
+			av_channel_layout_default(_outputChannelLayout.get(), channelCount);
+		}
+
+		std::optional<LoudnessInfo>
+		Analyzer::run()
+		{
+			while (true)
+			{
+				const int error {av_read_frame(_inputContext.get(), _packet.get())};
+				if (error == AVERROR_EOF)
+					break;
+				else if (error < 0)
+					throw LoudnessException {"Cannot read input", error};
+
+				if (_packet->stream_index == _streamIndex)
+					decode(_packet.get());
+
+				av_packet_unref(_packet.get());
+			}
+
+			decode(nullptr);
+			if (swr_is_initialized(_resampler.get()))
+				measure(nullptr);
+
+			const std::optional<double> integratedLoudness {_meter->getIntegratedLoudness()};
+			if (!integratedLoudness)
+				return std::nullopt;
+
+			return LoudnessInfo {*integratedLoudness, _meter->getSamplePeak()};
+		}
+
+		void
+		Analyzer::decode(const AVPacket* packet)
+		{
+			int error {avcodec_send_packet(_decoderContext.get(), packet)};
+			if (error < 0)
+			{
+				// Just skip corrupted packets
+				LMS_LOG(AV, DEBUG) << "Cannot decode packet: " << averrorToString(error);
+				return;
+			}
+
+			while (true)
+			{
+				error = avcodec_receive_frame(_decoderContext.get(), _decodedFrame.get());
+				if (error == AVERROR(EAGAIN) || error == AVERROR_EOF)
+					break;
+				else if (error < 0)
+					throw LoudnessException {"Cannot decode", error};
+
+				// Some decoders only report the channel count
+				if (_decodedFrame->ch_layout.order == AV_CHANNEL_ORDER_UNSPEC)
+					av_channel_layout_default(&_decodedFrame->ch_layout, _decodedFrame->ch_layout.nb_channels);
+
+				measure(_decodedFrame.get());
+				av_frame_unref(_decodedFrame.get());
+			}
+		}
+
+		void
+		Analyzer::measure(const AVFrame* frame)
+		{
+			// Only the sample format and the channel count are converted
+			int error {av_channel_layout_copy(&_resampledFrame->ch_layout, _outputChannelLayout.get())};
+			if (error < 0)
+				throw LoudnessException {"Cannot set output channel layout", error};
+			_resampledFrame->format = AV_SAMPLE_FMT_FLT;
+			_resampledFrame->sample_rate = _decoderContext->sample_rate;
+
+			// resampler is lazily configured using the first frame
+			error = swr_convert_frame(_resampler.get(), _resampledFrame.get(), frame);
+			if (error < 0)
+				throw LoudnessException {"Cannot convert samples", error};
+
+			if (_resampledFrame->nb_samples > 0)
+				_meter->addSamples(reinterpret_cast<const float*>(_resampledFrame->data[0]), _resampledFrame->nb_samples);
+
+			av_frame_unref(_resampledFrame.get());
+		}
+	}
+
+	bool
+	isLoudnessAnalysisSupported()
+	{
+		return true;
+	}
+
+	std::optional<LoudnessInfo>
+	computeLoudness(const std::filesystem::path& file)
+	{
+		LMS_LOG(AV, DEBUG) << "Computing loudness of '" << file.string() << "'";
+
+		try
+		{
+			return Analyzer {file}.run();
+		}
+		catch (const Exception& e)
+		{
+			LMS_LOG(AV, ERROR) << "Cannot compute loudness of '" << file.string() << "': " << e.what();
+			throw;
+		}
+	}
+#else
+	bool
+	isLoudnessAnalysisSupported()
+	{
+		return false;
+	}
+
+	std::optional<LoudnessInfo>
+	computeLoudness(const std::filesystem::path&)
+	{
+		throw Exception {"Loudness analysis not supported"};
+	}
+#endif // LMS_SUPPORT_LOUDNESS
+}
+
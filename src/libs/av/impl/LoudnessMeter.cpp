@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "av/LoudnessMeter.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include "av/Types.hpp"
+
+namespace Av
+{
+	namespace
+	{
+		constexpr double absoluteGate {-70.};	// LUFS
+		constexpr double relativeGate {-10.};	// LU
+
+		double energyToLoudness(double energy)
+		{
+			return -0.691 + 10. * std::log10(energy);
+		}
+
+		double loudnessToEnergy(double loudness)
+		{
+			return std::pow(10., (loudness + 0.691) / 10.);
+		}
+	}
+
+	LoudnessMeter::LoudnessMeter(std::size_t channelCount, std::size_t sampleRate)
+		: _channelCount {channelCount}
+		, _subBlockFrameCount {sampleRate / 10}
+		, _filterStates(channelCount)
+	{
+		if (channelCount == 0 || channelCount > 2)
+			throw Exception {"Unhandled channel count (" + std::to_string(channelCount) + ")"};
+		if (_subBlockFrameCount == 0)
+			throw Exception {"Unhandled sample rate (" + std::to_string(sampleRate) + ")"};
+
+		// K-weighting filters, coefficients computed for the actual sample rate (BS.1770 only gives them for 48kHz)
+		{
+			// high shelf
+			const double f0 {1681.974450955533};
+			const double G {3.999843853973347};
+			const double Q {0.7071752369554196};
+
+			const double K {std::tan(M_PI * f0 / sampleRate)};
+			const double Vh {std::pow(10., G / 20.)};
+			const double Vb {std::pow(Vh, 0.4996667741545416)};
+			const double a0 {1. + K / Q + K * K};
+
+			_preFilter.b = {(Vh + Vb * K / Q + K * K) / a0, 2. * (K * K - Vh) / a0, (Vh - Vb * K / Q + K * K) / a0};
+			_preFilter.a = {1., 2. * (K * K - 1.) / a0, (1. - K / Q + K * K) / a0};
+		}
+
+		{
+			// high pass
+			const double f0 {38.13547087602444};
+			const double Q {0.5003270373238773};
+
+			const double K {std::tan(M_PI * f0 / sampleRate)};
+			const double a0 {1. + K / Q + K * K};
+
+			_rlbFilter.b = {1., -2., 1.};
+			_rlbFilter.a = {1., 2. * (K * K - 1.) / a0, (1. - K / Q + K * K) / a0};
+		}
+	}
+
+	double
+	LoudnessMeter::applyFilter(const Biquad& filter, std::array<double, 2>& state, double sample)
+	{
+		// transposed direct form II
+		const double res {filter.b[0] * sample + state[0]};
+		state[0] = filter.b[1] * sample - filter.a[1] * res + state[1];
+		state[1] = filter.b[2] * sample - filter.a[2] * res;
+
+		return res;
+	}
+
+	void
+	LoudnessMeter::addSamples(const float* samples, std::size_t frameCount)
+	{
+		for (std::size_t frame {}; frame < frameCount; ++frame)
+		{
+			for (std::size_t channel {}; channel < _channelCount; ++channel)
+			{
+				const float sample {samples[frame * _channelCount + channel]};
+				_samplePeak = std::max(_samplePeak, std::abs(sample));
+
+				FilterState& state {_filterStates[channel]};
+				const double filtered {applyFilter(_rlbFilter, state.rlbFilter, applyFilter(_preFilter, state.preFilter, sample))};
+				_subBlockEnergy += filtered * filtered;
+			}
+
+			if (++_subBlockFrameIndex == _subBlockFrameCount)
+				processSubBlock();
+		}
+	}
+
+	void
+	LoudnessMeter::processSubBlock()
+	{
+		const double subBlockEnergy {_subBlockEnergy / _subBlockFrameCount};
+
+		// A block is made of the last 4 sub blocks
+		if (++_subBlockCount >= 4)
+			_blockEnergies.push_back((std::accumulate(std::cbegin(_previousSubBlockEnergies), std::cend(_previousSubBlockEnergies), 0.) + subBlockEnergy) / 4.);
+
+		std::rotate(std::begin(_previousSubBlockEnergies), std::next(std::begin(_previousSubBlockEnergies)), std::end(_previousSubBlockEnergies));
+		_previousSubBlockEnergies.back() = subBlockEnergy;
+
+		_subBlockEnergy = 0;
+		_subBlockFrameIndex = 0;
+	}
+
+	std::optional<double>
+	LoudnessMeter::getIntegratedLoudness() const
+	{
+		auto computeGatedLoudness {[this](double thresholdEnergy) -> std::optional<double>
+		{
+			double energySum {};
+			std::size_t blockCount {};
+
+			for (const double blockEnergy : _blockEnergies)
+			{
+				if (blockEnergy > thresholdEnergy)
+				{
+					energySum += blockEnergy;
+					blockCount++;
+				}
+			}
+
+			if (blockCount == 0)
+				return std::nullopt;
+
+			return energyToLoudness(energySum / blockCount);
+		}};
+
+		const std::optional<double> absoluteGatedLoudness {computeGatedLoudness(loudnessToEnergy(absoluteGate))};
+		if (!absoluteGatedLoudness)
+			return std::nullopt;
+
+		return computeGatedLoudness(loudnessToEnergy(*absoluteGatedLoudness + relativeGate));
+	}
+}
+
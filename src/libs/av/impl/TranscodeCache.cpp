@@ -0,0 +1,190 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "TranscodeCache.hpp"
+
+#include <iomanip>
+#include <sstream>
+
+#include "av/TranscodeParameters.hpp"
+#include "utils/Hash.hpp"
+#include "utils/Logger.hpp"
+
+namespace Av
+{
+	namespace
+	{
+		// The track file identity is part of the name: cached outputs of modified files will never be used again, and will eventually get evicted
+		std::optional<std::string>
+		computeEntryName(const std::filesystem::path& trackPath, const TranscodeParameters& parameters)
+		{
+			std::ostringstream oss;
+
+			try
+			{
+				oss << trackPath.string()
+					<< '|' << std::filesystem::file_size(trackPath)
+					<< '|' << std::filesystem::last_write_time(trackPath).time_since_epoch().count();
+			}
+			catch (const std::filesystem::filesystem_error& e)
+			{
+				LMS_LOG(TRANSCODE, ERROR) << "Cannot get file info for '" << trackPath.string() << "': " << e.what();
+				return std::nullopt;
+			}
+
+			oss << '|' << static_cast<int>(parameters.format)
+				<< '|' << parameters.bitrate
+				<< '|' << (parameters.stream ? std::to_string(*parameters.stream) : "auto")
+				<< '|' << parameters.offset.count()
+				<< '|' << (parameters.duration ? std::to_string(parameters.duration->count()) : "all")
+				<< '|' << (parameters.gain ? std::to_string(*parameters.gain) : "none")
+				<< '|' << parameters.stripMetadata;
+
+			std::ostringstream res;
+			res << std::hex << std::setfill('0') << std::setw(16) << Utils::computeFnv1aHash(oss.str());
+
+			return res.str();
+		}
+	}
+
+	class TranscodeCache::Entry final : public ITranscodeCache::IEntry
+	{
+		public:
+			Entry(DiskLruCache& cache, const DiskLruCache::EntryName& entryName, const std::filesystem::path& path)
+			: _cache {cache}
+			, _entryName {entryName}
+			, _path {path}
+			{
+			}
+
+			~Entry() override
+			{
+				_cache.unpin(_entryName);
+			}
+
+			Entry(const Entry&) = delete;
+			Entry(Entry&&) = delete;
+			Entry& operator=(const Entry&) = delete;
+			Entry& operator=(Entry&&) = delete;
+
+		private:
+			const std::filesystem::path& getPath() const override { return _path; }
+
+			DiskLruCache&					_cache;
+			const DiskLruCache::EntryName	_entryName;
+			const std::filesystem::path		_path;
+	};
+
+	class TranscodeCache::EntryWriter final : public ITranscodeCache::IEntryWriter
+	{
+		public:
+			EntryWriter(std::unique_ptr<DiskLruCache::Writer> writer)
+			: _writer {std::move(writer)}
+			{
+			}
+
+			~EntryWriter() override = default;
+			EntryWriter(const EntryWriter&) = delete;
+			EntryWriter(EntryWriter&&) = delete;
+			EntryWriter& operator=(const EntryWriter&) = delete;
+			EntryWriter& operator=(EntryWriter&&) = delete;
+
+		private:
+			void write(const std::byte* data, std::size_t size) override
+			{
+				_writer->write(data, size);
+			}
+
+			void commit() override
+			{
+				_writer->commit();
+			}
+
+			std::unique_ptr<DiskLruCache::Writer> _writer;
+	};
+
+	std::unique_ptr<ITranscodeCache>
+	createTranscodeCache(const std::filesystem::path& cacheDirectory, std::size_t maxSize)
+	{
+		return std::make_unique<TranscodeCache>(cacheDirectory, maxSize);
+	}
+
+	TranscodeCache::TranscodeCache(const std::filesystem::path& cacheDirectory, std::size_t maxSize)
+	: _cache {cacheDirectory, maxSize}
+	{
+		const DiskLruCache::Stats stats {_cache.getStats()};
+		LMS_LOG(TRANSCODE, INFO) << "Transcode cache: " << stats.entryCount << " entries, " << stats.size << "/" << maxSize << " bytes used";
+	}
+
+	std::unique_ptr<ITranscodeCache::IEntry>
+	TranscodeCache::getEntry(const std::filesystem::path& trackPath, const TranscodeParameters& parameters)
+	{
+		const std::optional<std::string> entryName {computeEntryName(trackPath, parameters)};
+		if (!entryName)
+			return nullptr;
+
+		const std::optional<DiskLruCache::EntryInfo> entryInfo {_cache.pin(*entryName)};
+		if (!entryInfo)
+			return nullptr;
+
+		LMS_LOG(TRANSCODE, DEBUG) << "Cache hit for '" << trackPath.string() << "'";
+
+		return std::make_unique<Entry>(_cache, *entryName, entryInfo->path);
+	}
+
+	bool
+	TranscodeCache::contains(const std::filesystem::path& trackPath, const TranscodeParameters& parameters) const
+	{
+		const std::optional<std::string> entryName {computeEntryName(trackPath, parameters)};
+		if (!entryName)
+			return false;
+
+		return _cache.contains(*entryName);
+	}
+
+	std::unique_ptr<ITranscodeCache::IEntryWriter>
+	TranscodeCache::createEntryWriter(const std::filesystem::path& trackPath, const TranscodeParameters& parameters)
+	{
+		const std::optional<std::string> entryName {computeEntryName(trackPath, parameters)};
+		if (!entryName)
+			return nullptr;
+
+		std::unique_ptr<DiskLruCache::Writer> writer {_cache.createWriter(*entryName)};
+		if (!writer)
+			return nullptr;
+
+		return std::make_unique<EntryWriter>(std::move(writer));
+	}
+
+	ITranscodeCache::Stats
+	TranscodeCache::getStats() const
+	{
+		const DiskLruCache::Stats cacheStats {_cache.getStats()};
+
+		Stats stats;
+		stats.entryCount = cacheStats.entryCount;
+		stats.size = cacheStats.size;
+		stats.hits = cacheStats.hits;
+		stats.misses = cacheStats.misses;
+
+		return stats;
+	}
+}
+
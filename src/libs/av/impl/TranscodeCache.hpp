@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "av/ITranscodeCache.hpp"
+#include "utils/DiskLruCache.hpp"
+
+namespace Av
+{
+	class TranscodeCache final : public ITranscodeCache
+	{
+		public:
+			TranscodeCache(const std::filesystem::path& cacheDirectory, std::size_t maxSize);
+			~TranscodeCache() override = default;
+			TranscodeCache(const TranscodeCache&) = delete;
+			TranscodeCache(TranscodeCache&&) = delete;
+			TranscodeCache& operator=(const TranscodeCache&) = delete;
+			TranscodeCache& operator=(TranscodeCache&&) = delete;
+
+		private:
+			class Entry;
+			class EntryWriter;
+
+			std::unique_ptr<IEntry> getEntry(const std::filesystem::path& trackPath, const TranscodeParameters& parameters) override;
+			bool contains(const std::filesystem::path& trackPath, const TranscodeParameters& parameters) const override;
+			std::unique_ptr<IEntryWriter> createEntryWriter(const std::filesystem::path& trackPath, const TranscodeParameters& parameters) override;
+			Stats getStats() const override;
+
+			DiskLruCache	_cache;
+	};
+}
+
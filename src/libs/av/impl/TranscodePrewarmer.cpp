@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "TranscodePrewarmer.hpp"
+
+#include <algorithm>
+
+#include "av/ITranscodeCache.hpp"
+#include "utils/Logger.hpp"
+#include "utils/Service.hpp"
+#include "BufferedTranscoder.hpp"
+
+namespace Av
+{
+	namespace
+	{
+		bool operator==(const TranscodeParameters& lhs, const TranscodeParameters& rhs)
+		{
+			return lhs.format == rhs.format
+				&& lhs.bitrate == rhs.bitrate
+				&& lhs.stream == rhs.stream
+				&& lhs.offset == rhs.offset
+				&& lhs.duration == rhs.duration
+				&& lhs.gain == rhs.gain
+				&& lhs.stripMetadata == rhs.stripMetadata;
+		}
+	}
+
+	std::unique_ptr<ITranscodePrewarmer>
+	createTranscodePrewarmer(std::size_t maxBufferSize, std::chrono::seconds maxAge)
+	{
+		return std::make_unique<TranscodePrewarmer>(maxBufferSize, maxAge);
+	}
+
+	TranscodePrewarmer::TranscodePrewarmer(std::size_t maxBufferSize, std::chrono::seconds maxEntryAge)
+		: _maxBufferSize {maxBufferSize}
+		, _maxEntryAge {maxEntryAge}
+	{
+		LMS_LOG(TRANSCODE, INFO) << "Transcode prewarm buffer size = " << _maxBufferSize << ", max age = " << _maxEntryAge.count() << "s";
+	}
+
+	void
+	TranscodePrewarmer::prewarm(const std::filesystem::path& trackPath, const TranscodeParameters& parameters)
+	{
+		if (const ITranscodeCache* cache {Service<ITranscodeCache>::get()})
+		{
+			if (cache->contains(trackPath, parameters))
+				return;
+		}
+
+		// Destroyed outside of the lock, as destroying jobs may start other ones
+		std::list<Entry> evictedEntries;
+
+		{
+			std::scoped_lock lock {_mutex};
+
+			evictedEntries = evictEntries();
+			if (std::any_of(std::cbegin(_entries), std::cend(_entries), [&](const Entry& entry) { return entry.trackPath == trackPath && entry.parameters == parameters; }))
+				return;
+		}
+
+		Entry entry;
+		entry.trackPath = trackPath;
+		entry.parameters = parameters;
+		entry.creationTime = std::chrono::steady_clock::now();
+
+		// Speculative work: never wait for a slot
+		if (ITranscodeScheduler* scheduler {Service<ITranscodeScheduler>::get()})
+		{
+			entry.job = scheduler->createJob(TranscodePriority::Low, [] {});
+			if (!entry.job->isRunning())
+			{
+				LMS_LOG(TRANSCODE, DEBUG) << "No free transcode slot, not prewarming '" << trackPath.string() << "'";
+				return;
+			}
+		}
+
+		try
+		{
+			entry.transcoder = std::make_unique<BufferedTranscoder>(createTranscoder(trackPath, parameters), _maxBufferSize);
+		}
+		catch (const Exception& e)
+		{
+			LMS_LOG(TRANSCODE, ERROR) << "Cannot prewarm '" << trackPath.string() << "': " << e.what();
+			return;
+		}
+
+		LMS_LOG(TRANSCODE, DEBUG) << "Prewarming '" << trackPath.string() << "'";
+
+		std::scoped_lock lock {_mutex};
+		_entries.push_back(std::move(entry));
+		evictedEntries.splice(std::end(evictedEntries), evictEntries());
+	}
+
+	std::unique_ptr<ITranscoder>
+	TranscodePrewarmer::take(const std::filesystem::path& trackPath, const TranscodeParameters& parameters)
+	{
+		// Destroyed outside of the lock, as destroying jobs may start other ones
+		std::list<Entry> evictedEntries;
+		std::optional<Entry> takenEntry;
+
+		{
+			std::scoped_lock lock {_mutex};
+
+			evictedEntries = evictEntries();
+
+			auto it {std::find_if(std::begin(_entries), std::end(_entries), [&](const Entry& entry) { return entry.trackPath == trackPath && entry.parameters == parameters; })};
+			if (it == std::end(_entries))
+				return nullptr;
+
+			LMS_LOG(TRANSCODE, DEBUG) << "Using prewarmed transcode for '" << trackPath.string() << "'";
+
+			takenEntry = std::move(*it);
+			_entries.erase(it);
+		}
+
+		// Now a regular stream, that is not limited by the scheduler
+		return std::move(takenEntry->transcoder);
+	}
+
+	std::list<TranscodePrewarmer::Entry>
+	TranscodePrewarmer::evictEntries()
+	{
+		const auto now {std::chrono::steady_clock::now()};
+
+		std::list<Entry> evictedEntries;
+		while (!_entries.empty()
+				&& (_entries.size() > maxEntryCount || now - _entries.front().creationTime > _maxEntryAge))
+		{
+			LMS_LOG(TRANSCODE, DEBUG) << "Discarding unused prewarmed transcode for '" << _entries.front().trackPath.string() << "'";
+			evictedEntries.splice(std::end(evictedEntries), _entries, std::begin(_entries));
+		}
+
+		return evictedEntries;
+	}
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <chrono>
+#include <list>
+#include <mutex>
+#include <optional>
+
+#include "av/ITranscodePrewarmer.hpp"
+#include "av/ITranscodeScheduler.hpp"
+#include "av/TranscodeParameters.hpp"
+#include "ITranscoder.hpp"
+
+namespace Av
+{
+	class TranscodePrewarmer final : public ITranscodePrewarmer
+	{
+		public:
+			TranscodePrewarmer(std::size_t maxBufferSize, std::chrono::seconds maxEntryAge);
+			~TranscodePrewarmer() override = default;
+			TranscodePrewarmer(const TranscodePrewarmer&) = delete;
+			TranscodePrewarmer(TranscodePrewarmer&&) = delete;
+			TranscodePrewarmer& operator=(const TranscodePrewarmer&) = delete;
+			TranscodePrewarmer& operator=(TranscodePrewarmer&&) = delete;
+
+		private:
+			void prewarm(const std::filesystem::path& trackPath, const TranscodeParameters& parameters) override;
+			std::unique_ptr<ITranscoder> take(const std::filesystem::path& trackPath, const TranscodeParameters& parameters) override;
+
+			struct Entry
+			{
+				std::filesystem::path					trackPath;
+				TranscodeParameters						parameters;
+				std::unique_ptr<ITranscodeScheduler::IJob>	job; // may be null, must outlive the transcoder
+				std::unique_ptr<ITranscoder>			transcoder;
+				std::chrono::steady_clock::time_point	creationTime;
+			};
+
+			// Evicted entries must be destroyed outside of the lock
+			std::list<Entry> evictEntries();
+
+			// Entries hold a transcode slot: do not keep them too long
+			static constexpr std::size_t maxEntryCount {16};
+
+			const std::size_t			_maxBufferSize;
+			const std::chrono::seconds	_maxEntryAge;
+			std::mutex			_mutex;
+			std::list<Entry>	_entries; // ordered by creation time
+	};
+}
@@ -19,38 +19,163 @@
 
 #include "TranscodeResourceHandler.hpp"
 
+#include "av/ITranscodePrewarmer.hpp"
+#include "utils/FileResourceHandlerCreator.hpp"
+#include "utils/IConfig.hpp"
+#include "utils/Logger.hpp"
+#include "utils/Service.hpp"
+#ifdef LMS_SUPPORT_LIBAV_TRANSCODER
+#include "LibavTranscoder.hpp"
+#endif // LMS_SUPPORT_LIBAV_TRANSCODER
+#include "Transcoder.hpp"
+
 namespace Av
 {
+	namespace
+	{
+		// Keeps the cache entry pinned while its file is served
+		class CachedFileResourceHandler final : public IResourceHandler
+		{
+			public:
+				CachedFileResourceHandler(std::unique_ptr<ITranscodeCache::IEntry> cacheEntry, std::string_view mimeType)
+				: _cacheEntry {std::move(cacheEntry)}
+				, _fileResourceHandler {createFileResourceHandler(_cacheEntry->getPath(), mimeType)}
+				{
+				}
+
+			private:
+				Wt::Http::ResponseContinuation* processRequest(const Wt::Http::Request& request, Wt::Http::Response& response) override
+				{
+					return _fileResourceHandler->processRequest(request, response);
+				}
+
+				std::unique_ptr<ITranscodeCache::IEntry>	_cacheEntry;
+				std::unique_ptr<IResourceHandler>			_fileResourceHandler;
+		};
+
+		BufferPool& getBufferPool()
+		{
+			// Shared by all the handlers, a buffer is only held while the handler is streaming
+			constexpr std::size_t bufferSize {32768};
+			constexpr std::size_t maxFreeBufferCount {64};
+
+			static BufferPool bufferPool {bufferSize, maxFreeBufferCount};
+			return bufferPool;
+		}
+	}
+
+	std::unique_ptr<ITranscoder>
+	createTranscoder(const std::filesystem::path& file, const TranscodeParameters& parameters)
+	{
+		const std::string backend {Service<IConfig>::get()->getString("transcode-backend", "ffmpeg")};
+
+		if (backend == "libav")
+		{
+#ifdef LMS_SUPPORT_LIBAV_TRANSCODER
+			return std::make_unique<LibavTranscoder>(file, parameters);
+#else
+			LMS_LOG(TRANSCODE, WARNING) << "Transcode backend 'libav' not built, using ffmpeg";
+			return std::make_unique<Transcoder>(file, parameters);
+#endif // LMS_SUPPORT_LIBAV_TRANSCODER
+		}
+		if (backend != "ffmpeg")
+			LMS_LOG(TRANSCODE, WARNING) << "Unhandled transcode backend '" << backend << "', using ffmpeg";
+
+		return std::make_unique<Transcoder>(file, parameters);
+	}
 
 	std::unique_ptr<IResourceHandler>
 	createTranscodeResourceHandler(const std::filesystem::path& trackPath, const TranscodeParameters& parameters)
 	{
-		return std::make_unique<TranscodeResourceHandler>(trackPath, parameters);
+		std::unique_ptr<ITranscodeCache::IEntryWriter> cacheEntryWriter;
+
+		if (ITranscodeCache* cache {Service<ITranscodeCache>::get()})
+		{
+			// Served as a regular file, so that range requests are supported
+			if (std::unique_ptr<ITranscodeCache::IEntry> cacheEntry {cache->getEntry(trackPath, parameters)})
+				return std::make_unique<CachedFileResourceHandler>(std::move(cacheEntry), formatToMimetype(parameters.format));
+
+			if (parameters.offset.count() > 0 && !parameters.duration)
+			{
+				// Seek: just remux the full output from the offset, if available
+				TranscodeParameters fullParameters {parameters};
+				fullParameters.offset = std::chrono::milliseconds {0};
+
+				if (std::unique_ptr<ITranscodeCache::IEntry> cacheEntry {cache->getEntry(trackPath, fullParameters)})
+					return std::make_unique<TranscodeResourceHandler>(std::move(cacheEntry), parameters);
+			}
+			else
+			{
+				// Only full outputs and segments are cached, seeks are served from full outputs
+				cacheEntryWriter = cache->createEntryWriter(trackPath, parameters);
+			}
+		}
+
+		if (ITranscodePrewarmer* prewarmer {Service<ITranscodePrewarmer>::get()})
+		{
+			if (std::unique_ptr<ITranscoder> prewarmedTranscoder {prewarmer->take(trackPath, parameters)})
+				return std::make_unique<TranscodeResourceHandler>(trackPath, parameters, std::move(prewarmedTranscoder), std::move(cacheEntryWriter));
+		}
+
+		return std::make_unique<TranscodeResourceHandler>(trackPath, parameters, std::move(cacheEntryWriter));
 	}
 
 	// TODO set some nice HTTP return code
 
-	TranscodeResourceHandler::TranscodeResourceHandler(const std::filesystem::path& trackPath, const TranscodeParameters& parameters)
-		: _transcoder {trackPath, parameters}
+	TranscodeResourceHandler::TranscodeResourceHandler(const std::filesystem::path& trackPath, const TranscodeParameters& parameters, std::unique_ptr<ITranscodeCache::IEntryWriter> cacheEntryWriter)
+		: _trackPath {trackPath}
+		, _parameters {parameters}
+		, _input {Transcoder::Input::Source}
+		, _cacheEntryWriter {std::move(cacheEntryWriter)}
+	{
+	}
+
+	TranscodeResourceHandler::TranscodeResourceHandler(std::unique_ptr<ITranscodeCache::IEntry> transcodedEntry, const TranscodeParameters& parameters)
+		: _trackPath {transcodedEntry->getPath()}
+		, _parameters {parameters}
+		, _input {Transcoder::Input::Transcoded}
+		, _transcodedEntry {std::move(transcodedEntry)}
+	{
+	}
+
+	TranscodeResourceHandler::TranscodeResourceHandler(const std::filesystem::path& trackPath, const TranscodeParameters& parameters, std::unique_ptr<ITranscoder> transcoder, std::unique_ptr<ITranscodeCache::IEntryWriter> cacheEntryWriter)
+		: _trackPath {trackPath}
+		, _parameters {parameters}
+		, _input {Transcoder::Input::Source}
+		, _transcoder {std::move(transcoder)}
+		, _cacheEntryWriter {std::move(cacheEntryWriter)}
 	{
 	}
 
 	Wt::Http::ResponseContinuation*
 	TranscodeResourceHandler::processRequest(const Wt::Http::Request& /*request*/, Wt::Http::Response& response)
 	{
-		response.setMimeType(_transcoder.getOutputMimeType());
+		response.setMimeType(std::string {formatToMimetype(_parameters.format)});
+
+		if (!_transcoder)
+		{
+			if (_input == Transcoder::Input::Transcoded)
+				_transcoder = std::make_unique<Transcoder>(_trackPath, _parameters, _input);
+			else
+				_transcoder = createTranscoder(_trackPath, _parameters);
+		}
 
 		if (_nbBytesReady > 0)
 		{
-			response.out().write(reinterpret_cast<const char *>(&_buffer[0]), _nbBytesReady);
+			response.out().write(reinterpret_cast<const char *>(_buffer.get()), _nbBytesReady);
+			if (_cacheEntryWriter)
+				_cacheEntryWriter->write(_buffer.get(), _nbBytesReady);
 			_nbBytesReady = 0;
 		}
 
-		if (!_transcoder.finished())
+		if (!_transcoder->finished())
 		{
+			if (!_buffer)
+				_buffer = getBufferPool().acquire();
+
 			Wt::Http::ResponseContinuation *continuation {response.createContinuation()};
 			continuation->waitForMoreData();
-			_transcoder.asyncRead(_buffer.data(), _buffer.size(), [=](std::size_t nbBytesRead)
+			_transcoder->asyncRead(_buffer.get(), getBufferPool().getBufferSize(), [=](std::size_t nbBytesRead)
 			{
 				assert(_nbBytesReady == 0);
 				_nbBytesReady = nbBytesRead;
@@ -60,7 +185,20 @@ namespace Av
 			return continuation;
 		}
 
+		_buffer.reset();
+
+		if (_cacheEntryWriter)
+		{
+			// The whole output has been produced: make it available for the next requests
+			// Otherwise, destroying the writer discards the partial output
+			if (_transcoder->succeeded())
+				_cacheEntryWriter->commit();
+			else
+				LMS_LOG(TRANSCODE, ERROR) << "Transcode of '" << _trackPath.string() << "' failed, not caching output";
+
+			_cacheEntryWriter.reset();
+		}
+
 		return {};
 	}
 }
-
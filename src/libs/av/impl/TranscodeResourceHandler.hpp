@@ -19,11 +19,13 @@
 
 #pragma once
 
-#include <array>
 #include <filesystem>
 
+#include "av/ITranscodeCache.hpp"
 #include "av/TranscodeParameters.hpp"
+#include "utils/BufferPool.hpp"
 #include "utils/IResourceHandler.hpp"
+#include "ITranscoder.hpp"
 #include "Transcoder.hpp"
 
 namespace Av
@@ -32,16 +34,23 @@ namespace Av
 	class TranscodeResourceHandler final : public IResourceHandler
 	{
 		public:
-			TranscodeResourceHandler(const std::filesystem::path& trackPath, const TranscodeParameters& parameters);
+			TranscodeResourceHandler(const std::filesystem::path& trackPath, const TranscodeParameters& parameters, std::unique_ptr<ITranscodeCache::IEntryWriter> cacheEntryWriter);
+			// Remux of a cached full output
+			TranscodeResourceHandler(std::unique_ptr<ITranscodeCache::IEntry> transcodedEntry, const TranscodeParameters& parameters);
+			// Already started transcoder
+			TranscodeResourceHandler(const std::filesystem::path& trackPath, const TranscodeParameters& parameters, std::unique_ptr<ITranscoder> transcoder, std::unique_ptr<ITranscodeCache::IEntryWriter> cacheEntryWriter);
 
 		private:
 			Wt::Http::ResponseContinuation* processRequest(const Wt::Http::Request& request, Wt::Http::Response& reponse) override;
 
-			static constexpr std::size_t _chunkSize {32768};
-			std::array<std::byte, _chunkSize> _buffer;
+			BufferPool::Buffer _buffer; // taken from a shared pool when reading the transcoder output
 			std::size_t _nbBytesReady {};
 			const std::filesystem::path _trackPath;
-			Transcoder _transcoder;
+			const TranscodeParameters _parameters;
+			const Transcoder::Input _input;
+			std::unique_ptr<ITranscodeCache::IEntry> _transcodedEntry; // pinned while used as input, may be null
+			std::unique_ptr<ITranscoder> _transcoder; // created on first request
+			std::unique_ptr<ITranscodeCache::IEntryWriter> _cacheEntryWriter; // may be null
 	};
 }
 
@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "TranscodeScheduler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+
+#include "utils/Logger.hpp"
+
+namespace Av
+{
+	class TranscodeScheduler::Job final : public IJob
+	{
+		public:
+			Job(TranscodeScheduler& scheduler, TranscodePriority priority, StartCallback startCallback)
+				: _scheduler {scheduler}
+				, _priority {priority}
+				, _startCallback {std::move(startCallback)}
+			{}
+
+			~Job() override
+			{
+				_scheduler.onJobDestroyed(*this);
+			}
+
+			Job(const Job&) = delete;
+			Job(Job&&) = delete;
+			Job& operator=(const Job&) = delete;
+			Job& operator=(Job&&) = delete;
+
+			bool isRunning() const override { return _running; }
+
+		private:
+			friend class TranscodeScheduler;
+
+			TranscodeScheduler&						_scheduler;
+			const TranscodePriority					_priority;
+			const StartCallback						_startCallback;
+			const std::chrono::steady_clock::time_point	_creationTime {std::chrono::steady_clock::now()};
+			std::atomic<bool>						_running {};
+			bool									_starting {}; // start callback being called, protected by the scheduler's mutex
+	};
+
+	std::unique_ptr<ITranscodeScheduler>
+	createTranscodeScheduler(std::size_t maxRunningJobCount)
+	{
+		return std::make_unique<TranscodeScheduler>(maxRunningJobCount);
+	}
+
+	TranscodeScheduler::TranscodeScheduler(std::size_t maxRunningJobCount)
+		: _maxRunningJobCount {std::max<std::size_t>(maxRunningJobCount, 1)}
+	{
+		LMS_LOG(TRANSCODE, INFO) << "Max running transcode jobs = " << _maxRunningJobCount;
+	}
+
+	std::unique_ptr<ITranscodeScheduler::IJob>
+	TranscodeScheduler::createJob(TranscodePriority priority, StartCallback startCallback)
+	{
+		auto job {std::make_unique<Job>(*this, priority, std::move(startCallback))};
+
+		std::scoped_lock lock {_mutex};
+
+		if (getQueuedJobCount() == 0 && _runningJobCount < _maxRunningJobCount)
+		{
+			job->_running = true;
+			_runningJobCount++;
+			_startedJobCount++;
+		}
+		else
+		{
+			_queuedJobs[static_cast<std::size_t>(priority)].push_back(job.get());
+			LMS_LOG(TRANSCODE, DEBUG) << "Transcode job queued, running = " << _runningJobCount << ", queued = " << getQueuedJobCount();
+		}
+
+		return job;
+	}
+
+	void
+	TranscodeScheduler::onJobDestroyed(Job& job)
+	{
+		std::unique_lock lock {_mutex};
+
+		// The job may be being started by another thread
+		_cv.wait(lock, [&] { return !job._starting; });
+
+		if (job._running)
+		{
+			assert(_runningJobCount > 0);
+			_runningJobCount--;
+			startQueuedJobs(lock);
+		}
+		else
+		{
+			auto& queue {_queuedJobs[static_cast<std::size_t>(job._priority)]};
+			auto it {std::find(std::begin(queue), std::end(queue), &job)};
+			assert(it != std::end(queue));
+			queue.erase(it);
+
+			_cancelledJobCount++;
+			LMS_LOG(TRANSCODE, DEBUG) << "Queued transcode job cancelled";
+		}
+	}
+
+	void
+	TranscodeScheduler::startQueuedJobs(std::unique_lock<std::mutex>& lock)
+	{
+		while (_runningJobCount < _maxRunningJobCount)
+		{
+			Job* job {popNextQueuedJob()};
+			if (!job)
+				break;
+
+			const std::chrono::steady_clock::duration waitTime {std::chrono::steady_clock::now() - job->_creationTime};
+			_totalWaitTime += waitTime;
+			_maxWaitTime = std::max(_maxWaitTime, waitTime);
+			_startedJobCount++;
+			_runningJobCount++;
+
+			LMS_LOG(TRANSCODE, DEBUG) << "Starting queued transcode job, waited " << std::chrono::duration_cast<std::chrono::milliseconds>(waitTime).count() << " ms";
+
+			job->_running = true;
+			job->_starting = true;
+			lock.unlock();
+
+			job->_startCallback();
+
+			lock.lock();
+			job->_starting = false;
+			_cv.notify_all();
+		}
+	}
+
+	TranscodeScheduler::Job*
+	TranscodeScheduler::popNextQueuedJob()
+	{
+		for (auto itQueue {std::rbegin(_queuedJobs)}; itQueue != std::rend(_queuedJobs); ++itQueue)
+		{
+			if (!itQueue->empty())
+			{
+				Job* job {itQueue->front()};
+				itQueue->pop_front();
+				return job;
+			}
+		}
+
+		return nullptr;
+	}
+
+	std::size_t
+	TranscodeScheduler::getQueuedJobCount() const
+	{
+		std::size_t count {};
+		for (const auto& queue : _queuedJobs)
+			count += queue.size();
+
+		return count;
+	}
+
+	ITranscodeScheduler::Stats
+	TranscodeScheduler::getStats() const
+	{
+		std::scoped_lock lock {_mutex};
+
+		Stats stats;
+		stats.maxRunningJobCount = _maxRunningJobCount;
+		stats.runningJobCount = _runningJobCount;
+		stats.queuedJobCount = getQueuedJobCount();
+		stats.startedJobCount = _startedJobCount;
+		stats.cancelledJobCount = _cancelledJobCount;
+		if (_startedJobCount > 0)
+			stats.averageWaitTime = std::chrono::duration_cast<std::chrono::milliseconds>(_totalWaitTime / _startedJobCount);
+		stats.maxWaitTime = std::chrono::duration_cast<std::chrono::milliseconds>(_maxWaitTime);
+
+		return stats;
+	}
+}
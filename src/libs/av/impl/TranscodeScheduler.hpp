@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+#include "av/ITranscodeScheduler.hpp"
+
+namespace Av
+{
+	class TranscodeScheduler final : public ITranscodeScheduler
+	{
+		public:
+			TranscodeScheduler(std::size_t maxRunningJobCount);
+			~TranscodeScheduler() override = default;
+			TranscodeScheduler(const TranscodeScheduler&) = delete;
+			TranscodeScheduler(TranscodeScheduler&&) = delete;
+			TranscodeScheduler& operator=(const TranscodeScheduler&) = delete;
+			TranscodeScheduler& operator=(TranscodeScheduler&&) = delete;
+
+		private:
+			class Job;
+
+			std::unique_ptr<IJob> createJob(TranscodePriority priority, StartCallback startCallback) override;
+			Stats getStats() const override;
+
+			void onJobDestroyed(Job& job);
+			void startQueuedJobs(std::unique_lock<std::mutex>& lock);
+			Job* popNextQueuedJob();
+			std::size_t getQueuedJobCount() const;
+
+			static constexpr std::size_t priorityCount {3};
+
+			const std::size_t					_maxRunningJobCount;
+			mutable std::mutex					_mutex;
+			std::condition_variable				_cv;
+			std::size_t							_runningJobCount {};
+			std::array<std::deque<Job*>, priorityCount>	_queuedJobs;	// indexed by priority
+
+			std::size_t							_startedJobCount {};
+			std::size_t							_cancelledJobCount {};
+			std::chrono::steady_clock::duration	_totalWaitTime {};
+			std::chrono::steady_clock::duration	_maxWaitTime {};
+	};
+}
@@ -19,6 +19,7 @@
 
 #include "Transcoder.hpp"
 
+#include <algorithm>
 #include <atomic>
 #include <iomanip>
 
@@ -35,6 +36,28 @@ namespace Av {
 static std::atomic<size_t>		globalId {};
 static std::filesystem::path	ffmpegPath;
 
+static
+std::string
+toSecondsString(std::chrono::milliseconds duration)
+{
+	std::ostringstream oss;
+	oss << std::fixed << std::showpoint << std::setprecision(3) << (duration.count() / float {1000});
+	return oss.str();
+}
+
+// About a few seconds of output: enough to absorb the reader latency,
+// without letting ffmpeg run too far ahead of slow clients
+static
+std::size_t
+getPipeSize(std::size_t bitrate)
+{
+	constexpr std::size_t minPipeSize {16384};
+	constexpr std::size_t maxPipeSize {262144};
+	constexpr std::size_t bufferedSeconds {4};
+
+	return std::clamp(bitrate / 8 * bufferedSeconds, minPipeSize, maxPipeSize);
+}
+
 void
 Transcoder::init()
 {
@@ -43,10 +66,11 @@ Transcoder::init()
 		throw Exception {"File '" + ffmpegPath.string() + "' does not exist!"};
 }
 
-Transcoder::Transcoder(const std::filesystem::path& filePath, const TranscodeParameters& parameters)
+Transcoder::Transcoder(const std::filesystem::path& filePath, const TranscodeParameters& parameters, Input input)
 :  _id {globalId++}
 , _filePath {filePath}
 , _parameters {parameters}
+, _input {input}
 {
 	start();
 }
@@ -86,80 +110,104 @@ Transcoder::start()
 	args.emplace_back("-nostdin");
 
 	// input Offset
+	if (_parameters.offset.count() > 0)
 	{
-		args.emplace_back("-ss");
+		// Use the container indexes (seek tables, TOC, ...) instead of reading the whole file until the offset
+		// Not for segments: they must start exactly at their offset to join up with the previous one
+		if (!_parameters.duration)
+		{
+			args.emplace_back("-fflags");
+			args.emplace_back("+fastseek");
+		}
 
-		std::ostringstream oss;
-		oss << std::fixed << std::showpoint << std::setprecision(3) << (_parameters.offset.count() / float {1000});
-		args.emplace_back(oss.str());
+		args.emplace_back("-ss");
+		args.emplace_back(toSecondsString(_parameters.offset));
 	}
 
 	// Input file
 	args.emplace_back("-i");
 	args.emplace_back(_filePath.string());
 
-	// Stream mapping, if set
-	if (_parameters.stream)
+	if (_input == Input::Source)
 	{
-		args.emplace_back("-map");
-		args.emplace_back("0:" + std::to_string(*_parameters.stream));
-	}
-
-	if (_parameters.stripMetadata)
-	{
-		// Strip metadata
-		args.emplace_back("-map_metadata");
-		args.emplace_back("-1");
+		// Stream mapping, if set
+		if (_parameters.stream)
+		{
+			args.emplace_back("-map");
+			args.emplace_back("0:" + std::to_string(*_parameters.stream));
+		}
+
+		if (_parameters.stripMetadata)
+		{
+			// Strip metadata
+			args.emplace_back("-map_metadata");
+			args.emplace_back("-1");
+		}
 	}
 
 	// Skip video flows (including covers)
 	args.emplace_back("-vn");
 
-	// Output bitrates
-	args.emplace_back("-b:a");
-	args.emplace_back(std::to_string(_parameters.bitrate));
-
-
-	// Codecs and formats
-	switch (_parameters.format)
+	if (_parameters.duration)
 	{
-		case Format::MP3:
-			args.emplace_back("-f");
-			args.emplace_back("mp3");
-			break;
+		args.emplace_back("-t");
+		args.emplace_back(toSecondsString(*_parameters.duration));
 
-		case Format::OGG_OPUS:
-			args.emplace_back("-acodec");
-			args.emplace_back("libopus");
-			args.emplace_back("-f");
-			args.emplace_back("ogg");
-			break;
+		// Segments keep the timestamps of the whole track
+		args.emplace_back("-output_ts_offset");
+		args.emplace_back(toSecondsString(_parameters.offset));
 
-		case Format::MATROSKA_OPUS:
-			args.emplace_back("-acodec");
-			args.emplace_back("libopus");
-			args.emplace_back("-f");
-			args.emplace_back("matroska");
-			break;
+		// The encoder delay (priming samples) is timestamped before the segment start, where players drop it as an overlap with the previous segment
+		// Do not shift the timestamps of the first segment to make them positive
+		args.emplace_back("-avoid_negative_ts");
+		args.emplace_back("disabled");
+	}
 
-		case Format::OGG_VORBIS:
-			args.emplace_back("-acodec");
-			args.emplace_back("libvorbis");
-			args.emplace_back("-f");
-			args.emplace_back("ogg");
-			break;
+	const char* codec {};
+	const char* format {};
 
-		case Format::WEBM_VORBIS:
-			args.emplace_back("-acodec");
-			args.emplace_back("libvorbis");
-			args.emplace_back("-f");
-			args.emplace_back("webm");
-			break;
+	// Codecs and formats
+	switch (_parameters.format)
+	{
+		case Format::MP3:			format = "mp3"; break;	// muxer's default codec
+		case Format::OGG_OPUS:		codec = "libopus"; format = "ogg"; break;
+		case Format::MATROSKA_OPUS:	codec = "libopus"; format = "matroska"; break;
+		case Format::OGG_VORBIS:	codec = "libvorbis"; format = "ogg"; break;
+		case Format::WEBM_VORBIS:	codec = "libvorbis"; format = "webm"; break;
+		case Format::MPEGTS_AAC:	codec = "aac"; format = "mpegts"; break;
 
 		default:
 			throw Exception {"Unhandled format (" + std::to_string(static_cast<int>(_parameters.format)) + ")"};
 	}
 
+	if (_input == Input::Transcoded)
+	{
+		// Already encoded with the requested parameters
+		args.emplace_back("-acodec");
+		args.emplace_back("copy");
+	}
+	else
+	{
+		if (codec)
+		{
+			args.emplace_back("-acodec");
+			args.emplace_back(codec);
+		}
+
+		if (_parameters.gain)
+		{
+			args.emplace_back("-af");
+			args.emplace_back("volume=" + std::to_string(*_parameters.gain) + "dB");
+		}
+
+		// Output bitrates
+		args.emplace_back("-b:a");
+		args.emplace_back(std::to_string(_parameters.bitrate));
+	}
+
+	args.emplace_back("-f");
+	args.emplace_back(format);
+
 	_outputMimeType = formatToMimetype(_parameters.format);
 
 	args.emplace_back("pipe:1");
@@ -168,10 +216,9 @@ Transcoder::start()
 	for (const std::string& arg : args)
 		LOG(DEBUG) << "Arg = '" << arg << "'";
 
-	// Caution: stdin must have been closed before
 	try
 	{
-		_childProcess = Service<IChildProcessManager>::get()->spawnChildProcess(ffmpegPath, args);
+		_childProcess = Service<IChildProcessManager>::get()->spawnChildProcess(ffmpegPath, args, getPipeSize(_parameters.bitrate));
 	}
 	catch (ChildProcessException& exception)
 	{
@@ -219,4 +266,12 @@ Transcoder::finished() const
 	return _childProcess->finished();
 }
 
+bool
+Transcoder::succeeded() const
+{
+	assert(_childProcess);
+
+	return _childProcess->exitedSuccessfully();
+}
+
 } // namespace Transcode
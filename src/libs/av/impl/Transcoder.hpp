@@ -24,16 +24,24 @@
 
 #include "av/TranscodeParameters.hpp"
 #include "av/Types.hpp"
+#include "ITranscoder.hpp"
 
 class IChildProcess;
 
 namespace Av
 {
-	class Transcoder
+	// Forks a ffmpeg process and reads its output
+	class Transcoder final : public ITranscoder
 	{
 		public:
-			Transcoder(const std::filesystem::path& file, const TranscodeParameters& parameters);
-			~Transcoder();
+			enum class Input
+			{
+				Source,
+				Transcoded,	// output of a previous full transcode with the same parameters: only remuxed from the offset
+			};
+
+			Transcoder(const std::filesystem::path& file, const TranscodeParameters& parameters, Input input = Input::Source);
+			~Transcoder() override;
 
 			Transcoder(const Transcoder&) = delete;
 			Transcoder& operator=(const Transcoder&) = delete;
@@ -44,14 +52,14 @@ namespace Av
 			void			asyncWaitForData(WaitCallback cb);
 
 			// non blocking calls
-			using ReadCallback = std::function<void(std::size_t nbReadBytes)>;
-			void			asyncRead(std::byte* buffer, std::size_t bufferSize, ReadCallback);
+			void			asyncRead(std::byte* buffer, std::size_t bufferSize, ReadCallback) override;
 			std::size_t		readSome(std::byte* buffer, std::size_t bufferSize);
 
-			const std::string&	getOutputMimeType() const { return _outputMimeType; }
+			const std::string&	getOutputMimeType() const override { return _outputMimeType; }
 			const TranscodeParameters& getParameters() const { return _parameters; }
 
-			bool			finished() const;
+			bool			finished() const override;
+			bool			succeeded() const override;
 
 		private:
 			static void init();
@@ -61,6 +69,7 @@ namespace Av
 			const std::size_t		_id {};
 			const std::filesystem::path	_filePath;
 			const TranscodeParameters	_parameters;
+			const Input					_input;
 
 			std::unique_ptr<IChildProcess>	_childProcess;
 
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+
+namespace Av
+{
+	struct TranscodeParameters;
+
+	// Transcoded outputs, stored on disk and evicted on a least recently used basis
+	class ITranscodeCache
+	{
+		public:
+			virtual ~ITranscodeCache() = default;
+
+			// Cached output, its file is not evicted as long as this object lives
+			class IEntry
+			{
+				public:
+					virtual ~IEntry() = default;
+
+					virtual const std::filesystem::path& getPath() const = 0;
+			};
+
+			// Returns nullptr if there is no cached output
+			virtual std::unique_ptr<IEntry> getEntry(const std::filesystem::path& trackPath, const TranscodeParameters& parameters) = 0;
+
+			// No side effect: not accounted in the stats, does not mark the entry as used
+			virtual bool contains(const std::filesystem::path& trackPath, const TranscodeParameters& parameters) const = 0;
+
+			// Used to fill an entry while the output is being produced
+			// Destroying the writer without committing discards the entry
+			class IEntryWriter
+			{
+				public:
+					virtual ~IEntryWriter() = default;
+
+					virtual void write(const std::byte* data, std::size_t size) = 0;
+					virtual void commit() = 0;
+			};
+
+			// Returns nullptr if the entry cannot be created (already being written, ...)
+			virtual std::unique_ptr<IEntryWriter> createEntryWriter(const std::filesystem::path& trackPath, const TranscodeParameters& parameters) = 0;
+
+			struct Stats
+			{
+				std::size_t entryCount {};
+				std::size_t size {};
+				std::size_t hits {};
+				std::size_t misses {};
+			};
+			virtual Stats getStats() const = 0;
+	};
+
+	std::unique_ptr<ITranscodeCache> createTranscodeCache(const std::filesystem::path& cacheDirectory, std::size_t maxSize);
+}
+
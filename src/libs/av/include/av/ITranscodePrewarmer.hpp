@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+
+namespace Av
+{
+	class ITranscoder;
+	struct TranscodeParameters;
+
+	// Starts transcodes before they are requested (next track in a play queue, ...)
+	// The output is buffered and handed to the first matching transcode resource handler
+	class ITranscodePrewarmer
+	{
+		public:
+			virtual ~ITranscodePrewarmer() = default;
+
+			// Does nothing if there is no free transcode slot or if the output is already cached
+			// Prewarmed transcodes hold a transcode slot until they are taken or discarded
+			virtual void prewarm(const std::filesystem::path& trackPath, const TranscodeParameters& parameters) = 0;
+
+			// Takes the matching prewarmed transcode, if any (null otherwise), its transcode slot is released
+			virtual std::unique_ptr<ITranscoder> take(const std::filesystem::path& trackPath, const TranscodeParameters& parameters) = 0;
+	};
+
+	// Unused prewarmed transcodes are discarded after maxAge
+	std::unique_ptr<ITranscodePrewarmer> createTranscodePrewarmer(std::size_t maxBufferSize, std::chrono::seconds maxAge);
+}
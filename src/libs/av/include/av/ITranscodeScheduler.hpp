@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+namespace Av
+{
+	enum class TranscodePriority
+	{
+		Low,		// background work, downloads
+		Normal,		// API clients, that may prefetch several tracks
+		High,		// live playback
+	};
+
+	// Limits the number of transcode jobs running at the same time
+	// Queued jobs are started by priority, then by creation order
+	class ITranscodeScheduler
+	{
+		public:
+			virtual ~ITranscodeScheduler() = default;
+
+			// Destroying a job cancels it if still queued, or frees its slot
+			// Must not be destroyed from its start callback
+			class IJob
+			{
+				public:
+					virtual ~IJob() = default;
+
+					virtual bool isRunning() const = 0;
+			};
+
+			// The job is started right away if a slot is available, in that case the callback is not called
+			// Otherwise the job is queued and the callback is called from another thread once the job is started
+			using StartCallback = std::function<void()>;
+			virtual std::unique_ptr<IJob> createJob(TranscodePriority priority, StartCallback startCallback) = 0;
+
+			struct Stats
+			{
+				std::size_t maxRunningJobCount {};
+				std::size_t runningJobCount {};
+				std::size_t queuedJobCount {};
+				std::size_t startedJobCount {};
+				std::size_t cancelledJobCount {};	// cancelled while being queued
+				std::chrono::milliseconds averageWaitTime {};	// of started jobs
+				std::chrono::milliseconds maxWaitTime {};
+			};
+			virtual Stats getStats() const = 0;
+	};
+
+	std::unique_ptr<ITranscodeScheduler> createTranscodeScheduler(std::size_t maxRunningJobCount);
+}
@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <filesystem>
+#include <optional>
+
+namespace Av
+{
+	struct LoudnessInfo
+	{
+		double	integratedLoudness {};	// LUFS
+		float	samplePeak {};			// 1.0 is full scale
+	};
+
+	// False if LMS was built without loudness analysis support
+	bool isLoudnessAnalysisSupported();
+
+	// Decodes the whole file, may be slow
+	// None if the loudness cannot be measured (silence, too short)
+	// Throws Av::Exception on error
+	std::optional<LoudnessInfo> computeLoudness(const std::filesystem::path& file);
+}
+
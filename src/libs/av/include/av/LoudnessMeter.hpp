@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+namespace Av
+{
+	// EBU R128 (ITU-R BS.1770) integrated loudness meter
+	// Only mono and stereo inputs are handled (all the channels have the same weight)
+	class LoudnessMeter
+	{
+		public:
+			LoudnessMeter(std::size_t channelCount, std::size_t sampleRate);
+
+			// interleaved samples, 1.0 is full scale
+			void addSamples(const float* samples, std::size_t frameCount);
+
+			// In LUFS, none if the input is too short or silent
+			std::optional<double>	getIntegratedLoudness() const;
+			float					getSamplePeak() const { return _samplePeak; }
+
+		private:
+			struct Biquad
+			{
+				std::array<double, 3> b {};
+				std::array<double, 3> a {};
+			};
+
+			struct FilterState
+			{
+				std::array<double, 2> preFilter {};
+				std::array<double, 2> rlbFilter {};
+			};
+
+			static double	applyFilter(const Biquad& filter, std::array<double, 2>& state, double sample);
+			void			processSubBlock();
+
+			const std::size_t			_channelCount;
+			const std::size_t			_subBlockFrameCount;	// 100ms
+			Biquad						_preFilter;
+			Biquad						_rlbFilter;
+			std::vector<FilterState>	_filterStates;
+
+			double						_subBlockEnergy {};
+			std::size_t					_subBlockFrameIndex {};
+			std::array<double, 3>		_previousSubBlockEnergies {};
+			std::size_t					_subBlockCount {};
+			std::vector<double>			_blockEnergies;			// 400ms blocks, overlapped by 75%
+			float						_samplePeak {};
+	};
+}
+
@@ -32,6 +32,8 @@ struct TranscodeParameters
 	std::size_t					bitrate {128000};
 	std::optional<std::size_t>	stream; // Id of the stream to be transcoded (auto detect by default)
 	std::chrono::milliseconds	offset {0};
+	std::optional<std::chrono::milliseconds>	duration;	// Max output duration, used to produce segments (whole track by default)
+	std::optional<float>		gain;		// In dB, applied while transcoding (replay gain)
 	bool 						stripMetadata {true};
 };
 
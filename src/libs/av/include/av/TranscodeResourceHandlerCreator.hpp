@@ -28,6 +28,7 @@ namespace Av
 {
 	struct TranscodeParameters;
 
+	// Streams are not limited by the transcode scheduler: they are paced by the clients and would hold a slot during the whole playback
 	std::unique_ptr<IResourceHandler> createTranscodeResourceHandler(const std::filesystem::path& trackPath, const TranscodeParameters& parameters);
 }
 
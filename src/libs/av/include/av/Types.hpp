@@ -39,6 +39,7 @@ namespace Av {
 		MATROSKA_OPUS	= 2,
 		OGG_VORBIS		= 3,
 		WEBM_VORBIS		= 4,
+		MPEGTS_AAC		= 5,	// used for segments
 	};
 
 	std::string_view formatToMimetype(Format format);
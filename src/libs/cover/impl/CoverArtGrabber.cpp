@@ -19,6 +19,8 @@
 
 #include "CoverArtGrabber.hpp"
 
+#include <sstream>
+
 #include "av/IAudioFile.hpp"
 
 #include "database/Release.hpp"
@@ -34,8 +36,9 @@ using RawImage = CoverArt::GraphicsMagick::RawImage;
 #endif
 
 #include "utils/Logger.hpp"
-#include "utils/Random.hpp"
+#include "utils/String.hpp"
 #include "utils/Utils.hpp"
+#include "DominantColor.hpp"
 #include "Exception.hpp"
 
 namespace
@@ -43,8 +46,8 @@ namespace
 	struct TrackInfo
 	{
 		bool hasCover {};
-		bool isMultiDisc {};
 		std::filesystem::path trackPath;
+		std::filesystem::path coverPath;
 		std::optional<Database::ReleaseId> releaseId;
 	};
 
@@ -63,13 +66,10 @@ namespace
 
 		res->hasCover = track->hasCover();
 		res->trackPath = track->getPath();
+		res->coverPath = track->getCoverPath();
 
 		if (const Database::Release::pointer& release {track->getRelease()})
-		{
 			res->releaseId = release->getId();
-			if (release->getTotalDisc() > 1)
-				res->isMultiDisc = true;
-		}
 
 		return res;
 	}
@@ -77,45 +77,57 @@ namespace
 
 namespace CoverArt {
 
-static
-bool
-isFileSupported(const std::filesystem::path& file, const std::vector<std::filesystem::path>& extensions)
-{
-	return (std::find(std::cbegin(extensions), std::cend(extensions), file.extension()) != std::cend(extensions));
-}
+// Only used to size the access frequency history of the cache
+static constexpr std::size_t averageCoverSize {32 * 1024};
 
 std::unique_ptr<IGrabber>
 createGrabber(const std::filesystem::path& execPath,
 		const std::filesystem::path& defaultCoverPath,
-		std::size_t maxCacheSize, std::size_t maxFileSize, unsigned jpegQuality)
+		std::size_t maxCacheSize, std::size_t maxFileSize, unsigned jpegQuality, unsigned webpQuality,
+		const std::filesystem::path& diskCacheDirectory, std::size_t maxDiskCacheSize)
 {
-	return std::make_unique<Grabber>(execPath, defaultCoverPath, maxCacheSize, maxFileSize, jpegQuality);
+	return std::make_unique<Grabber>(execPath, defaultCoverPath, maxCacheSize, maxFileSize, jpegQuality, webpQuality, diskCacheDirectory, maxDiskCacheSize);
 }
 
 Grabber::Grabber(const std::filesystem::path& execPath,
 		const std::filesystem::path& defaultCoverPath,
 		std::size_t maxCacheSize,
 		std::size_t maxFileSize,
-		unsigned jpegQuality)
-	: _defaultCoverPath {defaultCoverPath}
+		unsigned jpegQuality,
+		unsigned webpQuality,
+		const std::filesystem::path& diskCacheDirectory,
+		std::size_t maxDiskCacheSize)
+	: _cache {maxCacheSize, maxCacheSize / averageCoverSize}
+	, _defaultCoverPath {defaultCoverPath}
 	, _maxCacheSize {maxCacheSize}
 	, _maxFileSize {maxFileSize}
 	, _jpegQuality {Utils::clamp<unsigned>(jpegQuality, 1, 100)}
+	, _webpQuality {Utils::clamp<unsigned>(webpQuality, 1, 100)}
 {
-	LMS_LOG(COVER, INFO) << "Default cover path = '" << _defaultCoverPath.string() << "'";
-	LMS_LOG(COVER, INFO) << "Max cache size = " << _maxCacheSize;
-	LMS_LOG(COVER, INFO) << "Max file size = " << _maxFileSize;
-	LMS_LOG(COVER, INFO) << "JPEG export quality = " << _jpegQuality;
-
 #if LMS_SUPPORT_IMAGE_GM
+	// Must be done before querying the supported formats
 	GraphicsMagick::init(execPath);
 #else
 	(void)execPath;
 #endif
 
+	_webpSupported = RawImage::isEncodingSupported(ImageFormat::WebP);
+
+	LMS_LOG(COVER, INFO) << "Default cover path = '" << _defaultCoverPath.string() << "'";
+	LMS_LOG(COVER, INFO) << "Max cache size = " << _maxCacheSize;
+	LMS_LOG(COVER, INFO) << "Max file size = " << _maxFileSize;
+	LMS_LOG(COVER, INFO) << "JPEG export quality = " << _jpegQuality;
+	if (_webpSupported)
+		LMS_LOG(COVER, INFO) << "WebP export quality = " << _webpQuality;
+	else
+		LMS_LOG(COVER, INFO) << "WebP export not supported";
+
+	if (maxDiskCacheSize > 0)
+		_diskCache = std::make_unique<DiskCache>(diskCacheDirectory, maxDiskCacheSize);
+
 	try
 	{
-		getDefault(512);
+		getDefault(512, ImageFormat::JPEG);
 	}
 	catch (const ImageException& e)
 	{
@@ -124,7 +136,7 @@ Grabber::Grabber(const std::filesystem::path& execPath,
 }
 
 std::unique_ptr<IEncodedImage>
-Grabber::getFromAvMediaFile(const Av::IAudioFile& input, ImageSize width) const
+Grabber::getFromAvMediaFile(const Av::IAudioFile& input, ImageSize width, ImageFormat format) const
 {
 	std::unique_ptr<IEncodedImage> image;
 
@@ -135,9 +147,9 @@ Grabber::getFromAvMediaFile(const Av::IAudioFile& input, ImageSize width) const
 
 		try
 		{
-			RawImage rawImage {picture.data, picture.dataSize};
+			RawImage rawImage {picture.data, picture.dataSize, width};
 			rawImage.resize(width);
-			image = rawImage.encodeToJPEG(_jpegQuality);
+			image = rawImage.encode(format, getQuality(format));
 		}
 		catch (const ImageException& e)
 		{
@@ -148,227 +160,149 @@ Grabber::getFromAvMediaFile(const Av::IAudioFile& input, ImageSize width) const
 	return image;
 }
 
-std::unique_ptr<IEncodedImage>
-Grabber::getFromCoverFile(const std::filesystem::path& p, ImageSize width) const
+std::shared_ptr<IEncodedImage>
+Grabber::getFromCoverFile(const std::filesystem::path& p, ImageSize width, ImageFormat format) const
 {
-	std::unique_ptr<IEncodedImage> image;
-
-	try
-	{
-		RawImage rawImage {p};
-		rawImage.resize(width);
-		image = rawImage.encodeToJPEG(_jpegQuality);
-	}
-	catch (const ImageException& e)
+	return _sourceFlights.run(computeSourceFlightKey("file", p, width, format), [&]
 	{
-		LMS_LOG(COVER, ERROR) << "Cannot read cover in file '" << p.string() << "': " << e.what();
-	}
+		const std::optional<std::string> diskCacheKey {computeDiskCacheKey("file", p, width, format)};
 
-	return image;
+		std::shared_ptr<IEncodedImage> image {loadFromDiskCache(diskCacheKey)};
+		if (image)
+			return image;
+
+		if (isCoverFileTooBig(p))
+			return image;
+
+		try
+		{
+			RawImage rawImage {p, width};
+			rawImage.resize(width);
+			image = rawImage.encode(format, getQuality(format));
+		}
+		catch (const ImageException& e)
+		{
+			LMS_LOG(COVER, ERROR) << "Cannot read cover in file '" << p.string() << "': " << e.what();
+		}
+
+		saveToDiskCache(diskCacheKey, image);
+
+		return image;
+	});
 }
 
 std::shared_ptr<IEncodedImage>
-Grabber::getDefault(ImageSize width)
+Grabber::getDefault(ImageSize width, ImageFormat format)
 {
 	{
-		std::shared_lock lock {_cacheMutex};
+		std::shared_lock lock {_defaultCoverCacheMutex};
 
-		if (auto it {_defaultCoverCache.find(width)}; it != std::cend(_defaultCoverCache))
+		if (auto it {_defaultCoverCache.find({width, format})}; it != std::cend(_defaultCoverCache))
 			return it->second;
 	}
 
 	{
-		std::unique_lock lock {_cacheMutex};
+		std::unique_lock lock {_defaultCoverCacheMutex};
 
-		if (auto it {_defaultCoverCache.find(width)}; it != std::cend(_defaultCoverCache))
+		if (auto it {_defaultCoverCache.find({width, format})}; it != std::cend(_defaultCoverCache))
 			return it->second;
 
-		std::shared_ptr<IEncodedImage> image {getFromCoverFile(_defaultCoverPath, width)};
-		_defaultCoverCache[width] = image;
+		std::shared_ptr<IEncodedImage> image {getFromCoverFile(_defaultCoverPath, width, format)};
+		_defaultCoverCache[{width, format}] = image;
 		LMS_LOG(COVER, DEBUG) << "Default cache entries = " << _defaultCoverCache.size();
 
 		return image;
 	}
 }
 
-std::unique_ptr<IEncodedImage>
-Grabber::getFromDirectory(const std::filesystem::path& directory, ImageSize width) const
+std::shared_ptr<IEncodedImage>
+Grabber::getFromTrack(const std::filesystem::path& p, ImageSize width, ImageFormat format) const
 {
-	const std::multimap<std::string, std::filesystem::path> coverPaths {getCoverPaths(directory)};
-
-	auto tryLoadImageFromFilename = [&](std::string_view fileName)
+	return _sourceFlights.run(computeSourceFlightKey("embedded", p, width, format), [&]
 	{
-		std::unique_ptr<IEncodedImage> image;
-
-		auto range {coverPaths.equal_range(std::string {fileName})};
-		for (auto it {range.first}; it != range.second; ++it)
-		{
-			image = getFromCoverFile(it->second, width);
-			if (image)
-				break;
-		}
-		return image;
-	};
-
-	std::unique_ptr<IEncodedImage> image;
+		// Keyed on the track file identity, so that a hit does not even need to parse the file
+		const std::optional<std::string> diskCacheKey {computeDiskCacheKey("embedded", p, width, format)};
 
-	for (std::string_view filename : _preferredFileNames)
-	{
-		image = tryLoadImageFromFilename(filename);
+		std::shared_ptr<IEncodedImage> image {loadFromDiskCache(diskCacheKey)};
 		if (image)
 			return image;
-	}
 
-	// Just pick one
-	for (const auto& [filename, coverPath] : coverPaths)
-	{
-		image = getFromCoverFile(coverPath, width);
-		if (image)
-			return image;
-	}
-
-	return image;
-}
-
-std::unique_ptr<IEncodedImage>
-Grabber::getFromSameNamedFile(const std::filesystem::path& filePath, ImageSize width) const
-{
-	std::unique_ptr<IEncodedImage> res;
-
-	std::filesystem::path coverPath {filePath};
-	for (const std::filesystem::path& extension : _fileExtensions)
-	{
-		coverPath.replace_extension(extension);
-
-		if (!checkCoverFile(coverPath))
-			continue;
-
-		res = getFromCoverFile(coverPath, width);
-		if (res)
-			break;
-	}
-
-	return res;
-}
-
-bool
-Grabber::checkCoverFile(const std::filesystem::path& filePath) const
-{
-	std::error_code ec;
-
-	if (!isFileSupported(filePath, _fileExtensions))
-		return false;
-
-	if (!std::filesystem::exists(filePath, ec))
-		return false;
-
-	if (!std::filesystem::is_regular_file(filePath, ec))
-		return false;
-
-	if (std::filesystem::file_size(filePath, ec) > _maxFileSize && !ec)
-	{
-		LMS_LOG(COVER, INFO) << "Cover file '" << filePath.string() << " is too big (" << std::filesystem::file_size(filePath, ec) << "), limit is " << _maxFileSize;
-		return false;
-	}
-
-	return true;
-}
-
-std::multimap<std::string, std::filesystem::path>
-Grabber::getCoverPaths(const std::filesystem::path& directoryPath) const
-{
-	std::multimap<std::string, std::filesystem::path> res;
-	std::error_code ec;
-
-	std::filesystem::directory_iterator itPath(directoryPath, ec);
-	std::filesystem::directory_iterator itEnd;
-	while (!ec && itPath != itEnd)
-	{
-		const std::filesystem::path& path {*itPath};
-
-		if (checkCoverFile(path))
-			res.emplace(std::filesystem::path{ path }.filename().replace_extension("").string(), path);
-
-		itPath.increment(ec);
-	}
-
-	return res;
-}
+		try
+		{
+			image = getFromAvMediaFile(*Av::parseAudioFile(p), width, format);
+		}
+		catch (Av::Exception& e)
+		{
+			LMS_LOG(COVER, ERROR) << "Cannot get covers from track " << p.string() << ": " << e.what();
+		}
 
-std::unique_ptr<IEncodedImage>
-Grabber::getFromTrack(const std::filesystem::path& p, ImageSize width) const
-{
-	std::unique_ptr<IEncodedImage> image;
+		saveToDiskCache(diskCacheKey, image);
 
-	try
-	{
-		image = getFromAvMediaFile(*Av::parseAudioFile(p), width);
-	}
-	catch (Av::Exception& e)
-	{
-		LMS_LOG(COVER, ERROR) << "Cannot get covers from track " << p.string() << ": " << e.what();
-	}
-
-	return image;
+		return image;
+	});
 }
 
 std::shared_ptr<IEncodedImage>
-Grabber::getFromTrack(Database::Session& dbSession, Database::TrackId trackId, ImageSize width)
+Grabber::getFromTrack(Database::Session& dbSession, Database::TrackId trackId, ImageSize width, ImageFormat format)
 {
-	return getFromTrack(dbSession, trackId, width, true /* allow release fallback*/);
+	return getFromTrack(dbSession, trackId, width, format, true /* allow release fallback*/);
 }
 
 std::shared_ptr<IEncodedImage>
-Grabber::getFromTrack(Database::Session& dbSession, Database::TrackId trackId, ImageSize width, bool allowReleaseFallback)
+Grabber::getFromTrack(Database::Session& dbSession, Database::TrackId trackId, ImageSize width, ImageFormat format, bool allowReleaseFallback)
 {
 	using namespace Database;
 
-	const CacheEntryDesc cacheEntryDesc {trackId, width};
+	const CacheEntryDesc cacheEntryDesc {trackId, width, format};
 
-	std::shared_ptr<IEncodedImage> cover {loadFromCache(cacheEntryDesc)};
-	if (cover)
+	if (std::shared_ptr<IEncodedImage> cover {loadFromCache(cacheEntryDesc)})
 		return cover;
 
-	if (const std::optional<TrackInfo> trackInfo {getTrackInfo(dbSession, trackId)})
+	auto computeCover {[&]
 	{
-		if (trackInfo->hasCover)
-			cover = getFromTrack(trackInfo->trackPath, width);
+		std::shared_ptr<IEncodedImage> cover;
 
-		if (!cover)
-			cover = getFromSameNamedFile(trackInfo->trackPath, width);
+		if (const std::optional<TrackInfo> trackInfo {getTrackInfo(dbSession, trackId)})
+		{
+			if (trackInfo->hasCover)
+				cover = getFromTrack(trackInfo->trackPath, width, format);
 
-		if (!cover && trackInfo->releaseId && allowReleaseFallback)
-			cover = getFromRelease(dbSession, *trackInfo->releaseId, width);
+			if (!cover && !trackInfo->coverPath.empty())
+				cover = getFromCoverFile(trackInfo->coverPath, width, format);
 
-		if (!cover && trackInfo->isMultiDisc)
-		{
-			if (trackInfo->trackPath.parent_path().has_parent_path())
-				cover = getFromDirectory(trackInfo->trackPath.parent_path().parent_path(), width);
+			if (!cover && trackInfo->releaseId && allowReleaseFallback)
+				cover = getFromRelease(dbSession, *trackInfo->releaseId, width, format);
 		}
-	}
 
-	if (!cover)
-		cover = getDefault(width);
+		if (!cover)
+			cover = getDefault(width, format);
+
+		if (cover)
+			saveToCache(cacheEntryDesc, cover);
+
+		return cover;
+	}};
 
-	if (cover)
-		saveToCache(cacheEntryDesc, cover);
+	// Called from getFromRelease when release fallback is not allowed: joining a flight here
+	// could deadlock with a flight of the same track waiting for this release
+	if (!allowReleaseFallback)
+		return computeCover();
 
-	return cover;
+	return _coverFlights.run(cacheEntryDesc, computeCover);
 }
 
 std::shared_ptr<IEncodedImage>
-Grabber::getFromRelease(Database::Session& session, Database::ReleaseId releaseId, ImageSize width)
+Grabber::getFromRelease(Database::Session& session, Database::ReleaseId releaseId, ImageSize width, ImageFormat format)
 {
-	const CacheEntryDesc cacheEntryDesc {releaseId, width};
+	const CacheEntryDesc cacheEntryDesc {releaseId, width, format};
 
-	std::shared_ptr<IEncodedImage> cover {loadFromCache(cacheEntryDesc)};
-	if (cover)
+	if (std::shared_ptr<IEncodedImage> cover {loadFromCache(cacheEntryDesc)})
 		return cover;
 
 	struct ReleaseInfo
 	{
 		Database::TrackId firstTrackId;
-		std::filesystem::path releaseDirectory;
+		std::filesystem::path coverPath;
 	};
 
 	auto getReleaseInfo {[&]
@@ -383,71 +317,280 @@ Grabber::getFromRelease(Database::Session& session, Database::ReleaseId releaseI
 			{
 				res = ReleaseInfo {};
 				res->firstTrackId = firstTrack->getId();
-				res->releaseDirectory = firstTrack->getPath().parent_path();
+				res->coverPath = release->getCoverPath();
 			}
 		}
 
 		return res;
 	}};
 
-	if (const std::optional<ReleaseInfo> releaseInfo {getReleaseInfo()})
+	return _coverFlights.run(cacheEntryDesc, [&]
 	{
-		cover = getFromDirectory(releaseInfo->releaseDirectory, width);
+		std::shared_ptr<IEncodedImage> cover;
+
+		if (const std::optional<ReleaseInfo> releaseInfo {getReleaseInfo()})
+		{
+			if (!releaseInfo->coverPath.empty())
+				cover = getFromCoverFile(releaseInfo->coverPath, width, format);
+			if (!cover)
+				cover = getFromTrack(session, releaseInfo->firstTrackId, width, format, false /* no release fallback */);
+		}
+
 		if (!cover)
-			cover = getFromTrack(session, releaseInfo->firstTrackId, width, false /* no release fallback */);
+			cover = getDefault(width, format);
+
+		if (cover)
+			saveToCache(cacheEntryDesc, cover);
+
+		return cover;
+	});
+}
+
+std::optional<RGBColor>
+Grabber::computeReleaseColor(Database::Session& session, Database::ReleaseId releaseId)
+{
+	// Enough pixels to get the dominant color, and much faster to decode
+	constexpr ImageSize sampleSize {32};
+
+	std::filesystem::path releaseCoverPath;
+	std::optional<Database::TrackId> firstTrackId;
+	{
+		auto transaction {session.createSharedTransaction()};
+
+		const Database::Release::pointer release {Database::Release::getById(session, releaseId)};
+		if (!release)
+			return std::nullopt;
+
+		releaseCoverPath = release->getCoverPath();
+		if (const auto firstTrack {release->getFirstTrack()})
+			firstTrackId = firstTrack->getId();
 	}
 
-	if (!cover)
-		cover = getDefault(width);
+	auto computeColor {[](RawImage& rawImage)
+	{
+		rawImage.resize(sampleSize);
+		const std::vector<std::byte> pixels {rawImage.getRGBPixels()};
+		return computeDominantColor(pixels.data(), pixels.size() / 3);
+	}};
+
+	std::optional<RGBColor> color;
+
+	auto computeColorFromCoverFile {[&](const std::filesystem::path& p)
+	{
+		if (p.empty() || isCoverFileTooBig(p))
+			return;
+
+		try
+		{
+			RawImage rawImage {p, sampleSize};
+			color = computeColor(rawImage);
+		}
+		catch (const ImageException& e)
+		{
+			LMS_LOG(COVER, ERROR) << "Cannot read cover in file '" << p.string() << "': " << e.what();
+		}
+	}};
+
+	// Same sources as getFromRelease
+	computeColorFromCoverFile(releaseCoverPath);
+
+	const std::optional<TrackInfo> trackInfo {firstTrackId ? getTrackInfo(session, *firstTrackId) : std::nullopt};
+	if (!color && trackInfo && trackInfo->hasCover)
+	{
+		try
+		{
+			Av::parseAudioFile(trackInfo->trackPath)->visitAttachedPictures([&](const Av::Picture& picture)
+			{
+				if (color)
+					return;
+
+				try
+				{
+					RawImage rawImage {picture.data, picture.dataSize, sampleSize};
+					color = computeColor(rawImage);
+				}
+				catch (const ImageException& e)
+				{
+					LMS_LOG(COVER, ERROR) << "Cannot read embedded cover: " << e.what();
+				}
+			});
+		}
+		catch (Av::Exception& e)
+		{
+			LMS_LOG(COVER, ERROR) << "Cannot get covers from track " << trackInfo->trackPath.string() << ": " << e.what();
+		}
+	}
 
-	if (cover)
-		saveToCache(cacheEntryDesc, cover);
+	if (!color && trackInfo)
+		computeColorFromCoverFile(trackInfo->coverPath);
 
-	return cover;
+	return color;
 }
 
 void
 Grabber::flushCache()
 {
-	std::unique_lock lock {_cacheMutex};
+	const Stats stats {getStats()};
+
+	auto logStats {[](std::string_view cacheName, const CacheStats& cacheStats)
+	{
+		LMS_LOG(COVER, DEBUG) << cacheName << " cache stats: hits = " << cacheStats.hits << ", misses = " << cacheStats.misses
+			<< ", hit rate = " << cacheStats.getHitRatePercent() << "%"
+			<< ", nb entries = " << cacheStats.entryCount << ", size = " << cacheStats.size;
+	}};
+
+	logStats("Memory", stats.memoryCache);
+	if (stats.diskCache)
+		logStats("Disk", *stats.diskCache);
 
-	LMS_LOG(COVER, DEBUG) << "Cache stats: hits = " << _cacheHits << ", misses = " << _cacheMisses << ", nb entries = " << _cache.size() << ", size = " << _cacheSize;
-	_cacheHits = 0;
-	_cacheMisses = 0;
-	_cacheSize = 0;
 	_cache.clear();
 }
 
-void
-Grabber::saveToCache(const CacheEntryDesc& entryDesc, std::shared_ptr<IEncodedImage> image)
+IGrabber::Stats
+Grabber::getStats() const
+{
+	Stats stats;
+
+	const Cache::Stats memoryCacheStats {_cache.getStats()};
+	stats.memoryCache.entryCount = memoryCacheStats.entryCount;
+	stats.memoryCache.size = memoryCacheStats.weight;
+	stats.memoryCache.hits = memoryCacheStats.hits;
+	stats.memoryCache.misses = memoryCacheStats.misses;
+	stats.memoryCache.evictions = memoryCacheStats.evictions;
+	stats.memoryCache.rejections = memoryCacheStats.rejections;
+
+	if (_diskCache)
+	{
+		const DiskCache::Stats diskCacheStats {_diskCache->getStats()};
+
+		stats.diskCache = CacheStats {};
+		stats.diskCache->entryCount = diskCacheStats.entryCount;
+		stats.diskCache->size = diskCacheStats.size;
+		stats.diskCache->hits = diskCacheStats.hits;
+		stats.diskCache->misses = diskCacheStats.misses;
+	}
+
+	return stats;
+}
+
+ImageFormat
+Grabber::selectFormat(std::string_view httpAcceptHeader) const
+{
+	if (!_webpSupported)
+		return ImageFormat::JPEG;
+
+	// Ex: "image/avif,image/webp,*/*;q=0.8"
+	for (std::string_view mediaRange : StringUtils::splitString(httpAcceptHeader, ","))
+	{
+		const std::vector<std::string_view> params {StringUtils::splitString(mediaRange, ";")};
+		if (params.empty() || StringUtils::stringToLower(StringUtils::stringTrim(params.front())) != "image/webp")
+			continue;
+
+		float quality {1};
+		for (auto it {std::next(std::cbegin(params))}; it != std::cend(params); ++it)
+		{
+			const std::string param {StringUtils::stringTrim(*it)};
+			if (param.size() > 2 && (param[0] == 'q' || param[0] == 'Q') && param[1] == '=')
+				quality = StringUtils::readAs<float>(std::string_view {param}.substr(2)).value_or(0);
+		}
+
+		if (quality > 0)
+			return ImageFormat::WebP;
+	}
+
+	return ImageFormat::JPEG;
+}
+
+// The file may have changed since it has been selected by the scanner
+bool
+Grabber::isCoverFileTooBig(const std::filesystem::path& p) const
 {
-	std::unique_lock lock {_cacheMutex};
+	std::error_code ec;
+	const std::uintmax_t fileSize {std::filesystem::file_size(p, ec)};
+	if (ec || fileSize <= _maxFileSize)
+		return false;
 
-	while (_cacheSize + image->getDataSize() > _maxCacheSize && !_cache.empty())
+	LMS_LOG(COVER, INFO) << "Cover file '" << p.string() << "' is too big (" << fileSize << "), limit is " << _maxFileSize;
+	return true;
+}
+
+unsigned
+Grabber::getQuality(ImageFormat format) const
+{
+	switch (format)
 	{
-		auto itRandom {Random::pickRandom(_cache)};
-		_cacheSize -= itRandom->second->getDataSize();
-		_cache.erase(itRandom);
+		case ImageFormat::JPEG:	return _jpegQuality;
+		case ImageFormat::WebP:	return _webpQuality;
 	}
 
-	_cacheSize += image->getDataSize();
-	_cache[entryDesc] = image;
+	return _jpegQuality;
+}
+
+void
+Grabber::saveToCache(const CacheEntryDesc& entryDesc, std::shared_ptr<IEncodedImage> image)
+{
+	_cache.put(entryDesc, std::move(image));
 }
 
 std::shared_ptr<IEncodedImage>
 Grabber::loadFromCache(const CacheEntryDesc& entryDesc)
 {
-	std::shared_lock lock {_cacheMutex};
+	std::optional<std::shared_ptr<IEncodedImage>> image {_cache.get(entryDesc)};
 
-	auto it {_cache.find(entryDesc)};
-	if (it == std::cend(_cache))
-	{
-		++_cacheMisses;
+	return image ? std::move(*image) : nullptr;
+}
+
+// Keyed on the source type, path, width and format only: flights only coalesce concurrent requests, a file modified meanwhile is picked up by the next request
+std::string
+Grabber::computeSourceFlightKey(std::string_view sourceType, const std::filesystem::path& p, ImageSize width, ImageFormat format)
+{
+	return std::string {sourceType} + '|' + p.string() + '|' + std::to_string(width) + '|' + std::to_string(static_cast<int>(format));
+}
+
+// The source file identity and the encoding parameters are part of the key: entries of modified files will never be used again, and will eventually get evicted
+std::optional<std::string>
+Grabber::computeDiskCacheKey(std::string_view sourceType, const std::filesystem::path& p, ImageSize width, ImageFormat format) const
+{
+	if (!_diskCache)
+		return std::nullopt;
+
+	std::error_code ec;
+	const std::uintmax_t fileSize {std::filesystem::file_size(p, ec)};
+	if (ec)
+		return std::nullopt;
+
+	const std::filesystem::file_time_type lastWriteTime {std::filesystem::last_write_time(p, ec)};
+	if (ec)
+		return std::nullopt;
+
+	std::ostringstream oss;
+	oss << sourceType
+		<< '|' << p.string()
+		<< '|' << fileSize
+		<< '|' << lastWriteTime.time_since_epoch().count()
+		<< '|' << width
+		<< '|' << static_cast<int>(format)
+		<< '|' << getQuality(format);
+
+	return oss.str();
+}
+
+std::unique_ptr<IEncodedImage>
+Grabber::loadFromDiskCache(const std::optional<std::string>& key) const
+{
+	if (!key)
 		return nullptr;
-	}
 
-	++_cacheHits;
-	return it->second;
+	return _diskCache->load(*key);
+}
+
+void
+Grabber::saveToDiskCache(const std::optional<std::string>& key, const std::shared_ptr<IEncodedImage>& image) const
+{
+	if (!key || !image)
+		return;
+
+	_diskCache->store(*key, *image);
 }
 
 } // namespace CoverArt
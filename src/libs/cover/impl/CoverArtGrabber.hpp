@@ -19,19 +19,22 @@
 
 #pragma once
 
-#include <atomic>
 #include <filesystem>
 #include <map>
+#include <memory>
 #include <optional>
 #include <shared_mutex>
+#include <string>
 #include <string_view>
 #include <unordered_map>
 #include <variant>
-#include <vector>
 
 #include "cover/ICoverArtGrabber.hpp"
 #include "cover/IEncodedImage.hpp"
 #include "database/Types.hpp"
+#include "utils/SingleFlight.hpp"
+#include "utils/TinyLfuCache.hpp"
+#include "DiskCache.hpp"
 
 namespace Database
 {
@@ -49,11 +52,13 @@ namespace CoverArt
 	{
 		std::variant<Database::TrackId, Database::ReleaseId> id;
 		std::size_t			size;
+		ImageFormat			format;
 
 		bool operator==(const CacheEntryDesc& other) const
 		{
 			return id == other.id
-				&& size == other.size;
+				&& size == other.size
+				&& format == other.format;
 		}
 	};
 
@@ -75,6 +80,7 @@ namespace std
 					h ^= std::hash<IdType>()(id);
 				}, e.id);
 				h ^= std::hash<std::size_t>()(e.size) << 1;
+				h ^= std::hash<CoverArt::ImageFormat>()(e.format) << 2;
 				return h;
 			}
 	};
@@ -90,7 +96,10 @@ namespace CoverArt
 					const std::filesystem::path& defaultCoverPath,
 					std::size_t maxCacheEntries,
 					std::size_t maxFileSize,
-					unsigned jpegQuality);
+					unsigned jpegQuality,
+					unsigned webpQuality,
+					const std::filesystem::path& diskCacheDirectory,
+					std::size_t maxDiskCacheSize);
 
 			Grabber(const Grabber&) = delete;
 			Grabber& operator=(const Grabber&) = delete;
@@ -98,38 +107,53 @@ namespace CoverArt
 			Grabber& operator=(Grabber&&) = delete;
 
 		private:
-			std::shared_ptr<IEncodedImage>	getFromTrack(Database::Session& dbSession, Database::TrackId trackId, ImageSize width) override;
-			std::shared_ptr<IEncodedImage>	getFromRelease(Database::Session& dbSession, Database::ReleaseId releaseId, ImageSize width) override;
+			std::shared_ptr<IEncodedImage>	getFromTrack(Database::Session& dbSession, Database::TrackId trackId, ImageSize width, ImageFormat format) override;
+			std::shared_ptr<IEncodedImage>	getFromRelease(Database::Session& dbSession, Database::ReleaseId releaseId, ImageSize width, ImageFormat format) override;
 			void							flushCache() override;
+			Stats							getStats() const override;
+			ImageFormat						selectFormat(std::string_view httpAcceptHeader) const override;
+			std::optional<RGBColor>			computeReleaseColor(Database::Session& dbSession, Database::ReleaseId releaseId) override;
 
-			std::shared_ptr<IEncodedImage>	getFromTrack(Database::Session& dbSession, Database::TrackId trackId, ImageSize width, bool allowReleaseFallback);
-			std::unique_ptr<IEncodedImage>	getFromAvMediaFile(const Av::IAudioFile& input, ImageSize width) const;
-			std::unique_ptr<IEncodedImage>	getFromCoverFile(const std::filesystem::path& p, ImageSize width) const;
+			std::shared_ptr<IEncodedImage>	getFromTrack(Database::Session& dbSession, Database::TrackId trackId, ImageSize width, ImageFormat format, bool allowReleaseFallback);
+			std::unique_ptr<IEncodedImage>	getFromAvMediaFile(const Av::IAudioFile& input, ImageSize width, ImageFormat format) const;
+			std::shared_ptr<IEncodedImage>	getFromCoverFile(const std::filesystem::path& p, ImageSize width, ImageFormat format) const;
 
-			std::unique_ptr<IEncodedImage>	getFromTrack(const std::filesystem::path& path, ImageSize width) const;
-			std::multimap<std::string, std::filesystem::path>	getCoverPaths(const std::filesystem::path& directoryPath) const;
-			std::unique_ptr<IEncodedImage>	getFromDirectory(const std::filesystem::path& directory, ImageSize width) const;
-			std::unique_ptr<IEncodedImage>	getFromSameNamedFile(const std::filesystem::path& filePath, ImageSize width) const;
-			std::shared_ptr<IEncodedImage>	getDefault(ImageSize width);
+			std::shared_ptr<IEncodedImage>	getFromTrack(const std::filesystem::path& path, ImageSize width, ImageFormat format) const;
+			std::shared_ptr<IEncodedImage>	getDefault(ImageSize width, ImageFormat format);
 
-			bool							checkCoverFile(const std::filesystem::path& directoryPath) const;
+			unsigned						getQuality(ImageFormat format) const;
+			bool							isCoverFileTooBig(const std::filesystem::path& p) const;
 
-			std::shared_mutex _cacheMutex;
-			std::unordered_map<CacheEntryDesc, std::shared_ptr<IEncodedImage>> _cache;
-			std::unordered_map<ImageSize, std::shared_ptr<IEncodedImage>> _defaultCoverCache;
-			std::atomic<std::size_t>	_cacheMisses {};
-			std::atomic<std::size_t>	_cacheHits {};
-			std::size_t					_cacheSize {};
+			struct ImageWeigher
+			{
+				std::size_t operator()(const std::shared_ptr<IEncodedImage>& image) const { return image->getDataSize(); }
+			};
+			using Cache = TinyLfuCache<CacheEntryDesc, std::shared_ptr<IEncodedImage>, std::hash<CacheEntryDesc>, ImageWeigher>;
+			Cache _cache;
+
+			std::shared_mutex _defaultCoverCacheMutex;
+			std::map<std::pair<ImageSize, ImageFormat>, std::shared_ptr<IEncodedImage>> _defaultCoverCache;
 
 			void saveToCache(const CacheEntryDesc& entryDesc, std::shared_ptr<IEncodedImage> image);
 			std::shared_ptr<IEncodedImage> loadFromCache(const CacheEntryDesc& entryDesc);
 
+			std::optional<std::string> computeDiskCacheKey(std::string_view sourceType, const std::filesystem::path& p, ImageSize width, ImageFormat format) const;
+			std::unique_ptr<IEncodedImage> loadFromDiskCache(const std::optional<std::string>& key) const;
+			void saveToDiskCache(const std::optional<std::string>& key, const std::shared_ptr<IEncodedImage>& image) const;
+
+			// Concurrent misses wait for the same computation, first for the same cache entry, then for the same source image
+			static std::string computeSourceFlightKey(std::string_view sourceType, const std::filesystem::path& p, ImageSize width, ImageFormat format);
+			SingleFlight<CacheEntryDesc, std::shared_ptr<IEncodedImage>> _coverFlights;
+			mutable SingleFlight<std::string, std::shared_ptr<IEncodedImage>> _sourceFlights;
+
+			std::unique_ptr<DiskCache> _diskCache;
+
 			const std::filesystem::path _defaultCoverPath;
 			const std::size_t _maxCacheSize;
-			static inline const std::vector<std::filesystem::path> _fileExtensions {".jpg", ".jpeg", ".png", ".bmp"}; // TODO parametrize
 			const std::size_t _maxFileSize;
-			static inline const std::vector<std::string> _preferredFileNames {"cover", "front"}; // TODO parametrize
 			const unsigned _jpegQuality;
+			const unsigned _webpQuality;
+			bool _webpSupported {};
 	};
 
 } // namespace CoverArt
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "DiskCache.hpp"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <iomanip>
+#include <optional>
+#include <sstream>
+#include <vector>
+
+#include "utils/Hash.hpp"
+#include "utils/Logger.hpp"
+#include "EncodedImage.hpp"
+
+namespace CoverArt
+{
+	namespace
+	{
+		struct FileFormat
+		{
+			std::string_view mimeType;
+			std::string_view extension;
+		};
+		constexpr std::array<FileFormat, 2> fileFormats
+		{{
+			{"image/jpeg", ".jpg"},
+			{"image/webp", ".webp"},
+		}};
+
+		std::optional<std::string_view>
+		getExtension(std::string_view mimeType)
+		{
+			auto it {std::find_if(std::cbegin(fileFormats), std::cend(fileFormats), [&](const FileFormat& format) { return format.mimeType == mimeType; })};
+			if (it == std::cend(fileFormats))
+				return std::nullopt;
+
+			return it->extension;
+		}
+
+		std::optional<std::string_view>
+		getMimeType(std::string_view extension)
+		{
+			auto it {std::find_if(std::cbegin(fileFormats), std::cend(fileFormats), [&](const FileFormat& format) { return format.extension == extension; })};
+			if (it == std::cend(fileFormats))
+				return std::nullopt;
+
+			return it->mimeType;
+		}
+
+		std::string
+		computeEntryName(std::string_view key)
+		{
+			std::ostringstream oss;
+			oss << std::hex << std::setfill('0') << std::setw(16) << Utils::computeFnv1aHash(key);
+
+			return oss.str();
+		}
+	}
+
+	DiskCache::DiskCache(const std::filesystem::path& cacheDirectory, std::size_t maxSize)
+	: _maxSize {maxSize}
+	, _cache {cacheDirectory, maxSize, [](std::string_view extension) { return getMimeType(extension).has_value(); }}
+	{
+		const Stats stats {_cache.getStats()};
+		LMS_LOG(COVER, INFO) << "Cover disk cache: " << stats.entryCount << " entries, " << stats.size << "/" << _maxSize << " bytes used";
+	}
+
+	std::unique_ptr<IEncodedImage>
+	DiskCache::load(std::string_view key)
+	{
+		const std::string entryName {computeEntryName(key)};
+
+		const std::optional<DiskLruCache::EntryInfo> entryInfo {_cache.pin(entryName)};
+		if (!entryInfo)
+			return nullptr;
+
+		const std::optional<std::string_view> mimeType {getMimeType(entryInfo->path.extension().string())};
+
+		std::vector<std::byte> data(entryInfo->size);
+		std::ifstream ifs {entryInfo->path, std::ios::binary};
+		const bool success {ifs.read(reinterpret_cast<char*>(data.data()), data.size()).good()};
+		_cache.unpin(entryName);
+
+		if (!success || !mimeType)
+		{
+			LMS_LOG(COVER, DEBUG) << "Cannot read cache file '" << entryInfo->path.string() << "'";
+			return nullptr;
+		}
+
+		return std::make_unique<EncodedImage>(std::move(data), *mimeType);
+	}
+
+	void
+	DiskCache::store(std::string_view key, const IEncodedImage& image)
+	{
+		const std::optional<std::string_view> extension {getExtension(image.getMimeType())};
+		if (!extension || image.getDataSize() > _maxSize)
+			return;
+
+		// Already cached or being stored by a concurrent call
+		std::unique_ptr<DiskLruCache::Writer> writer {_cache.createWriter(computeEntryName(key), *extension)};
+		if (!writer)
+			return;
+
+		writer->write(image.getData(), image.getDataSize());
+		writer->commit();
+	}
+
+	DiskCache::Stats
+	DiskCache::getStats() const
+	{
+		return _cache.getStats();
+	}
+}
+
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <string_view>
+
+#include "cover/IEncodedImage.hpp"
+#include "utils/DiskLruCache.hpp"
+
+namespace CoverArt
+{
+	// Persistent cache of the encoded covers, survives restarts and in-memory cache flushes
+	// Entries are content addressed: the key must identify the source image and the encoding parameters
+	class DiskCache
+	{
+		public:
+			DiskCache(const std::filesystem::path& cacheDirectory, std::size_t maxSize);
+			~DiskCache() = default;
+			DiskCache(const DiskCache&) = delete;
+			DiskCache(DiskCache&&) = delete;
+			DiskCache& operator=(const DiskCache&) = delete;
+			DiskCache& operator=(DiskCache&&) = delete;
+
+			std::unique_ptr<IEncodedImage> load(std::string_view key);
+			void store(std::string_view key, const IEncodedImage& image);
+
+			using Stats = DiskLruCache::Stats;
+			Stats getStats() const;
+
+		private:
+			const std::size_t	_maxSize;
+			DiskLruCache		_cache;
+	};
+}
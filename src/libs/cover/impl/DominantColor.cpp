@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "DominantColor.hpp"
+
+#include <array>
+#include <cstdint>
+
+namespace CoverArt
+{
+	RGBColor
+	computeDominantColor(const std::byte* rgbPixels, std::size_t pixelCount)
+	{
+		// Pixels are grouped using the 4 most significant bits of each channel
+		constexpr unsigned bitsPerChannel {4};
+		constexpr std::size_t bucketCount {1 << (bitsPerChannel * 3)};
+
+		struct Bucket
+		{
+			std::size_t count {};
+			std::size_t red {};
+			std::size_t green {};
+			std::size_t blue {};
+		};
+		std::array<Bucket, bucketCount> buckets {};
+
+		const Bucket* dominantBucket {&buckets.front()};
+		for (std::size_t i {}; i < pixelCount; ++i)
+		{
+			const unsigned red {std::to_integer<unsigned>(rgbPixels[i * 3])};
+			const unsigned green {std::to_integer<unsigned>(rgbPixels[i * 3 + 1])};
+			const unsigned blue {std::to_integer<unsigned>(rgbPixels[i * 3 + 2])};
+
+			Bucket& bucket {buckets[((red >> (8 - bitsPerChannel)) << (bitsPerChannel * 2))
+				| ((green >> (8 - bitsPerChannel)) << bitsPerChannel)
+				| (blue >> (8 - bitsPerChannel))]};
+
+			bucket.count++;
+			bucket.red += red;
+			bucket.green += green;
+			bucket.blue += blue;
+
+			if (bucket.count > dominantBucket->count)
+				dominantBucket = &bucket;
+		}
+
+		if (dominantBucket->count == 0)
+			return 0;
+
+		return static_cast<RGBColor>(((dominantBucket->red / dominantBucket->count) << 16)
+				| ((dominantBucket->green / dominantBucket->count) << 8)
+				| (dominantBucket->blue / dominantBucket->count));
+	}
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "cover/IEncodedImage.hpp"
+
+namespace CoverArt
+{
+	// Already encoded image, as read back from the disk cache
+	class EncodedImage : public IEncodedImage
+	{
+		public:
+			EncodedImage(std::vector<std::byte>&& data, std::string_view mimeType)
+				: _data {std::move(data)}
+				, _mimeType {mimeType}
+			{}
+
+		private:
+			const std::byte* getData() const override { return _data.empty() ? nullptr : _data.data(); }
+			std::size_t getDataSize() const override { return _data.size(); }
+			std::string_view getMimeType() const override { return _mimeType; }
+
+			const std::vector<std::byte> _data;
+			const std::string _mimeType;
+	};
+}
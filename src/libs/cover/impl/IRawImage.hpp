@@ -20,6 +20,7 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 
 #include "cover/IEncodedImage.hpp"
 
@@ -30,7 +31,8 @@ namespace CoverArt
 		public:
 			virtual ~IRawImage() = default;
 			virtual void resize(ImageSize width) = 0;
-			virtual std::unique_ptr<IEncodedImage> encodeToJPEG(unsigned quality) const = 0;
+			virtual std::unique_ptr<IEncodedImage> encode(ImageFormat format, unsigned quality) const = 0;
+			virtual std::vector<std::byte> getRGBPixels() const = 0; // 3 bytes per pixel
 	};
 }
 
@@ -23,6 +23,7 @@
 
 #include "utils/Logger.hpp"
 #include "JPEGImage.hpp"
+#include "WebPImage.hpp"
 #include "Exception.hpp"
 
 namespace CoverArt::GraphicsMagick {
@@ -45,12 +46,16 @@ init(const std::filesystem::path& path)
 	LMS_LOG(COVER, INFO) << "Magick Disk resource limit = " << GetMagickResourceLimit(MagickLib::DiskResource);
 }
 
-RawImage::RawImage(const std::byte* encodedData, std::size_t encodedDataSize)
+RawImage::RawImage(const std::byte* encodedData, std::size_t encodedDataSize, std::optional<ImageSize> decodeSizeHint)
 {
 	try
 	{
 		Magick::Blob blob {encodedData, encodedDataSize};
-		_image.read(blob);
+		// Used by the JPEG coder to decode at a reduced scale
+		if (decodeSizeHint)
+			_image.read(blob, Magick::Geometry {static_cast<unsigned int>(*decodeSizeHint), static_cast<unsigned int>(*decodeSizeHint)});
+		else
+			_image.read(blob);
 	}
 	catch (Magick::WarningCoder& e)
 	{
@@ -68,10 +73,12 @@ RawImage::RawImage(const std::byte* encodedData, std::size_t encodedDataSize)
 	}
 }
 
-RawImage::RawImage(const std::filesystem::path& p)
+RawImage::RawImage(const std::filesystem::path& p, std::optional<ImageSize> decodeSizeHint)
 {
 	try
 	{
+		if (decodeSizeHint)
+			_image.size(Magick::Geometry {static_cast<unsigned int>(*decodeSizeHint), static_cast<unsigned int>(*decodeSizeHint)});
 		_image.read(p.string().c_str());
 	}
 	catch (Magick::WarningCoder& e)
@@ -105,9 +112,62 @@ RawImage::resize(ImageSize width)
 }
 
 std::unique_ptr<IEncodedImage>
-RawImage::encodeToJPEG(unsigned quality) const
+RawImage::encode(ImageFormat format, unsigned quality) const
 {
-	return std::make_unique<JPEGImage>(*this, quality);
+	switch (format)
+	{
+		case ImageFormat::JPEG:
+			return std::make_unique<JPEGImage>(*this, quality);
+
+		case ImageFormat::WebP:
+			return std::make_unique<WebPImage>(*this, quality);
+	}
+
+	throw ImageException {"Unsupported export format!"};
+}
+
+bool
+RawImage::isEncodingSupported(ImageFormat format)
+{
+	switch (format)
+	{
+		case ImageFormat::JPEG:
+			return true;
+
+		case ImageFormat::WebP:
+		{
+			// Depends on the delegates GraphicsMagick has been built with
+			MagickLib::ExceptionInfo exception;
+			MagickLib::GetExceptionInfo(&exception);
+			const MagickLib::MagickInfo* magickInfo {MagickLib::GetMagickInfo("WEBP", &exception)};
+			MagickLib::DestroyExceptionInfo(&exception);
+
+			return magickInfo && magickInfo->encoder;
+		}
+	}
+
+	return false;
+}
+
+std::vector<std::byte>
+RawImage::getRGBPixels() const
+{
+	try
+	{
+		Magick::Image image {_image}; // shallow copy, write is not const
+		const std::size_t width {image.columns()};
+		const std::size_t height {image.rows()};
+
+		std::vector<std::byte> pixels(width * height * 3);
+		image.write(0, 0, width, height, "RGB", Magick::CharPixel, pixels.data());
+
+		return pixels;
+	}
+	catch (Magick::Exception& e)
+	{
+		LMS_LOG(COVER, ERROR) << "Caught Magick exception while exporting pixels: " << e.what();
+		throw ImageException {std::string {"Magick export error: "} + e.what()};
+	}
 }
 
 Magick::Image
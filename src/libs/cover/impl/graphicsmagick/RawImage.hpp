@@ -27,6 +27,7 @@
 
 #include <cstddef>
 #include <filesystem>
+#include <optional>
 
 #include "cover/IEncodedImage.hpp"
 #include "IRawImage.hpp"
@@ -38,14 +39,19 @@ namespace CoverArt::GraphicsMagick
 	class RawImage : IRawImage
 	{
 		public:
-			RawImage(const std::byte* encodedData, std::size_t encodedDataSize);
-			RawImage(const std::filesystem::path& path);
+			// decodeSizeHint: size the image is going to be resized to, the decoder may use it to directly decode a smaller image
+			RawImage(const std::byte* encodedData, std::size_t encodedDataSize, std::optional<ImageSize> decodeSizeHint = std::nullopt);
+			RawImage(const std::filesystem::path& path, std::optional<ImageSize> decodeSizeHint = std::nullopt);
 
 			void resize(ImageSize width) override;
-			std::unique_ptr<IEncodedImage> encodeToJPEG(unsigned quality) const override;
+			std::unique_ptr<IEncodedImage> encode(ImageFormat format, unsigned quality) const override;
+			std::vector<std::byte> getRGBPixels() const override;
+
+			static bool isEncodingSupported(ImageFormat format);
 
 		private:
 			friend class JPEGImage;
+			friend class WebPImage;
 			Magick::Image getMagickImage() const;
 
 			Magick::Image _image;
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "JPEGDecoder.hpp"
+
+#include <algorithm>
+#include <csetjmp>
+#include <cstdio>
+#include <jpeglib.h>
+
+#include "Exception.hpp"
+
+namespace CoverArt::LibJpeg
+{
+	namespace
+	{
+		// libjpeg default error handling exits the process
+		struct ErrorManager
+		{
+			jpeg_error_mgr	pub;
+			std::jmp_buf	jumpBuffer;
+			char			message[JMSG_LENGTH_MAX];
+		};
+
+		void
+		onError(j_common_ptr cinfo)
+		{
+			ErrorManager* errorManager {reinterpret_cast<ErrorManager*>(cinfo->err)};
+			(*cinfo->err->format_message)(cinfo, errorManager->message);
+			std::longjmp(errorManager->jumpBuffer, 1);
+		}
+
+		void
+		onOutputMessage(j_common_ptr)
+		{
+			// ignore warnings
+		}
+
+		unsigned
+		computeScaleDenom(JDIMENSION width, JDIMENSION height, ImageSize minSize)
+		{
+			const JDIMENSION maxDimension {std::max(width, height)};
+
+			unsigned scaleDenom {8};
+			while (scaleDenom > 1 && (maxDimension + scaleDenom - 1) / scaleDenom < minSize)
+				scaleDenom /= 2;
+
+			return scaleDenom;
+		}
+	}
+
+	bool
+	isJPEG(const std::byte* encodedData, std::size_t encodedDataSize)
+	{
+		return encodedDataSize >= 3
+			&& encodedData[0] == std::byte {0xFF}
+			&& encodedData[1] == std::byte {0xD8}
+			&& encodedData[2] == std::byte {0xFF};
+	}
+
+	// No C++ object with a non trivial destructor must live across setjmp/longjmp
+	DecodedImage
+	decode(const std::byte* encodedData, std::size_t encodedDataSize, ImageSize minSize)
+	{
+		jpeg_decompress_struct cinfo;
+		ErrorManager errorManager;
+		unsigned char* volatile outputData {};
+
+		cinfo.err = jpeg_std_error(&errorManager.pub);
+		errorManager.pub.error_exit = onError;
+		errorManager.pub.output_message = onOutputMessage;
+
+		if (setjmp(errorManager.jumpBuffer))
+		{
+			jpeg_destroy_decompress(&cinfo);
+			std::free(outputData);
+			throw ImageException {std::string {"Cannot decode JPEG image: "} + errorManager.message};
+		}
+
+		jpeg_create_decompress(&cinfo);
+		jpeg_mem_src(&cinfo, const_cast<unsigned char*>(reinterpret_cast<const unsigned char*>(encodedData)), encodedDataSize);
+		jpeg_read_header(&cinfo, TRUE);
+
+		cinfo.out_color_space = JCS_RGB;
+		cinfo.scale_num = 1;
+		cinfo.scale_denom = computeScaleDenom(cinfo.image_width, cinfo.image_height, minSize);
+		cinfo.dct_method = JDCT_ISLOW;
+
+		jpeg_start_decompress(&cinfo);
+		if (cinfo.output_components != 3)
+		{
+			jpeg_destroy_decompress(&cinfo);
+			throw ImageException {"Unexpected JPEG output component count"};
+		}
+
+		const std::size_t rowStride {static_cast<std::size_t>(cinfo.output_width) * cinfo.output_components};
+		outputData = static_cast<unsigned char*>(std::malloc(rowStride * cinfo.output_height));
+		if (!outputData)
+		{
+			jpeg_destroy_decompress(&cinfo);
+			throw ImageException {"Cannot allocate memory for decoded image!"};
+		}
+
+		while (cinfo.output_scanline < cinfo.output_height)
+		{
+			JSAMPROW row {outputData + cinfo.output_scanline * rowStride};
+			jpeg_read_scanlines(&cinfo, &row, 1);
+		}
+
+		jpeg_finish_decompress(&cinfo);
+
+		DecodedImage res;
+		res.width = cinfo.output_width;
+		res.height = cinfo.output_height;
+		res.data.reset(outputData);
+
+		jpeg_destroy_decompress(&cinfo);
+
+		return res;
+	}
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#ifndef LMS_SUPPORT_LIBJPEG
+#error "Bad configuration"
+#endif
+
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+
+#include "cover/IEncodedImage.hpp"
+
+namespace CoverArt::LibJpeg
+{
+	bool isJPEG(const std::byte* encodedData, std::size_t encodedDataSize);
+
+	struct DecodedImage
+	{
+		ImageSize width {};
+		ImageSize height {};
+		std::unique_ptr<unsigned char, decltype(&std::free)> data {nullptr, std::free}; // RGB, 3 bytes per pixel
+	};
+
+	// Uses DCT scaling (1/2, 1/4, 1/8) to directly decode at the smallest size
+	// whose largest dimension is still at least minSize
+	// Throws ImageException
+	DecodedImage decode(const std::byte* encodedData, std::size_t encodedDataSize, ImageSize minSize);
+}
@@ -28,24 +28,68 @@
 #include <stb/stb_image.h>
 #include <stb/stb_image_resize.h>
 
+#include <fstream>
+#include <vector>
+
+#include "utils/Logger.hpp"
 #include "JPEGImage.hpp"
+#if LMS_SUPPORT_LIBWEBP
+#include "WebPImage.hpp"
+#endif
+#if LMS_SUPPORT_LIBJPEG
+#include "libjpeg/JPEGDecoder.hpp"
+#endif
 
 #include "Exception.hpp"
 
 namespace CoverArt::STB
 {
-	RawImage::RawImage(const std::byte* encodedData, std::size_t encodedDataSize)
+	RawImage::RawImage(const std::byte* encodedData, std::size_t encodedDataSize, std::optional<ImageSize> decodeSizeHint)
 	{
-		int n;
-		_data = UniquePtrFree {stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(encodedData), encodedDataSize, &_width, &_height, &n, 3), std::free};
-		if (!_data)
-			throw ImageException {"Cannot load image from memory"};
+		load(encodedData, encodedDataSize, decodeSizeHint);
+	}
+
+	RawImage::RawImage(const std::filesystem::path& p, std::optional<ImageSize> decodeSizeHint)
+	{
+		std::error_code ec;
+		const std::uintmax_t fileSize {std::filesystem::file_size(p, ec)};
+		if (ec)
+			throw ImageException {"Cannot get file size: " + ec.message()};
+
+		std::vector<std::byte> encodedData(fileSize);
+		std::ifstream ifs {p, std::ios::binary};
+		if (!ifs.read(reinterpret_cast<char*>(encodedData.data()), encodedData.size()))
+			throw ImageException {"Cannot read file"};
+
+		load(encodedData.data(), encodedData.size(), decodeSizeHint);
 	}
 
-	RawImage::RawImage(const std::filesystem::path& p)
+	void
+	RawImage::load(const std::byte* encodedData, std::size_t encodedDataSize, std::optional<ImageSize> decodeSizeHint)
 	{
+#if LMS_SUPPORT_LIBJPEG
+		// Most of the pixels of large JPEG images would be thrown away by the resize
+		if (decodeSizeHint && LibJpeg::isJPEG(encodedData, encodedDataSize))
+		{
+			try
+			{
+				LibJpeg::DecodedImage decodedImage {LibJpeg::decode(encodedData, encodedDataSize, *decodeSizeHint)};
+				_width = decodedImage.width;
+				_height = decodedImage.height;
+				_data = std::move(decodedImage.data);
+				return;
+			}
+			catch (const ImageException& e)
+			{
+				LMS_LOG(COVER, DEBUG) << "Scaled JPEG decode failed, using the default decoder: " << e.what();
+			}
+		}
+#else
+		(void)decodeSizeHint;
+#endif
+
 		int n;
-		_data = UniquePtrFree {stbi_load(p.string().c_str(), &_width, &_height, &n, 3), std::free};
+		_data = UniquePtrFree {stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(encodedData), encodedDataSize, &_width, &_height, &n, 3), std::free};
 		if (!_data)
 			throw ImageException {"Cannot load image from memory"};
 	}
@@ -85,9 +129,51 @@ namespace CoverArt::STB
 	}
 
 	std::unique_ptr<IEncodedImage>
-	RawImage::encodeToJPEG(unsigned quality) const
+	RawImage::encode(ImageFormat format, unsigned quality) const
+	{
+		switch (format)
+		{
+			case ImageFormat::JPEG:
+				return std::make_unique<JPEGImage>(*this, quality);
+
+			case ImageFormat::WebP:
+#if LMS_SUPPORT_LIBWEBP
+				return std::make_unique<WebPImage>(*this, quality);
+#else
+				break;
+#endif
+		}
+
+		throw ImageException {"Unsupported export format!"};
+	}
+
+	bool
+	RawImage::isEncodingSupported(ImageFormat format)
 	{
-		return std::make_unique<JPEGImage>(*this, quality);
+		switch (format)
+		{
+			case ImageFormat::JPEG:
+				return true;
+
+			case ImageFormat::WebP:
+#if LMS_SUPPORT_LIBWEBP
+				return true;
+#else
+				return false;
+#endif
+		}
+
+		return false;
+	}
+
+	std::vector<std::byte>
+	RawImage::getRGBPixels() const
+	{
+		const std::byte* data {getData()};
+		if (!data)
+			return {};
+
+		return std::vector<std::byte>(data, data + static_cast<std::size_t>(_width) * _height * 3);
 	}
 
 	ImageSize
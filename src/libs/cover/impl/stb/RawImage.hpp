@@ -25,6 +25,7 @@
 
 #include <cstddef>
 #include <filesystem>
+#include <optional>
 
 #include "cover/IEncodedImage.hpp"
 #include "IRawImage.hpp"
@@ -34,17 +35,23 @@ namespace CoverArt::STB
 	class RawImage : public IRawImage
 	{
 		public:
-			RawImage(const std::byte* encodedData, std::size_t encodedDataSize);
-			RawImage(const std::filesystem::path& path);
+			// decodeSizeHint: size the image is going to be resized to, the decoder may use it to directly decode a smaller image
+			RawImage(const std::byte* encodedData, std::size_t encodedDataSize, std::optional<ImageSize> decodeSizeHint = std::nullopt);
+			RawImage(const std::filesystem::path& path, std::optional<ImageSize> decodeSizeHint = std::nullopt);
 
 			void resize(ImageSize width) override;
-			std::unique_ptr<IEncodedImage> encodeToJPEG(unsigned quality) const override;
+			std::unique_ptr<IEncodedImage> encode(ImageFormat format, unsigned quality) const override;
+			std::vector<std::byte> getRGBPixels() const override;
+
+			static bool isEncodingSupported(ImageFormat format);
 
 			ImageSize getWidth() const;
 			ImageSize getHeight() const;
 			const std::byte* getData() const;
 
 		private:
+			void load(const std::byte* encodedData, std::size_t encodedDataSize, std::optional<ImageSize> decodeSizeHint);
+
 			int _width;
 			int _height;
 			using UniquePtrFree = std::unique_ptr<unsigned char, decltype(&std::free)>;
@@ -21,6 +21,8 @@
 
 #include <filesystem>
 #include <memory>
+#include <optional>
+#include <string_view>
 
 #include "database/Types.hpp"
 #include "cover/IEncodedImage.hpp"
@@ -37,17 +39,49 @@ namespace CoverArt
 		public:
 			virtual ~IGrabber() = default;
 
-			virtual std::shared_ptr<IEncodedImage>	getFromTrack(Database::Session& dbSession, Database::TrackId trackId, ImageSize width) = 0;
-			virtual std::shared_ptr<IEncodedImage>	getFromRelease(Database::Session& dbSession, Database::ReleaseId releaseId, ImageSize width) = 0;
+			virtual std::shared_ptr<IEncodedImage>	getFromTrack(Database::Session& dbSession, Database::TrackId trackId, ImageSize width, ImageFormat format) = 0;
+			virtual std::shared_ptr<IEncodedImage>	getFromRelease(Database::Session& dbSession, Database::ReleaseId releaseId, ImageSize width, ImageFormat format) = 0;
+
+			// Dominant color of the release cover, to be displayed while the cover is loading (slow, not cached)
+			virtual std::optional<RGBColor> computeReleaseColor(Database::Session& dbSession, Database::ReleaseId releaseId) = 0;
+
+			// Best supported format given the Accept header of the request (JPEG if nothing better is accepted)
+			virtual ImageFormat selectFormat(std::string_view httpAcceptHeader) const = 0;
 
 			virtual void flushCache() = 0;
+
+			struct CacheStats
+			{
+				std::size_t entryCount {};
+				std::size_t size {};
+				std::size_t hits {};
+				std::size_t misses {};
+				std::size_t evictions {};
+				std::size_t rejections {};	// entries not admitted as less used than the ones they would have evicted
+
+				std::size_t getHitRatePercent() const
+				{
+					const std::size_t queryCount {hits + misses};
+					return queryCount ? (hits * 100) / queryCount : 0;
+				}
+			};
+
+			struct Stats
+			{
+				CacheStats memoryCache;
+				std::optional<CacheStats> diskCache;
+			};
+			virtual Stats getStats() const = 0;
 	};
 
 	std::unique_ptr<IGrabber> createGrabber(const std::filesystem::path& execPath,
 			const std::filesystem::path& defaultCoverPath,
 			std::size_t maxCacheEntries,
 			std::size_t maxFileSize,
-			unsigned jpegQuality);
+			unsigned jpegQuality,
+			unsigned webpQuality,
+			const std::filesystem::path& diskCacheDirectory,
+			std::size_t maxDiskCacheSize); // 0 to disable the disk cache
 
 } // namespace CoverArt
 
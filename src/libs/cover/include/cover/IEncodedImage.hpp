@@ -20,11 +20,19 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <string_view>
 
 namespace CoverArt
 {
 	using ImageSize = std::size_t;
+	using RGBColor = std::uint32_t; // 0xRRGGBB
+
+	enum class ImageFormat
+	{
+		JPEG,
+		WebP,
+	};
 
 	class IEncodedImage
 	{
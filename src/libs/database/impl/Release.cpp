@@ -19,6 +19,8 @@
 
 #include "database/Release.hpp"
 
+#include <unordered_set>
+
 #include <Wt/Dbo/WtSqlTraits.h>
 
 #include "database/Artist.hpp"
@@ -34,6 +36,9 @@
 namespace Database
 {
 
+// Color computed, but there is none
+static constexpr int noCoverColor {-1};
+
 template <typename T>
 static
 Wt::Dbo::Query<T>
@@ -156,6 +161,80 @@ Release::getAllIds(Session& session)
 	return std::vector<ReleaseId>(res.begin(), res.end());
 }
 
+std::vector<ReleaseId>
+Release::getAllIdsWithTracksAddedAfter(Session& session, const Wt::WDateTime& after)
+{
+	session.checkSharedLocked();
+
+	Wt::Dbo::collection<ReleaseId> res = session.getDboSession().query<ReleaseId>("SELECT DISTINCT r.id FROM release r INNER JOIN track t ON t.release_id = r.id")
+		.where("t.file_added >= ?").bind(after);
+	return std::vector<ReleaseId>(res.begin(), res.end());
+}
+
+std::vector<ReleaseId>
+Release::getAllIdsWithMissingCoverColor(Session& session)
+{
+	session.checkSharedLocked();
+
+	// Releases without any cover have a "no color" value, whatever the cover sources are
+	Wt::Dbo::collection<ReleaseId> res = session.getDboSession().query<ReleaseId>("SELECT r.id FROM release r")
+		.where("r.cover_color IS NULL");
+	return std::vector<ReleaseId>(res.begin(), res.end());
+}
+
+std::vector<Release::pointer>
+Release::getByTracks(Session& session, const std::vector<TrackId>& trackIds)
+{
+	session.checkSharedLocked();
+
+	std::vector<pointer> res;
+	std::unordered_set<ReleaseId> releaseIds;
+	forEachIdChunk(trackIds, [&](const std::vector<TrackId>& chunk)
+	{
+		auto query {session.getDboSession().query<Wt::Dbo::ptr<Release>>(
+				"SELECT DISTINCT r FROM release r"
+				" INNER JOIN track t ON t.release_id = r.id")
+			.where("t.id IN (" + makeBindPlaceholders(chunk.size()) + ")")};
+		for (const TrackId trackId : chunk)
+			query.bind(trackId);
+
+		auto collection {query.resultList()};
+		for (const Wt::Dbo::ptr<Release>& release : collection)
+		{
+			if (releaseIds.insert(release->getId()).second)
+				res.push_back(release);
+		}
+	});
+
+	return res;
+}
+
+std::unordered_map<ReleaseId, std::vector<Artist::pointer>>
+Release::getArtistsByRelease(Session& session, const std::vector<ReleaseId>& releaseIds, TrackArtistLinkType linkType)
+{
+	using QueryResultType = std::tuple<ReleaseId, Wt::Dbo::ptr<Artist>>;
+	session.checkSharedLocked();
+
+	std::unordered_map<ReleaseId, std::vector<Artist::pointer>> res;
+	forEachIdChunk(releaseIds, [&](const std::vector<ReleaseId>& chunk)
+	{
+		auto query {session.getDboSession().query<QueryResultType>(
+				"SELECT DISTINCT t.release_id, a FROM artist a"
+				" INNER JOIN track_artist_link t_a_l ON t_a_l.artist_id = a.id"
+				" INNER JOIN track t ON t.id = t_a_l.track_id")
+			.where("t_a_l.type = ?").bind(linkType)
+			.where("t.release_id IN (" + makeBindPlaceholders(chunk.size()) + ")")};
+		for (const ReleaseId releaseId : chunk)
+			query.bind(releaseId);
+
+		auto collection {query.resultList()};
+		for (const auto& [releaseId, artist] : collection)
+			res[releaseId].push_back(artist);
+	});
+
+	return res;
+}
+
 std::vector<Release::pointer>
 Release::getAllOrderedByArtist(Session& session, std::optional<std::size_t> offset, std::optional<std::size_t> size)
 {
@@ -444,6 +523,24 @@ Release::getCopyrightURL() const
 	return values.front();
 }
 
+std::optional<std::uint32_t>
+Release::getCoverColor() const
+{
+	if (!_coverColor || *_coverColor < 0)
+		return std::nullopt;
+
+	return static_cast<std::uint32_t>(*_coverColor);
+}
+
+void
+Release::setCoverColor(std::optional<std::uint32_t> color)
+{
+	if (color)
+		_coverColor = static_cast<int>(*color & 0xFFFFFF);
+	else
+		_coverColor = noCoverColor;
+}
+
 std::vector<Artist::pointer>
 Release::getArtists(TrackArtistLinkType linkType) const
 {
@@ -43,7 +43,7 @@ namespace Database
 {
 
 	using Version = std::size_t;
-	static constexpr Version LMS_DATABASE_VERSION {31};
+	static constexpr Version LMS_DATABASE_VERSION {36};
 
 	class VersionInfo
 	{
@@ -360,6 +360,41 @@ CREATE TABLE "track_backup" (
 			// Just increment the scan version of the settings to make the next scheduled scan rescan everything
 			ScanSettings::get(*this).modify()->incScanVersion();
 		}
+		else if (version == 31)
+		{
+			// Loudness analysis
+			_session.execute("ALTER TABLE track ADD loudness_analyzed BOOLEAN NOT NULL DEFAULT(0)");
+			_session.execute("ALTER TABLE track ADD track_loudness REAL");
+			_session.execute("ALTER TABLE track ADD track_peak REAL");
+			_session.execute("ALTER TABLE track ADD release_loudness REAL");
+		}
+		else if (version == 32)
+		{
+			// Cover files resolved by the scanner
+			_session.execute("ALTER TABLE track ADD cover_path TEXT NOT NULL DEFAULT('')");
+			_session.execute("ALTER TABLE release ADD cover_path TEXT NOT NULL DEFAULT('')");
+
+			// Just increment the scan version of the settings to make the next scheduled scan rescan everything
+			ScanSettings::get(*this).modify()->incScanVersion();
+		}
+		else if (version == 33)
+		{
+			// Cover colors, computed when the covers of the new releases are generated
+			// No need to rescan: the missing colors are computed by the next scan
+			_session.execute("ALTER TABLE release ADD cover_color INTEGER");
+		}
+		else if (version == 34)
+		{
+			// File sizes, reported by the Subsonic API without hitting the filesystem
+			// No need to rescan: the missing sizes are set by the next scan, even for the unchanged files
+			_session.execute("ALTER TABLE track ADD file_size BIGINT NOT NULL DEFAULT(0)");
+		}
+		else if (version == 35)
+		{
+			// Release peak, used to prevent clipping when applying the computed release gain
+			_session.execute("ALTER TABLE track ADD release_peak REAL");
+			_session.execute("UPDATE track SET release_peak = (SELECT MAX(t.track_peak) FROM track t WHERE t.release_id = track.release_id) WHERE release_loudness IS NOT NULL");
+		}
 		else
 		{
 			LMS_LOG(DB, ERROR) << "Database version " << version << " cannot be handled using migration";
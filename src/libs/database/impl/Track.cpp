@@ -19,6 +19,9 @@
 
 #include "database/Track.hpp"
 
+#include <algorithm>
+#include <cmath>
+
 #include <Wt/Dbo/WtSqlTraits.h>
 
 #include "database/Artist.hpp"
@@ -179,6 +182,27 @@ Track::create(Session& session, const std::filesystem::path& p)
 	return res;
 }
 
+std::vector<std::pair<TrackId, ReleaseId>>
+Track::getAllReleaseIds(Session& session)
+{
+	using QueryResultType = std::tuple<TrackId, ReleaseId>;
+	session.checkSharedLocked();
+
+	Wt::Dbo::collection<QueryResultType> queryRes = session.getDboSession().query<QueryResultType>("SELECT id,release_id FROM track")
+		.where("release_id IS NOT NULL");
+
+	std::vector<std::pair<TrackId, ReleaseId>> result;
+	result.reserve(queryRes.size());
+
+	std::transform(std::begin(queryRes), std::end(queryRes), std::back_inserter(result),
+			[](const QueryResultType& queryResult)
+			{
+				return std::make_pair(std::get<0>(queryResult), std::get<1>(queryResult));
+			});
+
+	return result;
+}
+
 std::vector<std::pair<TrackId, std::filesystem::path>>
 Track::getAllPaths(Session& session, std::optional<std::size_t> offset, std::optional<std::size_t> size)
 {
@@ -201,6 +225,28 @@ Track::getAllPaths(Session& session, std::optional<std::size_t> offset, std::opt
 	return result;
 }
 
+std::vector<std::pair<TrackId, std::filesystem::path>>
+Track::getAllPathsWithMissingLoudness(Session& session, std::optional<std::size_t> size)
+{
+	using QueryResultType = std::tuple<TrackId, std::string>;
+	session.checkSharedLocked();
+
+	Wt::Dbo::collection<QueryResultType> queryRes = session.getDboSession().query<QueryResultType>("SELECT id,file_path FROM track")
+		.where("loudness_analyzed = ?").bind(false)
+		.limit(size ? static_cast<int>(*size) : -1);
+
+	std::vector<std::pair<TrackId, std::filesystem::path>> result;
+	result.reserve(queryRes.size());
+
+	std::transform(std::begin(queryRes), std::end(queryRes), std::back_inserter(result),
+			[](const QueryResultType& queryResult)
+			{
+				return std::make_pair(std::get<0>(queryResult), std::get<1>(queryResult));
+			});
+
+	return result;
+}
+
 std::vector<Track::pointer>
 Track::getMBIDDuplicates(Session& session)
 {
@@ -315,6 +361,110 @@ Track::getStarred(Session& session,
 	return res;
 }
 
+std::vector<Track::pointer>
+Track::getByIds(Session& session, const std::vector<TrackId>& trackIds)
+{
+	session.checkSharedLocked();
+
+	std::unordered_map<TrackId, pointer> tracksById;
+	forEachIdChunk(trackIds, [&](const std::vector<TrackId>& chunk)
+	{
+		auto query {session.getDboSession().query<Wt::Dbo::ptr<Track>>("SELECT t FROM track t")
+			.where("t.id IN (" + makeBindPlaceholders(chunk.size()) + ")")};
+		for (const TrackId trackId : chunk)
+			query.bind(trackId);
+
+		auto collection {query.resultList()};
+		for (const Wt::Dbo::ptr<Track>& track : collection)
+			tracksById.emplace(track->getId(), track);
+	});
+
+	std::vector<pointer> res;
+	res.reserve(trackIds.size());
+	for (const TrackId trackId : trackIds)
+	{
+		auto it {tracksById.find(trackId)};
+		if (it != std::cend(tracksById))
+			res.push_back(it->second);
+	}
+
+	return res;
+}
+
+std::unordered_map<TrackId, std::vector<Artist::pointer>>
+Track::getArtistsByTrack(Session& session, const std::vector<TrackId>& trackIds, TrackArtistLinkType linkType)
+{
+	using QueryResultType = std::tuple<TrackId, Wt::Dbo::ptr<Artist>>;
+	session.checkSharedLocked();
+
+	std::unordered_map<TrackId, std::vector<Artist::pointer>> res;
+	forEachIdChunk(trackIds, [&](const std::vector<TrackId>& chunk)
+	{
+		auto query {session.getDboSession().query<QueryResultType>(
+				"SELECT t_a_l.track_id, a FROM artist a"
+				" INNER JOIN track_artist_link t_a_l ON t_a_l.artist_id = a.id")
+			.where("t_a_l.type = ?").bind(linkType)
+			.where("t_a_l.track_id IN (" + makeBindPlaceholders(chunk.size()) + ")")
+			.orderBy("t_a_l.id")};
+		for (const TrackId trackId : chunk)
+			query.bind(trackId);
+
+		auto collection {query.resultList()};
+		for (const auto& [trackId, artist] : collection)
+			res[trackId].push_back(artist);
+	});
+
+	return res;
+}
+
+std::unordered_map<TrackId, Cluster::pointer>
+Track::getFirstClusterByTrack(Session& session, const std::vector<TrackId>& trackIds, ClusterTypeId clusterTypeId)
+{
+	using QueryResultType = std::tuple<TrackId, Wt::Dbo::ptr<Cluster>>;
+	session.checkSharedLocked();
+
+	std::unordered_map<TrackId, Cluster::pointer> res;
+	forEachIdChunk(trackIds, [&](const std::vector<TrackId>& chunk)
+	{
+		auto query {session.getDboSession().query<QueryResultType>(
+				"SELECT t_c.track_id, c FROM cluster c"
+				" INNER JOIN track_cluster t_c ON t_c.cluster_id = c.id")
+			.where("c.cluster_type_id = ?").bind(clusterTypeId)
+			.where("t_c.track_id IN (" + makeBindPlaceholders(chunk.size()) + ")")
+			.orderBy("c.id")};
+		for (const TrackId trackId : chunk)
+			query.bind(trackId);
+
+		// keep the first cluster of each track
+		auto collection {query.resultList()};
+		for (const auto& [trackId, cluster] : collection)
+			res.emplace(trackId, cluster);
+	});
+
+	return res;
+}
+
+std::unordered_set<TrackId>
+Track::getStarredIds(Session& session, ObjectPtr<User> user, const std::vector<TrackId>& trackIds)
+{
+	session.checkSharedLocked();
+
+	std::unordered_set<TrackId> res;
+	forEachIdChunk(trackIds, [&](const std::vector<TrackId>& chunk)
+	{
+		auto query {session.getDboSession().query<TrackId>("SELECT uts.track_id FROM user_track_starred uts")
+			.where("uts.user_id = ?").bind(user->getId())
+			.where("uts.track_id IN (" + makeBindPlaceholders(chunk.size()) + ")")};
+		for (const TrackId trackId : chunk)
+			query.bind(trackId);
+
+		Wt::Dbo::collection<TrackId> collection = query.resultList();
+		res.insert(std::cbegin(collection), std::cend(collection));
+	});
+
+	return res;
+}
+
 std::vector<Cluster::pointer>
 Track::getClusters() const
 {
@@ -504,6 +654,37 @@ Track::getCopyrightURL() const
 	return _copyrightURL != "" ? std::make_optional<std::string>(_copyrightURL) : std::nullopt;
 }
 
+static
+std::optional<float>
+loudnessToReplayGain(std::optional<float> loudness, std::optional<float> peak)
+{
+	// ReplayGain 2.0 reference level
+	constexpr float referenceLoudness {-18};
+
+	if (!loudness)
+		return std::nullopt;
+
+	float gain {referenceLoudness - *loudness};
+
+	// Prevent clipping
+	if (peak && *peak > 0)
+		gain = std::min(gain, -20 * std::log10(*peak));
+
+	return gain;
+}
+
+std::optional<float>
+Track::getComputedTrackReplayGain() const
+{
+	return loudnessToReplayGain(_trackLoudness, _trackPeak);
+}
+
+std::optional<float>
+Track::getComputedReleaseReplayGain() const
+{
+	return loudnessToReplayGain(_releaseLoudness, _releasePeak);
+}
+
 std::vector<Artist::pointer>
 Track::getArtists(EnumSet<TrackArtistLinkType> linkTypes) const
 {
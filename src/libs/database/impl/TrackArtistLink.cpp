@@ -55,5 +55,16 @@ TrackArtistLink::getUsedTypes(Session& session)
 	return EnumSet<TrackArtistLinkType>(std::begin(res), std::end(res));
 }
 
+std::vector<std::tuple<TrackId, ArtistId, TrackArtistLinkType>>
+TrackArtistLink::getAllIds(Session& session)
+{
+	using QueryResultType = std::tuple<TrackId, ArtistId, TrackArtistLinkType>;
+	session.checkSharedLocked();
+
+	Wt::Dbo::collection<QueryResultType> res = session.getDboSession().query<QueryResultType>("SELECT track_id,artist_id,type FROM track_artist_link");
+
+	return std::vector<QueryResultType>(res.begin(), res.end());
+}
+
 }
 
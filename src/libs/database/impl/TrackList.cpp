@@ -103,6 +103,30 @@ TrackList::getAll(Session& session, ObjectPtr<User> user, Type type)
 	return std::vector<TrackList::pointer>(res.begin(), res.end());
 }
 
+std::vector<std::tuple<UserId, TrackId, Wt::WDateTime>>
+TrackList::getAllTrackIdsByUser(Session& session, Type type, const std::vector<std::string_view>& names)
+{
+	using QueryResultType = std::tuple<UserId, TrackId, Wt::WDateTime>;
+	session.checkSharedLocked();
+
+	if (names.empty())
+		return {};
+
+	std::string nameClause {"p.name IN ("};
+	for (std::size_t i {}; i < names.size(); ++i)
+		nameClause += (i == 0 ? "?" : ", ?");
+	nameClause += ")";
+
+	auto query {session.getDboSession().query<QueryResultType>("SELECT p.user_id, p_e.track_id, p_e.date_time FROM tracklist_entry p_e INNER JOIN tracklist p ON p.id = p_e.tracklist_id")
+		.where("p.type = ?").bind(type)
+		.where(nameClause)};
+	for (std::string_view name : names)
+		query.bind(name);
+
+	Wt::Dbo::collection<QueryResultType> queryRes = query.orderBy("p.user_id, p_e.date_time, p_e.id");
+	return std::vector<QueryResultType>(std::begin(queryRes), std::end(queryRes));
+}
+
 TrackList::pointer
 TrackList::getById(Session& session, TrackListId id)
 {
@@ -396,7 +420,8 @@ TrackList::getTrackIds() const
 	assert(session());
 
 	Wt::Dbo::collection<TrackId> res = session()->query<TrackId>("SELECT p_e.track_id from tracklist_entry p_e INNER JOIN tracklist p ON p_e.tracklist_id = p.id")
-		.where("p.id = ?").bind(getId());
+		.where("p.id = ?").bind(getId())
+		.orderBy("p_e.id");
 
 	return std::vector<TrackId>(res.begin(), res.end());
 }
@@ -29,5 +29,15 @@ namespace Database
 		return StringUtils::escapeString(keyword, "%_", escapeChar);
 	}
 
+	std::string
+	makeBindPlaceholders(std::size_t count)
+	{
+		std::string res;
+		for (std::size_t i {}; i < count; ++i)
+			res += (i == 0) ? "?" : ", ?";
+
+		return res;
+	}
+
 } // namespace Database
 
@@ -19,6 +19,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -29,5 +30,19 @@ namespace Database
 	static constexpr char escapeChar {'\\'};
 	std::string escapeLikeKeyword(std::string_view keywords);
 
+	// SQLite limits the number of host parameters per statement, split big id lists
+	static constexpr std::size_t maxBoundIdCount {256};
+	std::string makeBindPlaceholders(std::size_t count); // "?, ?, ..."
+
+	template <typename IdType, typename Func>
+	void forEachIdChunk(const std::vector<IdType>& ids, Func&& func)
+	{
+		for (std::size_t offset {}; offset < ids.size(); offset += maxBoundIdCount)
+		{
+			const std::size_t count {std::min(maxBoundIdCount, ids.size() - offset)};
+			func(std::vector<IdType>(std::cbegin(ids) + offset, std::cbegin(ids) + offset + count));
+		}
+	}
+
 } // namespace Database
 
@@ -19,7 +19,10 @@
 
 #pragma once
 
+#include <cstdint>
+#include <filesystem>
 #include <optional>
+#include <unordered_map>
 #include <vector>
 
 #include <Wt/WDateTime.h>
@@ -67,6 +70,12 @@ class Release : public Object<Release, ReleaseId>
 							std::optional<Range> range,
 							bool& moreExpected);
 		static std::vector<ReleaseId>	getAllIdsWithClusters(Session& session, std::optional<std::size_t> limit = {});
+		static std::vector<ReleaseId>	getAllIdsWithTracksAddedAfter(Session& session, const Wt::WDateTime& after); // added or updated
+		static std::vector<ReleaseId>	getAllIdsWithMissingCoverColor(Session& session); // color never computed
+
+		// Batch utility functions, to avoid querying each release separately
+		static std::vector<pointer>	getByTracks(Session& session, const std::vector<TrackId>& trackIds); // releases of these tracks, no duplicates
+		static std::unordered_map<ReleaseId, std::vector<ObjectPtr<Artist>>> getArtistsByRelease(Session& session, const std::vector<ReleaseId>& releaseIds, TrackArtistLinkType linkType);
 
 		std::vector<ObjectPtr<Track>> getTracks(const std::vector<ClusterId>& clusters = {}) const;
 		std::size_t					getTracksCount() const;
@@ -88,6 +97,8 @@ class Release : public Object<Release, ReleaseId>
 		// Accessors
 		const std::string&		getName() const		{ return _name; }
 		std::optional<UUID>		getMBID() const		{ return UUID::fromString(_MBID); }
+		std::filesystem::path	getCoverPath() const	{ return _coverPath; } // image file found along the tracks, resolved by the scanner
+		std::optional<std::uint32_t>	getCoverColor() const;	// 0xRRGGBB, dominant color of the cover
 		std::optional<std::size_t>	getTotalTrack() const;
 		std::optional<std::size_t>	getTotalDisc() const;
 		std::chrono::milliseconds	getDuration() const;
@@ -101,12 +112,16 @@ class Release : public Object<Release, ReleaseId>
 
 		void setName(std::string_view name)		{ _name = name; }
 		void setMBID(const std::optional<UUID>& mbid)	{ _MBID = mbid ? mbid->getAsString() : ""; }
+		void setCoverPath(const std::filesystem::path& coverPath)	{ _coverPath = coverPath.string(); }
+		void setCoverColor(std::optional<std::uint32_t> color); // none if the color cannot be computed (no cover, cannot decode, ...): not computed again
 
 		template<class Action>
 			void persist(Action& a)
 			{
 				Wt::Dbo::field(a, _name, "name");
 				Wt::Dbo::field(a, _MBID, "mbid");
+				Wt::Dbo::field(a, _coverPath, "cover_path");
+				Wt::Dbo::field(a, _coverColor, "cover_color");
 
 				Wt::Dbo::hasMany(a, _tracks, Wt::Dbo::ManyToOne, "release");
 				Wt::Dbo::hasMany(a, _starringUsers, Wt::Dbo::ManyToMany, "user_release_starred", "", Wt::Dbo::OnDeleteCascade);
@@ -117,6 +132,8 @@ class Release : public Object<Release, ReleaseId>
 
 		std::string	_name;
 		std::string	_MBID;
+		std::string	_coverPath;
+		std::optional<int>	_coverColor; // null if not computed yet, negative if no color
 
 		Wt::Dbo::collection<Wt::Dbo::ptr<Track>>	_tracks; // Tracks in the release
 		Wt::Dbo::collection<Wt::Dbo::ptr<User>>		_starringUsers; // Users that starred this release
@@ -20,10 +20,12 @@
 #pragma once
 
 #include <chrono>
+#include <cstdint>
 #include <filesystem>
 #include <optional>
 #include <string>
 #include <string_view>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
@@ -77,7 +79,9 @@ class Track : public Object<Track, TrackId>
 		static std::vector<pointer>	getAllRandom(Session& session, const std::vector<ClusterId>& clusters, std::optional<std::size_t> limit = std::nullopt);
 		static std::vector<TrackId>	getAllIdsRandom(Session& session, const std::vector<ClusterId>& clusters, std::optional<std::size_t> limit = std::nullopt);
 		static std::vector<TrackId>	getAllIds(Session& session);
+		static std::vector<std::pair<TrackId, ReleaseId>> getAllReleaseIds(Session& session);
 		static std::vector<std::pair<TrackId, std::filesystem::path>> getAllPaths(Session& session, std::optional<std::size_t> offset = std::nullopt, std::optional<std::size_t> size = std::nullopt);
+		static std::vector<std::pair<TrackId, std::filesystem::path>> getAllPathsWithMissingLoudness(Session& session, std::optional<std::size_t> size = std::nullopt);
 		static std::vector<pointer>	getMBIDDuplicates(Session& session);
 		static std::vector<pointer>	getLastWritten(Session& session, std::optional<Wt::WDateTime> after, const std::vector<ClusterId>& clusters, std::optional<Range> range, bool& moreResults);
 		static std::vector<pointer>	getAllWithRecordingMBIDAndMissingFeatures(Session& session);
@@ -88,6 +92,12 @@ class Track : public Object<Track, TrackId>
 							const std::vector<ClusterId>& clusters,
 							std::optional<Range> range, bool& hasMore);
 
+		// Batch utility functions, to avoid querying each track separately
+		static std::vector<pointer>	getByIds(Session& session, const std::vector<TrackId>& trackIds); // same order, unknown ids are skipped
+		static std::unordered_map<TrackId, std::vector<ObjectPtr<Artist>>> getArtistsByTrack(Session& session, const std::vector<TrackId>& trackIds, TrackArtistLinkType linkType);
+		static std::unordered_map<TrackId, ObjectPtr<Cluster>> getFirstClusterByTrack(Session& session, const std::vector<TrackId>& trackIds, ClusterTypeId clusterTypeId);
+		static std::unordered_set<TrackId> getStarredIds(Session& session, ObjectPtr<User> user, const std::vector<TrackId>& trackIds); // subset of trackIds
+
 		// Create utility
 		static pointer	create(Session& session, const std::filesystem::path& p);
 
@@ -101,16 +111,23 @@ class Track : public Object<Track, TrackId>
 		void setName(const std::string& name)				{ _name = std::string(name, 0, _maxNameLength); }
 		void setDuration(std::chrono::milliseconds duration)		{ _duration = duration; }
 		void setLastWriteTime(Wt::WDateTime time)			{ _fileLastWrite = time; }
+		void setFileSize(std::uintmax_t fileSize)			{ _fileSize = static_cast<long long>(fileSize); }
 		void setAddedTime(Wt::WDateTime time)				{ _fileAdded = time; }
 		void setDate(const Wt::WDate& date)							{ _date = date; }
 		void setOriginalDate(const Wt::WDate& date)					{ _originalDate = date; }
 		void setHasCover(bool hasCover)					{ _hasCover = hasCover; }
+		void setCoverPath(const std::filesystem::path& coverPath)	{ _coverPath = coverPath.string(); }
 		void setTrackMBID(const std::optional<UUID>& MBID)			{ _trackMBID = MBID ? MBID->getAsString() : ""; }
 		void setRecordingMBID(const std::optional<UUID>& MBID)		{ _recordingMBID = MBID ? MBID->getAsString() : ""; }
 		void setCopyright(const std::string& copyright)			{ _copyright = std::string(copyright, 0, _maxCopyrightLength); }
 		void setCopyrightURL(const std::string& copyrightURL)		{ _copyrightURL = std::string(copyrightURL, 0, _maxCopyrightURLLength); }
 		void setTrackReplayGain(float replayGain)			{ _trackReplayGain = replayGain; }
 		void setReleaseReplayGain(float replayGain)			{ _releaseReplayGain = replayGain; }
+		void setLoudnessAnalyzed(bool analyzed)				{ _loudnessAnalyzed = analyzed; }
+		void setTrackLoudness(std::optional<float> loudness)	{ _trackLoudness = loudness; }
+		void setTrackPeak(std::optional<float> peak)			{ _trackPeak = peak; }
+		void setReleaseLoudness(std::optional<float> loudness)	{ _releaseLoudness = loudness; }
+		void setReleasePeak(std::optional<float> peak)			{ _releasePeak = peak; }
 		void clearArtistLinks();
 		void addArtistLink(const ObjectPtr<TrackArtistLink>& artistLink);
 		void setRelease(ObjectPtr<Release> release)			{ _release = getDboPtr(release); }
@@ -127,17 +144,27 @@ class Track : public Object<Track, TrackId>
 		std::filesystem::path		getPath() const			{ return _filePath; }
 		std::chrono::milliseconds	getDuration() const		{ return _duration; }
 		const Wt::WDateTime&		getLastWritten() const	{ return _fileLastWrite; }
+		std::uintmax_t				getFileSize() const		{ return static_cast<std::uintmax_t>(_fileSize); } // as of the last scan
 		std::optional<int>			getYear() const;
 		std::optional<int>			getOriginalYear() const;
 		Wt::WDateTime				getLastWriteTime() const	{ return _fileLastWrite; }
 		Wt::WDateTime				getAddedTime() const		{ return _fileAdded; }
 		bool						hasCover() const		{ return _hasCover; }
+		std::filesystem::path		getCoverPath() const	{ return _coverPath; } // image file dedicated to this track, resolved by the scanner
 		std::optional<UUID>			getTrackMBID() const			{ return UUID::fromString(_trackMBID); }
 		std::optional<UUID>			getRecordingMBID() const			{ return UUID::fromString(_recordingMBID); }
 		std::optional<std::string>	getCopyright() const;
 		std::optional<std::string>	getCopyrightURL() const;
 		std::optional<float>		getTrackReplayGain() const	{ return _trackReplayGain; }
 		std::optional<float>		getReleaseReplayGain() const	{ return _releaseReplayGain; }
+		// Computed by the loudness analysis, fallback when there are no replay gain tags
+		bool						isLoudnessAnalyzed() const	{ return _loudnessAnalyzed; }
+		std::optional<float>		getTrackLoudness() const	{ return _trackLoudness; } // LUFS
+		std::optional<float>		getTrackPeak() const		{ return _trackPeak; }
+		std::optional<float>		getReleaseLoudness() const	{ return _releaseLoudness; } // LUFS
+		std::optional<float>		getReleasePeak() const		{ return _releasePeak; }
+		std::optional<float>		getComputedTrackReplayGain() const;
+		std::optional<float>		getComputedReleaseReplayGain() const;
 
 		// no artistLinkTypes means get all
 		std::vector<ObjectPtr<Artist>>	getArtists(EnumSet<TrackArtistLinkType> artistLinkTypes) const;
@@ -167,13 +194,20 @@ class Track : public Object<Track, TrackId>
 				Wt::Dbo::field(a, _filePath,		"file_path");
 				Wt::Dbo::field(a, _fileLastWrite,	"file_last_write");
 				Wt::Dbo::field(a, _fileAdded,		"file_added");
+				Wt::Dbo::field(a, _fileSize,		"file_size");
 				Wt::Dbo::field(a, _hasCover,		"has_cover");
+				Wt::Dbo::field(a, _coverPath,		"cover_path");
 				Wt::Dbo::field(a, _trackMBID,		"mbid");
 				Wt::Dbo::field(a, _recordingMBID,	"recording_mbid");
 				Wt::Dbo::field(a, _copyright,		"copyright");
 				Wt::Dbo::field(a, _copyrightURL,	"copyright_url");
 				Wt::Dbo::field(a, _trackReplayGain,	"track_replay_gain");
 				Wt::Dbo::field(a, _releaseReplayGain,	"release_replay_gain");
+				Wt::Dbo::field(a, _loudnessAnalyzed,	"loudness_analyzed");
+				Wt::Dbo::field(a, _trackLoudness,	"track_loudness");
+				Wt::Dbo::field(a, _trackPeak,		"track_peak");
+				Wt::Dbo::field(a, _releaseLoudness,	"release_loudness");
+				Wt::Dbo::field(a, _releasePeak,		"release_peak");
 				Wt::Dbo::belongsTo(a, _release, "release", Wt::Dbo::OnDeleteCascade);
 				Wt::Dbo::hasMany(a, _trackArtistLinks, Wt::Dbo::ManyToOne, "track");
 				Wt::Dbo::hasMany(a, _clusters, Wt::Dbo::ManyToMany, "track_cluster", "", Wt::Dbo::OnDeleteCascade);
@@ -203,13 +237,20 @@ class Track : public Object<Track, TrackId>
 		std::string				_filePath;
 		Wt::WDateTime			_fileLastWrite;
 		Wt::WDateTime			_fileAdded;
+		long long				_fileSize {};
 		bool					_hasCover {};
+		std::string				_coverPath;
 		std::string				_trackMBID;
 		std::string				_recordingMBID;
 		std::string				_copyright;
 		std::string				_copyrightURL;
 		std::optional<float>	_trackReplayGain;
 		std::optional<float>	_releaseReplayGain;
+		bool					_loudnessAnalyzed {};
+		std::optional<float>	_trackLoudness;
+		std::optional<float>	_trackPeak;
+		std::optional<float>	_releaseLoudness;
+		std::optional<float>	_releasePeak;
 
 		Wt::Dbo::ptr<Release>				_release;
 		Wt::Dbo::collection<Wt::Dbo::ptr<TrackArtistLink>> _trackArtistLinks;
@@ -20,6 +20,8 @@
 #pragma once
 
 #include <string>
+#include <tuple>
+#include <vector>
 
 #include <Wt/Dbo/Dbo.h>
 
@@ -42,6 +44,7 @@ namespace Database
 			static pointer create(Session& session, ObjectPtr<Track> track, ObjectPtr<Artist> artist, TrackArtistLinkType type);
 
 			static EnumSet<TrackArtistLinkType> getUsedTypes(Session& session);
+			static std::vector<std::tuple<TrackId, ArtistId, TrackArtistLinkType>> getAllIds(Session& session);
 
 			ObjectPtr<Track>		getTrack() const { return _track; }
 			ObjectPtr<Artist>	getArtist() const { return _artist; }
@@ -22,6 +22,9 @@
 #include <optional>
 #include <string>
 #include <set>
+#include <string_view>
+#include <tuple>
+#include <utility>
 #include <vector>
 
 #include <Wt/Dbo/Dbo.h>
@@ -62,6 +65,8 @@ class TrackList : public Object<TrackList, TrackListId>
 		static std::vector<pointer> getAll(Session& session);
 		static std::vector<pointer> getAll(Session& session, ObjectPtr<User> user);
 		static std::vector<pointer> getAll(Session& session, ObjectPtr<User> user, Type type);
+		// Entries of the tracklists of the given type and names (all users), ordered by user, then by date time
+		static std::vector<std::tuple<UserId, TrackId, Wt::WDateTime>> getAllTrackIdsByUser(Session& session, Type type, const std::vector<std::string_view>& names);
 
 		// Create utility
 		static pointer	create(Session& session, std::string_view name, Type type, bool isPublic, ObjectPtr<User> user);
@@ -19,17 +19,22 @@
 
 #include "Engine.hpp"
 
+#include <algorithm>
 #include <unordered_map>
 #include <vector>
 
+#include "AnnClassifierCreator.hpp"
 #include "ClustersClassifierCreator.hpp"
 #include "FeaturesEngineCreator.hpp"
+#include "ListensClassifierCreator.hpp"
 
 #include "database/Db.hpp"
 #include "database/Session.hpp"
 #include "database/ScanSettings.hpp"
 #include "utils/Exception.hpp"
+#include "utils/IConfig.hpp"
 #include "utils/Logger.hpp"
+#include "utils/Service.hpp"
 
 namespace Recommendation {
 
@@ -40,6 +45,10 @@ createClassifier(ClassifierType type)
 {
 	switch (type)
 	{
+		case ClassifierType::Ann:
+			return createAnnClassifier();
+			break;
+
 		case ClassifierType::Clusters:
 			return createClustersClassifier();
 			break;
@@ -47,6 +56,10 @@ createClassifier(ClassifierType type)
 		case ClassifierType::Features:
 			return createFeaturesEngine();
 			break;
+
+		case ClassifierType::Listens:
+			return createListensClassifier();
+			break;
 	}
 
 	return {};
@@ -60,98 +73,222 @@ createEngine(Database::Db& db)
 
 Engine::Engine(Database::Db& db)
 : _db {db}
+, _trackResultCache {Service<IConfig>::get()->getULong("recommendation-max-cache-entries", 1000)}
+, _releaseResultCache {Service<IConfig>::get()->getULong("recommendation-max-cache-entries", 1000)}
+, _artistResultCache {Service<IConfig>::get()->getULong("recommendation-max-cache-entries", 1000)}
+, _listensRefreshPeriod {Service<IConfig>::get()->getULong("recommendation-listens-refresh-period", 30)}
 {
+	scheduleListensRefresh();
 }
 
-Engine::TrackContainer
-Engine::getSimilarTracksFromTrackList(Database::Session& session, Database::TrackListId trackListId, std::size_t maxCount)
+Engine::~Engine()
 {
-	TrackContainer res;
+	_ioService.post([this] { _listensRefreshTimer.cancel(); });
+	cancelLoad();
+	_ioContextRunner.stop();
+}
 
-	std::shared_lock lock {_classifiersMutex};
-	for (const auto& classifierName : _classifierPriorities)
+bool
+Engine::ResultCacheKey::operator==(const ResultCacheKey& other) const
+{
+	return generation == other.generation
+		&& ids == other.ids
+		&& linkTypes == other.linkTypes
+		&& maxCount == other.maxCount;
+}
+
+std::size_t
+Engine::ResultCacheKeyHash::operator()(const ResultCacheKey& key) const
+{
+	std::size_t res {std::hash<std::size_t>{}(key.generation)};
+
+	auto combine {[&](std::size_t value)
 	{
-		auto itClassifier {_classifiers.find(classifierName)};
-		if (itClassifier == std::cend(_classifiers))
-			continue;
+		res ^= value + 0x9e3779b9 + (res << 6) + (res >> 2);
+	}};
 
-		res = itClassifier->second->getSimilarTracksFromTrackList(session, trackListId, maxCount);
-		if (!res.empty())
-			break;
-	}
+	for (const Database::IdType::ValueType id : key.ids)
+		combine(std::hash<Database::IdType::ValueType>{}(id));
+	combine(key.linkTypes);
+	combine(key.maxCount);
 
 	return res;
 }
 
-Engine::TrackContainer
-Engine::getSimilarTracks(Database::Session& dbSession, const std::vector<Database::TrackId>& trackIds, std::size_t maxCount)
+template <typename IdType>
+Engine::ResultCacheKey
+Engine::createResultCacheKey(const std::vector<IdType>& ids, EnumSet<Database::TrackArtistLinkType> linkTypes, std::size_t maxCount) const
 {
-	TrackContainer res;
+	ResultCacheKey key;
+
+	key.generation = _resultCacheGeneration;
+	key.ids.reserve(ids.size());
+	std::transform(std::cbegin(ids), std::cend(ids), std::back_inserter(key.ids), [](IdType id) { return id.getValue(); });
+	for (Database::TrackArtistLinkType linkType : linkTypes)
+		key.linkTypes |= (std::uint32_t {1} << static_cast<std::uint32_t>(linkType));
+	key.maxCount = maxCount;
 
-	std::shared_lock lock {_classifiersMutex};
-	for (ClassifierType classifierType : _classifierPriorities)
+	return key;
+}
+
+void
+Engine::invalidateResultCaches()
+{
+	auto logStats {[](std::string_view objectName, const auto& cache)
 	{
-		auto itClassifier {_classifiers.find(classifierType)};
-		if (itClassifier == std::cend(_classifiers))
-			continue;
+		const auto stats {cache.getStats()};
+		const std::size_t queryCount {stats.hits + stats.misses};
+
+		LMS_LOG(RECOMMENDATION, DEBUG) << "Similar " << objectName << " cache: " << stats.entryCount << " entries, hits = " << stats.hits << ", misses = " << stats.misses
+			<< ", hit rate = " << (queryCount ? (stats.hits * 100) / queryCount : 0) << "%";
+	}};
+
+	logStats("tracks", _trackResultCache);
+	logStats("releases", _releaseResultCache);
+	logStats("artists", _artistResultCache);
+
+	// Results computed concurrently with the old generation will never be hit
+	_resultCacheGeneration++;
+
+	_trackResultCache.clear();
+	_releaseResultCache.clear();
+	_artistResultCache.clear();
+}
 
-		const IClassifier& classifier {*itClassifier->second};
-		res = classifier.getSimilarTracks(dbSession, trackIds, maxCount);
-		if (!res.empty())
+static
+float
+getClassifierWeight(ClassifierType type)
+{
+	switch (type)
+	{
+		case ClassifierType::Listens:
+			return 1;
+
+		case ClassifierType::Ann:
+			return 0.9;
+
+		case ClassifierType::Features:
+			return 0.8;
+
+		case ClassifierType::Clusters:
+			return 0.6;
+	}
+
+	return 0;
+}
+
+template <typename IdType, typename QueryFunc>
+std::vector<IdType>
+Engine::getBlendedResults(std::string_view objectName, std::size_t maxCount, QueryFunc queryFunc)
+{
+	struct ScoredId
+	{
+		IdType id;
+		float score;
+	};
+	std::vector<ScoredId> scoredIds;
+	std::unordered_map<IdType, std::size_t> scoredIdIndexes;
+
+	{
+		std::shared_lock lock {_classifiersMutex};
+		for (ClassifierType classifierType : _classifierPriorities)
 		{
-			LMS_LOG(RECOMMENDATION, DEBUG) << "Got " << res.size() << " similar tracks using classifier '" << classifier.getName() << "'";
-			break;
+			// Clusters classifier relies on heavy SQL queries: only use it to complete the results
+			if (classifierType == ClassifierType::Clusters && scoredIds.size() >= maxCount)
+				break;
+
+			auto itClassifier {_classifiers.find(classifierType)};
+			if (itClassifier == std::cend(_classifiers))
+				continue;
+
+			const IClassifier& classifier {*itClassifier->second};
+			const std::vector<IdType> classifierRes {queryFunc(classifier)};
+			if (classifierRes.empty())
+				continue;
+
+			LMS_LOG(RECOMMENDATION, DEBUG) << "Got " << classifierRes.size() << " similar " << objectName << " using classifier '" << classifier.getName() << "'";
+
+			// Reciprocal rank fusion: objects reported by several classifiers are pushed up
+			const float weight {getClassifierWeight(classifierType)};
+			for (std::size_t rank {}; rank < classifierRes.size(); ++rank)
+			{
+				const float score {weight / static_cast<float>(rank + 1)};
+
+				auto [itIndex, inserted] {scoredIdIndexes.try_emplace(classifierRes[rank], scoredIds.size())};
+				if (inserted)
+					scoredIds.push_back({classifierRes[rank], score});
+				else
+					scoredIds[itIndex->second].score += score;
+			}
 		}
 	}
 
+	std::stable_sort(std::begin(scoredIds), std::end(scoredIds), [](const ScoredId& a, const ScoredId& b) { return a.score > b.score; });
+	if (scoredIds.size() > maxCount)
+		scoredIds.resize(maxCount);
+
+	std::vector<IdType> res;
+	res.reserve(scoredIds.size());
+	std::transform(std::cbegin(scoredIds), std::cend(scoredIds), std::back_inserter(res), [](const ScoredId& scoredId) { return scoredId.id; });
+
+	return res;
+}
+
+Engine::TrackContainer
+Engine::getSimilarTracksFromTrackList(Database::Session& session, Database::TrackListId trackListId, std::size_t maxCount)
+{
+	// Not cached, as tracklist contents change quite often (play queue, ...)
+	return getBlendedResults<Database::TrackId>("tracks", maxCount, [&](const IClassifier& classifier)
+	{
+		return classifier.getSimilarTracksFromTrackList(session, trackListId, maxCount);
+	});
+}
+
+Engine::TrackContainer
+Engine::getSimilarTracks(Database::Session& dbSession, const std::vector<Database::TrackId>& trackIds, std::size_t maxCount)
+{
+	const ResultCacheKey cacheKey {createResultCacheKey(trackIds, {}, maxCount)};
+	if (std::optional<TrackContainer> cachedRes {_trackResultCache.get(cacheKey)})
+		return std::move(*cachedRes);
+
+	TrackContainer res {getBlendedResults<Database::TrackId>("tracks", maxCount, [&](const IClassifier& classifier)
+	{
+		return classifier.getSimilarTracks(dbSession, trackIds, maxCount);
+	})};
+
+	_trackResultCache.put(cacheKey, res);
 	return res;
 }
 
 Engine::ReleaseContainer
 Engine::getSimilarReleases(Database::Session& dbSession, Database::ReleaseId releaseId, std::size_t maxCount)
 {
-	ReleaseContainer res;
+	const ResultCacheKey cacheKey {createResultCacheKey<Database::ReleaseId>({releaseId}, {}, maxCount)};
+	if (std::optional<ReleaseContainer> cachedRes {_releaseResultCache.get(cacheKey)})
+		return std::move(*cachedRes);
 
-	std::shared_lock lock {_classifiersMutex};
-	for (ClassifierType classifierType : _classifierPriorities)
+	ReleaseContainer res {getBlendedResults<Database::ReleaseId>("releases", maxCount, [&](const IClassifier& classifier)
 	{
-		auto itClassifier {_classifiers.find(classifierType)};
-		if (itClassifier == std::cend(_classifiers))
-			continue;
-
-		const IClassifier& classifier {*itClassifier->second};
-		res = classifier.getSimilarReleases(dbSession, releaseId, maxCount);
-		if (!res.empty())
-		{
-			LMS_LOG(RECOMMENDATION, DEBUG) << "Got " << res.size() << " similar releases using classifier '" << classifier.getName() << "'";
-			break;
-		}
-	}
+		return classifier.getSimilarReleases(dbSession, releaseId, maxCount);
+	})};
 
+	_releaseResultCache.put(cacheKey, res);
 	return res;
 }
 
 Engine::ArtistContainer
 Engine::getSimilarArtists(Database::Session& dbSession, Database::ArtistId artistId, EnumSet<Database::TrackArtistLinkType> linkTypes, std::size_t maxCount)
 {
-	ArtistContainer res;
+	const ResultCacheKey cacheKey {createResultCacheKey<Database::ArtistId>({artistId}, linkTypes, maxCount)};
+	if (std::optional<ArtistContainer> cachedRes {_artistResultCache.get(cacheKey)})
+		return std::move(*cachedRes);
 
-	std::shared_lock lock {_classifiersMutex};
-	for (ClassifierType classifierType : _classifierPriorities)
+	ArtistContainer res {getBlendedResults<Database::ArtistId>("artists", maxCount, [&](const IClassifier& classifier)
 	{
-		auto itClassifier {_classifiers.find(classifierType)};
-		if (itClassifier == std::cend(_classifiers))
-			continue;
-
-		const IClassifier& classifier {*itClassifier->second};
-		res = classifier.getSimilarArtists(dbSession, artistId, linkTypes, maxCount);
-		if (!res.empty())
-		{
-			LMS_LOG(RECOMMENDATION, DEBUG) << "Got " << res.size() << " similar artists using classifier '" << classifier.getName() << "'";
-			return res;
-		}
-	}
+		return classifier.getSimilarArtists(dbSession, artistId, linkTypes, maxCount);
+	})};
 
+	_artistResultCache.put(cacheKey, res);
 	return res;
 }
 
@@ -185,22 +322,27 @@ Engine::load(bool forceReload, const ProgressCallback& progressCallback)
 	switch (getRecommendationEngineType(_db.getTLSSession()))
 	{
 		case ScanSettings::RecommendationEngineType::Clusters:
-			setClassifierPriorities({ClassifierType::Clusters});
+			setClassifierPriorities({ClassifierType::Listens, ClassifierType::Clusters});
 			addClassifier(ClassifierType::Clusters);
+			addClassifier(ClassifierType::Listens);
 			break;
 		case ScanSettings::RecommendationEngineType::Features:
-			setClassifierPriorities({ClassifierType::Features, ClassifierType::Clusters});
+			setClassifierPriorities({ClassifierType::Listens, ClassifierType::Ann, ClassifierType::Features, ClassifierType::Clusters});
 			// not same order since clusters is faster to load
 			addClassifier(ClassifierType::Clusters);
+			addClassifier(ClassifierType::Listens);
+			addClassifier(ClassifierType::Ann);
 			addClassifier(ClassifierType::Features);
 			break;
 	}
 
-	assert(_pendingClassifiers.empty());
 	clearClassifiers();
 
 	{
-		std::scoped_lock lock {_controlMutex};
+		std::unique_lock lock {_controlMutex};
+
+		// Wait for the listens refresh, if any
+		_pendingClassifiersCondvar.wait(lock, [this] { return _pendingClassifiers.empty(); });
 
 		std::transform(std::cbegin(classifiers), std::cend(classifiers), std::inserter(_pendingClassifiers, std::end(_pendingClassifiers)),
 				[](auto& classifier) { return classifier.classifier.get(); });
@@ -223,9 +365,13 @@ Engine::setClassifierPriorities(const std::vector<ClassifierType>& classifierPri
 void
 Engine::clearClassifiers()
 {
-	std::unique_lock lock {_classifiersMutex};
+	{
+		std::unique_lock lock {_classifiersMutex};
+
+		_classifiers.clear();
+	}
 
-	_classifiers.clear();
+	invalidateResultCaches();
 }
 
 void
@@ -253,9 +399,13 @@ Engine::loadClassifier(std::unique_ptr<IClassifier> classifier,
 
 	if (res)
 	{
-		std::unique_lock lock {_classifiersMutex};
+		{
+			std::unique_lock lock {_classifiersMutex};
+
+			_classifiers.emplace(classifierType, std::move(classifier));
+		}
 
-		_classifiers.emplace(classifierType, std::move(classifier));
+		invalidateResultCaches();
 	}
 
 	{
@@ -267,6 +417,66 @@ Engine::loadClassifier(std::unique_ptr<IClassifier> classifier,
 	_pendingClassifiersCondvar.notify_one();
 }
 
+void
+Engine::scheduleListensRefresh()
+{
+	if (_listensRefreshPeriod.count() == 0)
+		return;
+
+	_listensRefreshTimer.expires_from_now(_listensRefreshPeriod);
+	_listensRefreshTimer.async_wait([this](const boost::system::error_code& ec)
+	{
+		if (ec)
+			return;
+
+		refreshListensClassifier();
+		scheduleListensRefresh();
+	});
+}
+
+void
+Engine::refreshListensClassifier()
+{
+	std::unique_ptr<IClassifier> classifier {createClassifier(ClassifierType::Listens)};
+
+	{
+		std::scoped_lock lock {_controlMutex};
+
+		// Will be done by the current load anyway
+		if (_loadCancelled || !_pendingClassifiers.empty())
+			return;
+
+		_pendingClassifiers.insert(classifier.get());
+	}
+
+	LMS_LOG(RECOMMENDATION, DEBUG) << "Refreshing classifier '" << classifier->getName() << "'...";
+	const bool res {classifier->load(_db.getTLSSession(), false, {})};
+
+	{
+		std::scoped_lock lock {_controlMutex};
+
+		_pendingClassifiers.erase(classifier.get());
+	}
+	_pendingClassifiersCondvar.notify_all();
+
+	if (!res)
+		return;
+
+	{
+		std::unique_lock lock {_classifiersMutex};
+
+		// Only replace the classifier used by the current engine type
+		auto itClassifier {_classifiers.find(ClassifierType::Listens)};
+		if (itClassifier == std::cend(_classifiers))
+			return;
+
+		itClassifier->second = std::move(classifier);
+	}
+
+	invalidateResultCaches();
+	LMS_LOG(RECOMMENDATION, DEBUG) << "Refreshing listens classifier DONE";
+}
+
 void
 Engine::cancelLoad()
 {
@@ -19,13 +19,21 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <shared_mutex>
+#include <string_view>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/steady_timer.hpp>
+
 #include "recommendation/IEngine.hpp"
+#include "utils/IOContextRunner.hpp"
+#include "utils/LruCache.hpp"
 #include "IClassifier.hpp"
 
 namespace Database
@@ -37,15 +45,17 @@ namespace Recommendation
 {
 	enum class ClassifierType
 	{
+		Ann,
 		Clusters,
 		Features,
+		Listens,
 	};
 
 	class Engine : public IEngine
 	{
 		public:
 			Engine(Database::Db& db);
-			~Engine() = default;
+			~Engine();
 
 			Engine(const Engine&) = delete;
 			Engine(Engine&&) = delete;
@@ -65,10 +75,40 @@ namespace Recommendation
 					EnumSet<Database::TrackArtistLinkType> linkTypes,
 					std::size_t maxCount) override;
 
+			// Blend the results of the classifiers, using their priority
+			template <typename IdType, typename QueryFunc>
+			std::vector<IdType> getBlendedResults(std::string_view objectName, std::size_t maxCount, QueryFunc queryFunc);
+
+			struct ResultCacheKey
+			{
+				std::size_t generation {};
+				std::vector<Database::IdType::ValueType> ids;
+				std::uint32_t linkTypes {};
+				std::size_t maxCount {};
+
+				bool operator==(const ResultCacheKey& other) const;
+			};
+
+			struct ResultCacheKeyHash
+			{
+				std::size_t operator()(const ResultCacheKey& key) const;
+			};
+
+			template <typename IdType>
+			using ResultCache = LruCache<ResultCacheKey, std::vector<IdType>, ResultCacheKeyHash>;
+
+			template <typename IdType>
+			ResultCacheKey createResultCacheKey(const std::vector<IdType>& ids, EnumSet<Database::TrackArtistLinkType> linkTypes, std::size_t maxCount) const;
+			void invalidateResultCaches();
+
 			void setClassifierPriorities(const std::vector<ClassifierType>& classifierTypes);
 			void clearClassifiers();
 			void loadClassifier(std::unique_ptr<IClassifier> classifier, ClassifierType classifierType, bool forceReload, const ProgressCallback& progressCallback);
 
+			// New listens are taken into account without waiting for the next scan
+			void scheduleListensRefresh();
+			void refreshListensClassifier();
+
 			Database::Db&				_db;
 
 			std::mutex							_controlMutex;
@@ -80,6 +120,17 @@ namespace Recommendation
 			using ClassifierContainer = std::unordered_map<ClassifierType, std::unique_ptr<IClassifier>>;
 			ClassifierContainer			_classifiers;
 			std::vector<ClassifierType>	_classifierPriorities; // ordered by priority
+
+			// Results only depend on the loaded classifiers, which are reloaded after each scan
+			std::atomic<std::size_t>		_resultCacheGeneration {};
+			ResultCache<Database::TrackId>		_trackResultCache;
+			ResultCache<Database::ReleaseId>	_releaseResultCache;
+			ResultCache<Database::ArtistId>		_artistResultCache;
+
+			const std::chrono::minutes		_listensRefreshPeriod;
+			boost::asio::io_service			_ioService;
+			boost::asio::steady_timer		_listensRefreshTimer {_ioService};
+			IOContextRunner					_ioContextRunner {_ioService, 1};
 	};
 
 } // ns Recommendation
@@ -0,0 +1,458 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "AnnClassifier.hpp"
+
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <unordered_set>
+
+#include "database/Session.hpp"
+#include "database/Track.hpp"
+#include "database/TrackArtistLink.hpp"
+#include "database/TrackList.hpp"
+#include "features/FeaturesEngine.hpp"
+#include "utils/IConfig.hpp"
+#include "utils/Logger.hpp"
+#include "utils/Service.hpp"
+
+namespace Recommendation {
+
+std::unique_ptr<IClassifier> createAnnClassifier()
+{
+	return std::make_unique<AnnClassifier>();
+}
+
+static
+std::filesystem::path
+getCacheDirectory()
+{
+	return Service<IConfig>::get()->getPath("working-dir") / "cache" / "ann";
+}
+
+static
+std::filesystem::path
+getCacheTrackIndexFilePath()
+{
+	return getCacheDirectory() / "track_index";
+}
+
+static
+std::filesystem::path
+getCacheTrackIdsFilePath()
+{
+	return getCacheDirectory() / "track_ids";
+}
+
+static
+void
+invalidateCache()
+{
+	std::error_code ec;
+
+	std::filesystem::remove(getCacheTrackIndexFilePath(), ec);
+	std::filesystem::remove(getCacheTrackIdsFilePath(), ec);
+}
+
+static
+std::optional<std::pair<Ann::HnswIndex, std::vector<Database::TrackId>>>
+readTrackIndexFromCache(const Ann::HnswIndex::Settings& settings)
+{
+	std::ifstream indexStream {getCacheTrackIndexFilePath(), std::ios::binary};
+	std::ifstream idsStream {getCacheTrackIdsFilePath()};
+	if (!indexStream || !idsStream)
+		return std::nullopt;
+
+	LMS_LOG(RECOMMENDATION, INFO) << "Reading ANN index from cache...";
+
+	std::optional<Ann::HnswIndex> index {Ann::HnswIndex::read(indexStream)};
+	if (!index)
+	{
+		LMS_LOG(RECOMMENDATION, ERROR) << "Cannot read ANN index from cache: bad format";
+		return std::nullopt;
+	}
+
+	if (index->getSettings().maxLinkCount != settings.maxLinkCount || index->getSettings().efConstruction != settings.efConstruction)
+	{
+		LMS_LOG(RECOMMENDATION, INFO) << "ANN index settings changed, rebuilding index";
+		return std::nullopt;
+	}
+
+	std::vector<Database::TrackId> trackIds;
+	trackIds.reserve(index->getNodeCount());
+
+	Database::IdType::ValueType trackId;
+	while (idsStream >> trackId)
+		trackIds.emplace_back(trackId);
+
+	if (trackIds.size() != index->getNodeCount())
+	{
+		LMS_LOG(RECOMMENDATION, ERROR) << "Cannot read ANN index from cache: track count mismatch";
+		return std::nullopt;
+	}
+
+	return std::make_pair(std::move(*index), std::move(trackIds));
+}
+
+static
+std::filesystem::path
+getTmpFilePath(const std::filesystem::path& path)
+{
+	std::filesystem::path tmpPath {path};
+	tmpPath += ".tmp";
+	return tmpPath;
+}
+
+// Written in temporary files first, so that a crash does not leave truncated files
+static
+void
+writeTrackIndexToCache(const Ann::HnswIndex& index, const std::vector<Database::TrackId>& trackIds)
+{
+	std::error_code ec;
+	std::filesystem::create_directories(getCacheDirectory(), ec);
+
+	const std::filesystem::path indexTmpPath {getTmpFilePath(getCacheTrackIndexFilePath())};
+	const std::filesystem::path idsTmpPath {getTmpFilePath(getCacheTrackIdsFilePath())};
+
+	bool success {};
+	{
+		std::ofstream indexStream {indexTmpPath, std::ios::binary | std::ios::trunc};
+		std::ofstream idsStream {idsTmpPath, std::ios::trunc};
+		if (indexStream && idsStream)
+		{
+			index.write(indexStream);
+			for (Database::TrackId trackId : trackIds)
+				idsStream << trackId.getValue() << '\n';
+
+			indexStream.flush();
+			idsStream.flush();
+			success = indexStream && idsStream;
+		}
+	}
+
+	if (success)
+	{
+		// Remove the ids first: a crash in between leaves an incomplete cache, not a mismatching one
+		std::filesystem::remove(getCacheTrackIdsFilePath(), ec);
+		std::filesystem::rename(indexTmpPath, getCacheTrackIndexFilePath(), ec);
+		if (!ec)
+			std::filesystem::rename(idsTmpPath, getCacheTrackIdsFilePath(), ec);
+
+		if (!ec)
+		{
+			LMS_LOG(RECOMMENDATION, DEBUG) << "Created ANN index cache";
+			return;
+		}
+
+		LMS_LOG(RECOMMENDATION, ERROR) << "Cannot rename ANN index cache files: " << ec.message();
+	}
+
+	LMS_LOG(RECOMMENDATION, ERROR) << "Cannot create ANN index cache";
+	std::filesystem::remove(indexTmpPath, ec);
+	std::filesystem::remove(idsTmpPath, ec);
+	invalidateCache();
+}
+
+template <typename IdType>
+AnnClassifier::ObjectIndex<IdType>::ObjectIndex(Ann::HnswIndex _index, std::vector<IdType> _ids)
+: index {std::move(_index)}
+, ids {std::move(_ids)}
+{
+	nodeIds.reserve(ids.size());
+	for (std::size_t i {}; i < ids.size(); ++i)
+		nodeIds.emplace(ids[i], static_cast<Ann::NodeId>(i));
+}
+
+AnnClassifier::AnnClassifier()
+: _indexSettings {Service<IConfig>::get()->getULong("recommendation-ann-max-links", 16), Service<IConfig>::get()->getULong("recommendation-ann-ef-construction", 200)}
+, _efSearch {Service<IConfig>::get()->getULong("recommendation-ann-ef-search", 64)}
+{
+}
+
+std::optional<AnnClassifier::TrackIndex>
+AnnClassifier::createTrackIndex(Database::Session& session, const ProgressCallback& progressCallback) const
+{
+	std::optional<FeaturesEngine::TrackFeatureVectors> trackFeatureVectors {FeaturesEngine::extractTrackFeatureVectors(session, FeaturesEngine::getDefaultTrainFeatureSettings(), [this] { return _loadCancelled; })};
+	if (!trackFeatureVectors || trackFeatureVectors->vectors.empty())
+		return std::nullopt;
+
+	// Apply the feature weights once for all, so that the index can use a plain euclidian distance
+	const std::size_t dimCount {trackFeatureVectors->weights.getNbDimensions()};
+	std::vector<Ann::Value> scaleFactors(dimCount);
+	for (std::size_t i {}; i < dimCount; ++i)
+		scaleFactors[i] = std::sqrt(trackFeatureVectors->weights[i]);
+
+	LMS_LOG(RECOMMENDATION, DEBUG) << "Building ANN index...";
+
+	Ann::HnswIndex index {dimCount, _indexSettings};
+	std::vector<Ann::Value> values(dimCount);
+
+	const std::size_t trackCount {trackFeatureVectors->vectors.size()};
+	for (std::size_t i {}; i < trackCount; ++i)
+	{
+		if (_loadCancelled)
+			return std::nullopt;
+
+		const SOM::InputVector& vector {trackFeatureVectors->vectors[i]};
+		for (std::size_t j {}; j < dimCount; ++j)
+			values[j] = vector[j] * scaleFactors[j];
+
+		index.add(values);
+
+		if (progressCallback && (i % 1000 == 0 || i + 1 == trackCount))
+			progressCallback(Progress {trackCount, i + 1});
+	}
+
+	LMS_LOG(RECOMMENDATION, DEBUG) << "Building ANN index DONE";
+
+	return TrackIndex {std::move(index), std::move(trackFeatureVectors->trackIds)};
+}
+
+template <typename IdType>
+std::optional<AnnClassifier::ObjectIndex<IdType>>
+AnnClassifier::createCentroidIndex(const std::vector<std::pair<Database::TrackId, IdType>>& trackObjectIds) const
+{
+	const Ann::HnswIndex& trackIndex {_trackIndex->index};
+	const std::size_t dimCount {trackIndex.getDimCount()};
+
+	struct Centroid
+	{
+		std::vector<Ann::Value> sum;
+		std::size_t count {};
+	};
+	std::vector<IdType> objectIds;
+	std::unordered_map<IdType, Centroid> centroids;
+
+	for (const auto& [trackId, objectId] : trackObjectIds)
+	{
+		auto itNodeId {_trackIndex->nodeIds.find(trackId)};
+		if (itNodeId == std::cend(_trackIndex->nodeIds))
+			continue;
+
+		auto [itCentroid, inserted] {centroids.try_emplace(objectId)};
+		if (inserted)
+		{
+			itCentroid->second.sum.resize(dimCount);
+			objectIds.push_back(objectId);
+		}
+
+		const std::vector<Ann::Value> values {trackIndex.getValues(itNodeId->second)};
+		for (std::size_t i {}; i < dimCount; ++i)
+			itCentroid->second.sum[i] += values[i];
+		itCentroid->second.count++;
+	}
+
+	Ann::HnswIndex index {dimCount, _indexSettings};
+	for (const IdType objectId : objectIds)
+	{
+		if (_loadCancelled)
+			return std::nullopt;
+
+		Centroid& centroid {centroids[objectId]};
+		for (Ann::Value& value : centroid.sum)
+			value /= centroid.count;
+
+		index.add(centroid.sum);
+	}
+
+	return ObjectIndex<IdType> {std::move(index), std::move(objectIds)};
+}
+
+bool
+AnnClassifier::load(Database::Session& session, bool forceReload, const ProgressCallback& progressCallback)
+{
+	if (forceReload)
+		invalidateCache();
+	else if (auto cache {readTrackIndexFromCache(_indexSettings)})
+		_trackIndex.emplace(std::move(cache->first), std::move(cache->second));
+
+	if (!_trackIndex)
+	{
+		LMS_LOG(RECOMMENDATION, INFO) << "Constructing ANN classifier...";
+
+		_trackIndex = createTrackIndex(session, progressCallback);
+		if (!_trackIndex)
+			return false;
+
+		writeTrackIndexToCache(_trackIndex->index, _trackIndex->ids);
+	}
+
+	// Centroids are cheap to compute compared to the track index: no need to cache them
+	LMS_LOG(RECOMMENDATION, DEBUG) << "Building release and artist indexes...";
+	{
+		std::vector<std::pair<Database::TrackId, Database::ReleaseId>> trackReleaseIds;
+		{
+			auto transaction {session.createSharedTransaction()};
+			trackReleaseIds = Database::Track::getAllReleaseIds(session);
+		}
+
+		_releaseIndex = createCentroidIndex(trackReleaseIds);
+		if (!_releaseIndex)
+			return false;
+	}
+
+	{
+		std::unordered_map<Database::TrackArtistLinkType, std::vector<std::pair<Database::TrackId, Database::ArtistId>>> trackArtistIds;
+		{
+			auto transaction {session.createSharedTransaction()};
+			for (const auto& [trackId, artistId, linkType] : Database::TrackArtistLink::getAllIds(session))
+				trackArtistIds[linkType].emplace_back(trackId, artistId);
+		}
+
+		for (const auto& [linkType, ids] : trackArtistIds)
+		{
+			std::optional<ObjectIndex<Database::ArtistId>> artistIndex {createCentroidIndex(ids)};
+			if (!artistIndex)
+				return false;
+
+			_artistIndexes.emplace(linkType, std::move(*artistIndex));
+		}
+	}
+	LMS_LOG(RECOMMENDATION, DEBUG) << "Building release and artist indexes DONE";
+
+	LMS_LOG(RECOMMENDATION, INFO) << "ANN classifier successfully loaded (" << _trackIndex->ids.size() << " tracks)";
+
+	return true;
+}
+
+void
+AnnClassifier::requestCancelLoad()
+{
+	LMS_LOG(RECOMMENDATION, DEBUG) << "Requesting init cancellation";
+	_loadCancelled = true;
+}
+
+template <typename IdType>
+std::vector<IdType>
+AnnClassifier::getSimilarObjects(const ObjectIndex<IdType>& objectIndex, const std::vector<IdType>& ids, std::size_t maxCount) const
+{
+	std::vector<IdType> res;
+
+	// Search around the centroid of the requested objects
+	std::vector<Ann::Value> query(objectIndex.index.getDimCount());
+	std::size_t foundCount {};
+	for (const IdType id : ids)
+	{
+		auto itNodeId {objectIndex.nodeIds.find(id)};
+		if (itNodeId == std::cend(objectIndex.nodeIds))
+			continue;
+
+		const std::vector<Ann::Value> values {objectIndex.index.getValues(itNodeId->second)};
+		for (std::size_t i {}; i < query.size(); ++i)
+			query[i] += values[i];
+		foundCount++;
+	}
+
+	if (foundCount == 0)
+		return res;
+
+	for (Ann::Value& value : query)
+		value /= foundCount;
+
+	const std::unordered_set<IdType> excludedIds (std::cbegin(ids), std::cend(ids));
+	const std::size_t searchCount {maxCount + foundCount};
+
+	for (const Ann::HnswIndex::SearchResult& searchResult : objectIndex.index.search(query, searchCount, std::max(_efSearch, searchCount)))
+	{
+		const IdType id {objectIndex.ids[searchResult.id]};
+		if (excludedIds.find(id) != std::cend(excludedIds))
+			continue;
+
+		res.push_back(id);
+		if (res.size() == maxCount)
+			break;
+	}
+
+	return res;
+}
+
+IClassifier::ResultContainer<Database::TrackId>
+AnnClassifier::getSimilarTracksFromTrackList(Database::Session& session, Database::TrackListId trackListId, std::size_t maxCount) const
+{
+	const std::vector<Database::TrackId> trackIds {[&]
+	{
+		std::vector<Database::TrackId> res;
+
+		auto transaction {session.createSharedTransaction()};
+
+		const Database::TrackList::pointer trackList {Database::TrackList::getById(session, trackListId)};
+		if (trackList)
+			res = trackList->getTrackIds();
+
+		return res;
+	}()};
+
+	return getSimilarTracks(session, trackIds, maxCount);
+}
+
+IClassifier::ResultContainer<Database::TrackId>
+AnnClassifier::getSimilarTracks(Database::Session&, const std::vector<Database::TrackId>& trackIds, std::size_t maxCount) const
+{
+	if (!_trackIndex)
+		return {};
+
+	return getSimilarObjects(*_trackIndex, trackIds, maxCount);
+}
+
+IClassifier::ResultContainer<Database::ReleaseId>
+AnnClassifier::getSimilarReleases(Database::Session&, Database::ReleaseId releaseId, std::size_t maxCount) const
+{
+	if (!_releaseIndex)
+		return {};
+
+	return getSimilarObjects<Database::ReleaseId>(*_releaseIndex, {releaseId}, maxCount);
+}
+
+IClassifier::ResultContainer<Database::ArtistId>
+AnnClassifier::getSimilarArtists(Database::Session&,
+		Database::ArtistId artistId,
+		EnumSet<Database::TrackArtistLinkType> linkTypes,
+		std::size_t maxCount) const
+{
+	std::vector<std::vector<Database::ArtistId>> similarArtistIdsByLinkType;
+	for (Database::TrackArtistLinkType linkType : linkTypes)
+	{
+		auto itIndex {_artistIndexes.find(linkType)};
+		if (itIndex != std::cend(_artistIndexes))
+			similarArtistIdsByLinkType.emplace_back(getSimilarObjects<Database::ArtistId>(itIndex->second, {artistId}, maxCount));
+	}
+
+	// Merge by rank
+	std::vector<Database::ArtistId> res;
+	std::unordered_set<Database::ArtistId> addedArtistIds;
+	for (std::size_t rank {}; rank < maxCount && res.size() < maxCount; ++rank)
+	{
+		for (const std::vector<Database::ArtistId>& similarArtistIds : similarArtistIdsByLinkType)
+		{
+			if (rank < similarArtistIds.size() && addedArtistIds.insert(similarArtistIds[rank]).second)
+			{
+				res.push_back(similarArtistIds[rank]);
+				if (res.size() == maxCount)
+					break;
+			}
+		}
+	}
+
+	return res;
+}
+
+} // ns Recommendation
+
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "ann/HnswIndex.hpp"
+#include "IClassifier.hpp"
+
+namespace Recommendation
+{
+	// Approximate nearest neighbour search over the track feature vectors
+	// Releases and artists are indexed using the centroid of their tracks
+	class AnnClassifier : public IClassifier
+	{
+		public:
+			AnnClassifier();
+			AnnClassifier(const AnnClassifier&) = delete;
+			AnnClassifier(AnnClassifier&&) = delete;
+			AnnClassifier& operator=(const AnnClassifier&) = delete;
+			AnnClassifier& operator=(AnnClassifier&&) = delete;
+
+		private:
+			std::string_view getName() const override { return "ANN"; }
+
+			bool load(Database::Session& session, bool forceReload, const ProgressCallback& progressCallback) override;
+			void requestCancelLoad() override;
+
+			ResultContainer<Database::TrackId> getSimilarTracksFromTrackList(Database::Session& session, Database::TrackListId tracklistId, std::size_t maxCount) const override;
+			ResultContainer<Database::TrackId> getSimilarTracks(Database::Session& session, const std::vector<Database::TrackId>& tracksId, std::size_t maxCount) const override;
+			ResultContainer<Database::ReleaseId> getSimilarReleases(Database::Session& session, Database::ReleaseId releaseId, std::size_t maxCount) const override;
+			ResultContainer<Database::ArtistId> getSimilarArtists(Database::Session& session,
+					Database::ArtistId artistId,
+					EnumSet<Database::TrackArtistLinkType> linkTypes,
+					std::size_t maxCount) const override;
+
+			template <typename IdType>
+			struct ObjectIndex
+			{
+				Ann::HnswIndex							index;
+				std::vector<IdType>						ids;		// indexed by node id
+				std::unordered_map<IdType, Ann::NodeId>	nodeIds;
+
+				ObjectIndex(Ann::HnswIndex index, std::vector<IdType> ids);
+			};
+
+			using TrackIndex = ObjectIndex<Database::TrackId>;
+
+			std::optional<TrackIndex> createTrackIndex(Database::Session& session, const ProgressCallback& progressCallback) const;
+
+			template <typename IdType>
+			std::optional<ObjectIndex<IdType>> createCentroidIndex(const std::vector<std::pair<Database::TrackId, IdType>>& trackObjectIds) const;
+
+			template <typename IdType>
+			std::vector<IdType> getSimilarObjects(const ObjectIndex<IdType>& objectIndex, const std::vector<IdType>& ids, std::size_t maxCount) const;
+
+			const Ann::HnswIndex::Settings	_indexSettings;
+			const std::size_t				_efSearch;
+
+			bool																_loadCancelled {};
+			std::optional<TrackIndex>											_trackIndex;
+			std::optional<ObjectIndex<Database::ReleaseId>>						_releaseIndex;
+			std::unordered_map<Database::TrackArtistLinkType, ObjectIndex<Database::ArtistId>>	_artistIndexes;
+	};
+
+} // ns Recommendation
+
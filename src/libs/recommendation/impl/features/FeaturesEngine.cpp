@@ -127,13 +127,11 @@ getInputVectorWeights(const FeatureSettingsMap& featureSettingsMap, std::size_t
 	return weights;
 }
 
-bool
-FeaturesEngine::loadFromTraining(Database::Session& session, const TrainSettings& trainSettings, const ProgressCallback& progressCallback)
+std::optional<FeaturesEngine::TrackFeatureVectors>
+FeaturesEngine::extractTrackFeatureVectors(Database::Session& session, const FeatureSettingsMap& featureSettingsMap, const CancelCallback& cancelCallback)
 {
-	LMS_LOG(RECOMMENDATION, INFO) << "Constructing features classifier...";
-
 	std::unordered_set<FeatureName> featureNames;
-	std::transform(std::cbegin(trainSettings.featureSettingsMap), std::cend(trainSettings.featureSettingsMap), std::inserter(featureNames, std::begin(featureNames)),
+	std::transform(std::cbegin(featureSettingsMap), std::cend(featureSettingsMap), std::inserter(featureNames, std::begin(featureNames)),
 		[](const auto& itFeatureSetting) { return itFeatureSetting.first; });
 
 	const std::size_t nbDimensions {std::accumulate(std::cbegin(featureNames), std::cend(featureNames), std::size_t {0},
@@ -150,17 +148,15 @@ FeaturesEngine::loadFromTraining(Database::Session& session, const TrainSettings
 		LMS_LOG(RECOMMENDATION, DEBUG) << "Getting Tracks with features DONE (found " << trackIds.size() << " tracks)";
 	}
 
-	std::vector<SOM::InputVector> samples;
-	std::vector<Database::TrackId> samplesTrackIds;
-
-	samples.reserve(trackIds.size());
-	samplesTrackIds.reserve(trackIds.size());
+	TrackFeatureVectors res;
+	res.vectors.reserve(trackIds.size());
+	res.trackIds.reserve(trackIds.size());
 
 	LMS_LOG(RECOMMENDATION, DEBUG) << "Extracting features...";
 	for (Database::TrackId trackId : trackIds)
 	{
-		if (_loadCancelled)
-			return false;
+		if (cancelCallback())
+			return std::nullopt;
 
 		std::optional<FeatureValuesMap> featureValuesMap;
 
@@ -176,23 +172,44 @@ FeaturesEngine::loadFromTraining(Database::Session& session, const TrainSettings
 		if (!inputVector)
 			continue;
 
-		samples.emplace_back(std::move(*inputVector));
-		samplesTrackIds.emplace_back(trackId);
+		res.vectors.emplace_back(std::move(*inputVector));
+		res.trackIds.emplace_back(trackId);
 	}
 	LMS_LOG(RECOMMENDATION, DEBUG) << "Extracting features DONE";
 
-	if (samples.empty())
+	if (res.vectors.empty())
+		return res;
+
+	LMS_LOG(RECOMMENDATION, DEBUG) << "Normalizing data...";
+	SOM::DataNormalizer dataNormalizer {nbDimensions};
+
+	dataNormalizer.computeNormalizationFactors(res.vectors);
+	for (auto& vector : res.vectors)
+		dataNormalizer.normalizeData(vector);
+
+	res.weights = getInputVectorWeights(featureSettingsMap, nbDimensions);
+
+	return res;
+}
+
+bool
+FeaturesEngine::loadFromTraining(Database::Session& session, const TrainSettings& trainSettings, const ProgressCallback& progressCallback)
+{
+	LMS_LOG(RECOMMENDATION, INFO) << "Constructing features classifier...";
+
+	std::optional<TrackFeatureVectors> trackFeatureVectors {extractTrackFeatureVectors(session, trainSettings.featureSettingsMap, [this] { return _loadCancelled; })};
+	if (!trackFeatureVectors)
+		return false;
+
+	if (trackFeatureVectors->vectors.empty())
 	{
 		LMS_LOG(RECOMMENDATION, INFO) << "Nothing to classify!";
 		return false;
 	}
 
-	LMS_LOG(RECOMMENDATION, DEBUG) << "Normalizing data...";
-	SOM::DataNormalizer dataNormalizer {nbDimensions};
-
-	dataNormalizer.computeNormalizationFactors(samples);
-	for (auto& sample : samples)
-		dataNormalizer.normalizeData(sample);
+	const std::vector<SOM::InputVector>& samples {trackFeatureVectors->vectors};
+	const std::vector<Database::TrackId>& samplesTrackIds {trackFeatureVectors->trackIds};
+	const std::size_t nbDimensions {trackFeatureVectors->weights.getNbDimensions()};
 
 	SOM::Coordinate size {static_cast<SOM::Coordinate>(std::sqrt(samples.size() / trainSettings.sampleCountPerNeuron))};
 	if (size < 2)
@@ -204,8 +221,7 @@ FeaturesEngine::loadFromTraining(Database::Session& session, const TrainSettings
 
 	SOM::Network network {size, size, nbDimensions};
 
-	SOM::InputVector weights {getInputVectorWeights(trainSettings.featureSettingsMap, nbDimensions)};
-	network.setDataWeights(weights);
+	network.setDataWeights(trackFeatureVectors->weights);
 
 	auto somProgressCallback{[&](const SOM::Network::CurrentIteration& iter)
 	{
@@ -236,7 +252,7 @@ FeaturesEngine::loadFromTraining(Database::Session& session, const TrainSettings
 
 	LMS_LOG(RECOMMENDATION, DEBUG) << "Classifying tracks DONE";
 
-	return load(session, std::move(network), std::move(trackPositions));
+	return load(session, std::move(network), std::move(trackPositions), std::nullopt);
 }
 
 bool
@@ -244,7 +260,14 @@ FeaturesEngine::loadFromCache(Database::Session& session, const FeaturesEngineCa
 {
 	LMS_LOG(RECOMMENDATION, INFO) << "Constructing features classifier from cache...";
 
-	return load(session, std::move(cache._network), cache._trackPositions);
+	std::optional<Neighbours> neighbours {cache._neighbours};
+	if (neighbours && neighbours->maxNeighbourCount != maxNeighbourCount)
+	{
+		LMS_LOG(RECOMMENDATION, INFO) << "Cached neighbours use a different count, computing them again";
+		neighbours.reset();
+	}
+
+	return load(session, std::move(cache._network), cache._trackPositions, std::move(neighbours));
 }
 
 IClassifier::ResultContainer<Database::TrackId>
@@ -269,7 +292,7 @@ FeaturesEngine::getSimilarTracksFromTrackList(Database::Session& session, Databa
 std::vector<Database::TrackId>
 FeaturesEngine::getSimilarTracks(Database::Session& session, const std::vector<Database::TrackId>& tracksIds, std::size_t maxCount) const
 {
-	auto similarTrackIds {getSimilarObjects(tracksIds, _trackMatrix, _trackPositions, maxCount)};
+	auto similarTrackIds {getSimilarObjects(tracksIds, _trackMatrix, _trackPositions, _neighbours.tracks, maxCount)};
 
 	{
 		// Report only existing ids, as tracks may have been removed a long time ago (refreshing the SOM takes some time)
@@ -288,7 +311,7 @@ FeaturesEngine::getSimilarTracks(Database::Session& session, const std::vector<D
 std::vector<Database::ReleaseId>
 FeaturesEngine::getSimilarReleases(Database::Session& session, Database::ReleaseId releaseId, std::size_t maxCount) const
 {
-	auto similarReleaseIds {getSimilarObjects<Database::ReleaseId>({releaseId}, _releaseMatrix, _releasePositions, maxCount)};
+	auto similarReleaseIds {getSimilarObjects<Database::ReleaseId>({releaseId}, _releaseMatrix, _releasePositions, _neighbours.releases, maxCount)};
 
 	{
 		// Report only existing ids
@@ -320,7 +343,11 @@ FeaturesEngine::getSimilarArtists(Database::Session& session,
 			return similarArtistIds;
 		}
 
-		return getSimilarObjects({artistId}, itArtists->second, _artistPositions, maxCount);
+		const auto itNeighbours {_neighbours.artists.find(linkType)};
+		if (itNeighbours == std::cend(_neighbours.artists))
+			return getSimilarObjects<Database::ArtistId>({artistId}, itArtists->second, _artistPositions, maxCount);
+
+		return getSimilarObjects<Database::ArtistId>({artistId}, itArtists->second, _artistPositions, itNeighbours->second, maxCount);
 	}};
 
 	std::unordered_set<Database::ArtistId> similarArtistIds;
@@ -353,7 +380,7 @@ FeaturesEngine::getSimilarArtists(Database::Session& session,
 FeaturesEngineCache
 FeaturesEngine::toCache() const
 {
-	return FeaturesEngineCache {*_network, _trackPositions};
+	return FeaturesEngineCache {*_network, _trackPositions, _neighbours};
 }
 
 bool
@@ -368,7 +395,16 @@ FeaturesEngine::load(Database::Session& session, bool forceReload, const Progres
 	{
 		const std::optional<FeaturesEngineCache> cache {FeaturesEngineCache::read()};
 		if (cache)
-			return loadFromCache(session, *cache);
+		{
+			if (!loadFromCache(session, *cache))
+				return false;
+
+			// Older caches do not contain the neighbours, or not enough of them
+			if (!cache->_neighbours || cache->_neighbours->maxNeighbourCount != maxNeighbourCount)
+				toCache().write();
+
+			return true;
+		}
 	}
 
 	TrainSettings trainSettings;
@@ -391,7 +427,8 @@ FeaturesEngine::requestCancelLoad()
 bool
 FeaturesEngine::load(Database::Session& session,
 			SOM::Network network,
-			const TrackPositions& trackPositions)
+			const TrackPositions& trackPositions,
+			std::optional<Neighbours> neighbours)
 {
 	using namespace Database;
 
@@ -447,9 +484,54 @@ FeaturesEngine::load(Database::Session& session,
 
 	_network = std::make_unique<SOM::Network>(std::move(network));
 
+	if (neighbours)
+		_neighbours = std::move(*neighbours);
+	else if (!computeNeighbours())
+		return false;
+
 	LMS_LOG(RECOMMENDATION, INFO) << "Classifier successfully loaded!";
 
 	return true;
 }
 
+bool
+FeaturesEngine::computeNeighbours()
+{
+	LMS_LOG(RECOMMENDATION, DEBUG) << "Computing neighbours...";
+
+	Neighbours neighbours;
+	neighbours.maxNeighbourCount = maxNeighbourCount;
+
+	{
+		auto trackNeighbours {computeObjectNeighbours(_trackMatrix, _trackPositions)};
+		if (!trackNeighbours)
+			return false;
+
+		neighbours.tracks = std::move(*trackNeighbours);
+	}
+
+	{
+		auto releaseNeighbours {computeObjectNeighbours(_releaseMatrix, _releasePositions)};
+		if (!releaseNeighbours)
+			return false;
+
+		neighbours.releases = std::move(*releaseNeighbours);
+	}
+
+	for (const auto& [linkType, artistMatrix] : _artistMatrix)
+	{
+		auto artistNeighbours {computeObjectNeighbours(artistMatrix, _artistPositions)};
+		if (!artistNeighbours)
+			return false;
+
+		neighbours.artists.emplace(linkType, std::move(*artistNeighbours));
+	}
+
+	_neighbours = std::move(neighbours);
+
+	LMS_LOG(RECOMMENDATION, DEBUG) << "Computing neighbours DONE";
+
+	return true;
+}
+
 } // ns Recommendation
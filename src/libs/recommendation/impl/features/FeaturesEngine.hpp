@@ -24,6 +24,7 @@
 #include <unordered_map>
 #include <optional>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 #include "som/DataNormalizer.hpp"
@@ -58,6 +59,25 @@ class FeaturesEngine : public IClassifier
 
 		static const FeatureSettingsMap& getDefaultTrainFeatureSettings();
 
+		// Normalized feature vectors of all the tracks that have features
+		struct TrackFeatureVectors
+		{
+			std::vector<Database::TrackId>	trackIds;
+			std::vector<SOM::InputVector>	vectors;
+			SOM::InputVector				weights {0};	// to be used when computing distances
+		};
+		using CancelCallback = std::function<bool()>;
+		static std::optional<TrackFeatureVectors> extractTrackFeatureVectors(Database::Session& session, const FeatureSettingsMap& featureSettingsMap, const CancelCallback& cancelCallback);
+
+		// Use training (may be very slow), the cache is neither read nor written
+		struct TrainSettings
+		{
+			std::size_t iterationCount {10};
+			float sampleCountPerNeuron {4};
+			FeatureSettingsMap featureSettingsMap;
+		};
+		bool loadFromTraining(Database::Session& session, const TrainSettings& trainSettings, const ProgressCallback& progressCallback);
+
 	private:
 
 		std::string_view getName() const override { return "Features"; }
@@ -75,15 +95,6 @@ class FeaturesEngine : public IClassifier
 
 		bool loadFromCache(Database::Session& session, const FeaturesEngineCache& cache);
 
-		// Use training (may be very slow)
-		struct TrainSettings
-		{
-			std::size_t iterationCount {10};
-			float sampleCountPerNeuron {4};
-			FeatureSettingsMap featureSettingsMap;
-		};
-		bool loadFromTraining(Database::Session& session, const TrainSettings& trainSettings, const ProgressCallback& progressCallback);
-
 		template <typename IdType>
 		using ObjectPositions = std::unordered_map<IdType, std::vector<SOM::Position>>;
 
@@ -97,7 +108,16 @@ class FeaturesEngine : public IClassifier
 		using ReleaseMatrix = ObjectMatrix<Database::ReleaseId>;
 		using TrackMatrix = ObjectMatrix<Database::TrackId>;
 
-		bool load(Database::Session& session, SOM::Network network, const TrackPositions& tracksPosition);
+		using Neighbours = FeaturesEngineCache::Neighbours;
+		template <typename IdType>
+		using ObjectNeighbours = FeaturesEngineCache::ObjectNeighbours<IdType>;
+
+		// Max number of precomputed neighbours per object, bigger requests are computed on the fly
+		// Must cover the default count of the Subsonic getSimilarSongs requests (50)
+		static constexpr std::size_t maxNeighbourCount {64};
+
+		bool load(Database::Session& session, SOM::Network network, const TrackPositions& tracksPosition, std::optional<Neighbours> neighbours);
+		bool computeNeighbours();
 
 		FeaturesEngineCache toCache() const;
 
@@ -105,12 +125,19 @@ class FeaturesEngine : public IClassifier
 		static std::vector<SOM::Position> getMatchingRefVectorsPosition(const std::vector<IdType>& ids, const ObjectPositions<IdType>& objectPositions);
 
 		template <typename IdType>
-		static std::vector<IdType> getObjectsIds(const std::vector<SOM::Position>& positions, const ObjectMatrix<IdType>& objectsMatrix);
+		std::vector<IdType> getSimilarObjects(const std::vector<IdType>& ids,
+				const ObjectMatrix<IdType>& objectMatrix,
+				const ObjectPositions<IdType>& objectPositions,
+				std::size_t maxCount) const;
+
+		template <typename IdType>
+		std::optional<ObjectNeighbours<IdType>> computeObjectNeighbours(const ObjectMatrix<IdType>& objectMatrix, const ObjectPositions<IdType>& objectPositions) const;
 
 		template <typename IdType>
 		std::vector<IdType> getSimilarObjects(const std::vector<IdType>& ids,
 				const ObjectMatrix<IdType>& objectMatrix,
 				const ObjectPositions<IdType>& objectPositions,
+				const ObjectNeighbours<IdType>& objectNeighbours,
 				std::size_t maxCount) const;
 
 		bool				_loadCancelled {};
@@ -126,6 +153,8 @@ class FeaturesEngine : public IClassifier
 		TrackPositions		_trackPositions;
 		TrackMatrix			_trackMatrix;
 
+		Neighbours			_neighbours;
+
 		static inline FeaturesFetchFunc _featuresFetchFunc;
 };
 
@@ -134,9 +163,7 @@ std::vector<SOM::Position>
 FeaturesEngine::getMatchingRefVectorsPosition(const std::vector<IdType>& ids, const ObjectPositions<IdType>& objectPositions)
 {
 	std::vector<SOM::Position> res;
-
-	if (ids.empty())
-		return res;
+	std::unordered_set<SOM::Position> addedPositions;
 
 	for (const IdType id : ids)
 	{
@@ -145,7 +172,10 @@ FeaturesEngine::getMatchingRefVectorsPosition(const std::vector<IdType>& ids, co
 			continue;
 
 		for (const SOM::Position& position : it->second)
-			Utils::push_back_if_not_present(res, position);
+		{
+			if (addedPositions.insert(position).second)
+				res.push_back(position);
+		}
 	}
 
 	return res;
@@ -153,14 +183,66 @@ FeaturesEngine::getMatchingRefVectorsPosition(const std::vector<IdType>& ids, co
 
 template <typename IdType>
 std::vector<IdType>
-FeaturesEngine::getObjectsIds(const std::vector<SOM::Position>& positions, const ObjectMatrix<IdType>& objectMatrix)
+FeaturesEngine::getSimilarObjects(const std::vector<IdType>& ids,
+		const ObjectMatrix<IdType>& objectMatrix,
+		const ObjectPositions<IdType>& objectPositions,
+		std::size_t maxCount) const
 {
 	std::vector<IdType> res;
 
-	for (const SOM::Position& position : positions)
+	std::vector<SOM::Position> searchedRefVectorsPosition {getMatchingRefVectorsPosition(ids, objectPositions)};
+	if (searchedRefVectorsPosition.empty())
+		return res;
+
+	// Objects that are already in input or already reported
+	std::unordered_set<IdType> excludedIds (std::cbegin(ids), std::cend(ids));
+
+	auto addObjects {[&](const SOM::Position& position)
 	{
 		for (const IdType id : objectMatrix.get(position))
-			Utils::push_back_if_not_present(res, id);
+		{
+			if (res.size() == maxCount)
+				break;
+
+			if (excludedIds.insert(id).second)
+				res.push_back(id);
+		}
+	}};
+
+	for (const SOM::Position& position : searchedRefVectorsPosition)
+		addObjects(position);
+
+	// If there is not enough objects, try again with closest neighbour until there is too much distance
+	while (res.size() < maxCount)
+	{
+		const std::optional<SOM::Position> closestRefVectorPosition {_network->getClosestRefVectorPosition(searchedRefVectorsPosition, _networkRefVectorsDistanceMedian * 0.75)};
+		if (!closestRefVectorPosition)
+			break;
+
+		// closest position is never part of the searched positions
+		searchedRefVectorsPosition.push_back(*closestRefVectorPosition);
+		addObjects(*closestRefVectorPosition);
+	}
+
+	return res;
+}
+
+template <typename IdType>
+std::optional<FeaturesEngine::ObjectNeighbours<IdType>>
+FeaturesEngine::computeObjectNeighbours(const ObjectMatrix<IdType>& objectMatrix, const ObjectPositions<IdType>& objectPositions) const
+{
+	ObjectNeighbours<IdType> res;
+	res.reserve(objectPositions.size());
+
+	for (const auto& [id, positions] : objectPositions)
+	{
+		if (_loadCancelled)
+			return std::nullopt;
+
+		// Objects without neighbours are kept, so that a missing entry means "not precomputed"
+		std::vector<IdType> neighbourIds {getSimilarObjects<IdType>({id}, objectMatrix, objectPositions, maxNeighbourCount)};
+		neighbourIds.shrink_to_fit();
+		res.emplace(id, std::move(neighbourIds));
 	}
 
 	return res;
@@ -171,43 +253,49 @@ std::vector<IdType>
 FeaturesEngine::getSimilarObjects(const std::vector<IdType>& ids,
 		const ObjectMatrix<IdType>& objectMatrix,
 		const ObjectPositions<IdType>& objectPositions,
+		const ObjectNeighbours<IdType>& objectNeighbours,
 		std::size_t maxCount) const
 {
-	std::vector<IdType> res;
-
-	std::vector<SOM::Position> searchedRefVectorsPosition {getMatchingRefVectorsPosition(ids, objectPositions)};
-	if (searchedRefVectorsPosition.empty())
-		return res;
+	if (maxCount > maxNeighbourCount)
+		return getSimilarObjects(ids, objectMatrix, objectPositions, maxCount);
 
-	while (1)
+	std::vector<const std::vector<IdType>*> neighbourIdsList;
+	for (const IdType id : ids)
 	{
-		std::vector<IdType> closestObjectIds {getObjectsIds(searchedRefVectorsPosition, objectMatrix)};
+		if (objectPositions.find(id) == std::cend(objectPositions))
+			continue;
 
-		// Remove objects that are already in input or already reported
-		closestObjectIds.erase(std::remove_if(std::begin(closestObjectIds), std::end(closestObjectIds),
-					[&](IdType id)
-					{
-						return std::find(std::cbegin(ids), std::cend(ids), id) != std::cend(ids);
-					})
-				, std::end(closestObjectIds));
+		// Neighbours may have been computed for another set of objects (cache loaded after a scan)
+		auto it {objectNeighbours.find(id)};
+		if (it == std::cend(objectNeighbours))
+			return getSimilarObjects(ids, objectMatrix, objectPositions, maxCount);
 
-		for (IdType id : closestObjectIds)
-		{
-			if (res.size() == maxCount)
-				break;
+		neighbourIdsList.push_back(&it->second);
+	}
 
-			Utils::push_back_if_not_present(res, id);
-		}
+	std::vector<IdType> res;
+	std::unordered_set<IdType> excludedIds (std::cbegin(ids), std::cend(ids));
 
-		if (res.size() == maxCount)
-			break;
+	// Take the closest neighbours of each input object first
+	for (std::size_t rank {}; rank < maxNeighbourCount && res.size() < maxCount; ++rank)
+	{
+		bool remainingNeighbours {};
+		for (const std::vector<IdType>* neighbourIds : neighbourIdsList)
+		{
+			if (rank >= neighbourIds->size())
+				continue;
+
+			remainingNeighbours = true;
+			if (excludedIds.insert((*neighbourIds)[rank]).second)
+			{
+				res.push_back((*neighbourIds)[rank]);
+				if (res.size() == maxCount)
+					break;
+			}
+		}
 
-		// If there is not enough objects, try again with closest neighbour until there is too much distance
-		const std::optional<SOM::Position> closestRefVectorPosition {_network->getClosestRefVectorPosition(searchedRefVectorsPosition, _networkRefVectorsDistanceMedian * 0.75)};
-		if (!closestRefVectorPosition)
+		if (!remainingNeighbours)
 			break;
-
-		Utils::push_back_if_not_present(searchedRefVectorsPosition, closestRefVectorPosition.value());
 	}
 
 	return res;
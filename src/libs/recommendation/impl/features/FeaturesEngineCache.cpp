@@ -19,6 +19,11 @@
 
 #include "FeaturesEngineCache.hpp"
 
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <string_view>
+
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/xml_parser.hpp>
 
@@ -45,6 +50,21 @@ static std::filesystem::path getCacheTrackPositionsFilePath()
 	return getCacheDirectory() / "track_positions";
 }
 
+static std::filesystem::path getCacheTrackNeighboursFilePath()
+{
+	return getCacheDirectory() / "track_neighbours";
+}
+
+static std::filesystem::path getCacheReleaseNeighboursFilePath()
+{
+	return getCacheDirectory() / "release_neighbours";
+}
+
+static std::filesystem::path getCacheArtistNeighboursFilePath()
+{
+	return getCacheDirectory() / "artist_neighbours";
+}
+
 static
 bool
 networkToCacheFile(const SOM::Network& network, std::filesystem::path path)
@@ -213,11 +233,186 @@ FeaturesEngineCache::createObjectPositionsFromCacheFile(const std::filesystem::p
 	}
 }
 
+// Neighbour files are quite big, so they use a compact line based format:
+// <id> <neighbour id> <neighbour id> ...
+template <typename IdType>
+static
+void
+writeObjectNeighbours(std::ostream& os, IdType id, const std::vector<IdType>& neighbourIds)
+{
+	os << id.getValue();
+	for (const IdType neighbourId : neighbourIds)
+		os << ' ' << neighbourId.getValue();
+	os << '\n';
+}
+
+template <typename IdType>
+static
+bool
+readObjectNeighbours(std::istream& is, FeaturesEngineCache::ObjectNeighbours<IdType>& neighbours)
+{
+	Database::IdType::ValueType id;
+	if (!(is >> id))
+		return false;
+
+	std::vector<IdType>& neighbourIds {neighbours[IdType {id}]};
+
+	Database::IdType::ValueType neighbourId;
+	while (is >> neighbourId)
+		neighbourIds.emplace_back(neighbourId);
+
+	return true;
+}
+
+// Each neighbour file starts with a header line: k <max neighbour count>
+static constexpr std::string_view neighbourCountTag {"k"};
+
+static
+bool
+readLines(const std::filesystem::path& path, std::size_t& maxNeighbourCount, std::function<bool(std::istream&)> lineParser)
+{
+	std::ifstream ifs {path};
+	if (!ifs)
+		return false;
+
+	std::string line;
+	if (!std::getline(ifs, line))
+		return false;
+
+	{
+		// Files written by older versions have no header
+		std::istringstream iss {line};
+		std::string tag;
+		if (!(iss >> tag >> maxNeighbourCount) || tag != neighbourCountTag)
+			return false;
+	}
+
+	while (std::getline(ifs, line))
+	{
+		std::istringstream iss {line};
+		if (!lineParser(iss))
+			return false;
+	}
+
+	return !ifs.bad();
+}
+
+// Written in a temporary file first, so that a crash does not leave a truncated file
+static
+bool
+writeLines(const std::filesystem::path& path, std::size_t maxNeighbourCount, std::function<void(std::ostream&)> linesWriter)
+{
+	std::filesystem::path tmpPath {path};
+	tmpPath += ".tmp";
+
+	{
+		std::ofstream ofs {tmpPath, std::ios::trunc};
+		ofs << neighbourCountTag << ' ' << maxNeighbourCount << '\n';
+		linesWriter(ofs);
+		ofs.flush();
+
+		if (!ofs)
+		{
+			std::error_code ec;
+			std::filesystem::remove(tmpPath, ec);
+			return false;
+		}
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(tmpPath, path, ec);
+	if (ec)
+	{
+		LMS_LOG(RECOMMENDATION, ERROR) << "Cannot rename cache file '" << tmpPath.string() << "': " << ec.message();
+		std::filesystem::remove(tmpPath, ec);
+		return false;
+	}
+
+	return true;
+}
+
+bool
+FeaturesEngineCache::neighboursToCacheFiles(const Neighbours& neighbours)
+{
+	const bool success {writeLines(getCacheTrackNeighboursFilePath(), neighbours.maxNeighbourCount, [&](std::ostream& os)
+		{
+			for (const auto& [trackId, neighbourIds] : neighbours.tracks)
+				writeObjectNeighbours(os, trackId, neighbourIds);
+		})
+		&& writeLines(getCacheReleaseNeighboursFilePath(), neighbours.maxNeighbourCount, [&](std::ostream& os)
+		{
+			for (const auto& [releaseId, neighbourIds] : neighbours.releases)
+				writeObjectNeighbours(os, releaseId, neighbourIds);
+		})
+		&& writeLines(getCacheArtistNeighboursFilePath(), neighbours.maxNeighbourCount, [&](std::ostream& os)
+		{
+			for (const auto& [linkType, artistNeighbours] : neighbours.artists)
+			{
+				for (const auto& [artistId, neighbourIds] : artistNeighbours)
+				{
+					os << static_cast<int>(linkType) << ' ';
+					writeObjectNeighbours(os, artistId, neighbourIds);
+				}
+			}
+		})};
+
+	if (!success)
+	{
+		LMS_LOG(RECOMMENDATION, ERROR) << "Cannot cache neighbours";
+		return false;
+	}
+
+	LMS_LOG(RECOMMENDATION, DEBUG) << "Created neighbours cache";
+	return true;
+}
+
+std::optional<FeaturesEngineCache::Neighbours>
+FeaturesEngineCache::createNeighboursFromCacheFiles()
+{
+	if (!std::filesystem::exists(getCacheTrackNeighboursFilePath())
+			|| !std::filesystem::exists(getCacheReleaseNeighboursFilePath())
+			|| !std::filesystem::exists(getCacheArtistNeighboursFilePath()))
+	{
+		return std::nullopt;
+	}
+
+	LMS_LOG(RECOMMENDATION, INFO) << "Reading neighbours from cache...";
+
+	Neighbours res;
+	std::size_t releaseMaxNeighbourCount {};
+	std::size_t artistMaxNeighbourCount {};
+	const bool success {readLines(getCacheTrackNeighboursFilePath(), res.maxNeighbourCount, [&](std::istream& is) { return readObjectNeighbours(is, res.tracks); })
+		&& readLines(getCacheReleaseNeighboursFilePath(), releaseMaxNeighbourCount, [&](std::istream& is) { return readObjectNeighbours(is, res.releases); })
+		&& readLines(getCacheArtistNeighboursFilePath(), artistMaxNeighbourCount, [&](std::istream& is)
+			{
+				int linkType;
+				if (!(is >> linkType))
+					return false;
+
+				return readObjectNeighbours(is, res.artists[static_cast<Database::TrackArtistLinkType>(linkType)]);
+			})};
+
+	if (!success
+		|| releaseMaxNeighbourCount != res.maxNeighbourCount
+		|| artistMaxNeighbourCount != res.maxNeighbourCount)
+	{
+		LMS_LOG(RECOMMENDATION, ERROR) << "Cannot read neighbours from cache";
+		return std::nullopt;
+	}
+
+	LMS_LOG(RECOMMENDATION, INFO) << "Successfully read neighbours from cache";
+
+	return res;
+}
+
 void
 FeaturesEngineCache::invalidate()
 {
 	std::filesystem::remove(getCacheNetworkFilePath());
 	std::filesystem::remove(getCacheTrackPositionsFilePath());
+	std::filesystem::remove(getCacheTrackNeighboursFilePath());
+	std::filesystem::remove(getCacheReleaseNeighboursFilePath());
+	std::filesystem::remove(getCacheArtistNeighboursFilePath());
 }
 
 std::optional<FeaturesEngineCache>
@@ -231,7 +426,8 @@ FeaturesEngineCache::read()
 	if (!trackPositions)
 		return std::nullopt;
 
-	return FeaturesEngineCache {std::move(*network), std::move(*trackPositions)};
+	// Neighbours may be missing if the cache was created by an older version, they will be computed again
+	return FeaturesEngineCache {std::move(*network), std::move(*trackPositions), createNeighboursFromCacheFiles()};
 }
 
 void
@@ -240,15 +436,17 @@ FeaturesEngineCache::write() const
 	std::filesystem::create_directories(Service<IConfig>::get()->getPath("working-dir") / "cache" / "features");
 
 	if (!networkToCacheFile(_network, getCacheNetworkFilePath())
-		|| !objectPositionToCacheFile(_trackPositions, getCacheTrackPositionsFilePath()))
+		|| !objectPositionToCacheFile(_trackPositions, getCacheTrackPositionsFilePath())
+		|| (_neighbours && !neighboursToCacheFiles(*_neighbours)))
 	{
 		invalidate();
 	}
 }
 
-FeaturesEngineCache::FeaturesEngineCache(SOM::Network network, TrackPositions trackPositions)
+FeaturesEngineCache::FeaturesEngineCache(SOM::Network network, TrackPositions trackPositions, std::optional<Neighbours> neighbours)
 : _network {std::move(network)},
-_trackPositions {std::move(trackPositions)}
+_trackPositions {std::move(trackPositions)},
+_neighbours {std::move(neighbours)}
 {
 }
 
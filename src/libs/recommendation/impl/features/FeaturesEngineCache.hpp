@@ -20,8 +20,10 @@
 #pragma once
 
 #include <filesystem>
+#include <optional>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "database/Types.hpp"
 #include "som/Network.hpp"
@@ -36,19 +38,37 @@ class FeaturesEngineCache
 		static std::optional<FeaturesEngineCache> read();
 		void write() const;
 
+		// Precomputed closest objects, ordered by similarity
+		template <typename IdType>
+		using ObjectNeighbours = std::unordered_map<IdType, std::vector<IdType>>;
+		using TrackNeighbours = ObjectNeighbours<Database::TrackId>;
+		using ReleaseNeighbours = ObjectNeighbours<Database::ReleaseId>;
+		using ArtistNeighbours = std::unordered_map<Database::TrackArtistLinkType, ObjectNeighbours<Database::ArtistId>>;
+
+		struct Neighbours
+		{
+			std::size_t			maxNeighbourCount {};	// max size of each list
+			TrackNeighbours		tracks;
+			ReleaseNeighbours	releases;
+			ArtistNeighbours	artists;
+		};
+
 	private:
 		using TrackPositions = std::unordered_map<Database::TrackId, std::vector<SOM::Position>>;
 
-		FeaturesEngineCache(SOM::Network network, TrackPositions trackPositions);
+		FeaturesEngineCache(SOM::Network network, TrackPositions trackPositions, std::optional<Neighbours> neighbours);
 
 		static std::optional<SOM::Network> createNetworkFromCacheFile(const std::filesystem::path& path);
 		static std::optional<TrackPositions> createObjectPositionsFromCacheFile(const std::filesystem::path& path);
 		static bool objectPositionToCacheFile(const TrackPositions& trackPositions, const std::filesystem::path& path);
+		static std::optional<Neighbours> createNeighboursFromCacheFiles();
+		static bool neighboursToCacheFiles(const Neighbours& neighbours);
 
 		friend class FeaturesEngine;
 
-		SOM::Network		_network;
-		TrackPositions		_trackPositions;
+		SOM::Network				_network;
+		TrackPositions				_trackPositions;
+		std::optional<Neighbours>	_neighbours; // not set if using an older cache
 };
 
 } // namespace Recommendation
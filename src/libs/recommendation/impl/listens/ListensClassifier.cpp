@@ -0,0 +1,362 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "ListensClassifier.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <string_view>
+#include <tuple>
+#include <unordered_set>
+
+#include "database/Session.hpp"
+#include "database/Track.hpp"
+#include "database/TrackArtistLink.hpp"
+#include "database/TrackList.hpp"
+#include "utils/Logger.hpp"
+
+namespace Recommendation {
+
+// Listen histories of the scrobblers (see the scrobbling lib), other internal tracklists are play queues
+static const std::vector<std::string_view> listenHistoryTrackListNames {"__scrobbler_internal_history__", "__scrobbler_listenbrainz_history__"};
+// Listens of the same track closer than this are duplicates (same listen reported by several scrobblers)
+static constexpr std::chrono::seconds duplicateListenMaxInterval {120};
+// Listens that are further apart than this are not considered as related
+static constexpr std::size_t listenWindowSize {5};
+// Max number of neighbours kept for each object
+static constexpr std::size_t maxNeighbourCount {50};
+
+std::unique_ptr<IClassifier> createListensClassifier()
+{
+	return std::make_unique<ListensClassifier>();
+}
+
+template <typename IdType>
+static
+void
+addToSequence(std::vector<IdType>& sequence, IdType id)
+{
+	// Consecutive listens of the same object (e.g. whole release) do not tell anything
+	if (sequence.empty() || sequence.back() != id)
+		sequence.push_back(id);
+}
+
+template <typename IdType>
+std::optional<ListensClassifier::ObjectNeighbours<IdType>>
+ListensClassifier::computeNeighbours(const ListenSequences<IdType>& listenSequences) const
+{
+	std::unordered_map<IdType, Score> occurrences;
+	std::unordered_map<IdType, std::unordered_map<IdType, Score>> coOccurrences;
+
+	for (const std::vector<IdType>& sequence : listenSequences)
+	{
+		if (_loadCancelled)
+			return std::nullopt;
+
+		for (std::size_t i {}; i < sequence.size(); ++i)
+		{
+			occurrences[sequence[i]] += 1;
+
+			for (std::size_t j {i + 1}; j < std::min(sequence.size(), i + 1 + listenWindowSize); ++j)
+			{
+				if (sequence[i] == sequence[j])
+					continue;
+
+				// The closer the listens, the more related
+				const Score weight {Score {1} / static_cast<Score>(j - i)};
+				coOccurrences[sequence[i]][sequence[j]] += weight;
+				coOccurrences[sequence[j]][sequence[i]] += weight;
+			}
+		}
+	}
+
+	ObjectNeighbours<IdType> res;
+	res.reserve(coOccurrences.size());
+
+	for (const auto& [id, coOccurrencesById] : coOccurrences)
+	{
+		if (_loadCancelled)
+			return std::nullopt;
+
+		const Score idOccurrences {occurrences[id]};
+
+		std::vector<ScoredId<IdType>> neighbours;
+		neighbours.reserve(coOccurrencesById.size());
+		for (const auto& [neighbourId, coOccurrence] : coOccurrencesById)
+		{
+			// Normalize so that very often listened objects do not show up everywhere
+			neighbours.push_back({neighbourId, coOccurrence / std::sqrt(idOccurrences * occurrences[neighbourId])});
+		}
+
+		const std::size_t neighbourCount {std::min(neighbours.size(), maxNeighbourCount)};
+		std::partial_sort(std::begin(neighbours), std::next(std::begin(neighbours), neighbourCount), std::end(neighbours),
+				[](const ScoredId<IdType>& a, const ScoredId<IdType>& b) { return a.score > b.score; });
+		neighbours.resize(neighbourCount);
+		neighbours.shrink_to_fit();
+
+		res.emplace(id, std::move(neighbours));
+	}
+
+	return res;
+}
+
+template <typename IdType>
+std::vector<IdType>
+ListensClassifier::getSimilarObjects(const std::vector<IdType>& ids, const ObjectNeighbours<IdType>& objectNeighbours, std::size_t maxCount)
+{
+	std::vector<ScoredId<IdType>> scoredIds;
+	std::unordered_map<IdType, std::size_t> scoredIdIndexes;
+
+	for (const IdType id : ids)
+	{
+		const auto itNeighbours {objectNeighbours.find(id)};
+		if (itNeighbours == std::cend(objectNeighbours))
+			continue;
+
+		for (const ScoredId<IdType>& neighbour : itNeighbours->second)
+		{
+			auto [itIndex, inserted] {scoredIdIndexes.try_emplace(neighbour.id, scoredIds.size())};
+			if (inserted)
+				scoredIds.push_back(neighbour);
+			else
+				scoredIds[itIndex->second].score += neighbour.score;
+		}
+	}
+
+	// Do not report the input objects
+	const std::unordered_set<IdType> excludedIds (std::cbegin(ids), std::cend(ids));
+	scoredIds.erase(std::remove_if(std::begin(scoredIds), std::end(scoredIds),
+				[&](const ScoredId<IdType>& scoredId)
+				{
+					return excludedIds.find(scoredId.id) != std::cend(excludedIds);
+				}), std::end(scoredIds));
+
+	const std::size_t count {std::min(scoredIds.size(), maxCount)};
+	std::partial_sort(std::begin(scoredIds), std::next(std::begin(scoredIds), count), std::end(scoredIds),
+			[](const ScoredId<IdType>& a, const ScoredId<IdType>& b) { return a.score > b.score; });
+
+	std::vector<IdType> res;
+	res.reserve(count);
+	std::transform(std::cbegin(scoredIds), std::next(std::cbegin(scoredIds), count), std::back_inserter(res),
+			[](const ScoredId<IdType>& scoredId) { return scoredId.id; });
+
+	return res;
+}
+
+bool
+ListensClassifier::load(Database::Session& session, bool, const ProgressCallback& progressCallback)
+{
+	using namespace Database;
+
+	LMS_LOG(RECOMMENDATION, INFO) << "Constructing listens classifier...";
+
+	std::vector<std::tuple<UserId, TrackId, Wt::WDateTime>> listens;
+	std::vector<std::pair<TrackId, ReleaseId>> trackReleaseIds;
+	std::vector<std::tuple<TrackId, ArtistId, TrackArtistLinkType>> trackArtistIds;
+	{
+		auto transaction {session.createSharedTransaction()};
+
+		LMS_LOG(RECOMMENDATION, DEBUG) << "Getting listens...";
+		listens = TrackList::getAllTrackIdsByUser(session, TrackList::Type::Internal, listenHistoryTrackListNames);
+		trackReleaseIds = Track::getAllReleaseIds(session);
+		trackArtistIds = TrackArtistLink::getAllIds(session);
+		LMS_LOG(RECOMMENDATION, DEBUG) << "Getting listens DONE (found " << listens.size() << " entries)";
+	}
+
+	if (listens.empty())
+	{
+		LMS_LOG(RECOMMENDATION, INFO) << "No listen to classify!";
+		return false;
+	}
+
+	// One sequence per user, merging the histories of the scrobblers
+	ListenSequences<TrackId> trackSequences;
+	{
+		std::optional<UserId> currentUserId;
+		std::unordered_map<TrackId, Wt::WDateTime> lastListenDateTimes;
+		for (const auto& [userId, trackId, dateTime] : listens)
+		{
+			if (userId != currentUserId)
+			{
+				trackSequences.emplace_back();
+				lastListenDateTimes.clear();
+				currentUserId = userId;
+			}
+
+			auto [itLastListen, inserted] {lastListenDateTimes.try_emplace(trackId, dateTime)};
+			if (!inserted)
+			{
+				if (std::chrono::duration_cast<std::chrono::seconds>(dateTime.toTimePoint() - itLastListen->second.toTimePoint()) < duplicateListenMaxInterval)
+					continue;
+
+				itLastListen->second = dateTime;
+			}
+
+			addToSequence(trackSequences.back(), trackId);
+		}
+	}
+
+	ListenSequences<ReleaseId> releaseSequences;
+	{
+		const std::unordered_map<TrackId, ReleaseId> releaseIdByTrackId (std::cbegin(trackReleaseIds), std::cend(trackReleaseIds));
+
+		for (const std::vector<TrackId>& trackSequence : trackSequences)
+		{
+			std::vector<ReleaseId>& releaseSequence {releaseSequences.emplace_back()};
+			for (const TrackId trackId : trackSequence)
+			{
+				const auto itReleaseId {releaseIdByTrackId.find(trackId)};
+				if (itReleaseId != std::cend(releaseIdByTrackId))
+					addToSequence(releaseSequence, itReleaseId->second);
+			}
+		}
+	}
+
+	std::unordered_map<TrackArtistLinkType, ListenSequences<ArtistId>> artistSequences;
+	{
+		std::unordered_map<TrackId, std::vector<std::pair<ArtistId, TrackArtistLinkType>>> artistIdsByTrackId;
+		for (const auto& [trackId, artistId, linkType] : trackArtistIds)
+			artistIdsByTrackId[trackId].emplace_back(artistId, linkType);
+
+		for (const std::vector<TrackId>& trackSequence : trackSequences)
+		{
+			std::unordered_map<TrackArtistLinkType, std::vector<ArtistId>> artistSequenceByLinkType;
+			for (const TrackId trackId : trackSequence)
+			{
+				const auto itArtistIds {artistIdsByTrackId.find(trackId)};
+				if (itArtistIds == std::cend(artistIdsByTrackId))
+					continue;
+
+				for (const auto& [artistId, linkType] : itArtistIds->second)
+					addToSequence(artistSequenceByLinkType[linkType], artistId);
+			}
+
+			for (auto& [linkType, artistSequence] : artistSequenceByLinkType)
+				artistSequences[linkType].emplace_back(std::move(artistSequence));
+		}
+	}
+
+	auto notifyProgress {[&](std::size_t processedElems)
+	{
+		if (progressCallback)
+			progressCallback(Progress {3, processedElems});
+	}};
+
+	LMS_LOG(RECOMMENDATION, DEBUG) << "Computing co-listens...";
+
+	auto trackNeighbours {computeNeighbours(trackSequences)};
+	if (!trackNeighbours)
+		return false;
+	notifyProgress(1);
+
+	auto releaseNeighbours {computeNeighbours(releaseSequences)};
+	if (!releaseNeighbours)
+		return false;
+	notifyProgress(2);
+
+	std::unordered_map<TrackArtistLinkType, ObjectNeighbours<ArtistId>> artistNeighbours;
+	for (const auto& [linkType, sequences] : artistSequences)
+	{
+		auto artistNeighboursForLinkType {computeNeighbours(sequences)};
+		if (!artistNeighboursForLinkType)
+			return false;
+
+		artistNeighbours.emplace(linkType, std::move(*artistNeighboursForLinkType));
+	}
+	notifyProgress(3);
+
+	LMS_LOG(RECOMMENDATION, DEBUG) << "Computing co-listens DONE";
+
+	_trackNeighbours = std::move(*trackNeighbours);
+	_releaseNeighbours = std::move(*releaseNeighbours);
+	_artistNeighbours = std::move(artistNeighbours);
+
+	LMS_LOG(RECOMMENDATION, INFO) << "Classifier successfully loaded!";
+
+	return true;
+}
+
+void
+ListensClassifier::requestCancelLoad()
+{
+	LMS_LOG(RECOMMENDATION, DEBUG) << "Requesting init cancellation";
+	_loadCancelled = true;
+}
+
+IClassifier::ResultContainer<Database::TrackId>
+ListensClassifier::getSimilarTracksFromTrackList(Database::Session& session, Database::TrackListId trackListId, std::size_t maxCount) const
+{
+	const std::vector<Database::TrackId> trackIds {[&]
+	{
+		std::vector<Database::TrackId> res;
+
+		auto transaction {session.createSharedTransaction()};
+
+		const Database::TrackList::pointer trackList {Database::TrackList::getById(session, trackListId)};
+		if (trackList)
+			res = trackList->getTrackIds();
+
+		return res;
+	}()};
+
+	return getSimilarTracks(session, trackIds, maxCount);
+}
+
+IClassifier::ResultContainer<Database::TrackId>
+ListensClassifier::getSimilarTracks(Database::Session&, const std::vector<Database::TrackId>& trackIds, std::size_t maxCount) const
+{
+	// No need to check for removed tracks: the model is rebuilt after each scan (and periodically)
+	return getSimilarObjects(trackIds, _trackNeighbours, maxCount);
+}
+
+IClassifier::ResultContainer<Database::ReleaseId>
+ListensClassifier::getSimilarReleases(Database::Session&, Database::ReleaseId releaseId, std::size_t maxCount) const
+{
+	return getSimilarObjects<Database::ReleaseId>({releaseId}, _releaseNeighbours, maxCount);
+}
+
+IClassifier::ResultContainer<Database::ArtistId>
+ListensClassifier::getSimilarArtists(Database::Session&,
+		Database::ArtistId artistId,
+		EnumSet<Database::TrackArtistLinkType> linkTypes,
+		std::size_t maxCount) const
+{
+	ObjectNeighbours<Database::ArtistId> artistNeighbours;
+
+	for (Database::TrackArtistLinkType linkType : linkTypes)
+	{
+		const auto itArtistNeighbours {_artistNeighbours.find(linkType)};
+		if (itArtistNeighbours == std::cend(_artistNeighbours))
+			continue;
+
+		const auto itNeighbours {itArtistNeighbours->second.find(artistId)};
+		if (itNeighbours == std::cend(itArtistNeighbours->second))
+			continue;
+
+		std::vector<ScoredId<Database::ArtistId>>& neighbours {artistNeighbours[artistId]};
+		neighbours.insert(std::end(neighbours), std::cbegin(itNeighbours->second), std::cend(itNeighbours->second));
+	}
+
+	return getSimilarObjects<Database::ArtistId>({artistId}, artistNeighbours, maxCount);
+}
+
+} // namespace Recommendation
+
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "IClassifier.hpp"
+
+namespace Recommendation
+{
+	// Item-item model, built using the co-occurrences in the listen histories
+	class ListensClassifier : public IClassifier
+	{
+		public:
+			ListensClassifier() = default;
+			ListensClassifier(const ListensClassifier&) = delete;
+			ListensClassifier(ListensClassifier&&) = delete;
+			ListensClassifier& operator=(const ListensClassifier&) = delete;
+			ListensClassifier& operator=(ListensClassifier&&) = delete;
+
+		private:
+			std::string_view getName() const override { return "Listens"; }
+
+			bool load(Database::Session& session, bool forceReload, const ProgressCallback& progressCallback) override;
+			void requestCancelLoad() override;
+
+			ResultContainer<Database::TrackId> getSimilarTracksFromTrackList(Database::Session& session, Database::TrackListId tracklistId, std::size_t maxCount) const override;
+			ResultContainer<Database::TrackId> getSimilarTracks(Database::Session& session, const std::vector<Database::TrackId>& tracksId, std::size_t maxCount) const override;
+			ResultContainer<Database::ReleaseId> getSimilarReleases(Database::Session& session, Database::ReleaseId releaseId, std::size_t maxCount) const override;
+			ResultContainer<Database::ArtistId> getSimilarArtists(Database::Session& session,
+					Database::ArtistId artistId,
+					EnumSet<Database::TrackArtistLinkType> linkTypes,
+					std::size_t maxCount) const override;
+
+			using Score = float;
+
+			template <typename IdType>
+			struct ScoredId
+			{
+				IdType id;
+				Score score;
+			};
+
+			// Ordered by decreasing score
+			template <typename IdType>
+			using ObjectNeighbours = std::unordered_map<IdType, std::vector<ScoredId<IdType>>>;
+
+			// Listened objects, grouped by listen history and ordered by listen time
+			template <typename IdType>
+			using ListenSequences = std::vector<std::vector<IdType>>;
+
+			template <typename IdType>
+			std::optional<ObjectNeighbours<IdType>> computeNeighbours(const ListenSequences<IdType>& listenSequences) const;
+
+			template <typename IdType>
+			static std::vector<IdType> getSimilarObjects(const std::vector<IdType>& ids, const ObjectNeighbours<IdType>& objectNeighbours, std::size_t maxCount);
+
+			bool										_loadCancelled {};
+			ObjectNeighbours<Database::TrackId>			_trackNeighbours;
+			ObjectNeighbours<Database::ReleaseId>		_releaseNeighbours;
+			std::unordered_map<Database::TrackArtistLinkType, ObjectNeighbours<Database::ArtistId>> _artistNeighbours;
+	};
+
+} // namespace Recommendation
+
@@ -19,11 +19,24 @@
 
 #include "Scanner.hpp"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
 #include <ctime>
+#include <string_view>
+#include <thread>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 #include <boost/asio/placeholders.hpp>
 
 #include <Wt/WLocalDateTime.h>
 
+#include "av/Loudness.hpp"
+#include "cover/ICoverArtGrabber.hpp"
 #include "database/Artist.hpp"
 #include "database/Cluster.hpp"
 #include "database/Release.hpp"
@@ -34,8 +47,10 @@
 #include "metadata/TagLibParser.hpp"
 #include "recommendation/IEngine.hpp"
 #include "utils/Exception.hpp"
+#include "utils/IConfig.hpp"
 #include "utils/Logger.hpp"
 #include "utils/Path.hpp"
+#include "utils/Service.hpp"
 #include "utils/UUID.hpp"
 #include "AcousticBrainzUtils.hpp"
 
@@ -45,6 +60,12 @@ namespace {
 
 const std::filesystem::path excludeDirFileName {".lmsignore"};
 
+const std::array<std::filesystem::path, 4> coverFileExtensions {".jpg", ".jpeg", ".png", ".bmp"}; // TODO parametrize
+const std::array<std::string_view, 2> preferredCoverFileNames {"cover", "front"}; // TODO parametrize
+
+// Sizes requested by the web UI (see UserInterface::CoverResource::Size)
+constexpr std::array<CoverArt::ImageSize, 2> coverGenerationSizes {128, 512};
+
 Wt::WDate
 getNextMonday(Wt::WDate current)
 {
@@ -67,6 +88,27 @@ getNextFirstOfMonth(Wt::WDate current)
 	return current;
 }
 
+// Background work must not slow down the other users of the disks and of the CPUs
+void
+lowerCurrentThreadPriority()
+{
+#ifdef SYS_ioprio_set
+	constexpr int ioprioWhoProcess {1};
+	constexpr int ioprioClassIdle {3};
+	constexpr int ioprioClassShift {13};
+
+	// 0 means the calling thread
+	if (::syscall(SYS_ioprio_set, ioprioWhoProcess, 0, ioprioClassIdle << ioprioClassShift) < 0)
+		LMS_LOG(DBUPDATER, WARNING) << "Cannot set I/O priority: " << ::strerror(errno);
+#endif
+
+#ifdef SYS_gettid
+	// Linux only: applies to the calling thread
+	if (::setpriority(PRIO_PROCESS, static_cast<id_t>(::syscall(SYS_gettid)), 10) < 0)
+		LMS_LOG(DBUPDATER, WARNING) << "Cannot set thread priority: " << ::strerror(errno);
+#endif
+}
+
 bool
 isFileSupported(const std::filesystem::path& file, const std::unordered_set<std::filesystem::path>& extensions)
 {
@@ -255,7 +297,8 @@ createScanner(Database::Db& db, Recommendation::IEngine& recommendationEngine)
 }
 
 Scanner::Scanner(Database::Db& db, Recommendation::IEngine& recommendationEngine)
-: _recommendationEngine {recommendationEngine}
+: _db {db}
+, _recommendationEngine {recommendationEngine}
 , _dbSession {db}
 {
 	// For now, always use TagLib
@@ -263,6 +306,23 @@ Scanner::Scanner(Database::Db& db, Recommendation::IEngine& recommendationEngine
 
 	_ioService.setThreadCount(1);
 
+	_loudnessAnalysisEnabled = Service<IConfig>::get()->getBool("scanner-loudness-analysis", false);
+	if (_loudnessAnalysisEnabled && !Av::isLoudnessAnalysisSupported())
+	{
+		LMS_LOG(DBUPDATER, WARNING) << "Loudness analysis not supported by this build: disabling";
+		_loudnessAnalysisEnabled = false;
+	}
+	_loudnessAnalysisThreadCount = Service<IConfig>::get()->getULong("scanner-loudness-analysis-thread-count", 0);
+	if (_loudnessAnalysisThreadCount == 0)
+		_loudnessAnalysisThreadCount = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+
+	_coverGenerationEnabled = Service<IConfig>::get()->getBool("scanner-cover-generation", true);
+	_coverGenerationThreadCount = Service<IConfig>::get()->getULong("scanner-cover-generation-thread-count", 0);
+	if (_coverGenerationThreadCount == 0)
+		_coverGenerationThreadCount = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+
+	_maxCoverFileSize = Service<IConfig>::get()->getULong("cover-max-file-size", 10) * 1000 * 1000;
+
 	refreshScanSettings();
 
 	start();
@@ -425,6 +485,7 @@ Scanner::countAllFiles(ScanStats& stats)
 	ScanStepStats stepStats{stats.startTime, ScanProgressStep::DiscoveringFiles};
 
 	stats.filesScanned = 0;
+	_coverFiles.clear();
 	notifyInProgress(stepStats);
 
 	exploreFilesRecursive(_mediaDirectory, [&](std::error_code ec, const std::filesystem::path& path)
@@ -438,12 +499,133 @@ Scanner::countAllFiles(ScanStats& stats)
 			stepStats.processedElems++;
 			notifyInProgressIfNeeded(stepStats);
 		}
+		else if (!ec && isCoverFile(path))
+		{
+			_coverFiles[path.parent_path()].push_back(path);
+		}
 
 		return true;
 	}, excludeDirFileName);
 	notifyInProgress(stepStats);
 }
 
+bool
+Scanner::isCoverFile(const std::filesystem::path& file) const
+{
+	if (std::find(std::cbegin(coverFileExtensions), std::cend(coverFileExtensions), file.extension()) == std::cend(coverFileExtensions))
+		return false;
+
+	std::error_code ec;
+	const std::uintmax_t fileSize {std::filesystem::file_size(file, ec)};
+	if (ec)
+		return false;
+
+	if (fileSize > _maxCoverFileSize)
+	{
+		LMS_LOG(DBUPDATER, INFO) << "Cover file '" << file.string() << "' is too big (" << fileSize << "), limit is " << _maxCoverFileSize;
+		return false;
+	}
+
+	return true;
+}
+
+std::filesystem::path
+Scanner::findSameNamedCoverFile(const std::filesystem::path& trackPath) const
+{
+	auto itCoverFiles {_coverFiles.find(trackPath.parent_path())};
+	if (itCoverFiles == std::cend(_coverFiles))
+		return {};
+
+	const std::vector<std::filesystem::path>& coverFiles {itCoverFiles->second};
+
+	std::filesystem::path coverPath {trackPath};
+	for (const std::filesystem::path& extension : coverFileExtensions)
+	{
+		coverPath.replace_extension(extension);
+
+		if (std::find(std::cbegin(coverFiles), std::cend(coverFiles), coverPath) != std::cend(coverFiles))
+			return coverPath;
+	}
+
+	return {};
+}
+
+std::filesystem::path
+Scanner::findDirectoryCoverFile(const std::filesystem::path& directory) const
+{
+	auto itCoverFiles {_coverFiles.find(directory)};
+	if (itCoverFiles == std::cend(_coverFiles))
+		return {};
+
+	const std::vector<std::filesystem::path>& coverFiles {itCoverFiles->second};
+
+	for (std::string_view fileName : preferredCoverFileNames)
+	{
+		auto it {std::find_if(std::cbegin(coverFiles), std::cend(coverFiles), [&](const std::filesystem::path& coverFile) { return coverFile.stem() == fileName; })};
+		if (it != std::cend(coverFiles))
+			return *it;
+	}
+
+	// Just pick one, always the same
+	return *std::min_element(std::cbegin(coverFiles), std::cend(coverFiles));
+}
+
+std::vector<ReleaseId>
+Scanner::resolveReleaseCovers()
+{
+	LMS_LOG(DBUPDATER, DEBUG) << "Resolving release covers...";
+
+	std::vector<ReleaseId> releaseIds;
+	{
+		auto transaction {_dbSession.createSharedTransaction()};
+		releaseIds = Release::getAllIds(_dbSession);
+	}
+
+	std::vector<ReleaseId> updatedReleaseIds;
+	for (const ReleaseId releaseId : releaseIds)
+	{
+		if (_abortScan)
+			break;
+
+		std::filesystem::path coverPath;
+		{
+			auto transaction {_dbSession.createSharedTransaction()};
+
+			const Release::pointer release {Release::getById(_dbSession, releaseId)};
+			if (!release)
+				continue;
+
+			const Track::pointer firstTrack {release->getFirstTrack()};
+			if (!firstTrack)
+				continue;
+
+			const std::filesystem::path releaseDirectory {firstTrack->getPath().parent_path()};
+			coverPath = findDirectoryCoverFile(releaseDirectory);
+
+			// Discs may be in dedicated subdirectories
+			if (coverPath.empty() && release->getTotalDisc() > 1 && releaseDirectory.has_parent_path())
+				coverPath = findDirectoryCoverFile(releaseDirectory.parent_path());
+
+			if (coverPath == release->getCoverPath())
+				continue;
+		}
+
+		{
+			auto transaction {_dbSession.createUniqueTransaction()};
+
+			if (const Release::pointer release {Release::getById(_dbSession, releaseId)})
+			{
+				release.modify()->setCoverPath(coverPath);
+				updatedReleaseIds.push_back(releaseId);
+			}
+		}
+	}
+
+	LMS_LOG(DBUPDATER, DEBUG) << "Release covers resolved, " << updatedReleaseIds.size() << " updated";
+
+	return updatedReleaseIds;
+}
+
 void
 Scanner::scheduleScan(bool force, const Wt::WDateTime& dateTime)
 {
@@ -507,12 +689,17 @@ Scanner::scan(bool forceScan)
 
 	if (!_abortScan)
 	{
+		const std::vector<ReleaseId> releasesWithNewCover {resolveReleaseCovers()};
 		checkDuplicatedAudioFiles(stats);
 		fetchTrackFeatures(stats);
+		computeLoudness(stats);
 		reloadSimilarityEngine(stats);
+		generateCovers(stats, releasesWithNewCover);
 	}
 
-	LMS_LOG(DBUPDATER, INFO) << "Scan " << (_abortScan ? "aborted" : "complete") << ". Changes = " << stats.nbChanges() << " (added = " << stats.additions << ", removed = " << stats.deletions << ", updated = " << stats.updates << "), Not changed = " << stats.skips << ", Scanned = " << stats.scans << " (errors = " << stats.errors.size() << "), features fetched = " << stats.featuresFetched << ",  duplicates = " << stats.duplicates.size();
+	_coverFiles.clear();
+
+	LMS_LOG(DBUPDATER, INFO) << "Scan " << (_abortScan ? "aborted" : "complete") << ". Changes = " << stats.nbChanges() << " (added = " << stats.additions << ", removed = " << stats.deletions << ", updated = " << stats.updates << "), Not changed = " << stats.skips << ", Scanned = " << stats.scans << " (errors = " << stats.errors.size() << "), features fetched = " << stats.featuresFetched << ", loudness computed = " << stats.loudnessComputed << ", covers generated = " << stats.coversGenerated << ",  duplicates = " << stats.duplicates.size();
 
 	_dbSession.optimize();
 
@@ -618,6 +805,341 @@ Scanner::fetchTrackFeatures(ScanStats& stats)
 	LMS_LOG(DBUPDATER, INFO) << "Track features fetched!";
 }
 
+void
+Scanner::computeLoudness(ScanStats& stats)
+{
+	if (!_loudnessAnalysisEnabled)
+		return;
+
+	ScanStepStats stepStats {stats.startTime, ScanProgressStep::ComputingLoudness};
+
+	LMS_LOG(DBUPDATER, INFO) << "Computing missing track loudness...";
+
+	const auto tracksToAnalyze {[&]
+	{
+		auto transaction {_dbSession.createSharedTransaction()};
+
+		return Track::getAllPathsWithMissingLoudness(_dbSession);
+	}()};
+
+	stepStats.totalElems = tracksToAnalyze.size();
+	notifyInProgress(stepStats);
+
+	LMS_LOG(DBUPDATER, INFO) << "Found " << tracksToAnalyze.size() << " track(s) to analyze!";
+	if (tracksToAnalyze.empty())
+		return;
+
+	// Workers decode the files in parallel, results are stored in the database by this thread
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::vector<LoudnessResult> results;
+	std::atomic<std::size_t> nextTrackIndex {};
+
+	const std::size_t threadCount {std::min(_loudnessAnalysisThreadCount, tracksToAnalyze.size())};
+	std::size_t runningWorkerCount {threadCount};
+
+	auto worker {[&]
+	{
+		lowerCurrentThreadPriority();
+
+		while (!_abortScan)
+		{
+			const std::size_t trackIndex {nextTrackIndex++};
+			if (trackIndex >= tracksToAnalyze.size())
+				break;
+
+			const auto& [trackId, trackPath] {tracksToAnalyze[trackIndex]};
+
+			LoudnessResult result {trackId, std::nullopt};
+			try
+			{
+				result.loudness = Av::computeLoudness(trackPath);
+			}
+			catch (const Av::Exception&)
+			{
+				// Not retried until the file changes
+			}
+			catch (const std::exception& e)
+			{
+				// Not retried until the file changes
+				LMS_LOG(DBUPDATER, ERROR) << "Cannot compute loudness of '" << trackPath.string() << "': " << e.what();
+			}
+
+			{
+				std::scoped_lock lock {mutex};
+				results.push_back(result);
+			}
+			cv.notify_one();
+		}
+
+		{
+			std::scoped_lock lock {mutex};
+			--runningWorkerCount;
+		}
+		cv.notify_one();
+	}};
+
+	LMS_LOG(DBUPDATER, DEBUG) << "Using " << threadCount << " thread(s) for loudness analysis";
+
+	std::vector<std::thread> threads;
+	for (std::size_t i {}; i < threadCount; ++i)
+		threads.emplace_back(worker);
+
+	std::unordered_set<ReleaseId> releaseIds;
+	while (true)
+	{
+		std::vector<LoudnessResult> newResults;
+		bool complete {};
+		{
+			std::unique_lock lock {mutex};
+			cv.wait(lock, [&] { return !results.empty() || runningWorkerCount == 0; });
+
+			newResults.swap(results);
+			complete = (runningWorkerCount == 0);
+		}
+
+		storeLoudness(newResults, releaseIds);
+		stats.loudnessComputed += std::count_if(std::cbegin(newResults), std::cend(newResults), [](const LoudnessResult& result) { return result.loudness.has_value(); });
+
+		stepStats.processedElems += newResults.size();
+		notifyInProgressIfNeeded(stepStats);
+
+		if (complete)
+			break;
+	}
+
+	for (std::thread& thread : threads)
+		thread.join();
+
+	for (const ReleaseId releaseId : releaseIds)
+		updateReleaseLoudness(releaseId);
+
+	notifyInProgress(stepStats);
+	LMS_LOG(DBUPDATER, INFO) << "Track loudness computed!";
+}
+
+void
+Scanner::generateCovers(ScanStats& stats, const std::vector<ReleaseId>& releasesWithNewCover)
+{
+	CoverArt::IGrabber* coverArtGrabber {Service<CoverArt::IGrabber>::get()};
+	if (!_coverGenerationEnabled || !coverArtGrabber)
+		return;
+
+	// Resized covers are only useful if they are kept across scans
+	const bool generateResizedCovers {coverArtGrabber->getStats().diskCache.has_value()};
+
+	ScanStepStats stepStats {stats.startTime, ScanProgressStep::GeneratingCovers};
+
+	LMS_LOG(DBUPDATER, INFO) << "Generating covers of new and updated releases...";
+
+	// Releases whose color has never been computed (e.g. after a database upgrade) only need their color to be computed, they come last
+	std::size_t updatedReleaseCount {};
+	const std::vector<ReleaseId> releaseIds {[&]
+	{
+		std::vector<ReleaseId> res;
+		std::vector<ReleaseId> missingColorReleaseIds;
+		{
+			auto transaction {_dbSession.createSharedTransaction()};
+
+			res = Release::getAllIdsWithTracksAddedAfter(_dbSession, stats.startTime);
+			missingColorReleaseIds = Release::getAllIdsWithMissingCoverColor(_dbSession);
+		}
+
+		for (const ReleaseId releaseId : releasesWithNewCover)
+		{
+			if (std::find(std::cbegin(res), std::cend(res), releaseId) == std::cend(res))
+				res.push_back(releaseId);
+		}
+
+		updatedReleaseCount = res.size();
+
+		for (const ReleaseId releaseId : missingColorReleaseIds)
+		{
+			if (std::find(std::cbegin(res), std::cbegin(res) + updatedReleaseCount, releaseId) == std::cbegin(res) + updatedReleaseCount)
+				res.push_back(releaseId);
+		}
+
+		return res;
+	}()};
+
+	stepStats.totalElems = releaseIds.size();
+	notifyInProgress(stepStats);
+
+	LMS_LOG(DBUPDATER, INFO) << "Found " << releaseIds.size() << " release(s) to process!";
+	if (releaseIds.empty())
+		return;
+
+	// Generate the format the web browsers are going to request
+	const CoverArt::ImageFormat format {coverArtGrabber->selectFormat("image/webp")};
+
+	const std::size_t threadCount {std::min(_coverGenerationThreadCount, releaseIds.size())};
+
+	// Workers notify this thread on progress, as for the loudness analysis
+	std::atomic<std::size_t> nextReleaseIndex {};
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::size_t processedReleaseCount {};
+	std::size_t runningWorkerCount {threadCount};
+
+	auto processRelease {[&](Session& session, ReleaseId releaseId, bool colorOnly)
+	{
+		// Sent along with the releases, so that the clients can display a placeholder while loading the covers
+		const std::optional<CoverArt::RGBColor> coverColor {coverArtGrabber->computeReleaseColor(session, releaseId)};
+		{
+			auto transaction {session.createUniqueTransaction()};
+
+			if (const Release::pointer release {Release::getById(session, releaseId)})
+				release.modify()->setCoverColor(coverColor);
+		}
+
+		if (colorOnly || !generateResizedCovers)
+			return;
+
+		std::vector<TrackId> trackIds;
+		{
+			auto transaction {session.createSharedTransaction()};
+
+			if (const Release::pointer release {Release::getById(session, releaseId)})
+			{
+				for (const Track::pointer& track : release->getTracks())
+					trackIds.push_back(track->getId());
+			}
+		}
+
+		for (const CoverArt::ImageSize size : coverGenerationSizes)
+		{
+			coverArtGrabber->getFromRelease(session, releaseId, size, format);
+			for (const TrackId trackId : trackIds)
+				coverArtGrabber->getFromTrack(session, trackId, size, format);
+		}
+	}};
+
+	auto worker {[&]
+	{
+		lowerCurrentThreadPriority();
+
+		Session session {_db};
+
+		while (!_abortScan)
+		{
+			const std::size_t releaseIndex {nextReleaseIndex++};
+			if (releaseIndex >= releaseIds.size())
+				break;
+
+			const ReleaseId releaseId {releaseIds[releaseIndex]};
+
+			try
+			{
+				processRelease(session, releaseId, releaseIndex >= updatedReleaseCount);
+			}
+			catch (const std::exception& e)
+			{
+				LMS_LOG(DBUPDATER, ERROR) << "Release " << releaseId.getValue() << ": cannot generate covers: " << e.what();
+			}
+
+			{
+				std::scoped_lock lock {mutex};
+				++processedReleaseCount;
+			}
+			cv.notify_one();
+		}
+
+		{
+			std::scoped_lock lock {mutex};
+			--runningWorkerCount;
+		}
+		cv.notify_one();
+	}};
+
+	LMS_LOG(DBUPDATER, DEBUG) << "Using " << threadCount << " thread(s) for cover generation";
+
+	std::vector<std::thread> threads;
+	for (std::size_t i {}; i < threadCount; ++i)
+		threads.emplace_back(worker);
+
+	while (true)
+	{
+		bool complete {};
+		{
+			std::unique_lock lock {mutex};
+			cv.wait(lock, [&] { return processedReleaseCount != stepStats.processedElems || runningWorkerCount == 0; });
+
+			stepStats.processedElems = processedReleaseCount;
+			complete = (runningWorkerCount == 0);
+		}
+
+		notifyInProgressIfNeeded(stepStats);
+
+		if (complete)
+			break;
+	}
+
+	for (std::thread& thread : threads)
+		thread.join();
+
+	stats.coversGenerated = processedReleaseCount;
+	stepStats.processedElems = processedReleaseCount;
+
+	notifyInProgress(stepStats);
+	LMS_LOG(DBUPDATER, INFO) << "Covers generated!";
+}
+
+void
+Scanner::storeLoudness(const std::vector<LoudnessResult>& results, std::unordered_set<ReleaseId>& releaseIds)
+{
+	auto uniqueTransaction {_dbSession.createUniqueTransaction()};
+
+	for (const LoudnessResult& result : results)
+	{
+		Track::pointer track {Track::getById(_dbSession, result.trackId)};
+		if (!track)
+			continue;
+
+		track.modify()->setLoudnessAnalyzed(true);
+		track.modify()->setTrackLoudness(result.loudness ? std::make_optional<float>(result.loudness->integratedLoudness) : std::nullopt);
+		track.modify()->setTrackPeak(result.loudness ? std::make_optional<float>(result.loudness->samplePeak) : std::nullopt);
+
+		if (const Release::pointer release {track->getRelease()})
+			releaseIds.insert(release->getId());
+	}
+}
+
+void
+Scanner::updateReleaseLoudness(ReleaseId releaseId)
+{
+	auto uniqueTransaction {_dbSession.createUniqueTransaction()};
+
+	const Release::pointer release {Release::getById(_dbSession, releaseId)};
+	if (!release)
+		return;
+
+	// Approximation of the loudness of the whole release: mean of the track energies, weighted by the track durations
+	const std::vector<Track::pointer> tracks {release->getTracks()};
+
+	double energySum {};
+	double durationSum {};
+	std::optional<float> releasePeak;
+	for (const Track::pointer& track : tracks)
+	{
+		if (track->getTrackPeak())
+			releasePeak = std::max(releasePeak.value_or(0), *track->getTrackPeak());
+
+		if (!track->getTrackLoudness() || track->getDuration().count() <= 0)
+			continue;
+
+		const double duration {static_cast<double>(track->getDuration().count())};
+		energySum += duration * std::pow(10., *track->getTrackLoudness() / 10.);
+		durationSum += duration;
+	}
+
+	const std::optional<float> releaseLoudness {durationSum > 0 ? std::make_optional<float>(10. * std::log10(energySum / durationSum)) : std::nullopt};
+	for (const Track::pointer& track : tracks)
+	{
+		track.modify()->setReleaseLoudness(releaseLoudness);
+		track.modify()->setReleasePeak(releasePeak);
+	}
+}
+
 void
 Scanner::refreshScanSettings()
 {
@@ -687,16 +1209,46 @@ Scanner::scanAudioFile(const std::filesystem::path& file, bool forceScan, ScanSt
 		return;
 	}
 
+	// Cover files may have been added or removed even if the track has not changed
+	const std::filesystem::path coverPath {findSameNamedCoverFile(file)};
+
 	if (!forceScan)
 	{
-		// Skip file if last write is the same
-		auto transaction {_dbSession.createSharedTransaction()};
+		bool skip {};
+		bool coverChanged {};
+		bool fileSizeMissing {};
+		{
+			// Skip file if last write is the same
+			auto transaction {_dbSession.createSharedTransaction()};
 
-		const Track::pointer track {Track::getByPath(_dbSession, file)};
+			const Track::pointer track {Track::getByPath(_dbSession, file)};
+
+			if (track && track->getLastWriteTime().toTime_t() == lastWriteTime.toTime_t()
+					&& track->getScanVersion() == _scanVersion)
+			{
+				skip = true;
+				coverChanged = (track->getCoverPath() != coverPath);
+				fileSizeMissing = (track->getFileSize() == 0);
+			}
+		}
 
-		if (track && track->getLastWriteTime().toTime_t() == lastWriteTime.toTime_t()
-				&& track->getScanVersion() == _scanVersion)
+		if (skip)
 		{
+			if (coverChanged || fileSizeMissing)
+			{
+				std::error_code ec;
+				const std::uintmax_t fileSize {fileSizeMissing ? std::filesystem::file_size(file, ec) : 0};
+
+				auto transaction {_dbSession.createUniqueTransaction()};
+
+				if (const Track::pointer track {Track::getByPath(_dbSession, file)})
+				{
+					track.modify()->setCoverPath(coverPath);
+					if (fileSizeMissing && !ec)
+						track.modify()->setFileSize(fileSize);
+				}
+			}
+
 			stats.skips++;
 			return;
 		}
@@ -807,7 +1359,15 @@ Scanner::scanAudioFile(const std::filesystem::path& file, bool forceScan, ScanSt
 	if (trackInfo->album)
 		track.modify()->setRelease(getOrCreateRelease(_dbSession, *trackInfo->album));
 	track.modify()->setClusters(getOrCreateClusters(_dbSession, trackInfo->clusters));
+	// Analyze the loudness again only if the file has changed
+	if (track->getLastWriteTime().toTime_t() != lastWriteTime.toTime_t())
+		track.modify()->setLoudnessAnalyzed(false);
 	track.modify()->setLastWriteTime(lastWriteTime);
+	{
+		std::error_code ec;
+		const std::uintmax_t fileSize {std::filesystem::file_size(file, ec)};
+		track.modify()->setFileSize(ec ? 0 : fileSize);
+	}
 	track.modify()->setName(title);
 	track.modify()->setDuration(trackInfo->duration);
 	track.modify()->setAddedTime(Wt::WLocalDateTime::currentServerDateTime().toUTC());
@@ -828,6 +1388,7 @@ Scanner::scanAudioFile(const std::filesystem::path& file, bool forceScan, ScanSt
 	track.modify()->setTrackMBID(trackInfo->trackMBID);
 	track.modify()->setFeatures({}); // TODO: only if MBID changed?
 	track.modify()->setHasCover(trackInfo->hasCover);
+	track.modify()->setCoverPath(coverPath);
 	track.modify()->setCopyright(trackInfo->copyright);
 	track.modify()->setCopyrightURL(trackInfo->copyrightURL);
 	if (trackInfo->trackReplayGain)
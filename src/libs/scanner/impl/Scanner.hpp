@@ -22,7 +22,9 @@
 #include <chrono>
 #include <shared_mutex>
 #include <optional>
+#include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include <Wt/WDateTime.h>
 #include <Wt/WIOService.h>
@@ -30,6 +32,7 @@
 
 #include <boost/asio/system_timer.hpp>
 
+#include "av/Loudness.hpp"
 #include "database/Types.hpp"
 #include "database/ScanSettings.hpp"
 #include "database/Session.hpp"
@@ -80,10 +83,25 @@ class Scanner : public IScanner
 		bool fetchTrackFeatures(Database::TrackId trackId, const UUID& MBID);
 		void fetchTrackFeatures(ScanStats& stats);
 
+		struct LoudnessResult
+		{
+			Database::TrackId				trackId;
+			std::optional<Av::LoudnessInfo>	loudness;
+		};
+		void computeLoudness(ScanStats& stats);
+		void storeLoudness(const std::vector<LoudnessResult>& results, std::unordered_set<Database::ReleaseId>& releaseIds);
+		void updateReleaseLoudness(Database::ReleaseId releaseId);
+
+		void generateCovers(ScanStats& stats, const std::vector<Database::ReleaseId>& releasesWithNewCover);
+
 		// Helpers
 		void refreshScanSettings();
 
 		void countAllFiles(ScanStats& stats);
+		bool isCoverFile(const std::filesystem::path& file) const;
+		std::filesystem::path findSameNamedCoverFile(const std::filesystem::path& trackPath) const;
+		std::filesystem::path findDirectoryCoverFile(const std::filesystem::path& directory) const;
+		std::vector<Database::ReleaseId> resolveReleaseCovers(); // returns the releases whose cover file has changed
 		void removeMissingTracks(ScanStats& stats);
 		void removeOrphanEntries();
 		void checkDuplicatedAudioFiles(ScanStats& stats);
@@ -92,6 +110,7 @@ class Scanner : public IScanner
 		void notifyInProgress(const ScanStepStats& stats);
 		void reloadSimilarityEngine(ScanStats& stats);
 
+		Database::Db&							_db;
 		Recommendation::IEngine&				_recommendationEngine;
 
 		std::mutex								_controlMutex;
@@ -116,6 +135,15 @@ class Scanner : public IScanner
 		std::unordered_set<std::filesystem::path>		_fileExtensions;
 		std::filesystem::path					_mediaDirectory;
 		Database::ScanSettings::RecommendationEngineType _recommendationEngineType;
+
+		bool					_loudnessAnalysisEnabled {};
+		std::size_t				_loudnessAnalysisThreadCount {};
+		bool					_coverGenerationEnabled {};
+		std::size_t				_coverGenerationThreadCount {};
+		std::size_t				_maxCoverFileSize {};
+
+		// Cover files found while discovering the files, by directory: covers are resolved during the scan so that they can be served without exploring the directories
+		std::unordered_map<std::filesystem::path, std::vector<std::filesystem::path>> _coverFiles;
 };
 
 } // Scanner
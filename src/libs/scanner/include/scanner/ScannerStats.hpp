@@ -63,9 +63,11 @@ namespace Scanner {
 		DiscoveringFiles,
 		ScanningFiles,
 		FetchingTrackFeatures,
+		ComputingLoudness,
 		ReloadingSimilarityEngine,
+		GeneratingCovers,
 	};
-	static inline constexpr unsigned ScanProgressStepCount {5};
+	static inline constexpr unsigned ScanProgressStepCount {7};
 
 	// reduced scan stats
 	struct ScanStepStats
@@ -95,6 +97,8 @@ namespace Scanner {
 		std::size_t	updates {};			// updated file in DB
 
 		std::size_t	featuresFetched {};	// features fetched in DB
+		std::size_t	loudnessComputed {};	// track loudness computed in DB
+		std::size_t	coversGenerated {};	// releases whose covers have been generated
 
 		std::vector<ScanError>		errors;
 		std::vector<ScanDuplicate>	duplicates;
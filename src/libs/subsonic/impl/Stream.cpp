@@ -19,15 +19,25 @@
 
 #include "Stream.hpp"
 
+#include <algorithm>
+#include <array>
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+
+#include <Wt/Utils.h>
+
 #include "av/TranscodeParameters.hpp"
 #include "av/TranscodeResourceHandlerCreator.hpp"
 #include "av/Types.hpp"
 #include "database/Session.hpp"
 #include "database/Track.hpp"
 #include "database/User.hpp"
+#include "utils/IConfig.hpp"
 #include "utils/IResourceHandler.hpp"
 #include "utils/Logger.hpp"
 #include "utils/FileResourceHandlerCreator.hpp"
+#include "utils/Service.hpp"
 #include "utils/Utils.hpp"
 #include "ParameterParsing.hpp"
 #include "SubsonicId.hpp"
@@ -52,6 +62,26 @@ userTranscodeFormatToAvFormat(AudioFormat format)
 	}
 }
 
+// Gain applied in the transcoder, if enabled
+static
+std::optional<float>
+getTranscodeReplayGain(const Track::pointer& track, bool metadataKept)
+{
+	if (!Service<IConfig>::get()->getBool("api-subsonic-transcode-replay-gain", false))
+		return std::nullopt;
+
+	if (track->getTrackReplayGain())
+	{
+		// Clients already apply the gain using the tags
+		if (metadataKept)
+			return std::nullopt;
+
+		return track->getTrackReplayGain();
+	}
+
+	return track->getComputedTrackReplayGain();
+}
+
 struct StreamParameters
 {
 	std::filesystem::path trackPath;
@@ -73,13 +103,11 @@ getStreamParameters(RequestContext& context)
 
 	auto transaction {context.dbSession.createSharedTransaction()};
 
-	{
-		auto track {Track::getById(context.dbSession, id)};
-		if (!track)
-			throw RequestedDataNotFoundError {};
+	const Track::pointer track {Track::getById(context.dbSession, id)};
+	if (!track)
+		throw RequestedDataNotFoundError {};
 
-		parameters.trackPath = track->getPath();
-	}
+	parameters.trackPath = track->getPath();
 
 	{
 		const User::pointer user {User::getById(context.dbSession, context.userId)};
@@ -101,6 +129,7 @@ getStreamParameters(RequestContext& context)
 			transcodeParameters.bitrate = bitRate * 1000;
 			transcodeParameters.format = userTranscodeFormatToAvFormat(user->getSubsonicTranscodeFormat());
 			transcodeParameters.stripMetadata = false; // We want clients to use metadata (offline use, replay gain, etc.)
+			transcodeParameters.gain = getTranscodeReplayGain(track, true);
 
 			parameters.transcodeParameters = std::move(transcodeParameters);
 		}
@@ -174,4 +203,163 @@ handleStream(RequestContext& context, const Wt::Http::Request& request, Wt::Http
 	}
 }
 
+static constexpr std::chrono::seconds hlsSegmentDuration {10};
+// Bitrates offered when the client does not request any (in kbps)
+static constexpr std::array<std::size_t, 3> hlsDefaultBitRates {64, 128, 192};
+
+static
+std::string
+buildHlsUrl(const Wt::Http::ParameterMap& parameters, std::size_t bitRate, std::optional<std::size_t> segment = std::nullopt)
+{
+	std::ostringstream oss;
+	oss << "hls.m3u8?bitRate=" << bitRate;
+	if (segment)
+		oss << "&segment=" << *segment;
+
+	// Keep the track id, the authentication and client parameters
+	for (const auto& [name, values] : parameters)
+	{
+		if (name == "bitRate" || name == "segment")
+			continue;
+
+		for (const std::string& value : values)
+			oss << '&' << Wt::Utils::urlEncode(name) << '=' << Wt::Utils::urlEncode(value);
+	}
+
+	return oss.str();
+}
+
+static
+void
+writeHlsMasterPlaylist(std::ostream& os, const Wt::Http::ParameterMap& parameters, const std::vector<std::size_t>& bitRates)
+{
+	os << "#EXTM3U\n";
+	os << "#EXT-X-VERSION:3\n";
+
+	for (const std::size_t bitRate : bitRates)
+	{
+		os << "#EXT-X-STREAM-INF:BANDWIDTH=" << bitRate * 1000 << ",CODECS=\"mp4a.40.2\"\n";
+		os << buildHlsUrl(parameters, bitRate) << "\n";
+	}
+}
+
+static
+void
+writeHlsMediaPlaylist(std::ostream& os, const Wt::Http::ParameterMap& parameters, std::size_t bitRate, std::chrono::milliseconds duration)
+{
+	const std::chrono::milliseconds segmentDuration {hlsSegmentDuration};
+	const std::size_t segmentCount {std::max<std::size_t>((duration.count() + segmentDuration.count() - 1) / segmentDuration.count(), 1)};
+
+	os << "#EXTM3U\n";
+	os << "#EXT-X-VERSION:3\n";
+	os << "#EXT-X-TARGETDURATION:" << hlsSegmentDuration.count() << "\n";
+	os << "#EXT-X-MEDIA-SEQUENCE:0\n";
+	os << "#EXT-X-PLAYLIST-TYPE:VOD\n";
+
+	for (std::size_t segment {}; segment < segmentCount; ++segment)
+	{
+		std::chrono::milliseconds extInfDuration {segmentDuration};
+		if (duration.count() > 0 && segment == segmentCount - 1)
+			extInfDuration = duration - segmentDuration * segment;
+
+		os << "#EXTINF:" << std::fixed << std::setprecision(3) << (extInfDuration.count() / 1000.f) << ",\n";
+		os << buildHlsUrl(parameters, bitRate, segment) << "\n";
+	}
+
+	os << "#EXT-X-ENDLIST\n";
+}
+
+void
+handleHls(RequestContext& context, const Wt::Http::Request& request, Wt::Http::Response& response)
+{
+	std::shared_ptr<IResourceHandler> resourceHandler;
+
+	try
+	{
+		Wt::Http::ResponseContinuation* continuation {request.continuation()};
+		if (!continuation)
+		{
+			// Mandatory params
+			const TrackId id {getMandatoryParameterAs<TrackId>(context.parameters, "id")};
+
+			// Optional params
+			std::vector<std::size_t> bitRates {getMultiParametersAs<std::size_t>(context.parameters, "bitRate")};
+			const std::optional<std::size_t> segment {getParameterAs<std::size_t>(context.parameters, "segment")}; // LMS specific, used in generated playlists
+
+			std::filesystem::path trackPath;
+			std::chrono::milliseconds duration;
+			std::optional<float> gain;
+			std::size_t maxBitRate;
+			{
+				auto transaction {context.dbSession.createSharedTransaction()};
+
+				const auto track {Track::getById(context.dbSession, id)};
+				if (!track)
+					throw RequestedDataNotFoundError {};
+
+				trackPath = track->getPath();
+				duration = track->getDuration();
+				gain = getTranscodeReplayGain(track, false);
+
+				const User::pointer user {User::getById(context.dbSession, context.userId)};
+				if (!user)
+					throw UserNotAuthorizedError {};
+
+				maxBitRate = user->getSubsonicTranscodeBitrate() / 1000;
+			}
+
+			if (bitRates.empty())
+				std::copy_if(std::cbegin(hlsDefaultBitRates), std::cend(hlsDefaultBitRates), std::back_inserter(bitRates), [=](std::size_t bitRate) { return bitRate <= maxBitRate; });
+			if (bitRates.empty())
+				bitRates.push_back(maxBitRate);
+
+			for (std::size_t& bitRate : bitRates)
+				bitRate = Utils::clamp(bitRate, std::size_t {48}, maxBitRate);
+			std::sort(std::begin(bitRates), std::end(bitRates));
+			bitRates.erase(std::unique(std::begin(bitRates), std::end(bitRates)), std::end(bitRates));
+
+			if (!segment)
+			{
+				response.setMimeType("application/vnd.apple.mpegurl");
+
+				if (bitRates.size() > 1)
+					writeHlsMasterPlaylist(response.out(), context.parameters, bitRates);
+				else
+					writeHlsMediaPlaylist(response.out(), context.parameters, bitRates.front(), duration);
+
+				return;
+			}
+
+			if (bitRates.size() != 1)
+				throw BadParameterGenericError {"bitRate"};
+
+			// Segments are transcoded independently, so that each one can be cached and retried
+			Av::TranscodeParameters transcodeParameters;
+			transcodeParameters.format = Av::Format::MPEGTS_AAC;
+			transcodeParameters.bitrate = bitRates.front() * 1000;
+			transcodeParameters.offset = std::chrono::milliseconds {hlsSegmentDuration} * *segment;
+			transcodeParameters.duration = hlsSegmentDuration;
+			transcodeParameters.stripMetadata = true;
+			transcodeParameters.gain = gain;
+
+			if (duration.count() > 0 && transcodeParameters.offset >= duration)
+				throw BadParameterGenericError {"segment"};
+
+			resourceHandler = Av::createTranscodeResourceHandler(trackPath, transcodeParameters);
+		}
+		else
+		{
+			resourceHandler = Wt::cpp17::any_cast<std::shared_ptr<IResourceHandler>>(continuation->data());
+		}
+
+		continuation = resourceHandler->processRequest(request, response);
+		if (continuation)
+			continuation->setData(resourceHandler);
+	}
+	catch (const Av::Exception& e)
+	{
+		LMS_LOG(API_SUBSONIC, ERROR) << "Caught Av exception: " << e.what();
+	}
+}
+
 } // namespace API::Subsonic::Stream
@@ -28,5 +28,6 @@ namespace API::Subsonic::Stream
 {
 	void handleDownload(RequestContext& context, const Wt::Http::Request& request, Wt::Http::Response& response);
 	void handleStream(RequestContext& context, const Wt::Http::Request& request, Wt::Http::Response& response);
+	void handleHls(RequestContext& context, const Wt::Http::Request& request, Wt::Http::Response& response);
 }
 
@@ -23,6 +23,7 @@
 #include <ctime>
 #include <iomanip>
 #include <unordered_map>
+#include <unordered_set>
 
 #include <Wt/WLocalDateTime.h>
 
@@ -204,27 +205,84 @@ getArtistNames(const std::vector<Artist::pointer>& artists)
 	return StringUtils::joinStrings(names, ", ");
 }
 
+// Data needed to serialize a list of tracks, loaded using a few queries for the whole list
+struct TrackResponseData
+{
+	std::vector<Release::pointer>	releases;	// keeps the releases of the tracks loaded
+	std::unordered_map<ReleaseId, std::string> releasePaths;
+	std::unordered_map<TrackId, std::vector<Artist::pointer>> artists;
+	std::unordered_map<TrackId, Cluster::pointer> genres;
+	std::unordered_set<TrackId>		starredTrackIds;
+};
+
 static
-std::string
-getTrackPath(const Track::pointer& track)
+TrackResponseData
+loadTrackResponseData(Session& dbSession, const std::vector<Track::pointer>& tracks, const User::pointer& user)
 {
-	std::string path;
+	TrackResponseData data;
 
-	// The track path has to be relative from the root
+	std::vector<TrackId> trackIds;
+	trackIds.reserve(tracks.size());
+	std::transform(std::cbegin(tracks), std::cend(tracks), std::back_inserter(trackIds),
+			[](const Track::pointer& track) { return track->getId(); });
 
-	const auto release {track->getRelease()};
-	if (release)
+	data.releases = Release::getByTracks(dbSession, trackIds);
 	{
-		auto artists {release->getReleaseArtists()};
-		if (artists.empty())
-			artists = release->getArtists();
+		std::vector<ReleaseId> releaseIds;
+		releaseIds.reserve(data.releases.size());
+		std::transform(std::cbegin(data.releases), std::cend(data.releases), std::back_inserter(releaseIds),
+				[](const Release::pointer& release) { return release->getId(); });
+
+		auto releaseArtists {Release::getArtistsByRelease(dbSession, releaseIds, TrackArtistLinkType::ReleaseArtist)};
+		std::unordered_map<ReleaseId, std::vector<Artist::pointer>> artists;
+		if (releaseArtists.size() != releaseIds.size())
+			artists = Release::getArtistsByRelease(dbSession, releaseIds, TrackArtistLinkType::Artist);
 
-		if (artists.size() > 1)
-			path = "Various Artists/";
-		else if (artists.size() == 1)
-			path = makeNameFilesystemCompatible(artists.front()->getName()) + "/";
+		// The track path has to be relative from the root
+		for (const Release::pointer& release : data.releases)
+		{
+			const std::vector<Artist::pointer>* pathArtists {};
+			if (auto it {releaseArtists.find(release->getId())}; it != std::cend(releaseArtists))
+				pathArtists = &it->second;
+			else if (auto it {artists.find(release->getId())}; it != std::cend(artists))
+				pathArtists = &it->second;
+
+			std::string path;
+			if (pathArtists)
+			{
+				if (pathArtists->size() > 1)
+					path = "Various Artists/";
+				else
+					path = makeNameFilesystemCompatible(pathArtists->front()->getName()) + "/";
+			}
 
-		path += makeNameFilesystemCompatible(track->getRelease()->getName()) + "/";
+			path += makeNameFilesystemCompatible(release->getName()) + "/";
+			data.releasePaths.emplace(release->getId(), std::move(path));
+		}
+	}
+
+	data.artists = Track::getArtistsByTrack(dbSession, trackIds, TrackArtistLinkType::Artist);
+
+	// Report the first GENRE for each track
+	if (const ClusterType::pointer clusterType {ClusterType::getByName(dbSession, genreClusterName)})
+		data.genres = Track::getFirstClusterByTrack(dbSession, trackIds, clusterType->getId());
+
+	data.starredTrackIds = Track::getStarredIds(dbSession, user, trackIds);
+
+	return data;
+}
+
+static
+std::string
+getTrackPath(const Track::pointer& track, const TrackResponseData& data)
+{
+	std::string path;
+
+	if (const auto release {track->getRelease()})
+	{
+		auto it {data.releasePaths.find(release->getId())};
+		if (it != std::cend(data.releasePaths))
+			path = it->second;
 	}
 
 	if (track->getDiscNumber())
@@ -267,9 +325,19 @@ dateTimeToCreatedString(const Wt::WDateTime& dateTime)
 		return oss.str();
 }
 
+// Not part of the API, lets the clients display a placeholder while loading the cover
+static
+std::string
+coverColorToString(std::uint32_t color)
+{
+	std::ostringstream oss;
+	oss << '#' << std::hex << std::setfill('0') << std::setw(6) << (color & 0xFFFFFF);
+	return oss.str();
+}
+
 static
 Response::Node
-trackToResponseNode(const Track::pointer& track, Session& dbSession, const User::pointer& user)
+trackToResponseNode(const Track::pointer& track, const TrackResponseData& data, const User::pointer& user)
 {
 	Response::Node trackResponse;
 
@@ -283,13 +351,9 @@ trackToResponseNode(const Track::pointer& track, Session& dbSession, const User:
 	if (track->getYear())
 		trackResponse.setAttribute("year", *track->getYear());
 
-	trackResponse.setAttribute("path", getTrackPath(track));
-	{
-		std::error_code ec;
-		const auto fileSize {std::filesystem::file_size(track->getPath(), ec)};
-		if (!ec)
-			trackResponse.setAttribute("size", fileSize);
-	}
+	trackResponse.setAttribute("path", getTrackPath(track, data));
+	if (track->getFileSize())
+		trackResponse.setAttribute("size", track->getFileSize());
 
 	if (track->getPath().has_extension())
 	{
@@ -302,41 +366,48 @@ trackToResponseNode(const Track::pointer& track, Session& dbSession, const User:
 
 	trackResponse.setAttribute("coverArt", idToString(track->getId()));
 
-	const std::vector<Artist::pointer>& artists {track->getArtists({TrackArtistLinkType::Artist})};
-	if (!artists.empty())
+	if (auto itArtists {data.artists.find(track->getId())}; itArtists != std::cend(data.artists))
 	{
+		const std::vector<Artist::pointer>& artists {itArtists->second};
 		trackResponse.setAttribute("artist", getArtistNames(artists));
 
 		if (artists.size() == 1)
 			trackResponse.setAttribute("artistId", idToString(artists.front()->getId()));
 	}
 
-	if (track->getRelease())
+	if (const auto release {track->getRelease()})
 	{
-		trackResponse.setAttribute("album", track->getRelease()->getName());
-		trackResponse.setAttribute("albumId", idToString(track->getRelease()->getId()));
-		trackResponse.setAttribute("parent", idToString(track->getRelease()->getId()));
+		trackResponse.setAttribute("album", release->getName());
+		trackResponse.setAttribute("albumId", idToString(release->getId()));
+		trackResponse.setAttribute("parent", idToString(release->getId()));
+		if (const std::optional<std::uint32_t> coverColor {release->getCoverColor()})
+			trackResponse.setAttribute("coverArtColor", coverColorToString(*coverColor));
 	}
 
 	trackResponse.setAttribute("duration", std::chrono::duration_cast<std::chrono::seconds>(track->getDuration()).count());
 	trackResponse.setAttribute("type", "music");
 	trackResponse.setAttribute("created", dateTimeToCreatedString(track->getLastWritten()));
 
-	if (user->hasStarredTrack(track))
+	if (data.starredTrackIds.find(track->getId()) != std::cend(data.starredTrackIds))
 		trackResponse.setAttribute("starred", reportedStarredDate);
 
-	// Report the first GENRE for this track
-	ClusterType::pointer clusterType {ClusterType::getByName(dbSession, genreClusterName)};
-	if (clusterType)
-	{
-		auto clusters {track->getClusterGroups({clusterType}, 1)};
-		if (!clusters.empty() && !clusters.front().empty())
-			trackResponse.setAttribute("genre", clusters.front().front()->getName());
-	}
+	if (auto itGenre {data.genres.find(track->getId())}; itGenre != std::cend(data.genres))
+		trackResponse.setAttribute("genre", itGenre->second->getName());
 
 	return trackResponse;
 }
 
+static
+void
+addTrackNodes(Response::Node& parentNode, const std::string& key, const std::vector<Track::pointer>& tracks, Session& dbSession, const User::pointer& user)
+{
+	const TrackResponseData data {loadTrackResponseData(dbSession, tracks, user)};
+
+	for (const Track::pointer& track : tracks)
+		parentNode.addArrayChild(key, trackToResponseNode(track, data, user));
+}
+
+
 static
 Response::Node
 trackBookmarkToResponseNode(const TrackBookmark::pointer& trackBookmark)
@@ -374,6 +445,8 @@ releaseToResponseNode(const Release::pointer& release, Session& dbSession, const
 	albumNode.setAttribute("created", dateTimeToCreatedString(release->getLastWritten()));
 	albumNode.setAttribute("id", idToString(release->getId()));
 	albumNode.setAttribute("coverArt", idToString(release->getId()));
+	if (const std::optional<std::uint32_t> coverColor {release->getCoverColor()})
+		albumNode.setAttribute("coverArtColor", coverColorToString(*coverColor));
 	auto releaseYear {release->getReleaseYear()};
 	if (releaseYear)
 		albumNode.setAttribute("year", *releaseYear);
@@ -704,8 +777,7 @@ handleGetRandomSongsRequest(RequestContext& context)
 	Response response {Response::createOkResponse(context.serverProtocolVersion)};
 
 	Response::Node& randomSongsNode {response.createNode("randomSongs")};
-	for (const Track::pointer& track : tracks)
-		randomSongsNode.addArrayChild("song", trackToResponseNode(track, context.dbSession, user));
+	addTrackNodes(randomSongsNode, "song", tracks, context.dbSession, user);
 
 	return response;
 }
@@ -833,9 +905,7 @@ handleGetAlbumRequest(RequestContext& context)
 	Response response {Response::createOkResponse(context.serverProtocolVersion)};
 	Response::Node releaseNode {releaseToResponseNode(release, context.dbSession, user, true /* id3 */)};
 
-	auto tracks {release->getTracks()};
-	for (const Track::pointer& track : tracks)
-		releaseNode.addArrayChild("song", trackToResponseNode(track, context.dbSession, user));
+	addTrackNodes(releaseNode, "song", release->getTracks(), context.dbSession, user);
 
 	response.addNode("album", std::move(releaseNode));
 
@@ -1034,9 +1104,7 @@ handleGetMusicDirectoryRequest(RequestContext& context)
 
 		directoryNode.setAttribute("name", makeNameFilesystemCompatible(release->getName()));
 
-		auto tracks {release->getTracks()};
-		for (const Track::pointer& track : tracks)
-			directoryNode.addArrayChild("child", trackToResponseNode(track, context.dbSession, user));
+		addTrackNodes(directoryNode, "child", release->getTracks(), context.dbSession, user);
 	}
 	else
 		throw BadParameterGenericError {"id"};
@@ -1169,8 +1237,7 @@ handleGetSimilarSongsRequestCommon(RequestContext& context, bool id3)
 
 	Response response {Response::createOkResponse(context.serverProtocolVersion)};
 	Response::Node& similarSongsNode {response.createNode(id3 ? "similarSongs2" : "similarSongs")};
-	for (const Track::pointer& track : tracks)
-		similarSongsNode.addArrayChild("song", trackToResponseNode(track, context.dbSession, user));
+	addTrackNodes(similarSongsNode, "song", tracks, context.dbSession, user);
 
 	return response;
 }
@@ -1219,8 +1286,7 @@ handleGetStarredRequestCommon(RequestContext& context, bool id3)
 	{
 		bool moreResults {};
 		const auto tracks {Track::getStarred(context.dbSession, user, {}, std::nullopt, moreResults)};
-		for (const Track::pointer& track : tracks)
-			starredNode.addArrayChild("song", trackToResponseNode(track, context.dbSession, user));
+		addTrackNodes(starredNode, "song", tracks, context.dbSession, user);
 	}
 
 	return response;
@@ -1278,9 +1344,8 @@ handleGetPlaylistRequest(RequestContext& context)
 	Response response {Response::createOkResponse(context.serverProtocolVersion)};
 	Response::Node playlistNode {tracklistToResponseNode(tracklist, context.dbSession)};
 
-	auto entries {tracklist->getEntries()};
-	for (const TrackListEntry::pointer& entry : entries)
-		playlistNode.addArrayChild("entry", trackToResponseNode(entry->getTrack(), context.dbSession, user));
+	const auto tracks {Track::getByIds(context.dbSession, tracklist->getTrackIds())};
+	addTrackNodes(playlistNode, "entry", tracks, context.dbSession, user);
 
 	response.addNode("playlist", playlistNode );
 
@@ -1339,8 +1404,7 @@ handleGetSongsByGenreRequest(RequestContext& context)
 
 	bool more;
 	auto tracks {Track::getByFilter(context.dbSession, {cluster->getId()}, {}, Range {offset, size}, more)};
-	for (const Track::pointer& track : tracks)
-		songsByGenreNode.addArrayChild("song", trackToResponseNode(track, context.dbSession, user));
+	addTrackNodes(songsByGenreNode, "song", tracks, context.dbSession, user);
 
 	return response;
 }
@@ -1422,8 +1486,7 @@ handleSearchRequestCommon(RequestContext& context, bool id3)
 
 	{
 		auto tracks {Track::getByFilter(context.dbSession, {}, keywords, Range {songOffset, songCount}, more)};
-		for (const Track::pointer& track : tracks)
-			searchResult2Node.addArrayChild("song", trackToResponseNode(track, context.dbSession, user));
+		addTrackNodes(searchResult2Node, "song", tracks, context.dbSession, user);
 	}
 
 	return response;
@@ -1710,10 +1773,17 @@ handleGetBookmarks(RequestContext& context)
 	Response response {Response::createOkResponse(context.serverProtocolVersion)};
 	Response::Node& bookmarksNode {response.createNode("bookmarks")};
 
+	std::vector<Track::pointer> tracks;
+	tracks.reserve(bookmarks.size());
+	std::transform(std::cbegin(bookmarks), std::cend(bookmarks), std::back_inserter(tracks),
+			[](const TrackBookmark::pointer& bookmark) { return bookmark->getTrack(); });
+
+	const TrackResponseData trackResponseData {loadTrackResponseData(context.dbSession, tracks, user)};
+
 	for (const TrackBookmark::pointer& bookmark : bookmarks)
 	{
 		Response::Node bookmarkNode {trackBookmarkToResponseNode(bookmark)};
-		bookmarkNode.addArrayChild("entry", trackToResponseNode(bookmark->getTrack(), context.dbSession, user));
+		bookmarkNode.addArrayChild("entry", trackToResponseNode(bookmark->getTrack(), trackResponseData, user));
 
 		bookmarksNode.addArrayChild("bookmark", std::move(bookmarkNode));
 	}
@@ -1787,7 +1857,7 @@ handleNotImplemented(RequestContext&)
 
 static
 void
-handleGetCoverArt(RequestContext& context, const Wt::Http::Request& /*request*/, Wt::Http::Response& response)
+handleGetCoverArt(RequestContext& context, const Wt::Http::Request& request, Wt::Http::Response& response)
 {
 	// Mandatory params
 	const auto trackId {getParameterAs<TrackId>(context.parameters, "id")};
@@ -1799,12 +1869,15 @@ handleGetCoverArt(RequestContext& context, const Wt::Http::Request& /*request*/,
 	std::size_t size {getParameterAs<std::size_t>(context.parameters, "size").value_or(256)};
 	size = Utils::clamp(size, std::size_t {32}, std::size_t {1024});
 
+	const CoverArt::ImageFormat format {Service<CoverArt::IGrabber>::get()->selectFormat(request.headerValue("Accept"))};
+
 	std::shared_ptr<CoverArt::IEncodedImage> cover;
 	if (trackId)
-		cover = Service<CoverArt::IGrabber>::get()->getFromTrack(context.dbSession, *trackId, size);
+		cover = Service<CoverArt::IGrabber>::get()->getFromTrack(context.dbSession, *trackId, size, format);
 	else if (releaseId)
-		cover = Service<CoverArt::IGrabber>::get()->getFromRelease(context.dbSession, *releaseId, size);
+		cover = Service<CoverArt::IGrabber>::get()->getFromRelease(context.dbSession, *releaseId, size, format);
 
+	response.addHeader("Vary", "Accept");
 	response.out().write(reinterpret_cast<const char*>(cover->getData()), cover->getDataSize());
 	response.setMimeType(std::string {cover->getMimeType()});
 }
@@ -1864,7 +1937,6 @@ static const std::unordered_map<std::string, RequestEntryPointInfo> requestEntry
 	{"deletePlaylist",	{handleDeletePlaylistRequest}},
 
 	// Media retrieval
-	{"hls",				{handleNotImplemented}},
 	{"getCaptions",		{handleNotImplemented}},
 	{"getLyrics",		{handleNotImplemented}},
 	{"getAvatar",		{handleNotImplemented}},
@@ -1929,6 +2001,7 @@ static std::unordered_map<std::string, MediaRetrievalHandlerFunc> mediaRetrieval
 	// Media retrieval
 	{"download",		Stream::handleDownload},
 	{"stream",			Stream::handleStream},
+	{"hls",				Stream::handleHls},
 	{"getCoverArt",		handleGetCoverArt},
 };
 
@@ -1945,6 +2018,8 @@ SubsonicResource::handleRequest(const Wt::Http::Request &request, Wt::Http::Resp
 	std::string requestPath {request.pathInfo()};
 	if (StringUtils::stringEndsWith(requestPath, ".view"))
 		requestPath.resize(requestPath.length() - 5);
+	else if (StringUtils::stringEndsWith(requestPath, ".m3u8"))
+		requestPath.resize(requestPath.length() - 5);
 
 	// Optional parameters
 	const ResponseFormat format {getParameterAs<std::string>(request.getParameterMap(), "f").value_or("xml") == "json" ? ResponseFormat::json : ResponseFormat::xml};
@@ -1967,8 +2042,8 @@ SubsonicResource::handleRequest(const Wt::Http::Request &request, Wt::Http::Resp
 
 			Response resp {(itEntryPoint->second.func)(requestContext)};
 
-			resp.write(response.out(), format);
 			response.setMimeType(ResponseFormatToMimeType(format));
+			resp.write(response.out(), format);
 
 			LMS_LOG(API_SUBSONIC, DEBUG) << "Request " << requestId << " '" << requestPath << "' handled!";
 			return;
@@ -1991,8 +2066,8 @@ SubsonicResource::handleRequest(const Wt::Http::Request &request, Wt::Http::Resp
 			<< ", params = [" << parameterMapToDebugString(request.getParameterMap()) << "]"
 			<< ", code = " << static_cast<int>(e.getCode()) << ", msg = '" << e.getMessage() << "'";
 		Response resp {Response::createFailedResponse(protocolVersion, e)};
-		resp.write(response.out(), format);
 		response.setMimeType(ResponseFormatToMimeType(format));
+		resp.write(response.out(), format);
 	}
 }
 
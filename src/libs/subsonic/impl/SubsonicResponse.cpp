@@ -19,14 +19,6 @@
 
 #include "SubsonicResponse.hpp"
 
-#include <Wt/Json/Array.h>
-#include <Wt/Json/Object.h>
-#include <Wt/Json/Value.h>
-#include <Wt/Json/Serializer.h>
-
-#include <boost/property_tree/json_parser.hpp>
-#include <boost/property_tree/xml_parser.hpp>
-
 #include "utils/Exception.hpp"
 #include "utils/String.hpp"
 #include "ProtocolVersion.hpp"
@@ -169,111 +161,238 @@ Response::write(std::ostream& os, ResponseFormat format)
 	}
 }
 
-void
-Response::writeXML(std::ostream& os)
+namespace
 {
-	std::function<boost::property_tree::ptree(const Response::Node&)> nodeToPropertyTree = [&] (const Response::Node& node)
+	// Same escaping as the boost property tree XML writer
+	void
+	writeXMLEscaped(std::ostream& os, std::string_view str)
 	{
-		boost::property_tree::ptree res;
+		if (str.empty())
+			return;
 
-		for (auto itAttribute : node._attributes)
+		if (str.find_first_not_of(' ') == std::string_view::npos)
 		{
-			if (std::holds_alternative<std::string>(itAttribute.second))
-				res.put("<xmlattr>." + itAttribute.first, std::get<std::string>(itAttribute.second));
-			else if (std::holds_alternative<bool>(itAttribute.second))
-				res.put("<xmlattr>." + itAttribute.first, std::get<bool>(itAttribute.second));
-			else if (std::holds_alternative<long long>(itAttribute.second))
-				res.put("<xmlattr>." + itAttribute.first, std::get<long long>(itAttribute.second));
+			os << "&#32;" << str.substr(1);
+			return;
 		}
 
-		if (node._value)
+		for (const char c : str)
 		{
-			const auto& value {*node._value};
-
-			if (std::holds_alternative<std::string>(value))
-				res.put_value(std::get<std::string>(value));
-			else if (std::holds_alternative<bool>(value))
-				res.put_value(std::get<bool>(value));
-			else if (std::holds_alternative<long long>(value))
-				res.put_value(std::get<long long>(value));
+			switch (c)
+			{
+				case '<':	os << "&lt;"; break;
+				case '>':	os << "&gt;"; break;
+				case '&':	os << "&amp;"; break;
+				case '"':	os << "&quot;"; break;
+				case '\'':	os << "&apos;"; break;
+				default:	os << c; break;
+			}
 		}
-		else
+	}
+
+	void
+	writeJSONEscaped(std::ostream& os, std::string_view str)
+	{
+		os << '"';
+		for (const char c : str)
 		{
-			for (auto itChildNode : node._children)
+			switch (c)
 			{
-				for (const Response::Node& childNode : itChildNode.second)
-					res.add_child(itChildNode.first, nodeToPropertyTree(childNode));
+				case '"':	os << "\\\""; break;
+				case '\\':	os << "\\\\"; break;
+				case '\b':	os << "\\b"; break;
+				case '\f':	os << "\\f"; break;
+				case '\n':	os << "\\n"; break;
+				case '\r':	os << "\\r"; break;
+				case '\t':	os << "\\t"; break;
+				default:
+					if (static_cast<unsigned char>(c) < 0x20)
+					{
+						static constexpr char hexDigits[] {"0123456789abcdef"};
+						os << "\\u00" << hexDigits[(c >> 4) & 0xF] << hexDigits[c & 0xF];
+					}
+					else
+						os << c;
 			}
+		}
+		os << '"';
+	}
 
-			for (auto itChildArrayNode : node._childrenArrays)
-			{
-				const std::vector<Response::Node>& childArrayNodes {itChildArrayNode.second};
+	void
+	writeJSONIndentation(std::ostream& os, std::size_t indentation)
+	{
+		for (std::size_t i {}; i < indentation; ++i)
+			os << '\t';
+	}
+}
 
-				for (const Response::Node& childNode : childArrayNodes )
-					res.add_child(itChildArrayNode.first, nodeToPropertyTree(childNode));
-			}
+void
+Response::writeXMLValue(std::ostream& os, const Node::Value& value)
+{
+	if (std::holds_alternative<std::string>(value))
+		writeXMLEscaped(os, std::get<std::string>(value));
+	else if (std::holds_alternative<bool>(value))
+		os << (std::get<bool>(value) ? "true" : "false");
+	else if (std::holds_alternative<long long>(value))
+		os << std::get<long long>(value);
+}
+
+void
+Response::writeXMLNode(std::ostream& os, const std::string& key, const Node& node)
+{
+	// An empty string value is not written, as if there were no value
+	const bool hasValue {node._value && !(std::holds_alternative<std::string>(*node._value) && std::get<std::string>(*node._value).empty())};
+	const bool hasChildren {!node._children.empty() || !node._childrenArrays.empty()};
+
+	os << '<' << key;
+	for (const auto& [attributeKey, attributeValue] : node._attributes)
+	{
+		os << ' ' << attributeKey << "=\"";
+		writeXMLValue(os, attributeValue);
+		os << '"';
+	}
+
+	if (!hasValue && !hasChildren)
+	{
+		os << "/>";
+		return;
+	}
+
+	os << '>';
+
+	if (hasValue)
+	{
+		writeXMLValue(os, *node._value);
+	}
+	else
+	{
+		for (const auto& [childKey, childNodes] : node._children)
+		{
+			for (const Node& childNode : childNodes)
+				writeXMLNode(os, childKey, childNode);
 		}
 
-		return res;
-	};
+		for (const auto& [childArrayKey, childArrayNodes] : node._childrenArrays)
+		{
+			for (const Node& childNode : childArrayNodes)
+				writeXMLNode(os, childArrayKey, childNode);
+		}
+	}
 
-	boost::property_tree::ptree root {nodeToPropertyTree(_root)};
-	boost::property_tree::write_xml(os, root);
+	os << "</" << key << '>';
 }
 
 void
-Response::writeJSON(std::ostream& os)
+Response::writeXML(std::ostream& os)
 {
-	namespace Json = Wt::Json;
+	os << "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n";
 
-	std::function<Json::Object(const Response::Node&)> nodeToJsonObject = [&] (const Response::Node& node)
+	for (const auto& [childKey, childNodes] : _root._children)
 	{
-		Json::Object res;
+		for (const Node& childNode : childNodes)
+			writeXMLNode(os, childKey, childNode);
+	}
+}
 
-		auto valueToJsonValue {[](const Node::Value& value) -> Json::Value
+void
+Response::writeJSONValue(std::ostream& os, const Node::Value& value)
+{
+	if (std::holds_alternative<std::string>(value))
+		writeJSONEscaped(os, std::get<std::string>(value));
+	else if (std::holds_alternative<bool>(value))
+		os << (std::get<bool>(value) ? "true" : "false");
+	else if (std::holds_alternative<long long>(value))
+		os << std::get<long long>(value);
+}
+
+void
+Response::writeJSONNode(std::ostream& os, const Node& node, std::size_t indentation)
+{
+	// Members are sorted by key, the last one set wins in case of duplicates:
+	// attributes, then value, then children, then children arrays
+	using Member = std::variant<const Node::Value*, const Node*, const std::vector<Node>*>;
+	std::map<std::string_view, Member> members;
+
+	for (const auto& [attributeKey, attributeValue] : node._attributes)
+		members[attributeKey] = &attributeValue;
+
+	if (node._value)
+	{
+		members["value"] = &(*node._value);
+	}
+	else
+	{
+		for (const auto& [childKey, childNodes] : node._children)
 		{
-			if (std::holds_alternative<std::string>(value))
-				return Json::Value {std::get<std::string>(value)};
-			else if (std::holds_alternative<bool>(value))
-				return Json::Value {std::get<bool>(value)};
-			else if (std::holds_alternative<long long>(value))
-				return Json::Value {std::get<long long>(value)};
+			if (!childNodes.empty())
+				members[childKey] = &childNodes.back();
+		}
 
-			throw LmsException("Unexpected value type");
-		}};
+		for (const auto& [childArrayKey, childArrayNodes] : node._childrenArrays)
+			members[childArrayKey] = &childArrayNodes;
+	}
 
-		for (auto itAttribute : node._attributes)
-			res[itAttribute.first] = valueToJsonValue(itAttribute.second);
+	// Indented using tabs, one member or array element per line
+	if (members.empty())
+	{
+		os << "{}";
+		return;
+	}
 
-		if (node._value)
+	os << "{\n";
+	bool first {true};
+	for (const auto& [key, member] : members)
+	{
+		if (!first)
+			os << ",\n";
+		first = false;
+
+		writeJSONIndentation(os, indentation + 1);
+		writeJSONEscaped(os, key);
+		os << " : ";
+
+		if (std::holds_alternative<const Node::Value*>(member))
 		{
-			res["value"] = valueToJsonValue(*node._value);
+			writeJSONValue(os, *std::get<const Node::Value*>(member));
 		}
-		else
+		else if (std::holds_alternative<const Node*>(member))
 		{
-			for (auto itChildNode : node._children)
+			writeJSONNode(os, *std::get<const Node*>(member), indentation + 1);
+		}
+		else if (std::holds_alternative<const std::vector<Node>*>(member))
+		{
+			const std::vector<Node>& childNodes {*std::get<const std::vector<Node>*>(member)};
+			if (childNodes.empty())
 			{
-				for (const Response::Node& childNode : itChildNode.second)
-					res[itChildNode.first] = nodeToJsonObject(childNode);
+				os << "[]";
+				continue;
 			}
 
-			for (auto itChildArrayNode : node._childrenArrays)
+			os << "[\n";
+			bool firstChild {true};
+			for (const Node& childNode : childNodes)
 			{
-				const std::vector<Response::Node>& childArrayNodes {itChildArrayNode .second};
-
-				Json::Array array;
-				for (const Response::Node& childNode : childArrayNodes )
-					array.emplace_back(nodeToJsonObject(childNode));
+				if (!firstChild)
+					os << ",\n";
+				firstChild = false;
 
-				res[itChildArrayNode.first] = std::move(array);
+				writeJSONIndentation(os, indentation + 2);
+				writeJSONNode(os, childNode, indentation + 2);
 			}
+			os << '\n';
+			writeJSONIndentation(os, indentation + 1);
+			os << ']';
 		}
+	}
+	os << '\n';
+	writeJSONIndentation(os, indentation);
+	os << '}';
+}
 
-		return res;
-	};
-
-	Json::Object root {nodeToJsonObject(_root)};
-	os << Json::serialize(root);
+void
+Response::writeJSON(std::ostream& os)
+{
+	writeJSONNode(os, _root, 0);
 }
 
 } // namespace
@@ -19,6 +19,7 @@
 #pragma once
 
 #include <map>
+#include <ostream>
 #include <optional>
 #include <string>
 #include <string_view>
@@ -230,9 +231,15 @@ class Response
 		void write(std::ostream& os, ResponseFormat format);
 
 	private:
+		// Nodes are streamed as they are visited, without building an intermediate document
 		void writeJSON(std::ostream& os);
 		void writeXML(std::ostream& os);
 
+		static void writeXMLNode(std::ostream& os, const std::string& key, const Node& node);
+		static void writeXMLValue(std::ostream& os, const Node::Value& value);
+		static void writeJSONNode(std::ostream& os, const Node& node, std::size_t indentation);
+		static void writeJSONValue(std::ostream& os, const Node::Value& value);
+
 		Response() = default;
 		Node _root;
 };
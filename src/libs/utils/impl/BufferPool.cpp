@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "utils/BufferPool.hpp"
+
+#include <cassert>
+
+BufferPool::BufferPool(std::size_t bufferSize, std::size_t maxFreeBufferCount)
+: _bufferSize {bufferSize}
+, _maxFreeBufferCount {maxFreeBufferCount}
+{
+	_freeBuffers.reserve(maxFreeBufferCount);
+}
+
+BufferPool::~BufferPool()
+{
+	assert(_usedBufferCount == 0);
+
+	for (std::byte* buffer : _freeBuffers)
+		delete[] buffer;
+}
+
+void
+BufferPool::Releaser::operator()(std::byte* buffer) const
+{
+	_pool->release(buffer);
+}
+
+BufferPool::Buffer
+BufferPool::acquire()
+{
+	std::byte* buffer {};
+	{
+		std::scoped_lock lock {_mutex};
+
+		++_usedBufferCount;
+		if (!_freeBuffers.empty())
+		{
+			buffer = _freeBuffers.back();
+			_freeBuffers.pop_back();
+		}
+	}
+
+	if (!buffer)
+		buffer = new std::byte[_bufferSize];
+
+	return Buffer {buffer, Releaser {*this}};
+}
+
+void
+BufferPool::release(std::byte* buffer)
+{
+	{
+		std::scoped_lock lock {_mutex};
+
+		assert(_usedBufferCount > 0);
+		--_usedBufferCount;
+		if (_freeBuffers.size() < _maxFreeBufferCount)
+		{
+			_freeBuffers.push_back(buffer);
+			return;
+		}
+	}
+
+	delete[] buffer;
+}
+
+BufferPool::Stats
+BufferPool::getStats() const
+{
+	std::scoped_lock lock {_mutex};
+
+	return Stats {_usedBufferCount, _freeBuffers.size()};
+}
+
@@ -26,11 +26,11 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <signal.h>
+#include <spawn.h>
 #include <unistd.h>
 
 #include <algorithm>
 #include <iostream>
-#include <mutex>
 
 #include <boost/asio/read.hpp>
 #include <boost/asio/buffer.hpp>
@@ -53,65 +53,73 @@ namespace
 	};
 }
 
-ChildProcess::ChildProcess(boost::asio::io_context& ioContext, const std::filesystem::path& path, const Args& args)
+ChildProcess::ChildProcess(boost::asio::io_context& ioContext, const std::filesystem::path& path, const Args& args, std::optional<std::size_t> pipeSize)
 : _ioContext {ioContext}
 , _childStdout {_ioContext}
 
 {
-	// make sure only one thread is executing this part of code
-	static std::mutex mutex;
-	std::unique_lock<std::mutex> lock {mutex};
-
 	int pipe[2];
 
 	int res {pipe2(pipe, O_NONBLOCK | O_CLOEXEC)};
 	if (res < 0)
 		throw SystemException {errno, "pipe2 failed!"};
 
+	if (pipeSize)
 	{
 #if defined(__linux__) && defined(F_SETPIPE_SZ)
 		// Just a hint here to prevent the writer from writing too many bytes ahead of the reader
-		constexpr std::size_t pipeSize {65536*4};
-
-		if (fcntl(pipe[0], F_SETPIPE_SZ, pipeSize) == -1)
-			throw SystemException {errno, "fcntl failed!"};
-		if (fcntl(pipe[1], F_SETPIPE_SZ, pipeSize) == -1)
-			throw SystemException {errno, "fcntl failed!"};
+		// Both ends share the same pipe buffer, rounded up to a power of two pages by the kernel
+		if (fcntl(pipe[0], F_SETPIPE_SZ, static_cast<int>(*pipeSize)) == -1)
+			LMS_LOG(CHILDPROCESS, WARNING) << "Cannot set pipe size to " << *pipeSize << ": " << strerror(errno);
 #endif
 	}
 
-	res = fork();
-	if (res == -1)
-		throw SystemException {errno, "fork failed!"};
-
-	if (res == 0) // CHILD
+	std::vector<const char*> execArgs;
+	std::transform(std::cbegin(args), std::cend(args), std::back_inserter(execArgs), [](const std::string& arg) { return arg.c_str(); });
+	execArgs.push_back(nullptr);
+
+	// Unlike fork, posix_spawn does not duplicate the page tables of the server (vfork like),
+	// so that the spawn time does not depend on the server memory usage
+	// No need to serialize the spawns: all the fds of the pipes are created with O_CLOEXEC
+	::posix_spawn_file_actions_t fileActions;
+	::posix_spawnattr_t attributes;
+	::posix_spawn_file_actions_init(&fileActions);
+	::posix_spawnattr_init(&attributes);
+
+	// stdout is the pipe write end (dup2 clears O_CLOEXEC), no stdin nor stderr
+	::posix_spawn_file_actions_addopen(&fileActions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+	::posix_spawn_file_actions_addopen(&fileActions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+	::posix_spawn_file_actions_adddup2(&fileActions, pipe[1], STDOUT_FILENO);
+
+	// Do not inherit the signal mask of the calling thread
+	::sigset_t signalMask;
+	sigemptyset(&signalMask);
+	::posix_spawnattr_setsigmask(&attributes, &signalMask);
+	::posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETSIGMASK);
+
+	::pid_t pid {};
+	res = ::posix_spawn(&pid, path.string().c_str(), &fileActions, &attributes, const_cast<char* const*>(execArgs.data()), environ);
+
+	::posix_spawnattr_destroy(&attributes);
+	::posix_spawn_file_actions_destroy(&fileActions);
+	close(pipe[1]);
+
+	if (res != 0)
 	{
 		close(pipe[0]);
-		close(STDIN_FILENO);
-		close(STDERR_FILENO);
-
-		// Replace stdout with pipe write
-		if (dup2(pipe[1], STDOUT_FILENO) == -1)
-			exit(-1);
+		throw SystemException {res, "posix_spawn failed!"};
+	}
 
-		std::vector<const char*> execArgs;
-		std::transform(std::cbegin(args), std::cend(args), std::back_inserter(execArgs), [](const std::string& arg) { return arg.c_str(); });
-		execArgs.push_back(nullptr);
+	_childPID = pid;
 
-		res = execv(path.string().c_str(), (char *const*)&execArgs[0]);
-		if (res == -1)
-			exit(-1);
-	}
-	else // PARENT
+	boost::system::error_code assignError;
+	_childStdout.assign(pipe[0], assignError);
+	if (assignError)
 	{
-		close(pipe[1]);
-		{
-			boost::system::error_code assignError;
-			_childStdout.assign(pipe[0], assignError);
-			if (assignError)
-				throw SystemException {assignError, "fork failed!"};
-		}
-		_childPID = res;
+		close(pipe[0]);
+		kill();
+		wait(true);
+		throw SystemException {assignError, "assign failed!"};
 	}
 }
 
@@ -225,3 +233,15 @@ ChildProcess::finished()
 	return _finished;
 }
 
+bool
+ChildProcess::exitedSuccessfully()
+{
+	assert(finished());
+
+	// stdout has been closed, the process is exiting
+	if (!_waited)
+		wait(true);
+
+	return _exitCode && *_exitCode == 0;
+}
+
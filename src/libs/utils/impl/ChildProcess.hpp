@@ -36,13 +36,14 @@ class ChildProcess : public IChildProcess
 {
 	public:
 		~ChildProcess();
-		ChildProcess(boost::asio::io_context& ioContext, const std::filesystem::path& path, const Args& args);
+		ChildProcess(boost::asio::io_context& ioContext, const std::filesystem::path& path, const Args& args, std::optional<std::size_t> pipeSize);
 
 	private:
 		void		asyncRead(std::byte* data, std::size_t bufferSize, ReadCallback callback) override;
 		void		asyncWaitForData(WaitCallback cb) override;
 		std::size_t	readSome(std::byte* data, std::size_t bufferSize) override;
 		bool		finished() override;
+		bool		exitedSuccessfully() override;
 
 		void	kill();
 		void	drain();
@@ -36,9 +36,9 @@ ChildProcessManager::ChildProcessManager(boost::asio::io_context& ioContext)
 }
 
 std::unique_ptr<IChildProcess>
-ChildProcessManager::spawnChildProcess(const std::filesystem::path& path, const IChildProcess::Args& args)
+ChildProcessManager::spawnChildProcess(const std::filesystem::path& path, const IChildProcess::Args& args, std::optional<std::size_t> pipeSize)
 {
-	return std::make_unique<ChildProcess>(_ioContext, path, args);
+	return std::make_unique<ChildProcess>(_ioContext, path, args, pipeSize);
 }
 
 
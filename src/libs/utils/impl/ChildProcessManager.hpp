@@ -38,7 +38,7 @@ class ChildProcessManager : public IChildProcessManager
 		ChildProcessManager& operator=(ChildProcessManager&&) = delete;
 
 	private:
-		std::unique_ptr<IChildProcess> spawnChildProcess(const std::filesystem::path& path, const IChildProcess::Args& args) override;
+		std::unique_ptr<IChildProcess> spawnChildProcess(const std::filesystem::path& path, const IChildProcess::Args& args, std::optional<std::size_t> pipeSize) override;
 
 		boost::asio::io_context&	_ioContext;
 };
@@ -0,0 +1,275 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "utils/DiskLruCache.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+#include "utils/Logger.hpp"
+
+namespace
+{
+	constexpr std::string_view tmpFileExtension {".tmp"};
+}
+
+DiskLruCache::Writer::Writer(DiskLruCache& cache, const EntryName& entryName, std::string_view extension)
+: _cache {cache}
+, _entryName {entryName}
+, _path {_cache._directory / (entryName + std::string {extension})}
+, _tmpPath {_path.string() + std::string {tmpFileExtension}}
+, _ofs {_tmpPath, std::ios::binary | std::ios::trunc}
+{
+	if (!_ofs)
+		LMS_LOG(UTILS, ERROR) << "Cannot create cache file '" << _tmpPath.string() << "'";
+}
+
+DiskLruCache::Writer::~Writer()
+{
+	if (_committed)
+		return;
+
+	_ofs.close();
+
+	std::error_code ec;
+	std::filesystem::remove(_tmpPath, ec);
+	_cache.abortEntry(_entryName);
+}
+
+void
+DiskLruCache::Writer::write(const std::byte* data, std::size_t size)
+{
+	if (!_ofs)
+		return;
+
+	_ofs.write(reinterpret_cast<const char*>(data), size);
+	_size += size;
+}
+
+bool
+DiskLruCache::Writer::commit()
+{
+	assert(!_committed);
+
+	_ofs.close();
+	if (!_ofs)
+	{
+		LMS_LOG(UTILS, ERROR) << "Cannot write cache file '" << _tmpPath.string() << "'";
+		return false;
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(_tmpPath, _path, ec);
+	if (ec)
+	{
+		LMS_LOG(UTILS, ERROR) << "Cannot rename cache file '" << _tmpPath.string() << "': " << ec.message();
+		return false;
+	}
+
+	_committed = true;
+	_cache.addEntry(_entryName, _path, _size);
+
+	return true;
+}
+
+DiskLruCache::DiskLruCache(const std::filesystem::path& directory, std::size_t maxSize, ExtensionFilter extensionFilter)
+: _directory {directory}
+, _maxSize {maxSize}
+{
+	std::filesystem::create_directories(_directory);
+	loadEntries(extensionFilter);
+}
+
+void
+DiskLruCache::loadEntries(const ExtensionFilter& extensionFilter)
+{
+	struct FileEntry
+	{
+		EntryName name;
+		std::filesystem::path path;
+		std::size_t size;
+		std::filesystem::file_time_type lastWriteTime;
+	};
+	std::vector<FileEntry> fileEntries;
+
+	for (const std::filesystem::directory_entry& dirEntry : std::filesystem::directory_iterator {_directory})
+	{
+		std::error_code ec;
+
+		if (!dirEntry.is_regular_file(ec))
+			continue;
+
+		// Leftovers of interrupted writes, or of formats no longer produced
+		const std::string extension {dirEntry.path().extension().string()};
+		if (extension == tmpFileExtension || (extensionFilter && !extensionFilter(extension)))
+		{
+			std::filesystem::remove(dirEntry.path(), ec);
+			continue;
+		}
+
+		const std::size_t size {static_cast<std::size_t>(dirEntry.file_size(ec))};
+		if (ec)
+			continue;
+
+		const std::filesystem::file_time_type lastWriteTime {dirEntry.last_write_time(ec)};
+		if (ec)
+			continue;
+
+		fileEntries.push_back({dirEntry.path().stem().string(), dirEntry.path(), size, lastWriteTime});
+	}
+
+	// Last write time is updated on each hit
+	std::sort(std::begin(fileEntries), std::end(fileEntries), [](const FileEntry& a, const FileEntry& b) { return a.lastWriteTime > b.lastWriteTime; });
+
+	std::scoped_lock lock {_mutex};
+
+	for (const FileEntry& fileEntry : fileEntries)
+	{
+		// Same name with different extensions: only keep the most recently used one
+		if (_entries.find(fileEntry.name) != std::cend(_entries))
+		{
+			std::error_code ec;
+			std::filesystem::remove(fileEntry.path, ec);
+			continue;
+		}
+
+		_lru.push_back(fileEntry.name);
+		_entries.emplace(fileEntry.name, Entry {std::prev(std::end(_lru)), fileEntry.path, fileEntry.size});
+		_size += fileEntry.size;
+	}
+
+	evictEntries();
+}
+
+std::optional<DiskLruCache::EntryInfo>
+DiskLruCache::pin(const EntryName& entryName)
+{
+	std::scoped_lock lock {_mutex};
+
+	auto itEntry {_entries.find(entryName)};
+	if (itEntry == std::cend(_entries))
+	{
+		_misses++;
+		return std::nullopt;
+	}
+
+	_hits++;
+	_lru.splice(std::begin(_lru), _lru, itEntry->second.itLru);
+	itEntry->second.pinCount++;
+
+	// Keep track of the usage across restarts
+	std::error_code ec;
+	std::filesystem::last_write_time(itEntry->second.path, std::filesystem::file_time_type::clock::now(), ec);
+
+	return EntryInfo {itEntry->second.path, itEntry->second.size};
+}
+
+void
+DiskLruCache::unpin(const EntryName& entryName)
+{
+	std::scoped_lock lock {_mutex};
+
+	auto itEntry {_entries.find(entryName)};
+	assert(itEntry != std::cend(_entries) && itEntry->second.pinCount > 0);
+	itEntry->second.pinCount--;
+
+	// may have been skipped while pinned
+	evictEntries();
+}
+
+bool
+DiskLruCache::contains(const EntryName& entryName) const
+{
+	std::scoped_lock lock {_mutex};
+
+	return _entries.find(entryName) != std::cend(_entries);
+}
+
+std::unique_ptr<DiskLruCache::Writer>
+DiskLruCache::createWriter(const EntryName& entryName, std::string_view extension)
+{
+	{
+		std::scoped_lock lock {_mutex};
+
+		// Concurrent writes of the same entry: only the first one fills the cache
+		if (_entries.find(entryName) != std::cend(_entries) || !_pendingEntries.insert(entryName).second)
+			return nullptr;
+	}
+
+	return std::make_unique<Writer>(*this, entryName, extension);
+}
+
+void
+DiskLruCache::addEntry(const EntryName& entryName, const std::filesystem::path& path, std::size_t size)
+{
+	std::scoped_lock lock {_mutex};
+
+	_pendingEntries.erase(entryName);
+
+	_lru.push_front(entryName);
+	_entries.emplace(entryName, Entry {std::begin(_lru), path, size});
+	_size += size;
+
+	evictEntries();
+}
+
+void
+DiskLruCache::abortEntry(const EntryName& entryName)
+{
+	std::scoped_lock lock {_mutex};
+
+	_pendingEntries.erase(entryName);
+}
+
+void
+DiskLruCache::evictEntries()
+{
+	auto itLru {std::end(_lru)};
+	while (_size > _maxSize && itLru != std::begin(_lru))
+	{
+		--itLru;
+
+		auto itEntry {_entries.find(*itLru)};
+		if (itEntry->second.pinCount > 0)
+			continue;
+
+		std::error_code ec;
+		std::filesystem::remove(itEntry->second.path, ec);
+
+		_size -= itEntry->second.size;
+		_entries.erase(itEntry);
+		itLru = _lru.erase(itLru);
+	}
+}
+
+DiskLruCache::Stats
+DiskLruCache::getStats() const
+{
+	std::scoped_lock lock {_mutex};
+
+	Stats stats;
+	stats.entryCount = _entries.size();
+	stats.size = _size;
+	stats.hits = _hits;
+	stats.misses = _misses;
+
+	return stats;
+}
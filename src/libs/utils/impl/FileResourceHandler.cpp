@@ -19,46 +19,76 @@
 
 #include "FileResourceHandler.hpp"
 
-#include <fstream>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "utils/Logger.hpp"
 
 std::unique_ptr<IResourceHandler>
-createFileResourceHandler(const std::filesystem::path& path)
+createFileResourceHandler(const std::filesystem::path& path, std::string_view mimeType)
 {
-	return std::make_unique<FileResourceHandler>(path);
+	return std::make_unique<FileResourceHandler>(path, mimeType);
 }
 
 
-FileResourceHandler::FileResourceHandler(const std::filesystem::path& path)
+FileResourceHandler::FileResourceHandler(const std::filesystem::path& path, std::string_view mimeType)
 : _path {path}
+, _mimeType {mimeType}
 {
 }
 
+FileResourceHandler::~FileResourceHandler()
+{
+	closeFile();
+}
+
+void
+FileResourceHandler::closeFile()
+{
+	if (_fd >= 0)
+	{
+		::close(_fd);
+		_fd = -1;
+	}
+}
 
 Wt::Http::ResponseContinuation*
 FileResourceHandler::processRequest(const Wt::Http::Request& request, Wt::Http::Response& response)
 {
 	::uint64_t startByte {_offset};
-	std::ifstream ifs {_path.string().c_str(), std::ios::in | std::ios::binary};
 
 	if (startByte == 0)
 	{
-		if (!ifs)
+		_fd = ::open(_path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (_fd < 0)
 		{
-			LMS_LOG(UTILS, ERROR) << "Cannot open file stream for '" << _path.string() << "'";
+			LMS_LOG(UTILS, ERROR) << "Cannot open file '" << _path.string() << "': " << ::strerror(errno);
 			response.setStatus(404);
 			_isFinished = true;
 			return {};
 		}
-		else
+
+		struct stat fileStat;
+		if (::fstat(_fd, &fileStat) < 0)
 		{
-			response.setStatus(200);
+			LMS_LOG(UTILS, ERROR) << "Cannot stat file '" << _path.string() << "': " << ::strerror(errno);
+			closeFile();
+			response.setStatus(404);
+			_isFinished = true;
+			return {};
 		}
 
-		ifs.seekg(0, std::ios::end);
-		const ::uint64_t fileSize {static_cast<::uint64_t>(ifs.tellg())};
-		ifs.seekg(0, std::ios::beg);
+		response.setStatus(200);
+
+		if (!_mimeType.empty())
+			response.setMimeType(_mimeType);
+
+		const ::uint64_t fileSize {static_cast<::uint64_t>(fileStat.st_size)};
 
 		LMS_LOG(UTILS, DEBUG) << "File '" << _path.string() << "', fileSize = " << fileSize;
 
@@ -71,6 +101,7 @@ FileResourceHandler::processRequest(const Wt::Http::Request& request, Wt::Http::
 			response.addHeader("Content-Range", contentRange.str());
 
 			LMS_LOG(UTILS, DEBUG) << "Range not satisfiable";
+			closeFile();
 			_isFinished = true;
 			return {};
 		}
@@ -97,30 +128,40 @@ FileResourceHandler::processRequest(const Wt::Http::Request& request, Wt::Http::
 			_beyondLastByte = fileSize;
 			response.setContentLength(_beyondLastByte);
 		}
+
+		// The file is read in order, help the kernel to read ahead
+		::posix_fadvise(_fd, static_cast<::off_t>(startByte), static_cast<::off_t>(_beyondLastByte - startByte), POSIX_FADV_SEQUENTIAL);
 	}
-	else if (!ifs)
+	else if (_fd < 0)
 	{
-		LMS_LOG(UTILS, ERROR) << "Cannot reopen file stream for '" << _path.string() << "'";
+		LMS_LOG(UTILS, ERROR) << "File '" << _path.string() << "' is not open";
 		_isFinished = true;
 		return {};
 	}
 
-	ifs.seekg(static_cast<std::istream::pos_type>(startByte));
+	const ::uint64_t restSize {_beyondLastByte - startByte};
+	const std::size_t pieceSize {static_cast<std::size_t>(std::min<::uint64_t>(_buffer.size(), restSize))};
 
-	std::vector<char> buf;
-	buf.resize(_chunkSize);
+	::ssize_t readSize;
+	do
+	{
+		readSize = ::pread(_fd, _buffer.data(), pieceSize, static_cast<::off_t>(startByte));
+	}
+	while (readSize < 0 && errno == EINTR);
 
-	::uint64_t restSize = _beyondLastByte - startByte;
-	::uint64_t pieceSize = buf.size() > restSize ? restSize : buf.size();
+	if (readSize < 0)
+	{
+		LMS_LOG(UTILS, ERROR) << "Cannot read file '" << _path.string() << "': " << ::strerror(errno);
+		readSize = 0;
+	}
 
-	ifs.read(&buf[0], pieceSize);
-	const ::uint64_t actualPieceSize {static_cast<::uint64_t>(ifs.gcount())};
-	response.out().write(&buf[0], actualPieceSize);
+	const ::uint64_t actualPieceSize {static_cast<::uint64_t>(readSize)};
+	response.out().write(_buffer.data(), actualPieceSize);
 
 	LMS_LOG(UTILS, DEBUG) << "Written " << actualPieceSize << " bytes";
 
 	LMS_LOG(UTILS, DEBUG) << "Progress: " << actualPieceSize << "/" << restSize;
-	if (ifs.good() && actualPieceSize < restSize)
+	if (actualPieceSize > 0 && actualPieceSize < restSize)
 	{
 		_offset = startByte + actualPieceSize;
 		LMS_LOG(UTILS, DEBUG) << "Job not complete! Next chunk offset = " << _offset;
@@ -128,11 +169,9 @@ FileResourceHandler::processRequest(const Wt::Http::Request& request, Wt::Http::
 		return response.createContinuation();
 	}
 
+	closeFile();
 	_isFinished = true;
 	LMS_LOG(UTILS, DEBUG) << "Job complete!";
 
 	return {};
 }
-
-
-
@@ -19,21 +19,35 @@
 
 #pragma once
 
+#include <array>
 #include <filesystem>
+#include <string>
+#include <string_view>
 #include "utils/IResourceHandler.hpp"
 
 class FileResourceHandler final : public IResourceHandler
 {
 	public:
-		FileResourceHandler(const std::filesystem::path& filePath);
+		FileResourceHandler(const std::filesystem::path& filePath, std::string_view mimeType);
+		~FileResourceHandler() override;
+
+		FileResourceHandler(const FileResourceHandler&) = delete;
+		FileResourceHandler(FileResourceHandler&&) = delete;
+		FileResourceHandler& operator=(const FileResourceHandler&) = delete;
+		FileResourceHandler& operator=(FileResourceHandler&&) = delete;
 
 	private:
 
 		Wt::Http::ResponseContinuation* processRequest(const Wt::Http::Request& request, Wt::Http::Response& response) override;
 
+		void closeFile();
+
 		static constexpr std::size_t _chunkSize {65536};
 
 		std::filesystem::path	_path;
+		std::string				_mimeType;
+		int						_fd {-1};	// kept open across continuations
+		std::array<char, _chunkSize>	_buffer;
 		::uint64_t		_beyondLastByte {};
 		::uint64_t		_offset {};
 		bool			_isFinished {};
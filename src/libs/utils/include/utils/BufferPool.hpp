@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Thread safe pool of fixed size buffers
+// Released buffers are kept for reuse, up to maxFreeBufferCount
+class BufferPool
+{
+	public:
+		BufferPool(std::size_t bufferSize, std::size_t maxFreeBufferCount);
+		~BufferPool();
+
+		BufferPool(const BufferPool&) = delete;
+		BufferPool(BufferPool&&) = delete;
+		BufferPool& operator=(const BufferPool&) = delete;
+		BufferPool& operator=(BufferPool&&) = delete;
+
+		class Releaser
+		{
+			public:
+				Releaser() = default;
+				Releaser(BufferPool& pool) : _pool {&pool} {}
+
+				void operator()(std::byte* buffer) const;
+
+			private:
+				BufferPool* _pool {};
+		};
+		// The pool must outlive its buffers
+		using Buffer = std::unique_ptr<std::byte[], Releaser>;
+
+		Buffer		acquire();
+		std::size_t	getBufferSize() const { return _bufferSize; }
+
+		struct Stats
+		{
+			std::size_t usedBufferCount {};
+			std::size_t freeBufferCount {};
+		};
+		Stats getStats() const;
+
+	private:
+		void release(std::byte* buffer);
+
+		const std::size_t	_bufferSize;
+		const std::size_t	_maxFreeBufferCount;
+
+		mutable std::mutex		_mutex;
+		std::vector<std::byte*>	_freeBuffers;
+		std::size_t				_usedBufferCount {};
+};
+
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
+// Thread safe set of files stored in a directory, bounded by their total size
+// Least recently used entries are evicted first, the usage is kept across restarts using the last write time of the files
+// An entry is named after its file stem, the file extension is up to the caller
+// Files are written in temporary files first, so that a crash never leaves a partially written entry
+class DiskLruCache
+{
+	public:
+		using EntryName = std::string;
+
+		// Files whose extension is not accepted are removed on load (default: accept any extension)
+		using ExtensionFilter = std::function<bool(std::string_view extension)>;
+
+		DiskLruCache(const std::filesystem::path& directory, std::size_t maxSize, ExtensionFilter extensionFilter = {});
+		~DiskLruCache() = default;
+		DiskLruCache(const DiskLruCache&) = delete;
+		DiskLruCache(DiskLruCache&&) = delete;
+		DiskLruCache& operator=(const DiskLruCache&) = delete;
+		DiskLruCache& operator=(DiskLruCache&&) = delete;
+
+		struct EntryInfo
+		{
+			std::filesystem::path	path;
+			std::size_t				size;
+		};
+
+		// Marks the entry as used, its file is not evicted until unpin is called
+		// Returns std::nullopt if there is no such entry
+		std::optional<EntryInfo> pin(const EntryName& entryName);
+		void unpin(const EntryName& entryName);
+
+		// No side effect: not accounted in the stats, does not mark the entry as used
+		bool contains(const EntryName& entryName) const;
+
+		// Destroying the writer without committing discards the entry
+		// Must not outlive the cache
+		class Writer
+		{
+			public:
+				Writer(DiskLruCache& cache, const EntryName& entryName, std::string_view extension);
+				~Writer();
+				Writer(const Writer&) = delete;
+				Writer(Writer&&) = delete;
+				Writer& operator=(const Writer&) = delete;
+				Writer& operator=(Writer&&) = delete;
+
+				void write(const std::byte* data, std::size_t size);
+				bool commit();
+
+			private:
+				DiskLruCache&				_cache;
+				const EntryName				_entryName;
+				const std::filesystem::path	_path;
+				const std::filesystem::path	_tmpPath;
+				std::ofstream				_ofs;
+				std::size_t					_size {};
+				bool						_committed {};
+		};
+
+		// Returns nullptr if the entry already exists or is being written
+		std::unique_ptr<Writer> createWriter(const EntryName& entryName, std::string_view extension = "");
+
+		struct Stats
+		{
+			std::size_t entryCount {};
+			std::size_t size {};
+			std::size_t hits {};
+			std::size_t misses {};
+		};
+		Stats getStats() const;
+
+	private:
+		void loadEntries(const ExtensionFilter& extensionFilter);
+		void addEntry(const EntryName& entryName, const std::filesystem::path& path, std::size_t size);
+		void abortEntry(const EntryName& entryName);
+		void evictEntries();
+
+		const std::filesystem::path		_directory;
+		const std::size_t				_maxSize;
+
+		struct Entry
+		{
+			std::list<EntryName>::iterator	itLru;
+			std::filesystem::path			path;
+			std::size_t						size;
+			std::size_t						pinCount {};	// pinned entries are being used and cannot be evicted
+		};
+
+		mutable std::mutex						_mutex;
+		std::list<EntryName>					_lru;	// most recently used first
+		std::unordered_map<EntryName, Entry>	_entries;
+		std::unordered_set<EntryName>			_pendingEntries;
+		std::size_t								_size {};
+		std::size_t								_hits {};
+		std::size_t								_misses {};
+};
@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace Utils
+{
+	// 64-bit FNV-1a, stable across runs and platforms (unlike std::hash)
+	// Suitable for naming persisted entries, not for security purposes
+	constexpr std::uint64_t
+	computeFnv1aHash(std::string_view str)
+	{
+		std::uint64_t hash {0xcbf29ce484222325};
+		for (char c : str)
+		{
+			hash ^= static_cast<unsigned char>(c);
+			hash *= 0x100000001b3;
+		}
+
+		return hash;
+	}
+}
+
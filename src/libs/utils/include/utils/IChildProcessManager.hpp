@@ -20,6 +20,7 @@
 
 #include <filesystem>
 #include <memory>
+#include <optional>
 #include <boost/asio/io_service.hpp>
 
 #include "IChildProcess.hpp"
@@ -29,7 +30,8 @@ class IChildProcessManager
 	public:
 		virtual ~IChildProcessManager() = default;
 
-		virtual std::unique_ptr<IChildProcess> spawnChildProcess(const std::filesystem::path& path, const IChildProcess::Args& args) = 0;
+		// pipeSize is a hint for the size of the child's stdout pipe (system default if not set)
+		virtual std::unique_ptr<IChildProcess> spawnChildProcess(const std::filesystem::path& path, const IChildProcess::Args& args, std::optional<std::size_t> pipeSize = std::nullopt) = 0;
 };
 
 std::unique_ptr<IChildProcessManager> createChildProcessManager(boost::asio::io_service& ioService);
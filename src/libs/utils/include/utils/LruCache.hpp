@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Thread safe LRU cache, bounded by entry count
+// Entries are spread over several shards to reduce lock contention
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class LruCache
+{
+	public:
+		LruCache(std::size_t maxEntryCount, std::size_t shardCount = 8)
+		: _shards(shardCount)
+		{
+			for (Shard& shard : _shards)
+				shard.maxEntryCount = std::max(std::size_t {1}, maxEntryCount / shardCount);
+		}
+
+		LruCache(const LruCache&) = delete;
+		LruCache(LruCache&&) = delete;
+		LruCache& operator=(const LruCache&) = delete;
+		LruCache& operator=(LruCache&&) = delete;
+
+		std::optional<Value> get(const Key& key)
+		{
+			Shard& shard {getShard(key)};
+			std::scoped_lock lock {shard.mutex};
+
+			auto it {shard.index.find(key)};
+			if (it == std::cend(shard.index))
+			{
+				shard.misses++;
+				return std::nullopt;
+			}
+
+			shard.hits++;
+			// most recently used entries are at front
+			shard.entries.splice(std::begin(shard.entries), shard.entries, it->second);
+			return it->second->second;
+		}
+
+		void put(const Key& key, Value value)
+		{
+			Shard& shard {getShard(key)};
+			std::scoped_lock lock {shard.mutex};
+
+			auto it {shard.index.find(key)};
+			if (it != std::cend(shard.index))
+			{
+				it->second->second = std::move(value);
+				shard.entries.splice(std::begin(shard.entries), shard.entries, it->second);
+				return;
+			}
+
+			shard.entries.emplace_front(key, std::move(value));
+			shard.index.emplace(key, std::begin(shard.entries));
+
+			while (shard.entries.size() > shard.maxEntryCount)
+			{
+				shard.index.erase(shard.entries.back().first);
+				shard.entries.pop_back();
+			}
+		}
+
+		void clear()
+		{
+			for (Shard& shard : _shards)
+			{
+				std::scoped_lock lock {shard.mutex};
+
+				shard.index.clear();
+				shard.entries.clear();
+			}
+		}
+
+		struct Stats
+		{
+			std::size_t entryCount {};
+			std::size_t hits {};
+			std::size_t misses {};
+		};
+
+		Stats getStats() const
+		{
+			Stats stats;
+
+			for (const Shard& shard : _shards)
+			{
+				std::scoped_lock lock {shard.mutex};
+
+				stats.entryCount += shard.entries.size();
+				stats.hits += shard.hits;
+				stats.misses += shard.misses;
+			}
+
+			return stats;
+		}
+
+	private:
+		struct Shard
+		{
+			mutable std::mutex mutex;
+			std::size_t maxEntryCount {};
+			std::list<std::pair<Key, Value>> entries;
+			std::unordered_map<Key, typename std::list<std::pair<Key, Value>>::iterator, Hash> index;
+			std::size_t hits {};
+			std::size_t misses {};
+		};
+
+		Shard& getShard(const Key& key)
+		{
+			return _shards[Hash {}(key) % _shards.size()];
+		}
+
+		std::vector<Shard> _shards;
+};
+
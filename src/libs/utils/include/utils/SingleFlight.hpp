@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+// Concurrent calls for the same key are coalesced: only the first caller runs the function,
+// the others wait for its result (or exception)
+// The function must not run a call for the same key, or it will deadlock
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class SingleFlight
+{
+	public:
+		SingleFlight() = default;
+		SingleFlight(const SingleFlight&) = delete;
+		SingleFlight(SingleFlight&&) = delete;
+		SingleFlight& operator=(const SingleFlight&) = delete;
+		SingleFlight& operator=(SingleFlight&&) = delete;
+
+		template <typename Func>
+		Value run(const Key& key, Func&& func)
+		{
+			std::promise<Value> promise;
+			{
+				std::unique_lock lock {_mutex};
+
+				auto [it, inserted] {_calls.try_emplace(key)};
+				if (!inserted)
+				{
+					std::shared_future<Value> future {it->second};
+					lock.unlock();
+
+					_coalescedCallCount++;
+					return future.get();
+				}
+
+				it->second = promise.get_future().share();
+			}
+
+			try
+			{
+				Value value {func()};
+				promise.set_value(value);
+				removeCall(key);
+
+				return value;
+			}
+			catch (...)
+			{
+				promise.set_exception(std::current_exception());
+				removeCall(key);
+
+				throw;
+			}
+		}
+
+		// Number of calls that waited for the result of another one
+		std::size_t getCoalescedCallCount() const { return _coalescedCallCount; }
+
+	private:
+		void removeCall(const Key& key)
+		{
+			std::scoped_lock lock {_mutex};
+			_calls.erase(key);
+		}
+
+		std::mutex _mutex;
+		std::unordered_map<Key, std::shared_future<Value>, Hash> _calls;
+		std::atomic<std::size_t> _coalescedCallCount {};
+};
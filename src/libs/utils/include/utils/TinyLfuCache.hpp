@@ -0,0 +1,346 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Approximate access frequencies of keys, using a count-min sketch of 4 bits counters
+// Counters are periodically halved so that the history ages out
+class FrequencySketch
+{
+	public:
+		FrequencySketch(std::size_t expectedEntryCount)
+		{
+			std::size_t width {64};
+			while (width < expectedEntryCount)
+				width <<= 1;
+
+			_table.resize(width / 2); // two counters per byte
+			_sampleSize = width * 10;
+		}
+
+		void increment(std::size_t hash)
+		{
+			bool incremented {};
+			for (std::size_t depth {}; depth < depthCount; ++depth)
+			{
+				const std::size_t index {getIndex(hash, depth)};
+				if (getCounter(index) < maxCounterValue)
+				{
+					setCounter(index, getCounter(index) + 1);
+					incremented = true;
+				}
+			}
+
+			if (incremented && ++_additions >= _sampleSize)
+				reset();
+		}
+
+		unsigned getFrequency(std::size_t hash) const
+		{
+			unsigned frequency {maxCounterValue};
+			for (std::size_t depth {}; depth < depthCount; ++depth)
+				frequency = std::min(frequency, getCounter(getIndex(hash, depth)));
+
+			return frequency;
+		}
+
+	private:
+		static constexpr std::size_t depthCount {4};
+		static constexpr unsigned maxCounterValue {15};
+
+		std::size_t getIndex(std::size_t hash, std::size_t depth) const
+		{
+			static constexpr std::array<std::uint64_t, depthCount> seeds {0xc3a5c85c97cb3127, 0xb492b66fbe98f273, 0x9ae16a3b2f90404f, 0xcbf29ce484222325};
+
+			std::uint64_t h {(static_cast<std::uint64_t>(hash) + seeds[depth]) * seeds[depth]};
+			h ^= h >> 32;
+			return static_cast<std::size_t>(h) & (_table.size() * 2 - 1);
+		}
+
+		unsigned getCounter(std::size_t index) const
+		{
+			return (_table[index / 2] >> ((index % 2) * 4)) & 0x0F;
+		}
+
+		void setCounter(std::size_t index, unsigned value)
+		{
+			const unsigned shift {static_cast<unsigned>(index % 2) * 4};
+			_table[index / 2] = static_cast<std::uint8_t>((_table[index / 2] & ~(0x0F << shift)) | (value << shift));
+		}
+
+		void reset()
+		{
+			for (std::uint8_t& counters : _table)
+				counters = (counters >> 1) & 0x77;
+
+			_additions /= 2;
+		}
+
+		std::vector<std::uint8_t> _table;
+		std::size_t _sampleSize {};
+		std::size_t _additions {};
+};
+
+template <typename Value>
+struct UnitWeigher
+{
+	std::size_t operator()(const Value&) const { return 1; }
+};
+
+// Thread safe cache, bounded by the total weight of its entries
+// Entries are spread over several shards to reduce lock contention
+// Eviction uses a segmented LRU: entries hit while in probation get promoted to the protected segment
+// Admission uses TinyLFU: when full, a new entry is only added if it is accessed more often than the entries it would evict
+template <typename Key, typename Value, typename Hash = std::hash<Key>, typename Weigher = UnitWeigher<Value>>
+class TinyLfuCache
+{
+	public:
+		TinyLfuCache(std::size_t maxWeight, std::size_t expectedEntryCount, std::size_t shardCount = 8)
+		{
+			_shards.reserve(shardCount);
+			for (std::size_t i {}; i < shardCount; ++i)
+				_shards.emplace_back(std::make_unique<Shard>(std::max(std::size_t {1}, maxWeight / shardCount), expectedEntryCount / shardCount));
+		}
+
+		TinyLfuCache(const TinyLfuCache&) = delete;
+		TinyLfuCache(TinyLfuCache&&) = delete;
+		TinyLfuCache& operator=(const TinyLfuCache&) = delete;
+		TinyLfuCache& operator=(TinyLfuCache&&) = delete;
+
+		std::optional<Value> get(const Key& key)
+		{
+			const std::size_t hash {Hash {}(key)};
+			Shard& shard {getShard(hash)};
+			std::scoped_lock lock {shard.mutex};
+
+			// misses count too: they are likely to be followed by a put
+			shard.sketch.increment(hash);
+
+			auto it {shard.index.find(key)};
+			if (it == std::cend(shard.index))
+			{
+				shard.misses++;
+				return std::nullopt;
+			}
+
+			shard.hits++;
+			shard.onHit(it->second);
+			return it->second->value;
+		}
+
+		void put(const Key& key, Value value)
+		{
+			const std::size_t hash {Hash {}(key)};
+			Shard& shard {getShard(hash)};
+			std::scoped_lock lock {shard.mutex};
+
+			const std::size_t weight {Weigher {}(value)};
+
+			auto it {shard.index.find(key)};
+			if (it != std::cend(shard.index))
+			{
+				shard.erase(it->second);
+				shard.index.erase(it);
+			}
+
+			if (!shard.admit(hash, weight))
+			{
+				shard.rejections++;
+				return;
+			}
+
+			shard.probation.push_front(Node {key, std::move(value), hash, weight, false});
+			shard.probationWeight += weight;
+			shard.index.emplace(key, std::begin(shard.probation));
+		}
+
+		// Frequency history is kept
+		void clear()
+		{
+			for (const std::unique_ptr<Shard>& shard : _shards)
+			{
+				std::scoped_lock lock {shard->mutex};
+
+				shard->index.clear();
+				shard->probation.clear();
+				shard->protect.clear();
+				shard->probationWeight = 0;
+				shard->protectWeight = 0;
+			}
+		}
+
+		struct Stats
+		{
+			std::size_t entryCount {};
+			std::size_t weight {};
+			std::size_t hits {};
+			std::size_t misses {};
+			std::size_t evictions {};
+			std::size_t rejections {};
+		};
+
+		Stats getStats() const
+		{
+			Stats stats;
+
+			for (const std::unique_ptr<Shard>& shard : _shards)
+			{
+				std::scoped_lock lock {shard->mutex};
+
+				stats.entryCount += shard->index.size();
+				stats.weight += shard->probationWeight + shard->protectWeight;
+				stats.hits += shard->hits;
+				stats.misses += shard->misses;
+				stats.evictions += shard->evictions;
+				stats.rejections += shard->rejections;
+			}
+
+			return stats;
+		}
+
+	private:
+		struct Node
+		{
+			Key key;
+			Value value;
+			std::size_t hash;
+			std::size_t weight;
+			bool isProtected;
+		};
+		using NodeList = std::list<Node>;
+
+		// Aligned to prevent false sharing between shards
+		struct alignas(64) Shard
+		{
+			Shard(std::size_t maxWeight_, std::size_t expectedEntryCount)
+			: maxWeight {maxWeight_}
+			, maxProtectWeight {maxWeight_ * 8 / 10}
+			, sketch {expectedEntryCount}
+			{}
+
+			void onHit(typename NodeList::iterator itNode)
+			{
+				if (itNode->isProtected)
+				{
+					protect.splice(std::begin(protect), protect, itNode);
+					return;
+				}
+
+				itNode->isProtected = true;
+				probationWeight -= itNode->weight;
+				protectWeight += itNode->weight;
+				protect.splice(std::begin(protect), probation, itNode);
+
+				// Demoted entries get a second chance in probation
+				while (protectWeight > maxProtectWeight && protect.size() > 1)
+				{
+					auto itDemoted {std::prev(std::end(protect))};
+					itDemoted->isProtected = false;
+					protectWeight -= itDemoted->weight;
+					probationWeight += itDemoted->weight;
+					probation.splice(std::begin(probation), protect, itDemoted);
+				}
+			}
+
+			bool admit(std::size_t candidateHash, std::size_t candidateWeight)
+			{
+				if (candidateWeight > maxWeight)
+					return false;
+
+				// Victims are taken from the probation tail first, then from the protected tail
+				std::vector<typename NodeList::iterator> victims;
+				std::size_t freedWeight {};
+				const unsigned candidateFrequency {sketch.getFrequency(candidateHash)};
+
+				auto collectVictims {[&](NodeList& list)
+				{
+					for (auto it {std::rbegin(list)}; it != std::rend(list) && probationWeight + protectWeight - freedWeight + candidateWeight > maxWeight; ++it)
+					{
+						if (sketch.getFrequency(it->hash) >= candidateFrequency)
+							return false;
+
+						victims.push_back(std::prev(it.base()));
+						freedWeight += it->weight;
+					}
+					return true;
+				}};
+
+				if (!collectVictims(probation) || !collectVictims(protect))
+					return false;
+
+				for (auto itVictim : victims)
+				{
+					index.erase(itVictim->key);
+					erase(itVictim);
+					evictions++;
+				}
+
+				return true;
+			}
+
+			void erase(typename NodeList::iterator itNode)
+			{
+				if (itNode->isProtected)
+				{
+					protectWeight -= itNode->weight;
+					protect.erase(itNode);
+				}
+				else
+				{
+					probationWeight -= itNode->weight;
+					probation.erase(itNode);
+				}
+			}
+
+			mutable std::mutex mutex;
+			const std::size_t maxWeight;
+			const std::size_t maxProtectWeight;
+			FrequencySketch sketch;
+			NodeList probation;	// most recently used first
+			NodeList protect;	// most recently used first
+			std::size_t probationWeight {};
+			std::size_t protectWeight {};
+			std::unordered_map<Key, typename NodeList::iterator, Hash> index;
+			std::size_t hits {};
+			std::size_t misses {};
+			std::size_t evictions {};
+			std::size_t rejections {};
+		};
+
+		Shard& getShard(std::size_t hash)
+		{
+			return *_shards[hash % _shards.size()];
+		}
+
+		std::vector<std::unique_ptr<Shard>> _shards;
+};
@@ -17,6 +17,7 @@
  * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <chrono>
 #include <thread>
 
 #include <boost/asio/io_context.hpp>
@@ -28,6 +29,9 @@
 #include "auth/IAuthTokenService.hpp"
 #include "auth/IPasswordService.hpp"
 #include "auth/IEnvService.hpp"
+#include "av/ITranscodeCache.hpp"
+#include "av/ITranscodePrewarmer.hpp"
+#include "av/ITranscodeScheduler.hpp"
 #include "cover/ICoverArtGrabber.hpp"
 #include "database/Db.hpp"
 #include "database/Session.hpp"
@@ -254,7 +258,24 @@ int main(int argc, char* argv[])
 				server.appRoot() + "/images/unknown-cover.jpg",
 				config->getULong("cover-max-cache-size", 30) * 1000 * 1000,
 				config->getULong("cover-max-file-size", 10) * 1000 * 1000,
-				config->getULong("cover-jpeg-quality", 75))};
+				config->getULong("cover-jpeg-quality", 75),
+				config->getULong("cover-webp-quality", 75),
+				config->getPath("working-dir") / "cache" / "covers",
+				config->getULong("cover-disk-cache-max-size", 100) * 1000 * 1000)};
+		Service<Av::ITranscodeCache> transcodeCacheService;
+		if (const std::size_t transcodeCacheMaxSize {config->getULong("transcode-cache-max-size", 1000) * 1000 * 1000}; transcodeCacheMaxSize > 0)
+			transcodeCacheService.assign(Av::createTranscodeCache(config->getPath("working-dir") / "cache" / "transcode", transcodeCacheMaxSize));
+		std::size_t transcodeMaxRunningJobCount {config->getULong("transcode-max-running-jobs", 0)};
+		if (transcodeMaxRunningJobCount == 0)
+			transcodeMaxRunningJobCount = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+		Service<Av::ITranscodeScheduler> transcodeSchedulerService {Av::createTranscodeScheduler(transcodeMaxRunningJobCount)};
+		Service<Av::ITranscodePrewarmer> transcodePrewarmerService;
+		if (const std::chrono::seconds transcodePrewarmDelay {config->getULong("transcode-prewarm-delay", 10)}; transcodePrewarmDelay.count() > 0)
+		{
+			// Prewarmed transcodes hold a slot: they are expected to be requested once the current track ends, with some margin
+			transcodePrewarmerService.assign(Av::createTranscodePrewarmer(config->getULong("transcode-prewarm-max-buffer-size", 1024) * 1024, transcodePrewarmDelay + std::chrono::seconds {10}));
+		}
+
 		Service<Recommendation::IEngine> recommendationEngineService {Recommendation::createEngine(database)};
 		Service<Scanner::IScanner> scannerService {Scanner::createScanner(/*ioContext,*/ database, *recommendationEngineService)};
 
@@ -563,6 +563,12 @@ LmsApplication::createHome()
 		_playQueue->playNext();
 	});
 
+	_mediaPlayer->playbackEndingSoon.connect([this]
+	{
+		if (const std::optional<Database::TrackId> nextTrackId {_playQueue->getNextTrackId()})
+			_mediaPlayer->prewarmTrack(*nextTrackId);
+	});
+
 	_playQueue->trackSelected.connect([this] (Database::TrackId trackId, bool play, float replayGain)
 	{
 		_mediaPlayer->loadTrack(trackId, play, replayGain);
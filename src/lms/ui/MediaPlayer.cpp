@@ -23,7 +23,9 @@
 #include <Wt/Json/Value.h>
 #include <Wt/Json/Serializer.h>
 
+#include "utils/IConfig.hpp"
 #include "utils/Logger.hpp"
+#include "utils/Service.hpp"
 
 #include "database/Artist.hpp"
 #include "database/Release.hpp"
@@ -198,6 +200,7 @@ MediaPlayer::MediaPlayer()
 , scrobbleListenNow {this, "scrobbleListenNow"}
 , scrobbleListenFinished {this, "scrobbleListenFinished"}
 , playbackEnded {this, "playbackEnded"}
+, playbackEndingSoon {this, "playbackEndingSoon"}
 , _settingsLoaded {this, "settingsLoaded"}
 {
 	addFunction("tr", &Wt::WTemplate::Functions::tr);
@@ -225,6 +228,7 @@ MediaPlayer::MediaPlayer()
 		oss << "LMS.mediaplayer.init("
 			<< jsRef()
 			<< ", defaultSettings = " << settingsToJSString(defaultSettings)
+			<< ", " << Service<IConfig>::get()->getULong("transcode-prewarm-delay", 10)
 			<< ")";
 
 		LMS_LOG(UI, DEBUG) << "Running js = '" << oss.str() << "'";
@@ -232,6 +236,16 @@ MediaPlayer::MediaPlayer()
 	}
 }
 
+void
+MediaPlayer::prewarmTrack(Database::TrackId trackId)
+{
+	if (!_settings || _settings->transcode.mode == Settings::Transcode::Mode::Never)
+		return;
+
+	LMS_LOG(UI, DEBUG) << "Prewarming track ID = " << trackId.toString();
+	_audioTranscodeResource->prewarm(trackId, _settings->transcode.format, _settings->transcode.bitrate);
+}
+
 void
 MediaPlayer::loadTrack(Database::TrackId trackId, bool play, float replayGain)
 {
@@ -99,6 +99,9 @@ class MediaPlayer : public Wt::WTemplate
 		void loadTrack(Database::TrackId trackId, bool play, float replayGain);
 		void stop();
 
+		// Starts transcoding the track in background, using the current transcode settings
+		void prewarmTrack(Database::TrackId trackId);
+
 		std::optional<Settings>	getSettings() const { return _settings; }
 		void			setSettings(const Settings& settings);
 
@@ -112,6 +115,7 @@ class MediaPlayer : public Wt::WTemplate
 		Wt::JSignal<Database::TrackId::ValueType, unsigned /* ms */>	scrobbleListenFinished;
 
 		Wt::JSignal<>			playbackEnded;
+		Wt::JSignal<>			playbackEndingSoon;	// only emitted if the track is transcoded
 
 	private:
 		std::unique_ptr<AudioFileResource>		_audioFileResource;
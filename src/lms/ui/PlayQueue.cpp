@@ -294,6 +294,28 @@ PlayQueue::playNext()
 	loadTrack(*_trackPos + 1, true);
 }
 
+std::optional<Database::TrackId>
+PlayQueue::getNextTrackId() const
+{
+	if (!_trackPos)
+		return std::nullopt;
+
+	auto transaction {LmsApp->getDbSession().createSharedTransaction()};
+
+	const Database::TrackList::pointer tracklist {getTrackList()};
+
+	std::size_t pos {*_trackPos + 1};
+	if (pos >= tracklist->getCount())
+	{
+		if (!_repeatAll || tracklist->getCount() == 0)
+			return std::nullopt;
+
+		pos = 0;
+	}
+
+	return tracklist->getEntry(pos)->getTrack()->getId();
+}
+
 void
 PlayQueue::updateInfo()
 {
@@ -526,6 +548,29 @@ PlayQueue::enqueueRadioTracks()
 	enqueueTracks(trackToAddIds);
 }
 
+// Tags first, then the values computed by the loudness analysis
+static
+std::optional<float>
+getTrackReplayGain(const Database::Track::pointer& track)
+{
+	std::optional<float> gain {track->getTrackReplayGain()};
+	if (!gain)
+		gain = track->getComputedTrackReplayGain();
+
+	return gain;
+}
+
+static
+std::optional<float>
+getReleaseReplayGain(const Database::Track::pointer& track)
+{
+	std::optional<float> gain {track->getReleaseReplayGain()};
+	if (!gain)
+		gain = track->getComputedReleaseReplayGain();
+
+	return gain;
+}
+
 std::optional<float>
 PlayQueue::getReplayGain(std::size_t pos, const Database::Track::pointer& track) const
 {
@@ -541,13 +586,13 @@ PlayQueue::getReplayGain(std::size_t pos, const Database::Track::pointer& track)
 			return std::nullopt;
 
 		case MediaPlayer::Settings::ReplayGain::Mode::Track:
-			gain = track->getTrackReplayGain();
+			gain = getTrackReplayGain(track);
 			break;
 
 		case MediaPlayer::Settings::ReplayGain::Mode::Release:
-			gain = track->getReleaseReplayGain();
+			gain = getReleaseReplayGain(track);
 			if (!gain)
-				gain = track->getTrackReplayGain();
+				gain = getTrackReplayGain(track);
 			break;
 
 		case MediaPlayer::Settings::ReplayGain::Mode::Auto:
@@ -562,13 +607,13 @@ PlayQueue::getReplayGain(std::size_t pos, const Database::Track::pointer& track)
 				||
 				(nextTrack && nextTrack->getRelease() && nextTrack->getRelease() == track->getRelease()))
 			{
-				gain = track->getReleaseReplayGain();
+				gain = getReleaseReplayGain(track);
 				if (!gain)
-					gain = track->getTrackReplayGain();
+					gain = getTrackReplayGain(track);
 			}
 			else
 			{
-				gain = track->getTrackReplayGain();
+				gain = getTrackReplayGain(track);
 			}
 			break;
 		}
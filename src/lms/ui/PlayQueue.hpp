@@ -57,6 +57,9 @@ class PlayQueue : public Wt::WTemplate
 		// play the previous track in the queue
 		void playPrevious();
 
+		// track that will be played after the current one, if any
+		std::optional<Database::TrackId> getNextTrackId() const;
+
 		// Signal emitted when a track is to be load(and optionally played)
 		Wt::Signal<Database::TrackId, bool /*play*/, float /* replayGain */> trackSelected;
 
@@ -28,6 +28,8 @@
 #include <Wt/WResource.h>
 #include <Wt/WSplitButton.h>
 
+#include "av/ITranscodeScheduler.hpp"
+#include "cover/ICoverArtGrabber.hpp"
 #include "database/Session.hpp"
 #include "database/Track.hpp"
 #include "scanner/IScanner.hpp"
@@ -176,6 +178,47 @@ ScannerController::refreshContents()
 	actionBtn->dropDownButton()->addStyleClass("btn-primary");
 
 
+	{
+		const CoverArt::IGrabber::Stats coverStats {Service<CoverArt::IGrabber>::get()->getStats()};
+
+		bindString("cover-memory-cache", Wt::WString::tr("Lms.Admin.ScannerController.cover-memory-cache-status")
+				.arg(coverStats.memoryCache.entryCount)
+				.arg(coverStats.memoryCache.size / 1024)
+				.arg(coverStats.memoryCache.getHitRatePercent())
+				.arg(coverStats.memoryCache.hits)
+				.arg(coverStats.memoryCache.misses)
+				.arg(coverStats.memoryCache.evictions)
+				.arg(coverStats.memoryCache.rejections));
+
+		if (coverStats.diskCache)
+		{
+			bindString("cover-disk-cache", Wt::WString::tr("Lms.Admin.ScannerController.cover-disk-cache-status")
+					.arg(coverStats.diskCache->entryCount)
+					.arg(coverStats.diskCache->size / (1024 * 1024))
+					.arg(coverStats.diskCache->getHitRatePercent())
+					.arg(coverStats.diskCache->hits)
+					.arg(coverStats.diskCache->misses));
+		}
+		else
+			bindEmpty("cover-disk-cache");
+	}
+
+	if (const Av::ITranscodeScheduler* transcodeScheduler {Service<Av::ITranscodeScheduler>::get()})
+	{
+		const Av::ITranscodeScheduler::Stats transcodeStats {transcodeScheduler->getStats()};
+
+		bindString("transcode-jobs", Wt::WString::tr("Lms.Admin.ScannerController.transcode-jobs-status")
+				.arg(transcodeStats.runningJobCount)
+				.arg(transcodeStats.maxRunningJobCount)
+				.arg(transcodeStats.queuedJobCount)
+				.arg(transcodeStats.startedJobCount)
+				.arg(transcodeStats.cancelledJobCount)
+				.arg(static_cast<long long>(transcodeStats.averageWaitTime.count()))
+				.arg(static_cast<long long>(transcodeStats.maxWaitTime.count())));
+	}
+	else
+		bindEmpty("transcode-jobs");
+
 	const IScanner::Status status {Service<IScanner>::get()->getStatus()};
 	if (status.lastCompleteScanStats)
 	{
@@ -239,10 +282,22 @@ ScannerController::refreshContents()
 						.arg(status.currentScanStepStats->totalElems)
 						.arg(status.currentScanStepStats->progress()));
 					break;
+				case Scanner::ScanProgressStep::ComputingLoudness:
+					bindString("step-status", Wt::WString::tr("Lms.Admin.ScannerController.step-computing-loudness")
+						.arg(status.currentScanStepStats->processedElems)
+						.arg(status.currentScanStepStats->totalElems)
+						.arg(status.currentScanStepStats->progress()));
+					break;
 				case Scanner::ScanProgressStep::ReloadingSimilarityEngine:
 					bindString("step-status", Wt::WString::tr("Lms.Admin.ScannerController.step-reloading-similarity-engine")
 						.arg(status.currentScanStepStats->progress()));
 					break;
+				case Scanner::ScanProgressStep::GeneratingCovers:
+					bindString("step-status", Wt::WString::tr("Lms.Admin.ScannerController.step-generating-covers")
+						.arg(status.currentScanStepStats->processedElems)
+						.arg(status.currentScanStepStats->totalElems)
+						.arg(status.currentScanStepStats->progress()));
+					break;
 			}
 			break;
 	}
@@ -20,6 +20,8 @@
 #include "ReleaseListHelpers.hpp"
 
 #include <Wt/WAnchor.h>
+#include <Wt/WColor.h>
+#include <Wt/WCssDecorationStyle.h>
 #include <Wt/WImage.h>
 #include <Wt/WText.h>
 
@@ -34,6 +36,19 @@ using namespace Database;
 namespace UserInterface::ReleaseListHelpers
 {
 
+	void
+	applyCoverColor(Wt::WWidget& coverAnchor, const Release::pointer& release)
+	{
+		const std::optional<std::uint32_t> coverColor {release->getCoverColor()};
+		if (!coverColor)
+			return;
+
+		coverAnchor.addStyleClass("Lms-cover-anchor");
+		coverAnchor.decorationStyle().setBackgroundColor(Wt::WColor {static_cast<int>((*coverColor >> 16) & 0xFF),
+				static_cast<int>((*coverColor >> 8) & 0xFF),
+				static_cast<int>(*coverColor & 0xFF)});
+	}
+
 	static
 	std::unique_ptr<Wt::WTemplate>
 	createEntryInternal(const Release::pointer& release, const std::string& templateKey, const Artist::pointer& artist, const bool showYear)
@@ -49,6 +64,7 @@ namespace UserInterface::ReleaseListHelpers
 		cover->setStyleClass("Lms-cover");
 		cover->setAttributeValue("onload", LmsApp->javaScriptClass() + ".onLoadCover(this)");
 		anchor->setImage(std::move(cover));
+		applyCoverColor(*anchor, release);
 
 		auto artists = release->getReleaseArtists();
 		if (artists.empty())
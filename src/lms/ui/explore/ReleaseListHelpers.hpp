@@ -22,6 +22,7 @@
 #include <memory>
 
 #include <Wt/WTemplate.h>
+#include <Wt/WWidget.h>
 #include "database/Types.hpp"
 
 namespace Database
@@ -34,5 +35,8 @@ namespace UserInterface::ReleaseListHelpers
 {
 	std::unique_ptr<Wt::WTemplate> createEntry(const Database::ObjectPtr<Database::Release>& release);
 	std::unique_ptr<Wt::WTemplate> createEntryForArtist(const Database::ObjectPtr<Database::Release>& release, const Database::ObjectPtr<Database::Artist>& artist);
+
+	// Fill the area of the cover with its dominant color, while the cover is loading
+	void applyCoverColor(Wt::WWidget& coverAnchor, const Database::ObjectPtr<Database::Release>& release);
 } // namespace UserInterface
 
@@ -31,6 +31,7 @@
 #include "resource/CoverResource.hpp"
 #include "LmsApplication.hpp"
 #include "MediaPlayer.hpp"
+#include "ReleaseListHelpers.hpp"
 #include "TrackPopup.hpp"
 #include "TrackStringUtils.hpp"
 
@@ -77,6 +78,7 @@ namespace UserInterface::TrackListHelpers
 				cover->setStyleClass("Lms-cover");
 				cover->setAttributeValue("onload", LmsApp->javaScriptClass() + ".onLoadCover(this)");
 				anchor->setImage(std::move(cover));
+				ReleaseListHelpers::applyCoverColor(*anchor, release);
 			}
 		}
 		else
@@ -22,6 +22,7 @@
 #include <optional>
 #include <Wt/Http/Response.h>
 
+#include "av/ITranscodePrewarmer.hpp"
 #include "av/TranscodeParameters.hpp"
 #include "av/TranscodeResourceHandlerCreator.hpp"
 #include "av/Types.hpp"
@@ -29,6 +30,7 @@
 #include "database/Track.hpp"
 #include "database/User.hpp"
 #include "utils/Logger.hpp"
+#include "utils/Service.hpp"
 #include "utils/String.hpp"
 
 #include "LmsApplication.hpp"
@@ -119,6 +121,20 @@ readParameterAs(const Wt::Http::Request& request, const std::string& parameterNa
 	return res;
 }
 
+static
+Av::TranscodeParameters
+createTranscodeParameters(Av::Format format, Database::Bitrate bitrate, std::chrono::milliseconds offset)
+{
+	Av::TranscodeParameters parameters;
+
+	parameters.stripMetadata = true;
+	parameters.format = format;
+	parameters.bitrate = bitrate;
+	parameters.offset = offset;
+
+	return parameters;
+}
+
 struct TranscodeParameters
 {
 	std::filesystem::path file;
@@ -166,14 +182,37 @@ readTranscodeParameters(const Wt::Http::Request& request)
 		}
 	}
 
-	parameters.transcodeParameters.stripMetadata = true;
-	parameters.transcodeParameters.format = *avFormat;
-	parameters.transcodeParameters.bitrate = *bitrate;
-	parameters.transcodeParameters.offset = std::chrono::seconds {offset};
+	parameters.transcodeParameters = createTranscodeParameters(*avFormat, *bitrate, std::chrono::seconds {offset});
 
 	return parameters;
 }
 
+void
+AudioTranscodeResource::prewarm(Database::TrackId trackId, Database::AudioFormat format, Database::Bitrate bitrate)
+{
+	Av::ITranscodePrewarmer* prewarmer {Service<Av::ITranscodePrewarmer>::get()};
+	if (!prewarmer)
+		return;
+
+	const std::optional<Av::Format> avFormat {AudioFormatToAvFormat(format)};
+	if (!avFormat)
+		return;
+
+	std::filesystem::path trackPath;
+	{
+		auto transaction {LmsApp->getDbSession().createSharedTransaction()};
+
+		const Database::Track::pointer track {Database::Track::getById(LmsApp->getDbSession(), trackId)};
+		if (!track)
+			return;
+
+		trackPath = track->getPath();
+	}
+
+	// Must match the parameters of the request that will follow
+	prewarmer->prewarm(trackPath, createTranscodeParameters(*avFormat, bitrate, std::chrono::seconds {0}));
+}
+
 void
 AudioTranscodeResource::handleRequest(const Wt::Http::Request& request,
 		Wt::Http::Response& response)
@@ -39,6 +39,9 @@ class AudioTranscodeResource : public Wt::WResource
 		// Url depends on the user since settings are used in parameters
 		std::string getUrl(Database::TrackId trackId) const;
 
+		// Starts transcoding in background, so that the next request for this track is served right away
+		void prewarm(Database::TrackId trackId, Database::AudioFormat format, Database::Bitrate bitrate);
+
 		void handleRequest(const Wt::Http::Request& request, Wt::Http::Response& response);
 
 	private:
@@ -83,6 +83,8 @@ CoverResource::handleRequest(const Wt::Http::Request& request, Wt::Http::Respons
 		return;
 	}
 
+	const CoverArt::ImageFormat format {Service<CoverArt::IGrabber>::get()->selectFormat(request.headerValue("Accept"))};
+
 	std::shared_ptr<CoverArt::IEncodedImage> cover;
 
 	if (trackIdStr)
@@ -96,7 +98,7 @@ CoverResource::handleRequest(const Wt::Http::Request& request, Wt::Http::Respons
 			return;
 		}
 
-		cover = Service<CoverArt::IGrabber>::get()->getFromTrack(LmsApp->getDbSession(), *trackId, *size);
+		cover = Service<CoverArt::IGrabber>::get()->getFromTrack(LmsApp->getDbSession(), *trackId, *size, format);
 	}
 	else if (releaseIdStr)
 	{
@@ -106,7 +108,7 @@ CoverResource::handleRequest(const Wt::Http::Request& request, Wt::Http::Respons
 		if (!releaseId)
 			return;
 
-		cover = Service<CoverArt::IGrabber>::get()->getFromRelease(LmsApp->getDbSession(), *releaseId, *size);
+		cover = Service<CoverArt::IGrabber>::get()->getFromRelease(LmsApp->getDbSession(), *releaseId, *size, format);
 	}
 	else
 	{
@@ -115,6 +117,7 @@ CoverResource::handleRequest(const Wt::Http::Request& request, Wt::Http::Respons
 	}
 
 	response.setMimeType(std::string {cover->getMimeType()});
+	response.addHeader("Vary", "Accept");
 
 	response.out().write(reinterpret_cast<const char *>(cover->getData()), cover->getDataSize());
 }
@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <random>
+#include <sstream>
+#include <unordered_set>
+#include <gtest/gtest.h>
+#include "ann/HnswIndex.hpp"
+
+using namespace Ann;
+
+static
+std::vector<std::vector<Value>>
+generateValues(std::size_t count, std::size_t dimCount)
+{
+	std::mt19937 generator {42};
+	std::normal_distribution<Value> dist {0, 1};
+
+	std::vector<std::vector<Value>> res(count, std::vector<Value>(dimCount));
+	for (std::vector<Value>& values : res)
+	{
+		for (Value& value : values)
+			value = dist(generator);
+	}
+
+	return res;
+}
+
+static
+HnswIndex
+createIndex(const std::vector<std::vector<Value>>& allValues)
+{
+	HnswIndex index {allValues.front().size(), HnswIndex::Settings {8, 100}};
+	for (const std::vector<Value>& values : allValues)
+		index.add(values);
+
+	return index;
+}
+
+TEST(ann, Empty)
+{
+	const HnswIndex index {4};
+
+	EXPECT_EQ(index.getNodeCount(), 0);
+	EXPECT_TRUE(index.search({0, 0, 0, 0}, 10, 10).empty());
+	EXPECT_THROW(index.search({0, 0}, 10, 10), Exception);
+}
+
+TEST(ann, Self)
+{
+	const auto allValues {generateValues(500, 8)};
+	const HnswIndex index {createIndex(allValues)};
+
+	ASSERT_EQ(index.getNodeCount(), allValues.size());
+	for (NodeId id {}; id < allValues.size(); ++id)
+	{
+		const auto res {index.search(allValues[id], 1, 16)};
+		ASSERT_EQ(res.size(), 1);
+		EXPECT_EQ(res.front().id, id);
+		EXPECT_EQ(res.front().distance, 0);
+	}
+}
+
+TEST(ann, Recall)
+{
+	constexpr std::size_t resultCount {10};
+	const auto allValues {generateValues(2000, 16)};
+	const auto queries {generateValues(100, 16)};
+	const HnswIndex index {createIndex(allValues)};
+
+	std::size_t foundCount {};
+	for (const auto& query : queries)
+	{
+		const auto res {index.search(query, resultCount, 64)};
+		ASSERT_EQ(res.size(), resultCount);
+		EXPECT_TRUE(std::is_sorted(std::cbegin(res), std::cend(res), [](const auto& a, const auto& b) { return a.distance < b.distance; }));
+
+		std::unordered_set<NodeId> exactIds;
+		for (const auto& exactRes : index.searchExact(query, resultCount))
+			exactIds.insert(exactRes.id);
+
+		foundCount += std::count_if(std::cbegin(res), std::cend(res), [&](const auto& r) { return exactIds.count(r.id) > 0; });
+	}
+
+	EXPECT_GE(foundCount, queries.size() * resultCount * 9 / 10);
+}
+
+TEST(ann, Serialization)
+{
+	const auto allValues {generateValues(300, 8)};
+	const HnswIndex index {createIndex(allValues)};
+
+	std::stringstream ss;
+	index.write(ss);
+
+	const std::optional<HnswIndex> readIndex {HnswIndex::read(ss)};
+	ASSERT_TRUE(readIndex);
+	ASSERT_EQ(readIndex->getNodeCount(), index.getNodeCount());
+	EXPECT_EQ(readIndex->getValues(42), allValues[42]);
+
+	for (const auto& query : generateValues(20, 8))
+	{
+		const auto res {index.search(query, 5, 32)};
+		const auto readRes {readIndex->search(query, 5, 32)};
+
+		ASSERT_EQ(res.size(), readRes.size());
+		for (std::size_t i {}; i < res.size(); ++i)
+			EXPECT_EQ(res[i].id, readRes[i].id);
+	}
+
+	{
+		std::stringstream badSs {"garbage"};
+		EXPECT_FALSE(HnswIndex::read(badSs));
+	}
+
+	{
+		// truncated
+		const std::string data {ss.str()};
+		std::stringstream truncatedSs {data.substr(0, data.size() / 2)};
+		EXPECT_FALSE(HnswIndex::read(truncatedSs));
+	}
+
+	{
+		// huge value count, must not be allocated
+		std::string data {ss.str()};
+		const std::size_t valueCountOffset {8 + sizeof(std::uint32_t) + 4 * sizeof(std::uint64_t) + sizeof(NodeId)};
+		const std::uint64_t hugeCount {std::uint64_t {1} << 33};
+		data.replace(valueCountOffset, sizeof(hugeCount), reinterpret_cast<const char*>(&hugeCount), sizeof(hugeCount));
+		std::stringstream forgedSs {data};
+		EXPECT_FALSE(HnswIndex::read(forgedSs));
+	}
+}
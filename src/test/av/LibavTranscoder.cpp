@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <vector>
+#include <unistd.h>
+#include <gtest/gtest.h>
+
+#include "utils/IConfig.hpp"
+#include "utils/Service.hpp"
+#include "LibavTranscoder.hpp"
+
+using namespace Av;
+
+namespace
+{
+	class TmpDirectory
+	{
+		public:
+			TmpDirectory()
+			: _path {std::filesystem::temp_directory_path() / ("lms-test-av-" + std::to_string(::getpid()))}
+			{
+				std::filesystem::create_directories(_path);
+			}
+
+			~TmpDirectory()
+			{
+				std::error_code ec;
+				std::filesystem::remove_all(_path, ec);
+			}
+
+			const std::filesystem::path& getPath() const { return _path; }
+
+		private:
+			const std::filesystem::path _path;
+	};
+
+	template <typename T>
+	void writeValue(std::ostream& os, T value)
+	{
+		os.write(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+
+	// 16 bits stereo 1kHz sine
+	void writeWav(const std::filesystem::path& path, std::uint32_t sampleRate, std::uint32_t durationSeconds)
+	{
+		constexpr std::uint16_t channelCount {2};
+		constexpr std::uint16_t bytesPerSample {2};
+		const std::uint32_t dataSize {sampleRate * durationSeconds * channelCount * bytesPerSample};
+
+		std::ofstream ofs {path, std::ios::binary};
+		ofs.write("RIFF", 4);
+		writeValue<std::uint32_t>(ofs, 36 + dataSize);
+		ofs.write("WAVEfmt ", 8);
+		writeValue<std::uint32_t>(ofs, 16);
+		writeValue<std::uint16_t>(ofs, 1); // PCM
+		writeValue<std::uint16_t>(ofs, channelCount);
+		writeValue<std::uint32_t>(ofs, sampleRate);
+		writeValue<std::uint32_t>(ofs, sampleRate * channelCount * bytesPerSample);
+		writeValue<std::uint16_t>(ofs, channelCount * bytesPerSample);
+		writeValue<std::uint16_t>(ofs, bytesPerSample * 8);
+		ofs.write("data", 4);
+		writeValue<std::uint32_t>(ofs, dataSize);
+
+		for (std::uint32_t frame {}; frame < sampleRate * durationSeconds; ++frame)
+		{
+			const std::int16_t sample {static_cast<std::int16_t>(16384 * std::sin(2. * M_PI * 1000. * frame / sampleRate))};
+			writeValue(ofs, sample);
+			writeValue(ofs, sample);
+		}
+	}
+
+	std::vector<std::byte> readAll(ITranscoder& transcoder)
+	{
+		std::vector<std::byte> res;
+		std::vector<std::byte> buffer(4096);
+
+		while (!transcoder.finished())
+		{
+			std::promise<std::size_t> promise;
+			transcoder.asyncRead(buffer.data(), buffer.size(), [&](std::size_t nbReadBytes) { promise.set_value(nbReadBytes); });
+
+			const std::size_t nbReadBytes {promise.get_future().get()};
+			res.insert(std::cend(res), std::cbegin(buffer), std::next(std::cbegin(buffer), nbReadBytes));
+		}
+
+		return res;
+	}
+
+	class LibavTranscoderTest : public ::testing::Test
+	{
+		protected:
+			void SetUp() override
+			{
+				// no setting: defaults are used
+				const std::filesystem::path configPath {_tmpDirectory.getPath() / "lms.conf"};
+				std::ofstream {configPath};
+				_config.assign(createConfig(configPath));
+
+				_trackPath = _tmpDirectory.getPath() / "track.wav";
+				writeWav(_trackPath, 44100, 5);
+			}
+
+			TmpDirectory			_tmpDirectory;
+			Service<IConfig>		_config;
+			std::filesystem::path	_trackPath;
+	};
+}
+
+// The native AAC encoder is always available
+TEST_F(LibavTranscoderTest, FullOutput)
+{
+	TranscodeParameters parameters;
+	parameters.format = Format::MPEGTS_AAC;
+
+	const std::unique_ptr<ITranscoder> transcoder {std::make_unique<LibavTranscoder>(_trackPath, parameters)};
+	const std::vector<std::byte> output {readAll(*transcoder)};
+
+	EXPECT_TRUE(transcoder->succeeded());
+	// about 5 seconds at 128kbps, plus the container overhead
+	ASSERT_GT(output.size(), 60'000u);
+	EXPECT_LT(output.size(), 120'000u);
+	// MPEG-TS packets start with a sync byte
+	EXPECT_EQ(output.front(), std::byte {0x47});
+	EXPECT_EQ(output.size() % 188, 0u);
+}
+
+TEST_F(LibavTranscoderTest, Segment)
+{
+	TranscodeParameters parameters;
+	parameters.format = Format::MPEGTS_AAC;
+	parameters.offset = std::chrono::seconds {2};
+	parameters.duration = std::chrono::seconds {1};
+
+	const std::unique_ptr<ITranscoder> transcoder {std::make_unique<LibavTranscoder>(_trackPath, parameters)};
+	const std::vector<std::byte> output {readAll(*transcoder)};
+
+	EXPECT_TRUE(transcoder->succeeded());
+	ASSERT_GT(output.size(), 10'000u);
+	EXPECT_LT(output.size(), 40'000u);
+}
+
+TEST_F(LibavTranscoderTest, BadInput)
+{
+	TranscodeParameters parameters;
+	parameters.format = Format::MPEGTS_AAC;
+
+	EXPECT_THROW(LibavTranscoder(_tmpDirectory.getPath() / "missing.wav", parameters), Exception);
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <cmath>
+#include <vector>
+#include <gtest/gtest.h>
+#include "av/LoudnessMeter.hpp"
+
+using namespace Av;
+
+namespace
+{
+	// Stereo 1kHz sine, level is the peak level
+	void addSine(LoudnessMeter& meter, std::size_t sampleRate, double levelDbFS, std::size_t durationSeconds)
+	{
+		const double amplitude {std::pow(10., levelDbFS / 20.)};
+
+		std::vector<float> samples(sampleRate * 2);
+		for (std::size_t second {}; second < durationSeconds; ++second)
+		{
+			for (std::size_t frame {}; frame < sampleRate; ++frame)
+			{
+				const float sample {static_cast<float>(amplitude * std::sin(2. * M_PI * 1000. * frame / sampleRate))};
+				samples[frame * 2] = sample;
+				samples[frame * 2 + 1] = sample;
+			}
+
+			meter.addSamples(samples.data(), sampleRate);
+		}
+	}
+}
+
+// Test cases from EBU Tech 3341
+TEST(LoudnessMeter, Sine)
+{
+	for (const std::size_t sampleRate : {44100, 48000})
+	{
+		for (const double level : {-23., -33.})
+		{
+			LoudnessMeter meter {2, sampleRate};
+			addSine(meter, sampleRate, level, 20);
+
+			const std::optional<double> loudness {meter.getIntegratedLoudness()};
+			ASSERT_TRUE(loudness);
+			EXPECT_NEAR(*loudness, level, 0.1) << "sample rate = " << sampleRate;
+			EXPECT_NEAR(meter.getSamplePeak(), std::pow(10., level / 20.), 0.001);
+		}
+	}
+}
+
+TEST(LoudnessMeter, RelativeGate)
+{
+	LoudnessMeter meter {2, 48000};
+	addSine(meter, 48000, -36, 10);
+	addSine(meter, 48000, -23, 60);
+	addSine(meter, 48000, -36, 10);
+
+	const std::optional<double> loudness {meter.getIntegratedLoudness()};
+	ASSERT_TRUE(loudness);
+	EXPECT_NEAR(*loudness, -23., 0.1);
+}
+
+TEST(LoudnessMeter, AbsoluteGate)
+{
+	LoudnessMeter meter {2, 48000};
+	addSine(meter, 48000, -72, 10);
+	addSine(meter, 48000, -23, 10);
+
+	const std::optional<double> loudness {meter.getIntegratedLoudness()};
+	ASSERT_TRUE(loudness);
+	EXPECT_NEAR(*loudness, -23., 0.1);
+}
+
+TEST(LoudnessMeter, Silence)
+{
+	LoudnessMeter meter {1, 48000};
+
+	const std::vector<float> samples(48000 * 10);
+	meter.addSamples(samples.data(), 48000 * 10);
+
+	EXPECT_FALSE(meter.getIntegratedLoudness());
+	EXPECT_EQ(meter.getSamplePeak(), 0);
+}
+
+TEST(LoudnessMeter, TooShort)
+{
+	LoudnessMeter meter {1, 48000};
+
+	const std::vector<float> samples(48000 / 4, 0.5f);
+	meter.addSamples(samples.data(), samples.size());
+
+	EXPECT_FALSE(meter.getIntegratedLoudness());
+}
+
@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <atomic>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "av/ITranscodeCache.hpp"
+#include "av/TranscodeParameters.hpp"
+
+using namespace Av;
+
+namespace
+{
+	class TranscodeCacheTest : public ::testing::Test
+	{
+		protected:
+			void SetUp() override
+			{
+				const ::testing::TestInfo* testInfo {::testing::UnitTest::GetInstance()->current_test_info()};
+				_directory = std::filesystem::temp_directory_path() / (std::string {"lms-test-"} + testInfo->test_suite_name() + "-" + testInfo->name());
+				std::filesystem::remove_all(_directory);
+				std::filesystem::create_directories(_directory / "tracks");
+
+				_parameters.format = Format::OGG_OPUS;
+			}
+
+			void TearDown() override
+			{
+				std::error_code ec;
+				std::filesystem::remove_all(_directory, ec);
+			}
+
+			// Entries are named after the track file identity, so the track must exist
+			std::filesystem::path createTrack(std::string_view name)
+			{
+				const std::filesystem::path trackPath {_directory / "tracks" / name};
+				std::ofstream ofs {trackPath};
+				ofs << name;
+
+				return trackPath;
+			}
+
+			std::filesystem::path getCacheDirectory() const { return _directory / "cache"; }
+
+			std::filesystem::path _directory;
+			TranscodeParameters _parameters;
+	};
+
+	bool
+	put(ITranscodeCache& cache, const std::filesystem::path& trackPath, const TranscodeParameters& parameters, std::string_view content)
+	{
+		std::unique_ptr<ITranscodeCache::IEntryWriter> writer {cache.createEntryWriter(trackPath, parameters)};
+		if (!writer)
+			return false;
+
+		writer->write(reinterpret_cast<const std::byte*>(content.data()), content.size());
+		writer->commit();
+
+		return true;
+	}
+
+	std::string
+	readFile(const std::filesystem::path& path)
+	{
+		std::ifstream ifs {path, std::ios::binary};
+		return std::string {std::istreambuf_iterator<char> {ifs}, std::istreambuf_iterator<char> {}};
+	}
+}
+
+TEST_F(TranscodeCacheTest, PutGet)
+{
+	auto cache {createTranscodeCache(getCacheDirectory(), 100)};
+	const std::filesystem::path track {createTrack("track")};
+
+	EXPECT_FALSE(cache->getEntry(track, _parameters));
+	EXPECT_TRUE(put(*cache, track, _parameters, "transcoded"));
+
+	std::unique_ptr<ITranscodeCache::IEntry> entry {cache->getEntry(track, _parameters)};
+	ASSERT_TRUE(entry);
+	EXPECT_EQ(readFile(entry->getPath()), "transcoded");
+
+	// Other parameters: other entry
+	TranscodeParameters otherParameters {_parameters};
+	otherParameters.bitrate = 64000;
+	EXPECT_FALSE(cache->contains(track, otherParameters));
+}
+
+TEST_F(TranscodeCacheTest, Eviction)
+{
+	auto cache {createTranscodeCache(getCacheDirectory(), 30)};
+	const std::filesystem::path track1 {createTrack("track1")};
+	const std::filesystem::path track2 {createTrack("track2")};
+	const std::filesystem::path track3 {createTrack("track3")};
+	const std::filesystem::path track4 {createTrack("track4")};
+
+	EXPECT_TRUE(put(*cache, track1, _parameters, "0123456789"));
+	EXPECT_TRUE(put(*cache, track2, _parameters, "0123456789"));
+	EXPECT_TRUE(put(*cache, track3, _parameters, "0123456789"));
+
+	// track1 becomes the most recently used entry
+	EXPECT_TRUE(cache->getEntry(track1, _parameters));
+
+	EXPECT_TRUE(put(*cache, track4, _parameters, "0123456789"));
+	EXPECT_TRUE(cache->contains(track1, _parameters));
+	EXPECT_FALSE(cache->contains(track2, _parameters));
+	EXPECT_TRUE(cache->contains(track3, _parameters));
+	EXPECT_TRUE(cache->contains(track4, _parameters));
+
+	const ITranscodeCache::Stats stats {cache->getStats()};
+	EXPECT_EQ(stats.entryCount, 3);
+	EXPECT_LE(stats.size, 30);
+}
+
+TEST_F(TranscodeCacheTest, ServedEntryNotEvicted)
+{
+	auto cache {createTranscodeCache(getCacheDirectory(), 10)};
+	const std::filesystem::path track1 {createTrack("track1")};
+	const std::filesystem::path track2 {createTrack("track2")};
+
+	EXPECT_TRUE(put(*cache, track1, _parameters, "0123456789"));
+	{
+		std::unique_ptr<ITranscodeCache::IEntry> entry {cache->getEntry(track1, _parameters)};
+		ASSERT_TRUE(entry);
+
+		EXPECT_TRUE(put(*cache, track2, _parameters, "0123456789"));
+		EXPECT_EQ(readFile(entry->getPath()), "0123456789");
+	}
+
+	EXPECT_LE(cache->getStats().size, 10);
+}
+
+TEST_F(TranscodeCacheTest, ConcurrentPut)
+{
+	auto cache {createTranscodeCache(getCacheDirectory(), 1000)};
+	const std::filesystem::path track {createTrack("track")};
+
+	constexpr std::size_t threadCount {8};
+	std::atomic<std::size_t> writerCount {};
+	std::vector<std::thread> threads;
+	for (std::size_t i {}; i < threadCount; ++i)
+	{
+		threads.emplace_back([&, i]
+		{
+			if (put(*cache, track, _parameters, "transcoded by " + std::to_string(i)))
+				writerCount++;
+		});
+	}
+
+	for (std::thread& thread : threads)
+		thread.join();
+
+	// Only the first writer fills the cache, whether the others come before or after its commit
+	EXPECT_EQ(writerCount, 1);
+	EXPECT_EQ(cache->getStats().entryCount, 1);
+
+	std::unique_ptr<ITranscodeCache::IEntry> entry {cache->getEntry(track, _parameters)};
+	ASSERT_TRUE(entry);
+	EXPECT_EQ(readFile(entry->getPath()).rfind("transcoded by ", 0), 0);
+
+	// Writing an already cached entry is refused
+	EXPECT_FALSE(cache->createEntryWriter(track, _parameters));
+}
+
+TEST_F(TranscodeCacheTest, ConcurrentWriters)
+{
+	auto cache {createTranscodeCache(getCacheDirectory(), 1000)};
+	const std::filesystem::path track {createTrack("track")};
+
+	std::unique_ptr<ITranscodeCache::IEntryWriter> writer1 {cache->createEntryWriter(track, _parameters)};
+	ASSERT_TRUE(writer1);
+
+	// Only the first one fills the cache
+	EXPECT_FALSE(cache->createEntryWriter(track, _parameters));
+
+	writer1->write(reinterpret_cast<const std::byte*>("first"), 5);
+	writer1->commit();
+
+	std::unique_ptr<ITranscodeCache::IEntry> entry {cache->getEntry(track, _parameters)};
+	ASSERT_TRUE(entry);
+	EXPECT_EQ(readFile(entry->getPath()), "first");
+}
+
+TEST_F(TranscodeCacheTest, PartialEntryNeverServed)
+{
+	const std::filesystem::path track {createTrack("track")};
+
+	{
+		auto cache {createTranscodeCache(getCacheDirectory(), 1000)};
+		{
+			std::unique_ptr<ITranscodeCache::IEntryWriter> writer {cache->createEntryWriter(track, _parameters)};
+			ASSERT_TRUE(writer);
+			writer->write(reinterpret_cast<const std::byte*>("partial"), 7);
+
+			EXPECT_FALSE(cache->getEntry(track, _parameters));
+			EXPECT_FALSE(cache->contains(track, _parameters));
+		}
+
+		// Not committed
+		EXPECT_FALSE(cache->getEntry(track, _parameters));
+		EXPECT_TRUE(std::filesystem::is_empty(getCacheDirectory()));
+	}
+
+	// Leftover of a crash while writing
+	{
+		std::ofstream ofs {getCacheDirectory() / "0123456789abcdef.tmp"};
+		ofs << "partial";
+	}
+
+	auto cache {createTranscodeCache(getCacheDirectory(), 1000)};
+	EXPECT_EQ(cache->getStats().entryCount, 0);
+	EXPECT_FALSE(cache->getEntry(track, _parameters));
+	EXPECT_TRUE(std::filesystem::is_empty(getCacheDirectory()));
+}
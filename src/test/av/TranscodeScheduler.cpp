@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include "av/ITranscodeScheduler.hpp"
+
+using namespace Av;
+
+TEST(TranscodeScheduler, StartRightAway)
+{
+	auto scheduler {createTranscodeScheduler(2)};
+
+	bool callbackCalled {};
+	auto job1 {scheduler->createJob(TranscodePriority::Normal, [&] { callbackCalled = true; })};
+	auto job2 {scheduler->createJob(TranscodePriority::Normal, [&] { callbackCalled = true; })};
+
+	EXPECT_TRUE(job1->isRunning());
+	EXPECT_TRUE(job2->isRunning());
+	EXPECT_FALSE(callbackCalled);
+
+	const ITranscodeScheduler::Stats stats {scheduler->getStats()};
+	EXPECT_EQ(stats.runningJobCount, 2);
+	EXPECT_EQ(stats.queuedJobCount, 0);
+	EXPECT_EQ(stats.startedJobCount, 2);
+}
+
+TEST(TranscodeScheduler, Queue)
+{
+	auto scheduler {createTranscodeScheduler(1)};
+
+	auto job1 {scheduler->createJob(TranscodePriority::Normal, [] {})};
+	ASSERT_TRUE(job1->isRunning());
+
+	bool job2Started {};
+	auto job2 {scheduler->createJob(TranscodePriority::Normal, [&] { job2Started = true; })};
+	EXPECT_FALSE(job2->isRunning());
+	EXPECT_EQ(scheduler->getStats().queuedJobCount, 1);
+
+	job1.reset();
+	EXPECT_TRUE(job2Started);
+	EXPECT_TRUE(job2->isRunning());
+	EXPECT_EQ(scheduler->getStats().queuedJobCount, 0);
+	EXPECT_EQ(scheduler->getStats().runningJobCount, 1);
+}
+
+TEST(TranscodeScheduler, Priorities)
+{
+	auto scheduler {createTranscodeScheduler(1)};
+
+	auto job {scheduler->createJob(TranscodePriority::Normal, [] {})};
+
+	std::vector<TranscodePriority> startedJobs;
+	auto lowJob {scheduler->createJob(TranscodePriority::Low, [&] { startedJobs.push_back(TranscodePriority::Low); })};
+	auto normalJob {scheduler->createJob(TranscodePriority::Normal, [&] { startedJobs.push_back(TranscodePriority::Normal); })};
+	auto highJob {scheduler->createJob(TranscodePriority::High, [&] { startedJobs.push_back(TranscodePriority::High); })};
+
+	job.reset();
+	ASSERT_EQ(startedJobs.size(), 1);
+	EXPECT_EQ(startedJobs.back(), TranscodePriority::High);
+
+	highJob.reset();
+	ASSERT_EQ(startedJobs.size(), 2);
+	EXPECT_EQ(startedJobs.back(), TranscodePriority::Normal);
+
+	normalJob.reset();
+	ASSERT_EQ(startedJobs.size(), 3);
+	EXPECT_EQ(startedJobs.back(), TranscodePriority::Low);
+}
+
+TEST(TranscodeScheduler, Cancel)
+{
+	auto scheduler {createTranscodeScheduler(1)};
+
+	auto job1 {scheduler->createJob(TranscodePriority::Normal, [] {})};
+
+	bool job2Started {};
+	auto job2 {scheduler->createJob(TranscodePriority::Normal, [&] { job2Started = true; })};
+	job2.reset();
+	EXPECT_EQ(scheduler->getStats().cancelledJobCount, 1);
+
+	job1.reset();
+	EXPECT_FALSE(job2Started);
+	EXPECT_EQ(scheduler->getStats().runningJobCount, 0);
+
+	// slot is available again
+	auto job3 {scheduler->createJob(TranscodePriority::Normal, [] {})};
+	EXPECT_TRUE(job3->isRunning());
+}
+
+TEST(TranscodeScheduler, Concurrency)
+{
+	constexpr std::size_t maxRunningJobCount {3};
+	auto scheduler {createTranscodeScheduler(maxRunningJobCount)};
+
+	std::atomic<std::size_t> runningJobCount {};
+	std::atomic<std::size_t> maxObservedRunningJobCount {};
+
+	auto runJob {[&]
+	{
+		auto job {scheduler->createJob(TranscodePriority::Normal, [] {})};
+		while (!job->isRunning())
+			std::this_thread::yield();
+
+		const std::size_t count {++runningJobCount};
+		std::size_t maxCount {maxObservedRunningJobCount};
+		while (count > maxCount && !maxObservedRunningJobCount.compare_exchange_weak(maxCount, count))
+			;
+
+		std::this_thread::sleep_for(std::chrono::milliseconds {1});
+		--runningJobCount;
+	}};
+
+	std::vector<std::thread> threads;
+	for (std::size_t i {}; i < 16; ++i)
+		threads.emplace_back([&] { for (std::size_t j {}; j < 10; ++j) runJob(); });
+
+	for (std::thread& thread : threads)
+		thread.join();
+
+	EXPECT_LE(maxObservedRunningJobCount, maxRunningJobCount);
+
+	const ITranscodeScheduler::Stats stats {scheduler->getStats()};
+	EXPECT_EQ(stats.startedJobCount, 160);
+	EXPECT_EQ(stats.runningJobCount, 0);
+	EXPECT_EQ(stats.queuedJobCount, 0);
+}
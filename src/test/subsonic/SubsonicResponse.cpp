@@ -0,0 +1,271 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <sstream>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/xml_parser.hpp>
+#include <gtest/gtest.h>
+#include <Wt/Json/Array.h>
+#include <Wt/Json/Object.h>
+#include <Wt/Json/Serializer.h>
+#include <Wt/Json/Value.h>
+
+#include "SubsonicResponse.hpp"
+
+// The responses are streamed by hand: they must be byte-identical to
+// what the boost property tree and the Wt JSON serializers produce
+using namespace API::Subsonic;
+namespace Json = Wt::Json;
+
+namespace
+{
+	const ProtocolVersion protocolVersion {1, 16, 0};
+
+	const std::string specialChars {"Rock & Roll <\"Live\"> 'n' \\ stuff"};
+	const std::string controlChars {"first line\nsecond\tline"};
+
+	std::string
+	write(Response& response, ResponseFormat format)
+	{
+		std::ostringstream oss;
+		response.write(oss, format);
+		return oss.str();
+	}
+
+	Response
+	createResponse()
+	{
+		Response response {Response::createOkResponse(protocolVersion)};
+
+		{
+			Response::Node& album {response.createNode("album")};
+			album.setAttribute("id", "al-1");
+			album.setAttribute("name", specialChars);
+			album.setAttribute("comment", controlChars);
+			album.setAttribute("year", 1999);
+			album.setAttribute("offset", -5);
+			album.setAttribute("starred", true);
+
+			Response::Node& song1 {album.createArrayChild("song")};
+			song1.setAttribute("id", "tr-1");
+			song1.setAttribute("title", "   ");
+			song1.setAttribute("isDir", false);
+
+			Response::Node& song2 {album.createArrayChild("song")};
+			song2.setAttribute("id", "tr-2");
+			song2.setAttribute("title", "");
+		}
+
+		// Empty list
+		response.createNode("playlists");
+
+		// Duplicate keys
+		response.createNode("directory").setAttribute("id", "dir-1");
+		response.createNode("directory").setAttribute("id", "dir-2");
+
+		{
+			Response::Node& genre {response.createArrayNode("genre")};
+			genre.setAttribute("songCount", 3);
+			genre.setValue(specialChars);
+		}
+		response.createArrayNode("genre").setValue(controlChars);
+
+		response.createNode("lyrics").setValue("");
+		response.createNode("count").setValue(42);
+
+		return response;
+	}
+}
+
+TEST(SubsonicResponse, xml)
+{
+	namespace pt = boost::property_tree;
+
+	// Attributes and children are written sorted by key, then children arrays
+	pt::ptree expected;
+	pt::ptree& root {expected.add_child("subsonic-response", pt::ptree {})};
+	root.put("<xmlattr>.status", "ok");
+	root.put("<xmlattr>.version", "1.16.0");
+	{
+		pt::ptree album;
+		album.put("<xmlattr>.comment", controlChars);
+		album.put("<xmlattr>.id", "al-1");
+		album.put("<xmlattr>.name", specialChars);
+		album.put("<xmlattr>.offset", -5LL);
+		album.put("<xmlattr>.starred", true);
+		album.put("<xmlattr>.year", 1999LL);
+
+		pt::ptree song1;
+		song1.put("<xmlattr>.id", "tr-1");
+		song1.put("<xmlattr>.isDir", false);
+		song1.put("<xmlattr>.title", "   ");
+		album.add_child("song", song1);
+
+		pt::ptree song2;
+		song2.put("<xmlattr>.id", "tr-2");
+		song2.put("<xmlattr>.title", "");
+		album.add_child("song", song2);
+
+		root.add_child("album", album);
+	}
+	{
+		pt::ptree count;
+		count.put_value(42LL);
+		root.add_child("count", count);
+	}
+	{
+		pt::ptree directory1;
+		directory1.put("<xmlattr>.id", "dir-1");
+		root.add_child("directory", directory1);
+
+		pt::ptree directory2;
+		directory2.put("<xmlattr>.id", "dir-2");
+		root.add_child("directory", directory2);
+	}
+	{
+		pt::ptree lyrics;
+		lyrics.put_value("");
+		root.add_child("lyrics", lyrics);
+	}
+	root.add_child("playlists", pt::ptree {});
+	{
+		pt::ptree genre1;
+		genre1.put("<xmlattr>.songCount", 3LL);
+		genre1.put_value(specialChars);
+		root.add_child("genre", genre1);
+
+		pt::ptree genre2;
+		genre2.put_value(controlChars);
+		root.add_child("genre", genre2);
+	}
+
+	std::ostringstream oss;
+	pt::write_xml(oss, expected);
+
+	Response response {createResponse()};
+	EXPECT_EQ(write(response, ResponseFormat::xml), oss.str());
+}
+
+TEST(SubsonicResponse, json)
+{
+	// Only the last child is kept in case of duplicate keys
+	Json::Object root;
+	root["status"] = Json::Value {std::string {"ok"}};
+	root["version"] = Json::Value {std::string {"1.16.0"}};
+	{
+		Json::Object album;
+		album["comment"] = Json::Value {controlChars};
+		album["id"] = Json::Value {std::string {"al-1"}};
+		album["name"] = Json::Value {specialChars};
+		album["offset"] = Json::Value {-5LL};
+		album["starred"] = Json::Value {true};
+		album["year"] = Json::Value {1999LL};
+
+		Json::Object song1;
+		song1["id"] = Json::Value {std::string {"tr-1"}};
+		song1["isDir"] = Json::Value {false};
+		song1["title"] = Json::Value {std::string {"   "}};
+
+		Json::Object song2;
+		song2["id"] = Json::Value {std::string {"tr-2"}};
+		song2["title"] = Json::Value {std::string {""}};
+
+		Json::Array songs;
+		songs.emplace_back(std::move(song1));
+		songs.emplace_back(std::move(song2));
+		album["song"] = std::move(songs);
+
+		root["album"] = std::move(album);
+	}
+	{
+		Json::Object count;
+		count["value"] = Json::Value {42LL};
+		root["count"] = std::move(count);
+	}
+	{
+		Json::Object directory;
+		directory["id"] = Json::Value {std::string {"dir-2"}};
+		root["directory"] = std::move(directory);
+	}
+	{
+		Json::Object genre1;
+		genre1["songCount"] = Json::Value {3LL};
+		genre1["value"] = Json::Value {specialChars};
+
+		Json::Object genre2;
+		genre2["value"] = Json::Value {controlChars};
+
+		Json::Array genres;
+		genres.emplace_back(std::move(genre1));
+		genres.emplace_back(std::move(genre2));
+		root["genre"] = std::move(genres);
+	}
+	{
+		Json::Object lyrics;
+		lyrics["value"] = Json::Value {std::string {""}};
+		root["lyrics"] = std::move(lyrics);
+	}
+	root["playlists"] = Json::Object {};
+
+	Json::Object expected;
+	expected["subsonic-response"] = std::move(root);
+
+	Response response {createResponse()};
+	EXPECT_EQ(write(response, ResponseFormat::json), Json::serialize(expected));
+}
+
+TEST(SubsonicResponse, failed)
+{
+	namespace pt = boost::property_tree;
+
+	const std::string message {"The requested data was not found."};
+
+	pt::ptree expectedXML;
+	{
+		pt::ptree& root {expectedXML.add_child("subsonic-response", pt::ptree {})};
+		root.put("<xmlattr>.status", "failed");
+		root.put("<xmlattr>.version", "1.16.0");
+
+		pt::ptree error;
+		error.put("<xmlattr>.code", "70");
+		error.put("<xmlattr>.message", message);
+		root.add_child("error", error);
+	}
+	std::ostringstream oss;
+	pt::write_xml(oss, expectedXML);
+
+	Json::Object expectedJSON;
+	{
+		Json::Object root;
+		root["status"] = Json::Value {std::string {"failed"}};
+		root["version"] = Json::Value {std::string {"1.16.0"}};
+
+		Json::Object error;
+		error["code"] = Json::Value {std::string {"70"}};
+		error["message"] = Json::Value {message};
+		root["error"] = std::move(error);
+
+		expectedJSON["subsonic-response"] = std::move(root);
+	}
+
+	Response response {Response::createFailedResponse(protocolVersion, RequestedDataNotFoundError {})};
+	EXPECT_EQ(write(response, ResponseFormat::xml), oss.str());
+	EXPECT_EQ(write(response, ResponseFormat::json), Json::serialize(expectedJSON));
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "utils/BufferPool.hpp"
+
+TEST(BufferPool, Reuse)
+{
+	BufferPool pool {1024, 2};
+	EXPECT_EQ(pool.getBufferSize(), 1024);
+
+	const std::byte* bufferData {};
+	{
+		BufferPool::Buffer buffer {pool.acquire()};
+		ASSERT_TRUE(buffer);
+		bufferData = buffer.get();
+		buffer[1023] = std::byte {42};
+
+		EXPECT_EQ(pool.getStats().usedBufferCount, 1);
+		EXPECT_EQ(pool.getStats().freeBufferCount, 0);
+	}
+	EXPECT_EQ(pool.getStats().usedBufferCount, 0);
+	EXPECT_EQ(pool.getStats().freeBufferCount, 1);
+
+	BufferPool::Buffer buffer {pool.acquire()};
+	EXPECT_EQ(buffer.get(), bufferData);
+	EXPECT_EQ(pool.getStats().freeBufferCount, 0);
+}
+
+TEST(BufferPool, MaxFreeBufferCount)
+{
+	BufferPool pool {1024, 2};
+
+	{
+		std::vector<BufferPool::Buffer> buffers;
+		for (std::size_t i {}; i < 5; ++i)
+			buffers.push_back(pool.acquire());
+
+		EXPECT_EQ(pool.getStats().usedBufferCount, 5);
+	}
+
+	EXPECT_EQ(pool.getStats().usedBufferCount, 0);
+	EXPECT_EQ(pool.getStats().freeBufferCount, 2);
+}
+
+TEST(BufferPool, MultiThreads)
+{
+	BufferPool pool {64, 4};
+
+	std::vector<std::thread> threads;
+	for (std::size_t i {}; i < 8; ++i)
+	{
+		threads.emplace_back([&]
+		{
+			for (std::size_t j {}; j < 1000; ++j)
+			{
+				BufferPool::Buffer buffer {pool.acquire()};
+				buffer[0] = std::byte {1};
+			}
+		});
+	}
+
+	for (std::thread& thread : threads)
+		thread.join();
+
+	EXPECT_EQ(pool.getStats().usedBufferCount, 0);
+	EXPECT_LE(pool.getStats().freeBufferCount, 4);
+}
+
@@ -0,0 +1,233 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <fstream>
+#include <string>
+#include <string_view>
+
+#include <gtest/gtest.h>
+
+#include "utils/DiskLruCache.hpp"
+
+namespace
+{
+	class DiskLruCacheTest : public ::testing::Test
+	{
+		protected:
+			void SetUp() override
+			{
+				const ::testing::TestInfo* testInfo {::testing::UnitTest::GetInstance()->current_test_info()};
+				_directory = std::filesystem::temp_directory_path() / (std::string {"lms-test-"} + testInfo->test_suite_name() + "-" + testInfo->name());
+				std::filesystem::remove_all(_directory);
+			}
+
+			void TearDown() override
+			{
+				std::error_code ec;
+				std::filesystem::remove_all(_directory, ec);
+			}
+
+			std::filesystem::path _directory;
+	};
+
+	bool
+	put(DiskLruCache& cache, const DiskLruCache::EntryName& entryName, std::string_view content, std::string_view extension = "")
+	{
+		std::unique_ptr<DiskLruCache::Writer> writer {cache.createWriter(entryName, extension)};
+		if (!writer)
+			return false;
+
+		writer->write(reinterpret_cast<const std::byte*>(content.data()), content.size());
+		return writer->commit();
+	}
+
+	std::optional<std::string>
+	get(DiskLruCache& cache, const DiskLruCache::EntryName& entryName)
+	{
+		const std::optional<DiskLruCache::EntryInfo> entryInfo {cache.pin(entryName)};
+		if (!entryInfo)
+			return std::nullopt;
+
+		std::ifstream ifs {entryInfo->path, std::ios::binary};
+		std::string content(entryInfo->size, '\0');
+		ifs.read(content.data(), content.size());
+		cache.unpin(entryName);
+
+		return content;
+	}
+
+	void
+	writeFile(const std::filesystem::path& path, std::string_view content)
+	{
+		std::ofstream ofs {path, std::ios::binary};
+		ofs << content;
+	}
+}
+
+TEST_F(DiskLruCacheTest, PutGet)
+{
+	DiskLruCache cache {_directory, 100};
+
+	EXPECT_FALSE(get(cache, "a"));
+	EXPECT_FALSE(cache.contains("a"));
+
+	EXPECT_TRUE(put(cache, "a", "content_a"));
+	EXPECT_TRUE(put(cache, "b", "content_b", ".ext"));
+
+	EXPECT_TRUE(cache.contains("a"));
+	EXPECT_EQ(get(cache, "a"), "content_a");
+	EXPECT_EQ(get(cache, "b"), "content_b");
+	EXPECT_TRUE(std::filesystem::exists(_directory / "b.ext"));
+
+	const DiskLruCache::Stats stats {cache.getStats()};
+	EXPECT_EQ(stats.entryCount, 2);
+	EXPECT_EQ(stats.size, 18);
+	EXPECT_EQ(stats.hits, 2);
+	EXPECT_EQ(stats.misses, 1);
+}
+
+TEST_F(DiskLruCacheTest, Reload)
+{
+	{
+		DiskLruCache cache {_directory, 100};
+		EXPECT_TRUE(put(cache, "a", "content_a", ".ext"));
+	}
+
+	DiskLruCache cache {_directory, 100};
+	EXPECT_EQ(cache.getStats().entryCount, 1);
+	EXPECT_EQ(get(cache, "a"), "content_a");
+}
+
+TEST_F(DiskLruCacheTest, Eviction)
+{
+	DiskLruCache cache {_directory, 30};
+
+	EXPECT_TRUE(put(cache, "a", "0123456789"));
+	EXPECT_TRUE(put(cache, "b", "0123456789"));
+	EXPECT_TRUE(put(cache, "c", "0123456789"));
+
+	// a becomes the most recently used entry
+	EXPECT_TRUE(get(cache, "a"));
+
+	EXPECT_TRUE(put(cache, "d", "0123456789"));
+	EXPECT_TRUE(cache.contains("a"));
+	EXPECT_FALSE(cache.contains("b"));
+	EXPECT_TRUE(cache.contains("c"));
+	EXPECT_TRUE(cache.contains("d"));
+	EXPECT_FALSE(std::filesystem::exists(_directory / "b"));
+
+	EXPECT_TRUE(put(cache, "e", "0123456789"));
+	EXPECT_TRUE(cache.contains("a"));
+	EXPECT_FALSE(cache.contains("c"));
+	EXPECT_TRUE(cache.contains("d"));
+	EXPECT_TRUE(cache.contains("e"));
+
+	EXPECT_LE(cache.getStats().size, 30);
+}
+
+TEST_F(DiskLruCacheTest, PinnedEntryNotEvicted)
+{
+	DiskLruCache cache {_directory, 10};
+
+	EXPECT_TRUE(put(cache, "a", "0123456789"));
+	ASSERT_TRUE(cache.pin("a"));
+
+	EXPECT_TRUE(put(cache, "b", "0123456789"));
+	EXPECT_TRUE(cache.contains("a"));
+	EXPECT_FALSE(cache.contains("b"));
+
+	cache.unpin("a");
+	EXPECT_TRUE(put(cache, "c", "0123456789"));
+	EXPECT_FALSE(cache.contains("a"));
+	EXPECT_TRUE(cache.contains("c"));
+}
+
+TEST_F(DiskLruCacheTest, TmpFileIgnored)
+{
+	std::filesystem::create_directories(_directory);
+	writeFile(_directory / "a", "content_a");
+	writeFile(_directory / "b.tmp", "partial_b");
+	writeFile(_directory / "c.ext.tmp", "partial_c");
+
+	DiskLruCache cache {_directory, 100};
+	EXPECT_EQ(cache.getStats().entryCount, 1);
+	EXPECT_EQ(get(cache, "a"), "content_a");
+	EXPECT_FALSE(cache.contains("b"));
+	EXPECT_FALSE(cache.contains("c"));
+	EXPECT_FALSE(std::filesystem::exists(_directory / "b.tmp"));
+	EXPECT_FALSE(std::filesystem::exists(_directory / "c.ext.tmp"));
+}
+
+TEST_F(DiskLruCacheTest, ExtensionFilter)
+{
+	std::filesystem::create_directories(_directory);
+	writeFile(_directory / "a.good", "content_a");
+	writeFile(_directory / "b.bad", "content_b");
+
+	DiskLruCache cache {_directory, 100, [](std::string_view extension) { return extension == ".good"; }};
+	EXPECT_TRUE(cache.contains("a"));
+	EXPECT_FALSE(cache.contains("b"));
+	EXPECT_FALSE(std::filesystem::exists(_directory / "b.bad"));
+}
+
+TEST_F(DiskLruCacheTest, UncommittedEntryNotServed)
+{
+	DiskLruCache cache {_directory, 100};
+
+	{
+		std::unique_ptr<DiskLruCache::Writer> writer {cache.createWriter("a")};
+		ASSERT_TRUE(writer);
+		writer->write(reinterpret_cast<const std::byte*>("partial"), 7);
+
+		EXPECT_FALSE(cache.contains("a"));
+		EXPECT_FALSE(std::filesystem::exists(_directory / "a"));
+	}
+
+	EXPECT_FALSE(cache.contains("a"));
+	EXPECT_TRUE(std::filesystem::is_empty(_directory));
+
+	// Can be written again once aborted
+	EXPECT_TRUE(put(cache, "a", "content_a"));
+	EXPECT_EQ(get(cache, "a"), "content_a");
+}
+
+TEST_F(DiskLruCacheTest, KeyCollision)
+{
+	DiskLruCache cache {_directory, 100};
+
+	{
+		std::unique_ptr<DiskLruCache::Writer> writer1 {cache.createWriter("a")};
+		ASSERT_TRUE(writer1);
+
+		// Concurrent write of the same entry
+		EXPECT_FALSE(cache.createWriter("a"));
+		EXPECT_FALSE(cache.createWriter("a", ".ext"));
+
+		writer1->write(reinterpret_cast<const std::byte*>("first"), 5);
+		EXPECT_TRUE(writer1->commit());
+	}
+
+	// Already existing entry, whatever the extension
+	EXPECT_FALSE(put(cache, "a", "second"));
+	EXPECT_FALSE(put(cache, "a", "second", ".ext"));
+
+	EXPECT_EQ(get(cache, "a"), "first");
+	EXPECT_EQ(cache.getStats().entryCount, 1);
+}
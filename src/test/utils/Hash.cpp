@@ -0,0 +1,33 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <gtest/gtest.h>
+
+#include "utils/Hash.hpp"
+
+TEST(Hash, Fnv1a)
+{
+	// Reference values: entry names persisted on disk depend on them
+	EXPECT_EQ(Utils::computeFnv1aHash(""), 0xcbf29ce484222325);
+	EXPECT_EQ(Utils::computeFnv1aHash("a"), 0xaf63dc4c8601ec8c);
+	EXPECT_EQ(Utils::computeFnv1aHash("foobar"), 0x85944171f73967e8);
+
+	EXPECT_NE(Utils::computeFnv1aHash("ab"), Utils::computeFnv1aHash("ba"));
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "utils/LruCache.hpp"
+
+TEST(LruCache, GetPut)
+{
+	LruCache<int, std::string> cache {10, 1};
+
+	EXPECT_FALSE(cache.get(1));
+
+	cache.put(1, "one");
+	cache.put(2, "two");
+
+	ASSERT_TRUE(cache.get(1));
+	EXPECT_EQ(*cache.get(1), "one");
+	ASSERT_TRUE(cache.get(2));
+	EXPECT_EQ(*cache.get(2), "two");
+
+	cache.put(1, "new one");
+	ASSERT_TRUE(cache.get(1));
+	EXPECT_EQ(*cache.get(1), "new one");
+}
+
+TEST(LruCache, Eviction)
+{
+	LruCache<int, int> cache {2, 1};
+
+	cache.put(1, 1);
+	cache.put(2, 2);
+	EXPECT_TRUE(cache.get(1)); // 1 is now the most recently used
+
+	cache.put(3, 3);
+	EXPECT_TRUE(cache.get(1));
+	EXPECT_FALSE(cache.get(2));
+	EXPECT_TRUE(cache.get(3));
+	EXPECT_EQ(cache.getStats().entryCount, 2);
+}
+
+TEST(LruCache, Stats)
+{
+	LruCache<int, int> cache {100};
+
+	for (int i {}; i < 10; ++i)
+		cache.put(i, i);
+
+	for (int i {}; i < 20; ++i)
+		cache.get(i);
+
+	const auto stats {cache.getStats()};
+	EXPECT_EQ(stats.entryCount, 10);
+	EXPECT_EQ(stats.hits, 10);
+	EXPECT_EQ(stats.misses, 10);
+
+	cache.clear();
+	EXPECT_EQ(cache.getStats().entryCount, 0);
+	EXPECT_FALSE(cache.get(0));
+}
+
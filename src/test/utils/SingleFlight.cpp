@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "utils/SingleFlight.hpp"
+
+TEST(SingleFlight, Run)
+{
+	SingleFlight<int, int> singleFlight;
+
+	EXPECT_EQ(singleFlight.run(1, [] { return 42; }), 42);
+	EXPECT_EQ(singleFlight.run(1, [] { return 43; }), 43);
+	EXPECT_EQ(singleFlight.getCoalescedCallCount(), 0);
+}
+
+TEST(SingleFlight, Coalesce)
+{
+	SingleFlight<int, int> singleFlight;
+	std::atomic<std::size_t> runCount {};
+	std::atomic<bool> release {};
+
+	constexpr std::size_t threadCount {8};
+	std::vector<std::thread> threads;
+	std::vector<int> results(threadCount);
+	for (std::size_t i {}; i < threadCount; ++i)
+	{
+		threads.emplace_back([&, i]
+		{
+			results[i] = singleFlight.run(1, [&]
+			{
+				runCount++;
+				while (!release)
+					std::this_thread::yield();
+				return 42;
+			});
+		});
+	}
+
+	while (runCount == 0 || singleFlight.getCoalescedCallCount() != threadCount - 1)
+		std::this_thread::yield();
+	release = true;
+
+	for (std::thread& thread : threads)
+		thread.join();
+
+	EXPECT_EQ(runCount, 1);
+	for (int result : results)
+		EXPECT_EQ(result, 42);
+}
+
+TEST(SingleFlight, Exception)
+{
+	SingleFlight<int, int> singleFlight;
+
+	EXPECT_THROW(singleFlight.run(1, []() -> int { throw std::runtime_error {"failure"}; }), std::runtime_error);
+	EXPECT_EQ(singleFlight.run(1, [] { return 42; }), 42);
+}
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "utils/TinyLfuCache.hpp"
+
+TEST(TinyLfuCache, GetPut)
+{
+	TinyLfuCache<int, std::string> cache {10, 10, 1};
+
+	EXPECT_FALSE(cache.get(1));
+
+	cache.put(1, "one");
+	cache.put(2, "two");
+
+	ASSERT_TRUE(cache.get(1));
+	EXPECT_EQ(*cache.get(1), "one");
+	ASSERT_TRUE(cache.get(2));
+	EXPECT_EQ(*cache.get(2), "two");
+
+	cache.put(1, "new one");
+	ASSERT_TRUE(cache.get(1));
+	EXPECT_EQ(*cache.get(1), "new one");
+}
+
+TEST(TinyLfuCache, Admission)
+{
+	TinyLfuCache<int, int> cache {2, 10, 1};
+
+	for (int i {}; i < 5; ++i)
+	{
+		cache.get(1);
+		cache.get(2);
+	}
+	cache.put(1, 1);
+	cache.put(2, 2);
+
+	// One-off keys must not evict frequently accessed ones
+	for (int i {3}; i < 100; ++i)
+	{
+		EXPECT_FALSE(cache.get(i));
+		cache.put(i, i);
+	}
+
+	EXPECT_TRUE(cache.get(1));
+	EXPECT_TRUE(cache.get(2));
+	EXPECT_EQ(cache.getStats().entryCount, 2);
+	EXPECT_GT(cache.getStats().rejections, 0);
+
+	// Frequently accessed keys end up being admitted
+	for (int i {}; i < 10; ++i)
+		cache.get(100);
+	cache.put(100, 100);
+	EXPECT_TRUE(cache.get(100));
+	EXPECT_EQ(cache.getStats().evictions, 1);
+}
+
+TEST(TinyLfuCache, Weight)
+{
+	struct StringWeigher
+	{
+		std::size_t operator()(const std::string& str) const { return str.size(); }
+	};
+	TinyLfuCache<int, std::string, std::hash<int>, StringWeigher> cache {10, 10, 1};
+
+	cache.put(1, "12345");
+	cache.put(2, "12345");
+	EXPECT_EQ(cache.getStats().weight, 10);
+
+	// Too big
+	cache.put(3, "12345678901");
+	EXPECT_FALSE(cache.get(3));
+
+	for (int i {}; i < 5; ++i)
+		cache.get(4);
+	cache.put(4, "1234567");
+	EXPECT_TRUE(cache.get(4));
+	EXPECT_EQ(cache.getStats().entryCount, 1);
+	EXPECT_EQ(cache.getStats().weight, 7);
+}
+
+TEST(TinyLfuCache, Stats)
+{
+	TinyLfuCache<int, int> cache {100, 100};
+
+	for (int i {}; i < 10; ++i)
+		cache.put(i, i);
+
+	for (int i {}; i < 20; ++i)
+		cache.get(i);
+
+	const auto stats {cache.getStats()};
+	EXPECT_EQ(stats.entryCount, 10);
+	EXPECT_EQ(stats.hits, 10);
+	EXPECT_EQ(stats.misses, 10);
+
+	cache.clear();
+	EXPECT_EQ(cache.getStats().entryCount, 0);
+	EXPECT_FALSE(cache.get(0));
+}
@@ -0,0 +1,294 @@
+/*
+ * Copyright (C) 2021 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// Compares the SOM based similarity search used by the features classifier
+// with the HNSW index used by the ANN classifier, on synthetic clustered data
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <stdlib.h>
+#include <unordered_set>
+
+#include <boost/program_options.hpp>
+
+#include "ann/HnswIndex.hpp"
+#include "som/DataNormalizer.hpp"
+#include "som/Network.hpp"
+#include "utils/Logger.hpp"
+#include "utils/Service.hpp"
+#include "utils/StreamLogger.hpp"
+
+using Clock = std::chrono::steady_clock;
+using Neighbours = std::vector<std::size_t>;
+
+static
+std::vector<SOM::InputVector>
+generateSamples(std::size_t sampleCount, std::size_t dimCount, std::size_t clusterCount)
+{
+	std::mt19937 generator {42};
+	std::uniform_real_distribution<double> centerDist {0, 10};
+	std::normal_distribution<double> pointDist {0, 1};
+	std::uniform_int_distribution<std::size_t> clusterDist {0, clusterCount - 1};
+
+	std::vector<SOM::InputVector> centers(clusterCount, SOM::InputVector {dimCount});
+	for (SOM::InputVector& center : centers)
+	{
+		for (double& value : center)
+			value = centerDist(generator);
+	}
+
+	std::vector<SOM::InputVector> res;
+	res.reserve(sampleCount);
+	for (std::size_t i {}; i < sampleCount; ++i)
+	{
+		SOM::InputVector sample {centers[clusterDist(generator)]};
+		for (double& value : sample)
+			value += pointDist(generator);
+
+		res.emplace_back(std::move(sample));
+	}
+
+	SOM::DataNormalizer normalizer {dimCount};
+	normalizer.computeNormalizationFactors(res);
+	for (SOM::InputVector& sample : res)
+		normalizer.normalizeData(sample);
+
+	return res;
+}
+
+static
+std::vector<Neighbours>
+computeGroundTruth(const Ann::HnswIndex& index, const std::vector<std::size_t>& queryIds, std::size_t k)
+{
+	std::vector<Neighbours> res;
+	res.reserve(queryIds.size());
+
+	for (std::size_t queryId : queryIds)
+	{
+		Neighbours neighbours;
+		for (const Ann::HnswIndex::SearchResult& searchResult : index.searchExact(index.getValues(queryId), k + 1))
+		{
+			if (searchResult.id != queryId && neighbours.size() < k)
+				neighbours.push_back(searchResult.id);
+		}
+		res.emplace_back(std::move(neighbours));
+	}
+
+	return res;
+}
+
+struct Result
+{
+	double recall {};
+	double qps {};
+};
+
+template <typename SearchFunc>
+static
+Result
+benchmark(const std::vector<std::size_t>& queryIds, const std::vector<Neighbours>& groundTruth, std::size_t k, SearchFunc searchFunc)
+{
+	std::vector<Neighbours> results;
+	results.reserve(queryIds.size());
+
+	const Clock::time_point start {Clock::now()};
+	for (std::size_t queryId : queryIds)
+		results.emplace_back(searchFunc(queryId));
+	const std::chrono::duration<double> duration {Clock::now() - start};
+
+	std::size_t foundCount {};
+	for (std::size_t i {}; i < queryIds.size(); ++i)
+	{
+		const std::unordered_set<std::size_t> expected (std::cbegin(groundTruth[i]), std::cend(groundTruth[i]));
+		foundCount += std::count_if(std::cbegin(results[i]), std::cend(results[i]), [&](std::size_t id) { return expected.count(id) > 0; });
+	}
+
+	Result res;
+	res.recall = static_cast<double>(foundCount) / (queryIds.size() * k);
+	res.qps = duration.count() > 0 ? queryIds.size() / duration.count() : 0;
+
+	return res;
+}
+
+static
+void
+printResult(const std::string& name, const Result& result)
+{
+	std::cout << std::left << std::setw(24) << name
+		<< " recall = " << std::fixed << std::setprecision(3) << result.recall
+		<< ", QPS = " << std::setprecision(0) << result.qps << std::endl;
+}
+
+static
+std::vector<std::size_t>
+parseEfList(const std::string& str)
+{
+	std::vector<std::size_t> res;
+
+	std::istringstream iss {str};
+	std::string value;
+	while (std::getline(iss, value, ','))
+		res.push_back(std::stoul(value));
+
+	return res;
+}
+
+int main(int argc, char *argv[])
+{
+	try
+	{
+		namespace po = boost::program_options;
+
+		// log to stdout
+		Service<Logger> logger {std::make_unique<StreamLogger>(std::cout)};
+
+		po::options_description desc{"Allowed options"};
+		desc.add_options()
+		("help,h", "print usage message")
+		("samples", po::value<std::size_t>()->default_value(20000), "Number of samples (tracks)")
+		("dims", po::value<std::size_t>()->default_value(32), "Number of dimensions")
+		("clusters", po::value<std::size_t>()->default_value(100), "Number of clusters in generated data")
+		("queries", po::value<std::size_t>()->default_value(1000), "Number of queries")
+		("k", po::value<std::size_t>()->default_value(10), "Number of neighbours to search for")
+		("som-iterations", po::value<std::size_t>()->default_value(10), "SOM training iteration count")
+		("ann-max-links", po::value<std::size_t>()->default_value(16), "HNSW max links per node")
+		("ann-ef-construction", po::value<std::size_t>()->default_value(200), "HNSW ef used at construction time")
+		("ann-ef-search", po::value<std::string>()->default_value("16,32,64,128,256"), "HNSW ef values used at search time")
+		;
+
+		po::variables_map vm;
+		po::store(po::parse_command_line(argc, argv, desc), vm);
+
+		if (vm.count("help"))
+		{
+			std::cout << desc << std::endl;
+			return EXIT_SUCCESS;
+		}
+
+		const std::size_t sampleCount {vm["samples"].as<std::size_t>()};
+		const std::size_t dimCount {vm["dims"].as<std::size_t>()};
+		const std::size_t k {vm["k"].as<std::size_t>()};
+		if (sampleCount < 2 || dimCount == 0 || k == 0 || vm["clusters"].as<std::size_t>() == 0)
+			throw std::runtime_error {"Bad parameters"};
+
+		std::cout << "Generating " << sampleCount << " samples..." << std::endl;
+		const std::vector<SOM::InputVector> samples {generateSamples(sampleCount, dimCount, vm["clusters"].as<std::size_t>())};
+
+		std::vector<std::size_t> queryIds;
+		{
+			std::mt19937 generator {1337};
+			std::uniform_int_distribution<std::size_t> dist {0, sampleCount - 1};
+			for (std::size_t i {}; i < vm["queries"].as<std::size_t>(); ++i)
+				queryIds.push_back(dist(generator));
+		}
+
+		// HNSW
+		std::cout << "Building HNSW index..." << std::endl;
+		Ann::HnswIndex index {dimCount, Ann::HnswIndex::Settings {vm["ann-max-links"].as<std::size_t>(), vm["ann-ef-construction"].as<std::size_t>()}};
+		{
+			const Clock::time_point start {Clock::now()};
+			for (const SOM::InputVector& sample : samples)
+				index.add(std::vector<Ann::Value>(std::cbegin(sample), std::cend(sample)));
+			const std::chrono::duration<double> duration {Clock::now() - start};
+			std::cout << "HNSW index built in " << duration.count() << "s" << std::endl;
+		}
+
+		std::cout << "Computing ground truth..." << std::endl;
+		const std::vector<Neighbours> groundTruth {computeGroundTruth(index, queryIds, k)};
+
+		// SOM, same search as the features classifier
+		std::cout << "Training SOM..." << std::endl;
+		SOM::Coordinate size {std::max<SOM::Coordinate>(2, static_cast<SOM::Coordinate>(std::sqrt(sampleCount / 4.)))};
+		SOM::Network network {size, size, dimCount};
+		SOM::Matrix<Neighbours> matrix {size, size};
+		std::vector<SOM::Position> positions;
+		{
+			const Clock::time_point start {Clock::now()};
+			network.train(samples, vm["som-iterations"].as<std::size_t>());
+			positions.reserve(sampleCount);
+			for (std::size_t i {}; i < sampleCount; ++i)
+			{
+				positions.push_back(network.getClosestRefVectorPosition(samples[i]));
+				matrix[positions.back()].push_back(i);
+			}
+			const std::chrono::duration<double> duration {Clock::now() - start};
+			std::cout << "SOM (" << size << "x" << size << ") trained in " << duration.count() << "s" << std::endl;
+		}
+		const SOM::InputVector::Distance maxDistance {network.computeRefVectorsDistanceMedian() * 0.75};
+
+		std::cout << std::endl << "Results for " << queryIds.size() << " queries, recall@" << k << ":" << std::endl;
+
+		printResult("SOM", benchmark(queryIds, groundTruth, k, [&](std::size_t queryId)
+		{
+			Neighbours res;
+			std::vector<SOM::Position> searchedPositions {positions[queryId]};
+
+			auto addObjects {[&](const SOM::Position& position)
+			{
+				for (std::size_t id : matrix[position])
+				{
+					if (res.size() == k)
+						break;
+					if (id != queryId)
+						res.push_back(id);
+				}
+			}};
+
+			addObjects(searchedPositions.front());
+			while (res.size() < k)
+			{
+				const std::optional<SOM::Position> closestPosition {network.getClosestRefVectorPosition(searchedPositions, maxDistance)};
+				if (!closestPosition)
+					break;
+
+				searchedPositions.push_back(*closestPosition);
+				addObjects(*closestPosition);
+			}
+
+			return res;
+		}));
+
+		for (std::size_t efSearch : parseEfList(vm["ann-ef-search"].as<std::string>()))
+		{
+			printResult("HNSW (ef = " + std::to_string(efSearch) + ")", benchmark(queryIds, groundTruth, k, [&](std::size_t queryId)
+			{
+				Neighbours res;
+				for (const Ann::HnswIndex::SearchResult& searchResult : index.search(index.getValues(queryId), k + 1, efSearch))
+				{
+					if (searchResult.id != queryId && res.size() < k)
+						res.push_back(searchResult.id);
+				}
+
+				return res;
+			}));
+		}
+	}
+	catch (std::exception& e)
+	{
+		std::cerr << "Caught exception: " << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
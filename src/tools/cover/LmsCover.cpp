@@ -36,7 +36,7 @@
 
 static
 void
-dumpTrackCovers(Database::Session& session, CoverArt::ImageSize width)
+dumpTrackCovers(Database::Session& session, CoverArt::ImageSize width, CoverArt::ImageFormat format)
 {
 	std::vector<Database::TrackId> trackIds;
 	{
@@ -47,7 +47,24 @@ dumpTrackCovers(Database::Session& session, CoverArt::ImageSize width)
 	for (const Database::TrackId trackId : trackIds)
 	{
 		std::cout << "Getting cover for track id " << trackId.toString() << std::endl;
-		Service<CoverArt::IGrabber>::get()->getFromTrack(session, trackId, width);
+		Service<CoverArt::IGrabber>::get()->getFromTrack(session, trackId, width, format);
+	}
+}
+
+static
+void
+dumpReleaseCovers(Database::Session& session, CoverArt::ImageSize width, CoverArt::ImageFormat format)
+{
+	std::vector<Database::ReleaseId> releaseIds;
+	{
+		auto transaction {session.createSharedTransaction()};
+		releaseIds = Database::Release::getAllIds(session);
+	}
+
+	for (const Database::ReleaseId releaseId : releaseIds)
+	{
+		std::cout << "Getting cover for release id " << releaseId.toString() << std::endl;
+		Service<CoverArt::IGrabber>::get()->getFromRelease(session, releaseId, width, format);
 	}
 }
 
@@ -68,8 +85,11 @@ int main(int argc, char *argv[])
 		("conf,c", po::value<std::string>()->default_value("/etc/lms.conf"), "LMS config file")
         ("default-cover,d", po::value<std::string>(), "Default cover path")
         ("tracks,t", "dump covers for tracks")
+        ("releases,r", "dump covers for releases")
 		("size,s", po::value<unsigned>()->default_value(512), "Requested cover size")
 		("quality,q", po::value<unsigned>()->default_value(75), "JPEG quality (1-100)")
+		("webp-quality", po::value<unsigned>()->default_value(75), "WebP quality (1-100)")
+		("format,f", po::value<std::string>()->default_value("jpeg"), "Cover format (jpeg|webp)")
         ;
 
         po::variables_map vm;
@@ -87,14 +107,36 @@ int main(int argc, char *argv[])
 				vm["default-cover"].as<std::string>(),
 				config->getULong("cover-max-cache-size", 30) * 1000 * 1000,
 				config->getULong("cover-max-file-size", 10) * 1000 * 1000,
-				config->getULong("cover-jpeg-quality", vm["quality"].as<unsigned>())
+				config->getULong("cover-jpeg-quality", vm["quality"].as<unsigned>()),
+				config->getULong("cover-webp-quality", vm["webp-quality"].as<unsigned>()),
+				config->getPath("working-dir") / "cache" / "covers",
+				config->getULong("cover-disk-cache-max-size", 100) * 1000 * 1000
 				)};
 
+		CoverArt::ImageFormat format;
+		if (vm["format"].as<std::string>() == "jpeg")
+			format = CoverArt::ImageFormat::JPEG;
+		else if (vm["format"].as<std::string>() == "webp")
+			format = coverArtService->selectFormat("image/webp");
+		else
+			throw std::runtime_error {"Bad value '" + vm["format"].as<std::string>() + "' for 'format'"};
+
 		Database::Db db {config->getPath("working-dir") / "lms.db"};
 		Database::Session session {db};
 
 		if (vm.count("tracks"))
-			dumpTrackCovers(session, vm["size"].as<unsigned>());
+			dumpTrackCovers(session, vm["size"].as<unsigned>(), format);
+
+		// Covers are kept in the disk cache: this can be used to prewarm it
+		if (vm.count("releases"))
+			dumpReleaseCovers(session, vm["size"].as<unsigned>(), format);
+
+		const CoverArt::IGrabber::Stats stats {coverArtService->getStats()};
+		std::cout << "Memory cache: " << stats.memoryCache.entryCount << " entries, " << stats.memoryCache.size << " bytes, hits = " << stats.memoryCache.hits << ", misses = " << stats.memoryCache.misses
+			<< ", hit rate = " << stats.memoryCache.getHitRatePercent() << "%, evictions = " << stats.memoryCache.evictions << ", rejections = " << stats.memoryCache.rejections << std::endl;
+		if (stats.diskCache)
+			std::cout << "Disk cache: " << stats.diskCache->entryCount << " entries, " << stats.diskCache->size << " bytes, hits = " << stats.diskCache->hits << ", misses = " << stats.diskCache->misses
+				<< ", hit rate = " << stats.diskCache->getHitRatePercent() << "%" << std::endl;
 	}
 	catch( std::exception& e)
 	{
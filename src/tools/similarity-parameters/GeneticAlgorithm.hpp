@@ -17,7 +17,14 @@
  * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <iostream>
 #include <numeric>
+#include <optional>
 
 #include "utils/Random.hpp"
 
@@ -33,6 +40,15 @@ class GeneticAlgorithm
 		using MutateFunction = std::function<void(Individual&)>;
 		using ScoreFunction = std::function<Score(const Individual&)>;
 
+		struct ScoredIndividual
+		{
+			Individual individual;
+			std::optional<Score> score {};
+		};
+
+		// Called with the scored population, once per processed generation
+		using CheckpointFunction = std::function<void(std::size_t nextGeneration, const std::vector<ScoredIndividual>&)>;
+
 		struct Params
 		{
 			std::size_t		nbWorkers {1};
@@ -42,6 +58,7 @@ class GeneticAlgorithm
 			BreedFunction	breedFunction;
 			MutateFunction		mutateFunction;
 			ScoreFunction		scoreFunction;
+			CheckpointFunction	checkpointFunction;	// optional
 		};
 
 		GeneticAlgorithm(const Params& params);
@@ -49,14 +66,10 @@ class GeneticAlgorithm
 		// Returns the individual that has the maximum score after processing the requested generations
 		Individual simulate(const std::vector<Individual>& initialPopulation);
 
-	private:
-
-		struct ScoredIndividual
-		{
-			Individual individual;
-			std::optional<Score> score {};
-		};
+		// Same as simulate, using a population saved by the checkpoint function
+		Individual resume(std::vector<ScoredIndividual> population, std::size_t startGeneration);
 
+	private:
 		void scoreAndSortPopulation(std::vector<ScoredIndividual>& population);
 		Score getTotalScore(const std::vector<ScoredIndividual>& population) const;
 		typename std::vector<ScoredIndividual>::const_iterator pickRandomRouletteWheel(const std::vector<ScoredIndividual>& population, Score totalScore);
@@ -75,21 +88,31 @@ template<typename Individual>
 Individual
 GeneticAlgorithm<Individual>::simulate(const std::vector<Individual>& initialPopulation)
 {
-	const std::size_t childrenCountPerGeneration {static_cast<std::size_t>(initialPopulation.size() * _params.crossoverRatio)};
-	if (initialPopulation.size() < 10)
-		throw std::runtime_error("Initial population must has at least 10 elements");
-
 	std::vector<ScoredIndividual> scoredPopulation;
 	scoredPopulation.reserve(initialPopulation.size());
 
 	std::transform(std::cbegin(initialPopulation), std::cend(initialPopulation), std::back_inserter(scoredPopulation ),
 			[](const Individual& individual) { return ScoredIndividual {individual};});
 
+	return resume(std::move(scoredPopulation), 0);
+}
+
+template<typename Individual>
+Individual
+GeneticAlgorithm<Individual>::resume(std::vector<ScoredIndividual> scoredPopulation, std::size_t startGeneration)
+{
+	const std::size_t populationSize {scoredPopulation.size()};
+	const std::size_t childrenCountPerGeneration {static_cast<std::size_t>(populationSize * _params.crossoverRatio)};
+	if (populationSize < 10)
+		throw std::runtime_error("Initial population must has at least 10 elements");
+
 	scoreAndSortPopulation(scoredPopulation);
+	if (_params.checkpointFunction)
+		_params.checkpointFunction(startGeneration, scoredPopulation);
 
-	for (std::size_t currentGeneration {}; currentGeneration  < _params.nbGenerations; ++currentGeneration)
+	for (std::size_t currentGeneration {startGeneration}; currentGeneration  < _params.nbGenerations; ++currentGeneration)
 	{
-		assert(scoredPopulation.size() == initialPopulation.size());
+		assert(scoredPopulation.size() == populationSize);
 		std::cout << "Processing generation " << currentGeneration << "..." << std::endl;
 		std::cout << "Need to create " << childrenCountPerGeneration << " new children" << std::endl;
 
@@ -116,12 +139,14 @@ GeneticAlgorithm<Individual>::simulate(const std::vector<Individual>& initialPop
 		}
 
 		// Elitist selection
-		scoredPopulation.resize(initialPopulation.size() - childrenCountPerGeneration);
+		scoredPopulation.resize(populationSize - childrenCountPerGeneration);
 
 		scoredPopulation.insert(std::end(scoredPopulation), std::make_move_iterator(std::begin(children)), std::make_move_iterator(std::end(children)));
-		assert(scoredPopulation.size() == initialPopulation.size());
+		assert(scoredPopulation.size() == populationSize);
 
 		scoreAndSortPopulation(scoredPopulation);
+		if (_params.checkpointFunction)
+			_params.checkpointFunction(currentGeneration + 1, scoredPopulation);
 
 		std::cout << "Mean score = " << getTotalScore(scoredPopulation) / scoredPopulation.size() << std::endl;
 		std::cout << "Current best score = " << *scoredPopulation.front().score << std::endl;
@@ -19,23 +19,27 @@
 
 #include <iostream>
 #include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
 #include <string>
+#include <unordered_map>
 
 #include "database/Artist.hpp"
 #include "database/Cluster.hpp"
 #include "database/Db.hpp"
 #include "database/Release.hpp"
-#include "database/SessionPool.hpp"
+#include "database/Session.hpp"
 #include "database/Track.hpp"
 #include "database/TrackFeatures.hpp"
-#include "similarity/features/SimilarityFeaturesSearcher.hpp"
-#include "utils/Config.hpp"
+#include "features/FeaturesEngine.hpp"
+#include "utils/IConfig.hpp"
 #include "utils/Service.hpp"
-#include "utils/StreamLogger.hpp"
 
 #include "GeneticAlgorithm.hpp"
 
-using namespace Similarity;
+using namespace Recommendation;
 using SimilarityScore = GeneticAlgorithm<FeatureSettingsMap>::Score;
 
 // An individual is just a FeatureSettingsMap
@@ -160,11 +164,13 @@ const FeatureSettingsMap featuresSettings
 	{ "lowlevel.zerocrossingrate.var",		{1}},
 };
 
+using FeaturesCache = std::unordered_map<Database::TrackId, FeatureValuesMap>;
+
 static
-std::unordered_map<Database::IdType, FeatureValuesMap>
+FeaturesCache
 constructFeaturesCache(Database::Session& session, const FeatureSettingsMap& featureSettings)
 {
-	std::unordered_map<Database::IdType, FeatureValuesMap> cache;
+	FeaturesCache cache;
 
 	std::unordered_set<FeatureName> names;
 	std::transform(std::cbegin(featureSettings), std::cend(featureSettings), std::inserter(names, std::begin(names)),
@@ -172,7 +178,7 @@ constructFeaturesCache(Database::Session& session, const FeatureSettingsMap& fea
 
 	auto transaction {session.createSharedTransaction()};
 
-	for (auto trackId : Database::Track::getAllIdsWithFeatures(session))
+	for (const Database::TrackId trackId : Database::Track::getAllIdsWithFeatures(session))
 	{
 		const Database::Track::pointer track {Database::Track::getById(session, trackId)};
 		const Database::TrackFeatures::pointer trackFeatures {track->getTrackFeatures()};
@@ -185,7 +191,7 @@ constructFeaturesCache(Database::Session& session, const FeatureSettingsMap& fea
 
 static
 std::optional<FeatureValuesMap>
-getFeaturesFromCache(const std::unordered_map<Database::IdType, FeatureValuesMap>& cache, Database::IdType trackId, const FeatureNames& names)
+getFeaturesFromCache(const FeaturesCache& cache, Database::TrackId trackId, const FeatureNames& names)
 {
 	std::optional<FeatureValuesMap> res;
 
@@ -222,7 +228,7 @@ printFeatureSettingsMap(const FeatureSettingsMap& featureSettings)
 
 static
 std::string
-trackToString(Database::Session& session, Database::IdType trackId)
+trackToString(Database::Session& session, Database::TrackId trackId)
 {
 	std::string res;
 	auto transaction {session.createSharedTransaction()};
@@ -231,7 +237,7 @@ trackToString(Database::Session& session, Database::IdType trackId)
 	res += track->getName();
 	if (track->getRelease())
 		res += " [" + track->getRelease()->getName() + "]";
-	for (auto artist : track->getArtists())
+	for (auto artist : track->getArtists({Database::TrackArtistLinkType::Artist}))
 		res += " - " + artist->getName();
 	for (auto cluster : track->getClusters())
 		res += " {" + cluster->getType()->getName() + "-"+ cluster->getName() + "}";
@@ -241,7 +247,7 @@ trackToString(Database::Session& session, Database::IdType trackId)
 
 static
 SimilarityScore
-computeTrackScore(Database::Session& session, Database::IdType track1Id, Database::IdType track2Id)
+computeTrackScore(Database::Session& session, Database::TrackId track1Id, Database::TrackId track2Id)
 {
 	SimilarityScore score {};
 
@@ -255,10 +261,12 @@ computeTrackScore(Database::Session& session, Database::IdType track1Id, Databas
 
 	// Artists in common
 	{
-		auto track1ArtistIds {track1->getArtistIds()};
-		auto track2ArtistIds {track2->getArtistIds()};
+		auto track1ArtistIds {track1->getArtistIds({Database::TrackArtistLinkType::Artist})};
+		auto track2ArtistIds {track2->getArtistIds({Database::TrackArtistLinkType::Artist})};
+		std::sort(std::begin(track1ArtistIds), std::end(track1ArtistIds));
+		std::sort(std::begin(track2ArtistIds), std::end(track2ArtistIds));
 
-		std::vector<Database::IdType> commonArtistIds;
+		std::vector<Database::ArtistId> commonArtistIds;
 		std::set_intersection(std::cbegin(track1ArtistIds), std::cend(track1ArtistIds),
 				std::cbegin(track2ArtistIds), std::cend(track2ArtistIds),
 				std::back_inserter(commonArtistIds));
@@ -270,8 +278,10 @@ computeTrackScore(Database::Session& session, Database::IdType track1Id, Databas
 	{
 		auto track1ClusterIds {track1->getClusterIds()};
 		auto track2ClusterIds {track2->getClusterIds()};
+		std::sort(std::begin(track1ClusterIds), std::end(track1ClusterIds));
+		std::sort(std::begin(track2ClusterIds), std::end(track2ClusterIds));
 
-		std::vector<Database::IdType> commonClusterIds;
+		std::vector<Database::ClusterId> commonClusterIds;
 		std::set_intersection(std::cbegin(track1ClusterIds), std::cend(track1ClusterIds),
 				std::cbegin(track2ClusterIds), std::cend(track2ClusterIds),
 				std::back_inserter(commonClusterIds));
@@ -284,27 +294,27 @@ computeTrackScore(Database::Session& session, Database::IdType track1Id, Databas
 
 static
 SimilarityScore
-computeSimilarityScore(Database::Session& session, FeaturesSearcher::TrainSettings trainSettings)
+computeSimilarityScore(Database::Session& session, const FeaturesEngine::TrainSettings& trainSettings)
 {
-	std::cout << "Compute score of: ";
-	printFeatureSettingsMap(trainSettings.featureSettingsMap);
-	std::cout << std::endl;
+	FeaturesEngine engine;
+	if (!engine.loadFromTraining(session, trainSettings, {}))
+		return {};
 
-	FeaturesSearcher searcher {session, trainSettings};
+	const IClassifier& classifier {engine};
 
-	const std::vector<Database::IdType> trackIds = std::invoke([&]()
+	const std::vector<Database::TrackId> trackIds = std::invoke([&]()
 			{
 				auto transaction {session.createSharedTransaction()};
 				return Database::Track::getAllIdsWithFeatures(session);
 			});
 
 	SimilarityScore score {};
-	for (Database::IdType trackId : trackIds)
+	for (Database::TrackId trackId : trackIds)
 	{
 		constexpr std::size_t nbSimilarTracks {3};
 //		std::cout << "Processing track '" << trackToString(session, trackId) << "'" << std::endl;
 		SimilarityScore factor {1};		
-		for (Database::IdType similarTrackId : searcher.getSimilarTracks({trackId}, nbSimilarTracks))
+		for (Database::TrackId similarTrackId : classifier.getSimilarTracks(session, {trackId}, nbSimilarTracks))
 		{
 			SimilarityScore trackScore {computeTrackScore(session, trackId, similarTrackId)};
 //			std::cout << "\tScore = " << trackScore << " (*" << factor << ") with track '" << trackToString(session, similarTrackId) << "'" << std::endl;
@@ -315,28 +325,144 @@ computeSimilarityScore(Database::Session& session, FeaturesSearcher::TrainSettin
 		}
 	}
 
-	std::cout << "Total score = " << score << std::endl;
-
 	return score;
 }
 
+// Individuals are often evaluated several times (survivors, children identical to a parent, ...)
+// and each evaluation requires a whole training: keep all the scores, shared by all the workers
+class ScoreCache
+{
+	public:
+		using Key = std::vector<FeatureName>;
+
+		static Key createKey(const FeatureSettingsMap& featureSettings)
+		{
+			Key res;
+			std::transform(std::cbegin(featureSettings), std::cend(featureSettings), std::back_inserter(res),
+					[](const auto& itFeature) { return itFeature.first; });
+			std::sort(std::begin(res), std::end(res));
+
+			return res;
+		}
+
+		std::optional<SimilarityScore> get(const Key& key) const
+		{
+			std::scoped_lock lock {_mutex};
+
+			auto it {_scores.find(key)};
+			if (it == std::cend(_scores))
+				return std::nullopt;
+
+			return it->second;
+		}
+
+		void set(const Key& key, SimilarityScore score)
+		{
+			std::scoped_lock lock {_mutex};
+			_scores[key] = score;
+		}
+
+	private:
+		mutable std::mutex _mutex;
+		std::map<Key, SimilarityScore> _scores;
+};
+
+using ScoredPopulation = std::vector<GeneticAlgorithm<FeatureSettingsMap>::ScoredIndividual>;
+
+// Checkpoint format:
+// generation <next generation>
+// <score> <feature name>... (one line per individual)
+static
+void
+writeCheckpoint(const std::filesystem::path& path, std::size_t nextGeneration, const ScoredPopulation& population)
+{
+	// Write in a temporary file to not lose the previous checkpoint if interrupted
+	const std::filesystem::path tmpPath {path.string() + ".tmp"};
+	{
+		std::ofstream ofs {tmpPath, std::ios::trunc};
+		ofs << "generation " << nextGeneration << "\n";
+		for (const auto& scoredIndividual : population)
+		{
+			ofs << *scoredIndividual.score;
+			for (const FeatureName& name : ScoreCache::createKey(scoredIndividual.individual))
+				ofs << " " << name;
+			ofs << "\n";
+		}
+
+		if (!ofs)
+		{
+			std::cerr << "Cannot write checkpoint '" << tmpPath.string() << "'" << std::endl;
+			return;
+		}
+	}
+
+	std::filesystem::rename(tmpPath, path);
+}
+
+static
+std::optional<std::pair<std::size_t, ScoredPopulation>>
+readCheckpoint(const std::filesystem::path& path)
+{
+	std::ifstream ifs {path};
+	if (!ifs)
+		return std::nullopt;
+
+	std::string keyword;
+	std::size_t nextGeneration;
+	if (!(ifs >> keyword >> nextGeneration) || keyword != "generation")
+		throw std::runtime_error {"Bad checkpoint file '" + path.string() + "'"};
+
+	ScoredPopulation population;
+
+	std::string line;
+	while (std::getline(ifs, line))
+	{
+		std::istringstream iss {line};
+
+		SimilarityScore score;
+		if (!(iss >> score))
+			continue;
+
+		FeatureSettingsMap featureSettings;
+		std::string name;
+		while (iss >> name)
+		{
+			auto itFeatureSettings {featuresSettings.find(name)};
+			if (itFeatureSettings == std::cend(featuresSettings))
+				throw std::runtime_error {"Unknown feature '" + name + "' in checkpoint file"};
+
+			featureSettings.emplace(*itFeatureSettings);
+		}
+
+		population.push_back({std::move(featureSettings), score});
+	}
+
+	return std::make_pair(nextGeneration, std::move(population));
+}
+
 static
 void
-printBadlyClassifiedTracks(Database::Session& session, FeaturesSearcher::TrainSettings trainSettings)
+printBadlyClassifiedTracks(Database::Session& session, const FeaturesEngine::TrainSettings& trainSettings)
 {
-	
-	FeaturesSearcher searcher {session, trainSettings};
+	FeaturesEngine engine;
+	if (!engine.loadFromTraining(session, trainSettings, {}))
+	{
+		std::cerr << "Cannot train features engine" << std::endl;
+		return;
+	}
 
-	const std::vector<Database::IdType> trackIds = std::invoke([&]()
+	const IClassifier& classifier {engine};
+
+	const std::vector<Database::TrackId> trackIds = std::invoke([&]()
 			{
 				auto transaction {session.createSharedTransaction()};
 				return Database::Track::getAllIdsWithFeatures(session);
 			});
 
-	for (Database::IdType trackId : trackIds)
+	for (Database::TrackId trackId : trackIds)
 	{
 		constexpr std::size_t nbSimilarTracks {3};
-		for (Database::IdType similarTrackId : searcher.getSimilarTracks({trackId}, nbSimilarTracks))
+		for (Database::TrackId similarTrackId : classifier.getSimilarTracks(session, {trackId}, nbSimilarTracks))
 		{
 			SimilarityScore trackScore {computeTrackScore(session, trackId, similarTrackId)};
 			if (trackScore == 0)
@@ -386,29 +512,29 @@ int main(int argc, char *argv[])
 	{
 
 		// log to stdout
-//		ServiceProvider<Logger>::create<StreamLogger>(std::cout);
+//		Service<Logger> logger {std::make_unique<StreamLogger>(std::cout)};
 
-		if (argc != 3)
+		if (argc != 3 && argc != 4)
 		{
-			std::cerr << "usage: <lms_conf_file> <nb_workers>" << std::endl;
+			std::cerr << "usage: <lms_conf_file> <nb_workers> [checkpoint_file]" << std::endl;
 			return EXIT_FAILURE;
 		}
 
 		const std::filesystem::path configFilePath {std::string(argv[1], 0, 256)};
 		const std::size_t nbWorkers = atoi(argv[2]);
+		const std::optional<std::filesystem::path> checkpointFilePath {argc == 4 ? std::make_optional<std::filesystem::path>(argv[3]) : std::nullopt};
 
-		ServiceProvider<Config>::create(configFilePath);
+		Service<IConfig> config {createConfig(configFilePath)};
 
-		Database::Db db {ServiceProvider<Config>::get()->getPath("working-dir") / "lms.db"};
-		Database::SessionPool sessionPool {db, nbWorkers};
+		Database::Db db {config->getPath("working-dir") / "lms.db"};
 
 		std::cout << "Caching all features..." << std::endl;
 		// Cache all the features of all the music in order to speed up the multiple trainings
-		const auto cachedFeatures { constructFeaturesCache(Database::SessionPool::ScopedSession {sessionPool}.get(), featuresSettings) };
+		const FeaturesCache cachedFeatures {constructFeaturesCache(db.getTLSSession(), featuresSettings)};
 		std::cout << "Caching all features DONE" << std::endl;
 
-		FeaturesSearcher::setFeaturesFetchFunc(
-				[&](Database::IdType trackId, const FeatureNames& featureNames)
+		FeaturesEngine::setFeaturesFetchFunc(
+				[&](Database::TrackId trackId, const FeatureNames& featureNames)
 				{
 					return getFeaturesFromCache(cachedFeatures, trackId, featureNames);
 				});
@@ -432,7 +558,7 @@ int main(int argc, char *argv[])
 			initialPopulation.emplace_back(std::move(settings));
 		}
 
-		FeaturesSearcher::TrainSettings trainSettings;
+		FeaturesEngine::TrainSettings trainSettings;
 		trainSettings.iterationCount = 8;
 		trainSettings.sampleCountPerNeuron = 1.5;
 
@@ -443,16 +569,41 @@ int main(int argc, char *argv[])
 		params.mutationProbability = 0.2;
 		params.breedFunction = breedFeatureSettingsMap;
 		params.mutateFunction = mutateFeatureSettingsMap;
+		ScoreCache scoreCache;
 		params.scoreFunction =
 			[&](const FeatureSettingsMap& featureSettings)
 			{
-				FeaturesSearcher::TrainSettings settings {trainSettings};
+				const ScoreCache::Key key {ScoreCache::createKey(featureSettings)};
+				if (std::optional<SimilarityScore> score {scoreCache.get(key)})
+					return *score;
+
+				FeaturesEngine::TrainSettings settings {trainSettings};
 				settings.featureSettingsMap = featureSettings;
 
-				Database::SessionPool::ScopedSession scopedSession {sessionPool};
-				return computeSimilarityScore(scopedSession.get(), settings);
+				// one session per worker thread
+				const SimilarityScore score {computeSimilarityScore(db.getTLSSession(), settings)};
+				scoreCache.set(key, score);
+
+				// single output to not get mixed up with other workers
+				std::ostringstream oss;
+				oss << "Score = " << score << " for";
+				for (const FeatureName& name : key)
+					oss << " " << name;
+				oss << "\n";
+				std::cout << oss.str() << std::flush;
+
+				return score;
 			};
 
+		if (checkpointFilePath)
+		{
+			params.checkpointFunction =
+				[&](std::size_t nextGeneration, const ScoredPopulation& population)
+				{
+					writeCheckpoint(*checkpointFilePath, nextGeneration, population);
+				};
+		}
+
 		GeneticAlgorithm<FeatureSettingsMap> geneticAlgorithm {params};
 
 		std::cout << "Parameters:\n"
@@ -464,18 +615,33 @@ int main(int argc, char *argv[])
 			<< "\tmutationProbability = " << params.mutationProbability << "\n"
 			<< std::endl;
 			
-		std::cout << "Starting simulation..." << std::endl;
-		const FeatureSettingsMap selectedSettings {geneticAlgorithm.simulate(initialPopulation)};
+		std::optional<std::pair<std::size_t, ScoredPopulation>> checkpoint;
+		if (checkpointFilePath)
+			checkpoint = readCheckpoint(*checkpointFilePath);
+
+		FeatureSettingsMap selectedSettings;
+		if (checkpoint)
+		{
+			std::cout << "Resuming simulation from generation " << checkpoint->first << "..." << std::endl;
+			for (const auto& scoredIndividual : checkpoint->second)
+				scoreCache.set(ScoreCache::createKey(scoredIndividual.individual), *scoredIndividual.score);
+
+			selectedSettings = geneticAlgorithm.resume(std::move(checkpoint->second), checkpoint->first);
+		}
+		else
+		{
+			std::cout << "Starting simulation..." << std::endl;
+			selectedSettings = geneticAlgorithm.simulate(initialPopulation);
+		}
 		std::cout << "Simulation complete! Best result:" << std::endl;
 		printFeatureSettingsMap(selectedSettings);
 
 		// print all badly classified tracks
 		{
-			FeaturesSearcher::TrainSettings settings {trainSettings};
+			FeaturesEngine::TrainSettings settings {trainSettings};
 			settings.featureSettingsMap = selectedSettings;
 
-			Database::SessionPool::ScopedSession scopedSession {sessionPool};
-			printBadlyClassifiedTracks(scopedSession.get(), settings);
+			printBadlyClassifiedTracks(db.getTLSSession(), settings);
 		}
 	}
 	catch (std::exception& e)
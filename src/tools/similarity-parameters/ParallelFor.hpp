@@ -17,31 +17,65 @@
  * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <functional>
+#pragma once
+
+#include <atomic>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
 #include <thread>
-#include <boost/asio/io_context.hpp>
+#include <vector>
 
+// Calls func on each element, using nbWorkers threads (the calling thread being one of them)
+// Elements are handed out one at a time from a shared counter: a worker that is done
+// immediately picks the next remaining element, so that long jobs do not stall the others
+// The first exception thrown by func is rethrown once all the workers are done
 template <typename It, typename Func>
 void parallel_foreach(std::size_t nbWorkers, It begin, It end, Func&& func)
 {
 	if (nbWorkers == 0)
 		throw std::runtime_error("Invalid worker count");
 
-	boost::asio::io_context ioContext;
+	const std::size_t count {static_cast<std::size_t>(std::distance(begin, end))};
+	std::atomic<std::size_t> nextIndex {};
+
+	std::mutex exceptionMutex;
+	std::exception_ptr exception;
 
-	for (It it {begin}; it != end; ++it)
+	auto worker {[&]()
 	{
-		auto refValue {std::ref<typename It::value_type>(*it)};
-		ioContext.post([refValue, &func]() { std::cout << "EXEC FROM WORKER" << std::endl; func(refValue); std::cout << "END EXEC FROM WORKER" << std::endl; });
-	}
+		while (true)
+		{
+			const std::size_t index {nextIndex++};
+			if (index >= count)
+				break;
+
+			try
+			{
+				func(*std::next(begin, index));
+			}
+			catch (...)
+			{
+				std::scoped_lock lock {exceptionMutex};
+				if (!exception)
+					exception = std::current_exception();
+
+				// no need to process the remaining elements
+				nextIndex = count;
+			}
+		}
+	}};
 
 	std::vector<std::thread> threads;
-	for (std::size_t i {}; i < nbWorkers - 1; ++i)
-		threads.emplace_back([&]() { ioContext.run(); });
+	for (std::size_t i {1}; i < std::min(nbWorkers, count); ++i)
+		threads.emplace_back(worker);
 
-	ioContext.run();
+	worker();
 
 	for (std::thread& t : threads)
 		t.join();
-}
 
+	if (exception)
+		std::rethrow_exception(exception);
+}